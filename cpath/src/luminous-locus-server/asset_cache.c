@@ -0,0 +1,580 @@
+/*
+ * Luminous Locus Asset Cache Module
+ * Content-addressed snapshot of the asset root
+ *
+ * At startup every regular file under the root is mapped read-only and
+ * hashed; the hash becomes the file's strong ETag. Files that compress
+ * get a gzip copy built once here, or use the .gz/.br shipped next to
+ * them when there is one, so no request ever compresses anything. The
+ * table is never modified after it is built, so the server thread reads
+ * it without locks. Files added or changed later are not seen until the
+ * server restarts; they are still served from disk, without validators.
+ * Built over an asset pack instead, the entries point into the pack's
+ * mapping and take their hashes from its index, so startup opens one
+ * file and hashes nothing.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <strings.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "deflate.h"
+#include "asset_pack.h"
+#include "asset_cache.h"
+
+/* Deepest directory nesting walked */
+#define MAX_DEPTH 16
+
+/* Longest path below the root */
+#define PATH_MAX_LENGTH 1024
+
+/* A variant is only kept when it is at most this share of the original, in percent */
+#define VARIANT_MAX_PERCENT 90
+
+/* Quoted hex hash plus an encoding suffix */
+#define ETAG_SIZE 24
+
+struct AssetEntry {
+    char* Path;
+    const char* Type;
+    uint64_t Hash;
+    void* Mapping;              /* whole file, NULL when empty */
+    char* Compressed;           /* gzip built at startup, owned */
+    AssetBody Bodies[ASSET_ENCODING_COUNT];  /* Data NULL for a missing variant, identity always present */
+    char Tags[ASSET_ENCODING_COUNT][ETAG_SIZE];
+};
+
+struct AssetCache {
+    AssetEntry* Entries;
+    int Count;
+    int Capacity;
+    int* Table;                 /* open addressing over Entries, -1 when empty */
+    size_t TableMask;
+    AssetCacheStats Stats;
+};
+
+/* Encoding tokens and ETag suffixes, indexed by AssetEncoding */
+static const char* const g_encoding_names[ASSET_ENCODING_COUNT] = {NULL, "gzip", "br"};
+static const char* const g_encoding_suffixes[ASSET_ENCODING_COUNT] = {"", "-gz", "-br"};
+
+/* Extensions whose content is already compressed */
+static const char* const g_compressed_extensions[] = {".dmi", ".png", ".jpg", ".jpeg", ".ogg", ".gz", ".br"};
+
+/* Monotonic milliseconds */
+static int64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Little-endian 64-bit load */
+static uint64_t load64(const unsigned char* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    value = __builtin_bswap64(value);
+#endif
+    return value;
+}
+
+/* Rotate left */
+static uint64_t rotl64(uint64_t value, int bits) {
+    return value << bits | value >> (64 - bits);
+}
+
+/* Hash content, 8 bytes per round with a full avalanche at the end */
+uint64_t asset_hash64(const void* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ ((uint64_t)length * 0xc2b2ae3d27d4eb4full);
+    while (length >= 8) {
+        hash ^= rotl64(load64(p) * 0x87c37b91114253d5ull, 31) * 0x4cf5ad432745937full;
+        hash = rotl64(hash, 27) * 5 + 0x52dce729;
+        p += 8;
+        length -= 8;
+    }
+    uint64_t tail = 0;
+    for (size_t i = 0; i < length; i++) {
+        tail |= (uint64_t)p[i] << (8 * i);
+    }
+    hash ^= rotl64(tail * 0x87c37b91114253d5ull, 31) * 0x4cf5ad432745937full;
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/* Content type from the file extension */
+const char* asset_content_type(const char* path) {
+    static const struct {
+        const char* Extension;
+        const char* Type;
+    } types[] = {
+        {".dmi", "image/png"},
+        {".png", "image/png"},
+        {".jpg", "image/jpeg"},
+        {".ogg", "audio/ogg"},
+        {".wav", "audio/wav"},
+        {".json", "application/json"},
+        {".txt", "text/plain; charset=utf-8"},
+    };
+    const char* dot = path != NULL ? strrchr(path, '.') : NULL;
+    if (dot != NULL && strchr(dot, '/') == NULL) {
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+            if (strcasecmp(dot, types[i].Extension) == 0) {
+                return types[i].Type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+/* Whether the path ends with suffix */
+static bool has_suffix(const char* path, const char* suffix) {
+    size_t length = strlen(path);
+    size_t suffix_length = strlen(suffix);
+    return length >= suffix_length && strcasecmp(path + length - suffix_length, suffix) == 0;
+}
+
+/* Whether compressing the file is pointless */
+static bool already_compressed(const char* path) {
+    for (size_t i = 0; i < sizeof(g_compressed_extensions) / sizeof(g_compressed_extensions[0]); i++) {
+        if (has_suffix(path, g_compressed_extensions[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Append an entry for bytes that stay valid while the cache lives, false when out of memory */
+static AssetEntry* append_entry(AssetCache* cache, const char* path, const char* data, size_t length) {
+    if (cache->Count == cache->Capacity) {
+        int capacity = cache->Capacity > 0 ? cache->Capacity * 2 : 256;
+        AssetEntry* entries = (AssetEntry*)realloc(cache->Entries, capacity * sizeof(AssetEntry));
+        if (entries == NULL) {
+            return NULL;
+        }
+        cache->Entries = entries;
+        cache->Capacity = capacity;
+    }
+    AssetEntry* entry = &cache->Entries[cache->Count];
+    memset(entry, 0, sizeof(AssetEntry));
+    entry->Path = strdup(path);
+    if (entry->Path == NULL) {
+        return NULL;
+    }
+    entry->Type = asset_content_type(path);
+    entry->Bodies[ASSET_ENCODING_IDENTITY].Data = data != NULL ? data : "";
+    entry->Bodies[ASSET_ENCODING_IDENTITY].Length = length;
+    cache->Count++;
+    cache->Stats.Bytes += (int64_t)length;
+    return entry;
+}
+
+/* Map one file and add it, false only when out of memory */
+static bool add_file(void* data, int dir_fd, const char* name, const char* path, int64_t size) {
+    AssetCache* cache = (AssetCache*)data;
+    if (size > ASSET_CACHE_FILE_MAX || cache->Stats.Bytes + size > ASSET_CACHE_TOTAL_MAX) {
+        return true;
+    }
+    void* mapping = NULL;
+    if (size > 0) {
+        int fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return true;
+        }
+        mapping = mmap(NULL, (size_t)size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (mapping == MAP_FAILED) {
+            return true;
+        }
+    }
+
+    AssetEntry* entry = append_entry(cache, path, (const char*)mapping, (size_t)size);
+    if (entry == NULL) {
+        if (mapping != NULL) {
+            munmap(mapping, (size_t)size);
+        }
+        return false;
+    }
+    entry->Mapping = mapping;
+    entry->Hash = asset_hash64(entry->Bodies[ASSET_ENCODING_IDENTITY].Data, (size_t)size);
+    return true;
+}
+
+/* Walk a directory, path is its location below the root ("" for the root); closes dir_fd */
+static bool walk(int dir_fd, const char* path, int depth, AssetWalkHandler handler, void* data) {
+    DIR* dir = fdopendir(dir_fd);
+    if (dir == NULL) {
+        close(dir_fd);
+        return true;
+    }
+    bool ok = true;
+    struct dirent* item;
+    while (ok && (item = readdir(dir)) != NULL) {
+        /* Dotfiles are never assets, and this also skips . and .. */
+        if (item->d_name[0] == '.') {
+            continue;
+        }
+        char child[PATH_MAX_LENGTH];
+        int length = snprintf(child, sizeof(child), "%s%s%s", path, path[0] != '\0' ? "/" : "", item->d_name);
+        if (length < 0 || (size_t)length >= sizeof(child)) {
+            continue;
+        }
+        struct stat st;
+        if (fstatat(dirfd(dir), item->d_name, &st, 0) < 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode) && depth < MAX_DEPTH) {
+            int child_fd = openat(dirfd(dir), item->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (child_fd >= 0) {
+                ok = walk(child_fd, child, depth + 1, handler, data);
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            ok = handler(data, dirfd(dir), item->d_name, child, (int64_t)st.st_size);
+        }
+    }
+    closedir(dir);
+    return ok;
+}
+
+/* Walk the files below a root */
+bool asset_walk(int root_fd, AssetWalkHandler handler, void* data) {
+    if (handler == NULL) {
+        return false;
+    }
+    /* The walk closes the fd it is given, so hand it a copy */
+    int dir_fd = openat(root_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return dir_fd >= 0 && walk(dir_fd, "", 0, handler, data);
+}
+
+/* Slot of a path in the table, the empty slot it would take when absent */
+static size_t find_slot(const AssetCache* cache, const char* path) {
+    size_t slot = (size_t)asset_hash64(path, strlen(path)) & cache->TableMask;
+    while (cache->Table[slot] >= 0 && strcmp(cache->Entries[cache->Table[slot]].Path, path) != 0) {
+        slot = (slot + 1) & cache->TableMask;
+    }
+    return slot;
+}
+
+/* Index every entry by path */
+static bool build_table(AssetCache* cache) {
+    size_t capacity = 16;
+    while (capacity < (size_t)cache->Count * 2) {
+        capacity *= 2;
+    }
+    cache->Table = (int*)malloc(capacity * sizeof(int));
+    if (cache->Table == NULL) {
+        return false;
+    }
+    memset(cache->Table, 0xff, capacity * sizeof(int));
+    cache->TableMask = capacity - 1;
+    for (int i = 0; i < cache->Count; i++) {
+        cache->Table[find_slot(cache, cache->Entries[i].Path)] = i;
+    }
+    return true;
+}
+
+/* Use a shipped sibling as a variant, true when there was one */
+static bool adopt_sibling(AssetCache* cache, AssetEntry* entry, int encoding, const char* extension) {
+    char path[PATH_MAX_LENGTH];
+    if ((size_t)snprintf(path, sizeof(path), "%s%s", entry->Path, extension) >= sizeof(path)) {
+        return false;
+    }
+    int index = cache->Table[find_slot(cache, path)];
+    if (index < 0 || cache->Entries[index].Bodies[ASSET_ENCODING_IDENTITY].Length == 0) {
+        return false;
+    }
+    entry->Bodies[encoding] = cache->Entries[index].Bodies[ASSET_ENCODING_IDENTITY];
+    return true;
+}
+
+/* Gzip a file when that is worth keeping */
+char* asset_gzip_variant(const char* path, const void* data, size_t length, size_t* variant_length) {
+    if (path == NULL || data == NULL || variant_length == NULL || length == 0 || already_compressed(path)) {
+        return NULL;
+    }
+    size_t capacity = gzip_bound(length);
+    char* out = (char*)malloc(capacity);
+    if (out == NULL) {
+        return NULL;
+    }
+    size_t compressed = gzip_compress(data, length, out, capacity);
+    if (compressed == 0 || compressed * 100 > length * VARIANT_MAX_PERCENT) {
+        free(out);
+        return NULL;
+    }
+    char* shrunk = (char*)realloc(out, compressed);
+    *variant_length = compressed;
+    return shrunk != NULL ? shrunk : out;
+}
+
+/* Build gzip for a file that has no shipped one */
+static void compress_entry(AssetEntry* entry) {
+    const AssetBody* identity = &entry->Bodies[ASSET_ENCODING_IDENTITY];
+    size_t length = 0;
+    entry->Compressed = asset_gzip_variant(entry->Path, identity->Data, identity->Length, &length);
+    if (entry->Compressed != NULL) {
+        entry->Bodies[ASSET_ENCODING_GZIP].Data = entry->Compressed;
+        entry->Bodies[ASSET_ENCODING_GZIP].Length = length;
+    }
+}
+
+/* Attach variants and validators to every entry, compress builds missing gzip copies */
+static void finish_entries(AssetCache* cache, bool compress) {
+    for (int i = 0; i < cache->Count; i++) {
+        AssetEntry* entry = &cache->Entries[i];
+        if (!adopt_sibling(cache, entry, ASSET_ENCODING_GZIP, ".gz") && compress) {
+            compress_entry(entry);
+        }
+        adopt_sibling(cache, entry, ASSET_ENCODING_BR, ".br");
+
+        for (int encoding = 0; encoding < ASSET_ENCODING_COUNT; encoding++) {
+            AssetBody* body = &entry->Bodies[encoding];
+            snprintf(entry->Tags[encoding], ETAG_SIZE, "\"%016llx%s\"", (unsigned long long)entry->Hash,
+                     g_encoding_suffixes[encoding]);
+            body->Encoding = g_encoding_names[encoding];
+            body->ETag = entry->Tags[encoding];
+            if (encoding != ASSET_ENCODING_IDENTITY && body->Data != NULL) {
+                cache->Stats.VariantBytes += (int64_t)body->Length;
+                cache->Stats.VariantSaved +=
+                    (int64_t)entry->Bodies[ASSET_ENCODING_IDENTITY].Length - (int64_t)body->Length;
+            }
+        }
+    }
+}
+
+/* Build the cache */
+AssetCache* asset_cache_create(int root_fd) {
+    AssetCache* cache = (AssetCache*)calloc(1, sizeof(AssetCache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    int64_t start = monotonic_ms();
+    if (!asset_walk(root_fd, add_file, cache) || !build_table(cache)) {
+        asset_cache_free(cache);
+        return NULL;
+    }
+    finish_entries(cache, true);
+
+    cache->Stats.Files = cache->Count;
+    cache->Stats.BuildMs = monotonic_ms() - start;
+    return cache;
+}
+
+/* Build the cache over a pack */
+AssetCache* asset_cache_create_from_pack(const AssetPack* pack) {
+    if (pack == NULL) {
+        return NULL;
+    }
+    AssetCache* cache = (AssetCache*)calloc(1, sizeof(AssetCache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    int64_t start = monotonic_ms();
+    for (uint32_t i = 0; i < asset_pack_count(pack); i++) {
+        const AssetPackEntry* packed = asset_pack_entry_at(pack, i);
+        AssetEntry* entry = append_entry(cache, asset_pack_entry_path(pack, packed),
+                                         asset_pack_entry_data(pack, packed), (size_t)packed->Length);
+        if (entry == NULL) {
+            asset_cache_free(cache);
+            return NULL;
+        }
+        entry->Hash = packed->ContentHash;
+    }
+
+    /* The pack itself, so a client can take all of it, or ranges of it, in one request */
+    size_t length = 0;
+    const char* bytes = asset_pack_bytes(pack, &length);
+    AssetEntry* whole = append_entry(cache, ASSET_PACK_URL_PATH, bytes, length);
+    if (whole == NULL || !build_table(cache)) {
+        asset_cache_free(cache);
+        return NULL;
+    }
+    whole->Hash = asset_pack_hash(pack);
+    /* Its bytes are the entries' bytes, do not count them twice */
+    cache->Stats.Bytes -= (int64_t)length;
+
+    /* Gzip copies were made by the builder, nothing is compressed here */
+    finish_entries(cache, false);
+    cache->Stats.Files = cache->Count;
+    cache->Stats.BuildMs = monotonic_ms() - start;
+    return cache;
+}
+
+/* Free cache */
+void asset_cache_free(AssetCache* cache) {
+    if (cache != NULL) {
+        for (int i = 0; i < cache->Count; i++) {
+            AssetEntry* entry = &cache->Entries[i];
+            if (entry->Mapping != NULL) {
+                munmap(entry->Mapping, entry->Bodies[ASSET_ENCODING_IDENTITY].Length);
+            }
+            free(entry->Compressed);
+            free(entry->Path);
+        }
+        free(cache->Entries);
+        free(cache->Table);
+        free(cache);
+    }
+}
+
+/* Look up a file */
+const AssetEntry* asset_cache_find(const AssetCache* cache, const char* path) {
+    if (cache == NULL || cache->Table == NULL || path == NULL) {
+        return NULL;
+    }
+    int index = cache->Table[find_slot(cache, path)];
+    return index >= 0 ? &cache->Entries[index] : NULL;
+}
+
+/* Get build summary */
+void asset_cache_get_stats(const AssetCache* cache, AssetCacheStats* stats) {
+    if (stats == NULL) {
+        return;
+    }
+    if (cache == NULL) {
+        memset(stats, 0, sizeof(AssetCacheStats));
+        return;
+    }
+    *stats = cache->Stats;
+}
+
+/* Get content type */
+const char* asset_entry_type(const AssetEntry* entry) {
+    return entry != NULL ? entry->Type : "application/octet-stream";
+}
+
+/* Check for variants */
+bool asset_entry_has_variants(const AssetEntry* entry) {
+    if (entry == NULL) {
+        return false;
+    }
+    for (int encoding = 1; encoding < ASSET_ENCODING_COUNT; encoding++) {
+        if (entry->Bodies[encoding].Data != NULL) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Quality an Accept-Encoding value gives each coding, 0 when refused.
+ * Codings it does not name take the quality of "*", or 0 without one.
+ */
+static void parse_accept_encoding(const char* value, int* quality) {
+    int named[ASSET_ENCODING_COUNT] = {0};
+    int wildcard = 0;
+    const char* p = value;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        const char* token = p;
+        while (*p != '\0' && *p != ',' && *p != ';' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        size_t token_length = (size_t)(p - token);
+        int q = 1000;
+        while (*p != '\0' && *p != ',') {
+            if (*p == ';') {
+                const char* param = p + 1;
+                while (*param == ' ' || *param == '\t') {
+                    param++;
+                }
+                if ((param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+                    q = (int)(strtod(param + 2, NULL) * 1000.0);
+                }
+            }
+            p++;
+        }
+        if (token_length == 1 && token[0] == '*') {
+            wildcard = q > 0 ? q : -1;
+            continue;
+        }
+        for (int encoding = 1; encoding < ASSET_ENCODING_COUNT; encoding++) {
+            if (strlen(g_encoding_names[encoding]) == token_length &&
+                strncasecmp(token, g_encoding_names[encoding], token_length) == 0) {
+                named[encoding] = q > 0 ? q : -1;
+            }
+        }
+    }
+    for (int encoding = 1; encoding < ASSET_ENCODING_COUNT; encoding++) {
+        int q = named[encoding] != 0 ? named[encoding] : wildcard;
+        quality[encoding] = q > 0 ? q : 0;
+    }
+}
+
+/* Pick a representation */
+void asset_entry_select(const AssetEntry* entry, const char* accept_encoding, AssetBody* body) {
+    if (entry == NULL || body == NULL) {
+        return;
+    }
+    int best = ASSET_ENCODING_IDENTITY;
+    if (accept_encoding != NULL && asset_entry_has_variants(entry)) {
+        int quality[ASSET_ENCODING_COUNT] = {0};
+        parse_accept_encoding(accept_encoding, quality);
+        for (int encoding = 1; encoding < ASSET_ENCODING_COUNT; encoding++) {
+            const AssetBody* candidate = &entry->Bodies[encoding];
+            if (candidate->Data != NULL && quality[encoding] > 0 &&
+                candidate->Length < entry->Bodies[best].Length) {
+                best = encoding;
+            }
+        }
+    }
+    *body = entry->Bodies[best];
+}
+
+/* Compare validators, weakly as If-None-Match asks */
+bool asset_entry_matches(const AssetEntry* entry, const char* if_none_match) {
+    if (entry == NULL || if_none_match == NULL) {
+        return false;
+    }
+    const char* p = if_none_match;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        if (*p == '*') {
+            return true;
+        }
+        if (strncmp(p, "W/", 2) == 0) {
+            p += 2;
+        }
+        const char* tag = p;
+        if (*p == '"') {
+            p = strchr(p + 1, '"');
+            if (p == NULL) {
+                return false;
+            }
+            p++;
+        }
+        while (*p != '\0' && *p != ',') {
+            p++;
+        }
+        const char* end = tag;
+        while (end < p && *end != ' ' && *end != '\t' && *end != ',') {
+            end++;
+        }
+        for (int encoding = 0; encoding < ASSET_ENCODING_COUNT; encoding++) {
+            size_t length = strlen(entry->Tags[encoding]);
+            if (entry->Bodies[encoding].Data != NULL && (size_t)(end - tag) == length &&
+                memcmp(tag, entry->Tags[encoding], length) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
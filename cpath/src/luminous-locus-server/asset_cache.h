@@ -0,0 +1,96 @@
+/*
+ * Luminous Locus Asset Cache Header
+ */
+
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Files larger than this are left on disk */
+#define ASSET_CACHE_FILE_MAX (16 * 1024 * 1024)
+
+/* Mapped bytes across all cached files */
+#define ASSET_CACHE_TOTAL_MAX (256 * 1024 * 1024)
+
+/* Content codings a file may be stored in */
+enum AssetEncoding {
+    ASSET_ENCODING_IDENTITY,
+    ASSET_ENCODING_GZIP,
+    ASSET_ENCODING_BR,
+    ASSET_ENCODING_COUNT
+};
+
+/* Snapshot of the files under the asset root, read-only once built */
+typedef struct AssetCache AssetCache;
+
+/* One cached file and its encoded variants */
+typedef struct AssetEntry AssetEntry;
+
+/* One representation of a file, ready to send */
+typedef struct AssetBody {
+    const char* Data;
+    size_t Length;
+    const char* Encoding;   /* Content-Encoding value, NULL for identity */
+    const char* ETag;       /* quoted strong validator, distinct per encoding */
+} AssetBody;
+
+/* Cache build summary */
+typedef struct AssetCacheStats {
+    int Files;
+    int64_t Bytes;          /* identity bytes mapped */
+    int64_t VariantBytes;   /* bytes of the encoded variants kept */
+    int64_t VariantSaved;   /* identity bytes those variants stand in for, minus their size */
+    int64_t BuildMs;
+} AssetCacheStats;
+
+/* Called for each regular file found, false stops the walk */
+typedef bool (*AssetWalkHandler)(void* data, int dir_fd, const char* name, const char* path, int64_t size);
+
+/* Asset pack, see asset_pack.h */
+typedef struct AssetPack AssetPack;
+
+/* Map and hash every file below the root directory fd, which stays owned by the caller */
+AssetCache* asset_cache_create(int root_fd);
+
+/* Cache the entries of a pack, which must outlive the cache */
+AssetCache* asset_cache_create_from_pack(const AssetPack* pack);
+void asset_cache_free(AssetCache* cache);
+
+/* File at a path relative to the root, NULL when not cached */
+const AssetEntry* asset_cache_find(const AssetCache* cache, const char* path);
+
+/* Build summary */
+void asset_cache_get_stats(const AssetCache* cache, AssetCacheStats* stats);
+
+/* Content type of the file */
+const char* asset_entry_type(const AssetEntry* entry);
+
+/* Whether the response depends on Accept-Encoding */
+bool asset_entry_has_variants(const AssetEntry* entry);
+
+/* Smallest representation an Accept-Encoding value allows, identity when NULL */
+void asset_entry_select(const AssetEntry* entry, const char* accept_encoding, AssetBody* body);
+
+/* Whether an If-None-Match value names any representation of the file */
+bool asset_entry_matches(const AssetEntry* entry, const char* if_none_match);
+
+/*
+ * Visit every regular file below a root directory fd, skipping dotfiles.
+ * Paths are relative to the root; name is the entry in dir_fd. False
+ * when the walk failed or a handler stopped it.
+ */
+bool asset_walk(int root_fd, AssetWalkHandler handler, void* data);
+
+/* Malloc'd gzip of a file, NULL when its type is already compressed or gzip would not save enough */
+char* asset_gzip_variant(const char* path, const void* data, size_t length, size_t* variant_length);
+
+/* Content type from a path's extension */
+const char* asset_content_type(const char* path);
+
+/* 64-bit content hash, same value on every platform */
+uint64_t asset_hash64(const void* data, size_t length);
+
+#endif /* ASSET_CACHE_H */
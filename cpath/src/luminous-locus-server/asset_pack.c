@@ -0,0 +1,589 @@
+/*
+ * Luminous Locus Asset Pack Module
+ * One mapped archive holding every asset
+ *
+ * The builder walks an asset root and writes each file as a blob on a
+ * 64-byte boundary, adds a gzip copy of the files that compress and a
+ * compiled state table (see dmi_meta) for every .dmi.json sidecar, and
+ * the texture atlas of all those sheets (see dmi_atlas), then writes an
+ * index sorted by path hash and the paths themselves. Paths
+ * are packed in sorted order and nothing time-dependent is stored, so
+ * the same root always gives the same bytes. The reader maps the pack
+ * once and checks the header and every index record before trusting
+ * it; blobs are used in place and never copied. A pack is written
+ * beside its destination and renamed over it, so a server never maps a
+ * half-written one.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "asset_cache.h"
+#include "dmi_meta.h"
+#include "dmi_atlas.h"
+#include "asset_pack.h"
+
+/* Suffix of the sidecars compiled into state tables */
+#define SIDECAR_SUFFIX ".json"
+
+struct AssetPack {
+    const char* Data;
+    size_t Length;
+    const AssetPackHeader* Header;
+    const AssetPackEntry* Index;
+    const char* Names;
+};
+
+/* File found under the root */
+typedef struct PackFile {
+    char* Path;
+} PackFile;
+
+/* Index record being built, with its path */
+typedef struct PackRecord {
+    AssetPackEntry Entry;
+    char* Path;
+} PackRecord;
+
+/* Builder state */
+typedef struct PackBuilder {
+    PackFile* Files;
+    int FileCount;
+    int FileCapacity;
+    PackRecord* Records;
+    uint32_t RecordCount;
+    uint32_t RecordCapacity;
+    FILE* Out;
+    uint64_t Offset;
+    bool Failed;
+    DmiAtlasBuilder* Atlas;
+} PackBuilder;
+
+/* Whether path ends with suffix */
+static bool ends_with(const char* path, const char* suffix) {
+    size_t length = strlen(path);
+    size_t suffix_length = strlen(suffix);
+    return length >= suffix_length && strcmp(path + length - suffix_length, suffix) == 0;
+}
+
+/* Round up to the blob alignment */
+static uint64_t align_up(uint64_t offset) {
+    return (offset + ASSET_PACK_ALIGN - 1) & ~(uint64_t)(ASSET_PACK_ALIGN - 1);
+}
+
+/* Record a file found by the walk */
+static bool collect_file(void* data, int dir_fd, const char* name, const char* path, int64_t size) {
+    (void)dir_fd;
+    (void)size;
+    PackBuilder* builder = (PackBuilder*)data;
+    /* Never pack a pack, least of all the one being written */
+    if (ends_with(name, ".pack") || ends_with(name, ".pack.tmp")) {
+        return true;
+    }
+    if (builder->FileCount == builder->FileCapacity) {
+        int capacity = builder->FileCapacity > 0 ? builder->FileCapacity * 2 : 256;
+        PackFile* files = (PackFile*)realloc(builder->Files, capacity * sizeof(PackFile));
+        if (files == NULL) {
+            return false;
+        }
+        builder->Files = files;
+        builder->FileCapacity = capacity;
+    }
+    PackFile* file = &builder->Files[builder->FileCount];
+    file->Path = strdup(path);
+    if (file->Path == NULL) {
+        return false;
+    }
+    builder->FileCount++;
+    return true;
+}
+
+/* Order files by path */
+static int compare_files(const void* a, const void* b) {
+    return strcmp(((const PackFile*)a)->Path, ((const PackFile*)b)->Path);
+}
+
+/* Order index records by path hash, then path */
+static int compare_records(const void* a, const void* b) {
+    const PackRecord* left = (const PackRecord*)a;
+    const PackRecord* right = (const PackRecord*)b;
+    if (left->Entry.PathHash != right->Entry.PathHash) {
+        return left->Entry.PathHash < right->Entry.PathHash ? -1 : 1;
+    }
+    return strcmp(left->Path, right->Path);
+}
+
+/* Whether the walk found a file */
+static bool has_file(const PackBuilder* builder, const char* path) {
+    int low = 0;
+    int high = builder->FileCount;
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        int order = strcmp(builder->Files[mid].Path, path);
+        if (order == 0) {
+            return true;
+        }
+        if (order < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return false;
+}
+
+/* Read a whole file below the root, NULL when it cannot be read */
+static char* read_file(int root_fd, const char* path, size_t* length) {
+    int fd = openat(root_fd, path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    char* data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size >= 0) {
+        /* One spare byte so an empty file is not mistaken for a failure */
+        data = (char*)malloc((size_t)st.st_size + 1);
+    }
+    size_t used = 0;
+    while (data != NULL && used < (size_t)st.st_size) {
+        ssize_t got = read(fd, data + used, (size_t)st.st_size - used);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            free(data);
+            data = NULL;
+            break;
+        }
+        used += (size_t)got;
+    }
+    close(fd);
+    *length = used;
+    return data;
+}
+
+/* Write a blob on the next boundary and index it under path */
+static void write_blob(PackBuilder* builder, const char* path, uint32_t kind, const char* data, size_t length) {
+    if (builder->Failed) {
+        return;
+    }
+    if (builder->RecordCount == builder->RecordCapacity) {
+        uint32_t capacity = builder->RecordCapacity > 0 ? builder->RecordCapacity * 2 : 256;
+        PackRecord* records = (PackRecord*)realloc(builder->Records, capacity * sizeof(PackRecord));
+        if (records == NULL) {
+            builder->Failed = true;
+            return;
+        }
+        builder->Records = records;
+        builder->RecordCapacity = capacity;
+    }
+    PackRecord* record = &builder->Records[builder->RecordCount];
+    memset(record, 0, sizeof(PackRecord));
+    record->Path = strdup(path);
+    if (record->Path == NULL) {
+        builder->Failed = true;
+        return;
+    }
+    builder->RecordCount++;
+
+    static const char padding[ASSET_PACK_ALIGN] = {0};
+    uint64_t start = align_up(builder->Offset);
+    if (fwrite(padding, 1, (size_t)(start - builder->Offset), builder->Out) != start - builder->Offset ||
+        fwrite(data, 1, length, builder->Out) != length) {
+        builder->Failed = true;
+        return;
+    }
+    builder->Offset = start + length;
+
+    record->Entry.PathHash = asset_hash64(path, strlen(path));
+    record->Entry.Offset = start;
+    record->Entry.Length = length;
+    record->Entry.ContentHash = asset_hash64(data, length);
+    record->Entry.NameLength = (uint32_t)strlen(path);
+    record->Entry.Kind = kind;
+}
+
+/* Add a gzip copy of a blob when it has none of its own and one is worth keeping */
+static void write_variant(PackBuilder* builder, const char* path, const char* data, size_t length) {
+    char variant_path[1024];
+    int path_length = snprintf(variant_path, sizeof(variant_path), "%s.gz", path);
+    if (path_length < 0 || (size_t)path_length >= sizeof(variant_path) || has_file(builder, variant_path)) {
+        return;
+    }
+    size_t variant_length = 0;
+    char* variant = asset_gzip_variant(path, data, length, &variant_length);
+    if (variant != NULL) {
+        write_blob(builder, variant_path, ASSET_PACK_GZIP, variant, variant_length);
+        free(variant);
+    }
+}
+
+/* Pack one file and whatever is derived from it */
+static void pack_file(PackBuilder* builder, int root_fd, const PackFile* file) {
+    size_t length = 0;
+    char* data = read_file(root_fd, file->Path, &length);
+    if (data == NULL) {
+        fprintf(stderr, "Asset pack: cannot read %s, skipped\n", file->Path);
+        return;
+    }
+    write_blob(builder, file->Path, ASSET_PACK_FILE, data, length);
+    write_variant(builder, file->Path, data, length);
+
+    /* icons/x.dmi.json compiles to icons/x.dmi.states, reading icons/x.dmi for the sheet width */
+    char derived[1024];
+    size_t path_length = strlen(file->Path);
+    size_t stem_length = path_length - strlen(SIDECAR_SUFFIX);
+    if (ends_with(file->Path, ".dmi" SIDECAR_SUFFIX) &&
+        stem_length + sizeof(ASSET_PACK_STATES_SUFFIX) <= sizeof(derived)) {
+        memcpy(derived, file->Path, stem_length);
+        derived[stem_length] = '\0';
+        size_t sheet_length = 0;
+        char* sheet = has_file(builder, derived) ? read_file(root_fd, derived, &sheet_length) : NULL;
+        size_t table_length = 0;
+        void* table = dmi_meta_compile(data, length, sheet, sheet_length, &table_length);
+        if (table != NULL && sheet != NULL &&
+            !dmi_atlas_builder_add(builder->Atlas, derived, sheet, sheet_length, table, table_length)) {
+            fprintf(stderr, "Asset pack: %s cannot be decoded, left out of the atlas\n", derived);
+        }
+        if (table != NULL) {
+            memcpy(derived + stem_length, ASSET_PACK_STATES_SUFFIX, sizeof(ASSET_PACK_STATES_SUFFIX));
+            write_blob(builder, derived, ASSET_PACK_DMI_STATES, (const char*)table, table_length);
+            free(table);
+        } else {
+            fprintf(stderr, "Asset pack: %s is not a valid sidecar, no state table\n", file->Path);
+        }
+        free(sheet);
+    }
+    free(data);
+}
+
+/* Place the sheets gathered so far and pack the atlas pages and index */
+static void pack_atlas(PackBuilder* builder) {
+    DmiAtlasStats stats;
+    dmi_atlas_builder_get_stats(builder->Atlas, &stats);
+    if (builder->Failed || stats.Sheets == 0) {
+        return;
+    }
+    if (has_file(builder, DMI_ATLAS_INDEX_PATH)) {
+        fprintf(stderr, "Asset pack: the root has its own %s, no atlas built\n", DMI_ATLAS_INDEX_PATH);
+        return;
+    }
+    if (!dmi_atlas_builder_finish(builder->Atlas)) {
+        fprintf(stderr, "Asset pack: out of memory building the atlas, none packed\n");
+        return;
+    }
+    for (int i = 0; i < dmi_atlas_builder_page_count(builder->Atlas); i++) {
+        char path[64];
+        snprintf(path, sizeof(path), DMI_ATLAS_PAGE_PREFIX "%d.png", i);
+        size_t length = 0;
+        const char* page = dmi_atlas_builder_page(builder->Atlas, i, &length);
+        write_blob(builder, path, ASSET_PACK_ATLAS_PAGE, page, length);
+    }
+    size_t length = 0;
+    const char* index = dmi_atlas_builder_index(builder->Atlas, &length);
+    write_blob(builder, DMI_ATLAS_INDEX_PATH, ASSET_PACK_ATLAS_INDEX, index, length);
+    write_variant(builder, DMI_ATLAS_INDEX_PATH, index, length);
+}
+
+/* Write the index and paths, then the finished header */
+static void finish_pack(PackBuilder* builder) {
+    if (builder->Failed) {
+        return;
+    }
+    qsort(builder->Records, builder->RecordCount, sizeof(PackRecord), compare_records);
+
+    uint64_t names_length = 0;
+    for (uint32_t i = 0; i < builder->RecordCount; i++) {
+        builder->Records[i].Entry.NameOffset = (uint32_t)names_length;
+        names_length += builder->Records[i].Entry.NameLength + 1;
+    }
+    size_t index_length = builder->RecordCount * sizeof(AssetPackEntry);
+    AssetPackEntry* index = (AssetPackEntry*)malloc(index_length + 1);
+    if (index == NULL || names_length > UINT32_MAX) {
+        free(index);
+        builder->Failed = true;
+        return;
+    }
+    for (uint32_t i = 0; i < builder->RecordCount; i++) {
+        index[i] = builder->Records[i].Entry;
+    }
+
+    AssetPackHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.Magic, ASSET_PACK_MAGIC, sizeof(header.Magic));
+    header.Version = ASSET_PACK_VERSION;
+    header.EntryCount = builder->RecordCount;
+    header.IndexOffset = align_up(builder->Offset);
+    header.NamesOffset = header.IndexOffset + index_length;
+    header.NamesLength = names_length;
+    header.FileSize = header.NamesOffset + names_length;
+    header.ContentHash = asset_hash64(index, index_length);
+
+    static const char padding[ASSET_PACK_ALIGN] = {0};
+    size_t gap = (size_t)(header.IndexOffset - builder->Offset);
+    bool ok = fwrite(padding, 1, gap, builder->Out) == gap &&
+              fwrite(index, 1, index_length, builder->Out) == index_length;
+    for (uint32_t i = 0; ok && i < builder->RecordCount; i++) {
+        ok = fwrite(builder->Records[i].Path, 1, builder->Records[i].Entry.NameLength + 1, builder->Out) ==
+             builder->Records[i].Entry.NameLength + 1;
+    }
+    ok = ok && fseek(builder->Out, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, builder->Out) == 1;
+    free(index);
+    builder->Offset = header.FileSize;
+    builder->Failed = !ok;
+}
+
+/* Build a pack */
+bool asset_pack_build(const char* root, const char* out_path, AssetPackBuildStats* stats) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    (void)root;
+    (void)out_path;
+    (void)stats;
+    fprintf(stderr, "Asset pack: packs are little-endian and cannot be built on this host\n");
+    return false;
+#else
+    if (root == NULL || out_path == NULL) {
+        return false;
+    }
+    int root_fd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (root_fd < 0) {
+        fprintf(stderr, "Asset pack: cannot open root %s: %s\n", root, strerror(errno));
+        return false;
+    }
+    char temp_path[1024];
+    int temp_length = snprintf(temp_path, sizeof(temp_path), "%s.tmp", out_path);
+    if (temp_length < 0 || (size_t)temp_length >= sizeof(temp_path)) {
+        close(root_fd);
+        return false;
+    }
+
+    PackBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.Atlas = dmi_atlas_builder_create();
+    builder.Failed = builder.Atlas == NULL || !asset_walk(root_fd, collect_file, &builder);
+    if (!builder.Failed) {
+        qsort(builder.Files, builder.FileCount, sizeof(PackFile), compare_files);
+        builder.Out = fopen(temp_path, "wb");
+        builder.Failed = builder.Out == NULL;
+    }
+    if (!builder.Failed) {
+        /* Room for the header, which is written last */
+        AssetPackHeader blank;
+        memset(&blank, 0, sizeof(blank));
+        builder.Failed = fwrite(&blank, sizeof(blank), 1, builder.Out) != 1;
+        builder.Offset = sizeof(blank);
+    }
+    for (int i = 0; i < builder.FileCount && !builder.Failed; i++) {
+        pack_file(&builder, root_fd, &builder.Files[i]);
+    }
+    pack_atlas(&builder);
+    finish_pack(&builder);
+
+    if (builder.Out != NULL && fclose(builder.Out) != 0) {
+        builder.Failed = true;
+    }
+    if (builder.Out != NULL && (builder.Failed || rename(temp_path, out_path) != 0)) {
+        fprintf(stderr, "Asset pack: cannot write %s: %s\n", out_path, strerror(errno));
+        unlink(temp_path);
+        builder.Failed = true;
+    }
+
+    if (!builder.Failed && stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+        for (uint32_t i = 0; i < builder.RecordCount; i++) {
+            uint32_t kind = builder.Records[i].Entry.Kind;
+            stats->Files += kind == ASSET_PACK_FILE;
+            stats->Variants += kind == ASSET_PACK_GZIP;
+            stats->StateTables += kind == ASSET_PACK_DMI_STATES;
+        }
+        DmiAtlasStats atlas;
+        dmi_atlas_builder_get_stats(builder.Atlas, &atlas);
+        stats->AtlasPages = atlas.Pages;
+        stats->AtlasFrames = atlas.Frames;
+        stats->AtlasUniqueFrames = atlas.UniqueFrames;
+        stats->Bytes = (int64_t)builder.Offset;
+    }
+    for (int i = 0; i < builder.FileCount; i++) {
+        free(builder.Files[i].Path);
+    }
+    for (uint32_t i = 0; i < builder.RecordCount; i++) {
+        free(builder.Records[i].Path);
+    }
+    free(builder.Files);
+    free(builder.Records);
+    dmi_atlas_builder_free(builder.Atlas);
+    close(root_fd);
+    return !builder.Failed;
+#endif
+}
+
+/* Check the header and index of a mapped pack */
+static bool check_pack(const AssetPack* pack) {
+    const AssetPackHeader* header = pack->Header;
+    if (pack->Length < sizeof(AssetPackHeader) || memcmp(header->Magic, ASSET_PACK_MAGIC, sizeof(header->Magic)) != 0 ||
+        header->Version != ASSET_PACK_VERSION || header->FileSize != pack->Length) {
+        return false;
+    }
+    uint64_t index_length = (uint64_t)header->EntryCount * sizeof(AssetPackEntry);
+    if (header->IndexOffset % ASSET_PACK_ALIGN != 0 || header->IndexOffset < sizeof(AssetPackHeader) ||
+        header->IndexOffset > pack->Length || index_length > pack->Length - header->IndexOffset ||
+        header->NamesOffset != header->IndexOffset + index_length || header->NamesLength > UINT32_MAX ||
+        header->NamesLength != pack->Length - header->NamesOffset) {
+        return false;
+    }
+    if (asset_hash64(pack->Index, (size_t)index_length) != header->ContentHash) {
+        return false;
+    }
+    for (uint32_t i = 0; i < header->EntryCount; i++) {
+        const AssetPackEntry* entry = &pack->Index[i];
+        /* Blobs lie between the header and the index, paths are terminated inside the table */
+        if (entry->Offset % ASSET_PACK_ALIGN != 0 || entry->Offset < sizeof(AssetPackHeader) ||
+            entry->Offset > header->IndexOffset || entry->Length > header->IndexOffset - entry->Offset ||
+            entry->NameOffset >= header->NamesLength || entry->NameLength >= header->NamesLength - entry->NameOffset ||
+            pack->Names[entry->NameOffset + entry->NameLength] != '\0' ||
+            memchr(pack->Names + entry->NameOffset, '\0', entry->NameLength) != NULL) {
+            return false;
+        }
+        const char* name = pack->Names + entry->NameOffset;
+        if (entry->PathHash != asset_hash64(name, entry->NameLength)) {
+            return false;
+        }
+        if (i > 0) {
+            const AssetPackEntry* previous = &pack->Index[i - 1];
+            if (previous->PathHash > entry->PathHash ||
+                (previous->PathHash == entry->PathHash && strcmp(pack->Names + previous->NameOffset, name) >= 0)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/* Map a pack */
+AssetPack* asset_pack_open(const char* path) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    (void)path;
+    return NULL;
+#else
+    if (path == NULL) {
+        return NULL;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(AssetPackHeader)) {
+        close(fd);
+        return NULL;
+    }
+    void* mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return NULL;
+    }
+
+    AssetPack* pack = (AssetPack*)calloc(1, sizeof(AssetPack));
+    if (pack == NULL) {
+        munmap(mapping, (size_t)st.st_size);
+        return NULL;
+    }
+    pack->Data = (const char*)mapping;
+    pack->Length = (size_t)st.st_size;
+    pack->Header = (const AssetPackHeader*)mapping;
+    /* Bounds are checked before any of these are read */
+    pack->Index = (const AssetPackEntry*)(pack->Data + (pack->Header->IndexOffset <= pack->Length ?
+                                                        pack->Header->IndexOffset : 0));
+    pack->Names = pack->Data + (pack->Header->NamesOffset <= pack->Length ? pack->Header->NamesOffset : 0);
+    if (!check_pack(pack)) {
+        asset_pack_close(pack);
+        return NULL;
+    }
+    return pack;
+#endif
+}
+
+/* Unmap a pack */
+void asset_pack_close(AssetPack* pack) {
+    if (pack == NULL) {
+        return;
+    }
+    munmap((void*)pack->Data, pack->Length);
+    free(pack);
+}
+
+/* Number of entries */
+uint32_t asset_pack_count(const AssetPack* pack) {
+    return pack != NULL ? pack->Header->EntryCount : 0;
+}
+
+/* Entry by position */
+const AssetPackEntry* asset_pack_entry_at(const AssetPack* pack, uint32_t index) {
+    if (pack == NULL || index >= pack->Header->EntryCount) {
+        return NULL;
+    }
+    return &pack->Index[index];
+}
+
+/* Binary search on the path hash, then compare paths among equal hashes */
+const AssetPackEntry* asset_pack_find(const AssetPack* pack, const char* path) {
+    if (pack == NULL || path == NULL) {
+        return NULL;
+    }
+    uint64_t hash = asset_hash64(path, strlen(path));
+    uint32_t low = 0;
+    uint32_t high = pack->Header->EntryCount;
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (pack->Index[mid].PathHash < hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    for (uint32_t i = low; i < pack->Header->EntryCount && pack->Index[i].PathHash == hash; i++) {
+        if (strcmp(pack->Names + pack->Index[i].NameOffset, path) == 0) {
+            return &pack->Index[i];
+        }
+    }
+    return NULL;
+}
+
+/* Path of an entry */
+const char* asset_pack_entry_path(const AssetPack* pack, const AssetPackEntry* entry) {
+    if (pack == NULL || entry == NULL) {
+        return "";
+    }
+    return pack->Names + entry->NameOffset;
+}
+
+/* Bytes of an entry */
+const char* asset_pack_entry_data(const AssetPack* pack, const AssetPackEntry* entry) {
+    if (pack == NULL || entry == NULL) {
+        return NULL;
+    }
+    return pack->Data + entry->Offset;
+}
+
+/* The mapped pack */
+const char* asset_pack_bytes(const AssetPack* pack, size_t* length) {
+    if (length != NULL) {
+        *length = pack != NULL ? pack->Length : 0;
+    }
+    return pack != NULL ? pack->Data : NULL;
+}
+
+/* Hash of the index, which changes whenever any blob does */
+uint64_t asset_pack_hash(const AssetPack* pack) {
+    return pack != NULL ? pack->Header->ContentHash : 0;
+}
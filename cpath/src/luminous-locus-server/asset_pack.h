@@ -0,0 +1,98 @@
+/*
+ * Luminous Locus Asset Pack Header
+ */
+
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* First bytes of a pack */
+#define ASSET_PACK_MAGIC "LLPACK\r\n"
+#define ASSET_PACK_VERSION 1
+
+/* Every blob starts on this boundary */
+#define ASSET_PACK_ALIGN 64
+
+/* Path the whole pack is served under */
+#define ASSET_PACK_URL_PATH "assets.pack"
+
+/* Suffix of the compiled state table stored for each .dmi sidecar */
+#define ASSET_PACK_STATES_SUFFIX ".states"
+
+/* AssetPackEntry.Kind */
+enum AssetPackKind {
+    ASSET_PACK_FILE,        /* a file as it is on disk */
+    ASSET_PACK_GZIP,        /* gzip of the file named without the .gz */
+    ASSET_PACK_DMI_STATES,  /* dmi_meta table compiled from the .dmi.json of the same name */
+    ASSET_PACK_ATLAS_PAGE,  /* dmi_atlas page, a PNG */
+    ASSET_PACK_ATLAS_INDEX  /* dmi_atlas index locating every frame in the pages */
+};
+
+/*
+ * On-disk layout, little-endian: this header, the blobs, the index
+ * sorted by path hash, then the NUL-terminated paths.
+ */
+typedef struct AssetPackHeader {
+    char Magic[8];
+    uint32_t Version;
+    uint32_t EntryCount;
+    uint64_t IndexOffset;
+    uint64_t NamesOffset;
+    uint64_t NamesLength;
+    uint64_t FileSize;
+    uint64_t ContentHash;   /* hash of the index, which holds every blob's hash */
+    uint64_t Reserved;
+} AssetPackHeader;
+
+/* Index record */
+typedef struct AssetPackEntry {
+    uint64_t PathHash;      /* asset_hash64 of the path */
+    uint64_t Offset;        /* blob start, a multiple of ASSET_PACK_ALIGN */
+    uint64_t Length;
+    uint64_t ContentHash;   /* asset_hash64 of the blob */
+    uint32_t NameOffset;    /* into the path table */
+    uint32_t NameLength;
+    uint32_t Kind;
+    uint32_t Reserved;
+} AssetPackEntry;
+
+/* Mapped, checked pack */
+typedef struct AssetPack AssetPack;
+
+/* Builder summary */
+typedef struct AssetPackBuildStats {
+    int Files;
+    int Variants;
+    int StateTables;
+    int AtlasPages;
+    int AtlasFrames;        /* icon frames in the atlas index */
+    int AtlasUniqueFrames;  /* frames left after dropping duplicates */
+    int64_t Bytes;          /* size of the pack written */
+} AssetPackBuildStats;
+
+/* Pack every file under root into out_path, stats may be NULL */
+bool asset_pack_build(const char* root, const char* out_path, AssetPackBuildStats* stats);
+
+/* Map and check a pack, NULL when it is missing or malformed */
+AssetPack* asset_pack_open(const char* path);
+void asset_pack_close(AssetPack* pack);
+
+/* Entries, in index order */
+uint32_t asset_pack_count(const AssetPack* pack);
+const AssetPackEntry* asset_pack_entry_at(const AssetPack* pack, uint32_t index);
+
+/* Entry by path, NULL when the pack does not hold it */
+const AssetPackEntry* asset_pack_find(const AssetPack* pack, const char* path);
+
+/* Path and bytes of an entry, pointers into the mapping */
+const char* asset_pack_entry_path(const AssetPack* pack, const AssetPackEntry* entry);
+const char* asset_pack_entry_data(const AssetPack* pack, const AssetPackEntry* entry);
+
+/* The whole pack as mapped, for sending it or slices of it as they are */
+const char* asset_pack_bytes(const AssetPack* pack, size_t* length);
+uint64_t asset_pack_hash(const AssetPack* pack);
+
+#endif /* ASSET_PACK_H */
@@ -1,36 +1,968 @@
 /*
  * Luminous Locus Asset Server Module
- * Static asset serving
+ * Static asset serving over HTTP/1.1
+ *
+ * Files under the asset root (exec/ by default) are served with GET and
+ * HEAD on a thread and event loop of their own, so a round start full of
+ * clients pulling icons, sounds and maps never sits in front of game
+ * traffic. Connections are kept alive and pipelined requests are
+ * answered in order: the next request in the buffer is only parsed once
+ * the response before it is fully written. Files in the asset cache are
+ * written from their mapping with a strong ETag and the smallest encoding
+ * the client accepts; anything else goes from the page cache to the
+ * socket with sendfile. A single Range is answered with 206; multiple
+ * ranges get the whole file. Paths are resolved beneath the root and may
+ * not climb out of it. Given an asset pack, the cache is built over its
+ * mapping instead of the root, and the pack itself is served as
+ * /assets.pack so a client can fetch everything, or slices of it, in one
+ * request.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <strings.h>
+#include <time.h>
 
-#ifdef _WIN32
-    #include <winsock2.h>
-    #include <ws2tcpip.h>
-    #include <windows.h>
-    #define close closesocket
-#else
-    #include <sys/types.h>
-    #include <sys/socket.h>
-    #include <netinet/in.h>
-    #include <arpa/inet.h>
-    #include <unistd.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+    #include <sys/eventfd.h>
+    #include <sys/sendfile.h>
+#endif
+#include "event_loop.h"
+#include "asset_pack.h"
+#include "asset_cache.h"
+#include "assetserver.h"
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+#endif
+#ifndef MSG_MORE
+    #define MSG_MORE 0
 #endif
-#include "model.h"
+
+/* Event loop configuration */
+#define POLL_TIMEOUT_MS 1000
+#define INITIAL_CONN_CAPACITY 64
+
+/* Connections beyond this are closed on accept */
+#define ASSET_MAX_CONNS 4096
+
+/* Keep-alive connections silent this long are closed */
+#define ASSET_IDLE_TIMEOUT_MS 30000
+
+/* Request head buffer, a request line and headers must fit */
+#define ASSET_REQUEST_MAX 8192
+
+/* Response head buffer, also holds the short body of error responses */
+#define ASSET_HEADER_MAX 1024
+
+/* Longest decoded path below the root */
+#define ASSET_PATH_MAX 1024
+
+/* Largest sendfile call, keeps one download from starving the others */
+#define ASSET_SEND_CHUNK (1024 * 1024)
+
+/* Send result */
+enum AssetSendResult {
+    ASSET_SEND_DONE,
+    ASSET_SEND_PENDING,
+    ASSET_SEND_ERROR
+};
+
+/* One client connection */
+typedef struct AssetConn {
+    EventSource Source;         /* first member, the loop hands it back */
+    int Index;                  /* position in the server's table */
+    int64_t LastActive;         /* monotonic ms of the last byte either way */
+    bool KeepAlive;             /* reuse the connection after this response */
+    bool WantWrite;             /* waiting on EVENT_WRITE */
+    bool Responding;            /* a response is being written */
+    bool PeerClosed;            /* read returned 0, answer what is buffered and close */
+    int File;                   /* body of the current response on disk, -1 when none */
+    const char* Body;           /* body of the current response in the cache, NULL when none */
+    off_t Offset;               /* next body byte to send */
+    off_t End;                  /* one past the last body byte */
+    size_t HeaderLength;
+    size_t HeaderSent;
+    size_t Used;                /* request bytes buffered */
+    char Header[ASSET_HEADER_MAX];
+    char Request[ASSET_REQUEST_MAX];
+} AssetConn;
+
+/* Parsed request head */
+typedef struct AssetRequest {
+    char Method[8];
+    char Target[ASSET_PATH_MAX];
+    bool Http11;
+    bool KeepAlive;
+    bool HasBody;
+    bool HasRange;
+    char Range[64];
+    char IfNoneMatch[256];      /* empty when absent or too long to trust */
+    char AcceptEncoding[128];   /* empty when absent or too long, identity is sent */
+} AssetRequest;
 
 /* Asset server state */
 struct AssetServer {
     int Port;
     int Socket;
+    int RootFD;
+    char* Root;
+    char* PackPath;             /* NULL when serving the root alone */
+    AssetPack* Pack;
+    AssetCache* Cache;
     bool Running;
+    bool Started;
+    pthread_t Thread;
+    int WakeReadFD;
+    int WakeWriteFD;
+    EventLoop* Loop;
+    EventSource Listener;
+    EventSource Wakeup;
+    AssetConn** Conns;
+    int ConnCount;
+    int ConnCapacity;
+    int64_t LastSweep;
+    int64_t Requests;           /* written by the server thread, read by anyone */
+    int64_t BytesSent;
 };
 
+/* Monotonic milliseconds */
+static int64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Create non-blocking listening socket */
+static int create_listen_socket(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+
+    int opt = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        close(sock);
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(sock, SOMAXCONN) < 0 || !set_nonblocking(sock)) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* Create wakeup fd pair */
+static bool create_wakeup(AssetServer* server) {
+#ifdef __linux__
+    server->WakeReadFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    server->WakeWriteFD = server->WakeReadFD;
+    return server->WakeReadFD >= 0;
+#else
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return false;
+    }
+    set_nonblocking(fds[0]);
+    set_nonblocking(fds[1]);
+    server->WakeReadFD = fds[0];
+    server->WakeWriteFD = fds[1];
+    return true;
+#endif
+}
+
+/* Poke the server thread */
+static void wake(AssetServer* server) {
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t ignored = write(server->WakeWriteFD, &one, sizeof(one));
+#else
+    char one = 1;
+    ssize_t ignored = write(server->WakeWriteFD, &one, sizeof(one));
+#endif
+    (void)ignored;
+}
+
+/* Reason phrase */
+static const char* status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 206: return "Partial Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 416: return "Range Not Satisfiable";
+        case 431: return "Request Header Fields Too Large";
+        default: return "Internal Server Error";
+    }
+}
+
+/* Hex digit value, -1 when not one */
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/*
+ * Turn a request target into a path relative to the root. Query and
+ * fragment are dropped, %XX escapes decoded, empty and "." segments
+ * skipped. False for anything that could leave the root: "..", NUL,
+ * backslashes, or a target that is not an absolute path.
+ */
+static bool resolve_path(const char* target, char* out, size_t capacity) {
+    if (target[0] != '/') {
+        return false;
+    }
+    char decoded[ASSET_PATH_MAX];
+    size_t length = 0;
+    for (const char* p = target; *p != '\0' && *p != '?' && *p != '#'; p++) {
+        char c = *p;
+        if (c == '%') {
+            int high = hex_value(p[1]);
+            int low = high >= 0 ? hex_value(p[2]) : -1;
+            if (low < 0) {
+                return false;
+            }
+            c = (char)(high << 4 | low);
+            p += 2;
+        }
+        if (c == '\0' || c == '\\' || length + 1 >= sizeof(decoded)) {
+            return false;
+        }
+        decoded[length++] = c;
+    }
+    decoded[length] = '\0';
+
+    size_t used = 0;
+    char* save = NULL;
+    for (char* segment = strtok_r(decoded, "/", &save); segment != NULL; segment = strtok_r(NULL, "/", &save)) {
+        if (strcmp(segment, ".") == 0) {
+            continue;
+        }
+        if (strcmp(segment, "..") == 0) {
+            return false;
+        }
+        size_t segment_length = strlen(segment);
+        if (used + segment_length + 2 > capacity) {
+            return false;
+        }
+        if (used > 0) {
+            out[used++] = '/';
+        }
+        memcpy(out + used, segment, segment_length);
+        used += segment_length;
+    }
+    out[used] = '\0';
+    return used > 0;
+}
+
+/* Case-insensitive search for a comma-separated token in a header value */
+static bool header_has_token(const char* value, const char* token) {
+    size_t token_length = strlen(token);
+    const char* p = value;
+    while (*p != '\0') {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        const char* start = p;
+        while (*p != '\0' && *p != ',') {
+            p++;
+        }
+        const char* end = p;
+        while (end > start && (end[-1] == ' ' || end[-1] == '\t')) {
+            end--;
+        }
+        if ((size_t)(end - start) == token_length && strncasecmp(start, token, token_length) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Parse a request head of length bytes ending in the blank line, false when malformed */
+static bool parse_request(char* head, size_t length, AssetRequest* request) {
+    memset(request, 0, sizeof(AssetRequest));
+    head[length] = '\0';
+
+    char* save = NULL;
+    char* line = strtok_r(head, "\r\n", &save);
+    if (line == NULL) {
+        return false;
+    }
+    char* method = line;
+    char* target = strchr(method, ' ');
+    if (target == NULL) {
+        return false;
+    }
+    *target++ = '\0';
+    char* version = strchr(target, ' ');
+    if (version == NULL) {
+        return false;
+    }
+    *version++ = '\0';
+    if (strlen(method) >= sizeof(request->Method) || strlen(target) >= sizeof(request->Target)) {
+        return false;
+    }
+    strcpy(request->Method, method);
+    strcpy(request->Target, target);
+    if (strcmp(version, "HTTP/1.1") == 0) {
+        request->Http11 = true;
+    } else if (strcmp(version, "HTTP/1.0") != 0) {
+        return false;
+    }
+
+    bool keep_alive = request->Http11;
+    for (line = strtok_r(NULL, "\r\n", &save); line != NULL; line = strtok_r(NULL, "\r\n", &save)) {
+        char* value = strchr(line, ':');
+        if (value == NULL) {
+            return false;
+        }
+        *value++ = '\0';
+        while (*value == ' ' || *value == '\t') {
+            value++;
+        }
+        if (strcasecmp(line, "Connection") == 0) {
+            if (header_has_token(value, "close")) {
+                keep_alive = false;
+            } else if (header_has_token(value, "keep-alive")) {
+                keep_alive = true;
+            }
+        } else if (strcasecmp(line, "Range") == 0) {
+            if (strlen(value) < sizeof(request->Range)) {
+                strcpy(request->Range, value);
+                request->HasRange = true;
+            }
+        } else if (strcasecmp(line, "If-None-Match") == 0) {
+            if (strlen(value) < sizeof(request->IfNoneMatch)) {
+                strcpy(request->IfNoneMatch, value);
+            }
+        } else if (strcasecmp(line, "Accept-Encoding") == 0) {
+            if (strlen(value) < sizeof(request->AcceptEncoding)) {
+                strcpy(request->AcceptEncoding, value);
+            }
+        } else if (strcasecmp(line, "Content-Length") == 0) {
+            request->HasBody = strtoll(value, NULL, 10) != 0;
+        } else if (strcasecmp(line, "Transfer-Encoding") == 0) {
+            request->HasBody = true;
+        }
+    }
+    request->KeepAlive = keep_alive;
+    return true;
+}
+
+/*
+ * Apply a Range header to a file of size bytes. Returns 206 with
+ * first..last set, 416 when the range starts past the end, or 200 when
+ * the header is malformed or asks for several ranges and the whole file
+ * goes out instead.
+ */
+static int parse_range(const char* range, off_t size, off_t* first, off_t* last) {
+    if (strncasecmp(range, "bytes=", 6) != 0 || strchr(range, ',') != NULL) {
+        return 200;
+    }
+    const char* spec = range + 6;
+    char* end = NULL;
+    if (*spec == '-') {
+        long long suffix = strtoll(spec + 1, &end, 10);
+        if (end == spec + 1 || *end != '\0' || suffix < 0) {
+            return 200;
+        }
+        if (suffix == 0 || size == 0) {
+            return 416;
+        }
+        *first = suffix < (long long)size ? size - (off_t)suffix : 0;
+        *last = size - 1;
+        return 206;
+    }
+
+    long long start = strtoll(spec, &end, 10);
+    if (end == spec || *end != '-' || start < 0) {
+        return 200;
+    }
+    const char* tail = end + 1;
+    long long stop = (long long)size - 1;
+    if (*tail != '\0') {
+        stop = strtoll(tail, &end, 10);
+        if (*end != '\0' || stop < start) {
+            return 200;
+        }
+    }
+    if (start >= (long long)size) {
+        return 416;
+    }
+    *first = (off_t)start;
+    *last = stop < (long long)size ? (off_t)stop : size - 1;
+    return 206;
+}
+
+/* Start writing a response with no file, a one-line text body unless head_only */
+static void respond_error(AssetConn* conn, int status, bool head_only) {
+    char body[64];
+    int body_length = snprintf(body, sizeof(body), "%d %s\n", status, status_text(status));
+    int length = snprintf(conn->Header, sizeof(conn->Header),
+                          "HTTP/1.1 %d %s\r\n"
+                          "Server: Luminous-Locus\r\n"
+                          "Content-Type: text/plain; charset=utf-8\r\n"
+                          "Content-Length: %d\r\n"
+                          "%s"
+                          "%s"
+                          "\r\n"
+                          "%s",
+                          status, status_text(status), body_length,
+                          status == 405 ? "Allow: GET, HEAD\r\n" : "",
+                          conn->KeepAlive ? "" : "Connection: close\r\n",
+                          head_only ? "" : body);
+    conn->HeaderLength = (size_t)length;
+    conn->HeaderSent = 0;
+    conn->File = -1;
+    conn->Body = NULL;
+    conn->Offset = 0;
+    conn->End = 0;
+    conn->Responding = true;
+}
+
+/* Start writing a 416 for a file of size bytes */
+static void respond_unsatisfiable(AssetConn* conn, off_t size) {
+    int length = snprintf(conn->Header, sizeof(conn->Header),
+                          "HTTP/1.1 416 %s\r\n"
+                          "Server: Luminous-Locus\r\n"
+                          "Content-Range: bytes */%lld\r\n"
+                          "Content-Length: 0\r\n"
+                          "%s"
+                          "\r\n",
+                          status_text(416), (long long)size, conn->KeepAlive ? "" : "Connection: close\r\n");
+    conn->HeaderLength = (size_t)length;
+    conn->HeaderSent = 0;
+    conn->File = -1;
+    conn->Body = NULL;
+    conn->Offset = 0;
+    conn->End = 0;
+    conn->Responding = true;
+}
+
+/*
+ * Start writing a cached file. Validators are checked first, then the
+ * smallest encoding the client takes is picked; a Range always gets
+ * identity bytes, since ranges of a gzip stream help nobody.
+ */
+static void respond_cached(AssetConn* conn, const AssetRequest* request, const AssetEntry* entry, bool head_only) {
+    AssetBody body;
+    asset_entry_select(entry, request->HasRange || request->AcceptEncoding[0] == '\0' ? NULL
+                                                                                    : request->AcceptEncoding,
+                       &body);
+    const char* vary = asset_entry_has_variants(entry) ? "Vary: Accept-Encoding\r\n" : "";
+
+    if (request->IfNoneMatch[0] != '\0' && asset_entry_matches(entry, request->IfNoneMatch)) {
+        int length = snprintf(conn->Header, sizeof(conn->Header),
+                              "HTTP/1.1 304 %s\r\n"
+                              "Server: Luminous-Locus\r\n"
+                              "ETag: %s\r\n"
+                              "%s"
+                              "%s"
+                              "\r\n",
+                              status_text(304), body.ETag, vary, conn->KeepAlive ? "" : "Connection: close\r\n");
+        conn->HeaderLength = (size_t)length;
+        conn->HeaderSent = 0;
+        conn->File = -1;
+        conn->Body = NULL;
+        conn->Offset = 0;
+        conn->End = 0;
+        conn->Responding = true;
+        return;
+    }
+
+    off_t size = (off_t)body.Length;
+    off_t first = 0;
+    off_t last = size - 1;
+    int status = request->HasRange ? parse_range(request->Range, size, &first, &last) : 200;
+    if (status == 416) {
+        respond_unsatisfiable(conn, size);
+        return;
+    }
+    if (status == 200) {
+        first = 0;
+        last = size - 1;
+    }
+
+    char content_range[96] = "";
+    if (status == 206) {
+        snprintf(content_range, sizeof(content_range), "Content-Range: bytes %lld-%lld/%lld\r\n",
+                 (long long)first, (long long)last, (long long)size);
+    }
+    char content_encoding[48] = "";
+    if (body.Encoding != NULL) {
+        snprintf(content_encoding, sizeof(content_encoding), "Content-Encoding: %s\r\n", body.Encoding);
+    }
+    int length = snprintf(conn->Header, sizeof(conn->Header),
+                          "HTTP/1.1 %d %s\r\n"
+                          "Server: Luminous-Locus\r\n"
+                          "Content-Type: %s\r\n"
+                          "Content-Length: %lld\r\n"
+                          "Accept-Ranges: bytes\r\n"
+                          "ETag: %s\r\n"
+                          "%s"
+                          "%s"
+                          "%s"
+                          "%s"
+                          "\r\n",
+                          status, status_text(status), asset_entry_type(entry), (long long)(last - first + 1),
+                          body.ETag, content_encoding, vary, content_range,
+                          conn->KeepAlive ? "" : "Connection: close\r\n");
+    conn->HeaderLength = (size_t)length;
+    conn->HeaderSent = 0;
+    conn->File = -1;
+    conn->Body = head_only ? NULL : body.Data;
+    conn->Offset = head_only ? 0 : first;
+    conn->End = head_only ? 0 : last + 1;
+    conn->Responding = true;
+}
+
+/* Start writing the target's response, from the cache when it holds the file */
+static void respond_file(AssetServer* server, AssetConn* conn, const AssetRequest* request, bool head_only) {
+    char path[ASSET_PATH_MAX];
+    if (!resolve_path(request->Target, path, sizeof(path))) {
+        respond_error(conn, 404, head_only);
+        return;
+    }
+    const AssetEntry* entry = asset_cache_find(server->Cache, path);
+    if (entry != NULL) {
+        respond_cached(conn, request, entry, head_only);
+        return;
+    }
+
+    int fd = openat(server->RootFD, path, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        respond_error(conn, 404, head_only);
+        return;
+    }
+
+    off_t first = 0;
+    off_t last = st.st_size - 1;
+    int status = request->HasRange ? parse_range(request->Range, st.st_size, &first, &last) : 200;
+    if (status == 416) {
+        close(fd);
+        respond_unsatisfiable(conn, st.st_size);
+        return;
+    }
+    if (status == 200) {
+        first = 0;
+        last = st.st_size - 1;
+    }
+
+    char content_range[96] = "";
+    if (status == 206) {
+        snprintf(content_range, sizeof(content_range), "Content-Range: bytes %lld-%lld/%lld\r\n",
+                 (long long)first, (long long)last, (long long)st.st_size);
+    }
+    int length = snprintf(conn->Header, sizeof(conn->Header),
+                          "HTTP/1.1 %d %s\r\n"
+                          "Server: Luminous-Locus\r\n"
+                          "Content-Type: %s\r\n"
+                          "Content-Length: %lld\r\n"
+                          "Accept-Ranges: bytes\r\n"
+                          "%s"
+                          "%s"
+                          "\r\n",
+                          status, status_text(status), asset_content_type(path), (long long)(last - first + 1),
+                          content_range, conn->KeepAlive ? "" : "Connection: close\r\n");
+    conn->HeaderLength = (size_t)length;
+    conn->HeaderSent = 0;
+    conn->Body = NULL;
+    conn->Offset = first;
+    conn->End = last + 1;
+    if (head_only || conn->Offset >= conn->End) {
+        close(fd);
+        conn->File = -1;
+        conn->Offset = 0;
+        conn->End = 0;
+    } else {
+        conn->File = fd;
+    }
+    conn->Responding = true;
+}
+
+/*
+ * Answer the request at the front of the buffer, if a whole one is
+ * there. Returns false when more bytes are needed.
+ */
+static bool start_response(AssetServer* server, AssetConn* conn) {
+    char* end = NULL;
+    for (size_t i = 3; i < conn->Used; i++) {
+        if (memcmp(conn->Request + i - 3, "\r\n\r\n", 4) == 0) {
+            end = conn->Request + i + 1;
+            break;
+        }
+    }
+    if (end == NULL) {
+        if (conn->Used == sizeof(conn->Request)) {
+            conn->KeepAlive = false;
+            respond_error(conn, 431, false);
+            conn->Used = 0;
+            return true;
+        }
+        return false;
+    }
+
+    size_t head_length = (size_t)(end - conn->Request);
+    char head[ASSET_REQUEST_MAX + 1];
+    memcpy(head, conn->Request, head_length);
+    memmove(conn->Request, end, conn->Used - head_length);
+    conn->Used -= head_length;
+    __atomic_add_fetch(&server->Requests, 1, __ATOMIC_RELAXED);
+
+    AssetRequest request;
+    if (!parse_request(head, head_length, &request)) {
+        conn->KeepAlive = false;
+        respond_error(conn, 400, false);
+        return true;
+    }
+    /* Request bodies are not expected, and skipping them would desync the pipeline */
+    conn->KeepAlive = request.KeepAlive && !request.HasBody && !conn->PeerClosed;
+
+    bool head_only = strcmp(request.Method, "HEAD") == 0;
+    if (!head_only && strcmp(request.Method, "GET") != 0) {
+        respond_error(conn, 405, false);
+    } else if (request.HasBody) {
+        respond_error(conn, 400, head_only);
+    } else {
+        respond_file(server, conn, &request, head_only);
+    }
+    return true;
+}
+
+/* Write as much of the current response as the socket takes */
+static enum AssetSendResult send_response(AssetServer* server, AssetConn* conn) {
+    while (conn->HeaderSent < conn->HeaderLength) {
+        /* The head rides in the same segment as the first body bytes */
+        int flags = MSG_NOSIGNAL | (conn->File >= 0 || conn->Body != NULL ? MSG_MORE : 0);
+        ssize_t sent = send(conn->Source.FD, conn->Header + conn->HeaderSent,
+                            conn->HeaderLength - conn->HeaderSent, flags);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? ASSET_SEND_PENDING : ASSET_SEND_ERROR;
+        }
+        conn->HeaderSent += (size_t)sent;
+        __atomic_add_fetch(&server->BytesSent, (int64_t)sent, __ATOMIC_RELAXED);
+    }
+
+    while (conn->Body != NULL && conn->Offset < conn->End) {
+        off_t remaining = conn->End - conn->Offset;
+        size_t chunk = remaining < ASSET_SEND_CHUNK ? (size_t)remaining : ASSET_SEND_CHUNK;
+        ssize_t sent = send(conn->Source.FD, conn->Body + conn->Offset, chunk, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? ASSET_SEND_PENDING : ASSET_SEND_ERROR;
+        }
+        conn->Offset += sent;
+        __atomic_add_fetch(&server->BytesSent, (int64_t)sent, __ATOMIC_RELAXED);
+    }
+
+    while (conn->File >= 0 && conn->Offset < conn->End) {
+        off_t remaining = conn->End - conn->Offset;
+        size_t chunk = remaining < ASSET_SEND_CHUNK ? (size_t)remaining : ASSET_SEND_CHUNK;
+#ifdef __linux__
+        ssize_t sent = sendfile(conn->Source.FD, conn->File, &conn->Offset, chunk);
+#else
+        char buffer[16384];
+        if (chunk > sizeof(buffer)) {
+            chunk = sizeof(buffer);
+        }
+        ssize_t sent = pread(conn->File, buffer, chunk, conn->Offset);
+        if (sent > 0) {
+            sent = send(conn->Source.FD, buffer, (size_t)sent, MSG_NOSIGNAL);
+            if (sent > 0) {
+                conn->Offset += sent;
+            }
+        }
+#endif
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK ? ASSET_SEND_PENDING : ASSET_SEND_ERROR;
+        }
+        if (sent == 0) {
+            /* File shrank under us, the promised length can no longer be met */
+            return ASSET_SEND_ERROR;
+        }
+        __atomic_add_fetch(&server->BytesSent, (int64_t)sent, __ATOMIC_RELAXED);
+    }
+
+    if (conn->File >= 0) {
+        close(conn->File);
+        conn->File = -1;
+    }
+    conn->Body = NULL;
+    conn->Responding = false;
+    return ASSET_SEND_DONE;
+}
+
+/* Read until EAGAIN or the buffer is full, false once the peer is gone and nothing is left to answer */
+static bool read_requests(AssetConn* conn) {
+    while (conn->Used < sizeof(conn->Request)) {
+        ssize_t received = recv(conn->Source.FD, conn->Request + conn->Used, sizeof(conn->Request) - conn->Used, 0);
+        if (received > 0) {
+            conn->Used += (size_t)received;
+            continue;
+        }
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        }
+        conn->PeerClosed = true;
+        return conn->Used > 0;
+    }
+    return true;
+}
+
+/* Add connection to the table */
+static bool add_conn(AssetServer* server, AssetConn* conn) {
+    if (server->ConnCount == server->ConnCapacity) {
+        int capacity = server->ConnCapacity * 2;
+        AssetConn** conns = (AssetConn**)realloc(server->Conns, capacity * sizeof(AssetConn*));
+        if (conns == NULL) {
+            return false;
+        }
+        server->Conns = conns;
+        server->ConnCapacity = capacity;
+    }
+    conn->Index = server->ConnCount;
+    server->Conns[server->ConnCount++] = conn;
+    return true;
+}
+
+/* Close connection and drop it from the table */
+static void close_conn(AssetServer* server, AssetConn* conn) {
+    event_loop_remove(server->Loop, &conn->Source);
+    close(conn->Source.FD);
+    if (conn->File >= 0) {
+        close(conn->File);
+    }
+    int last = server->ConnCount - 1;
+    server->Conns[conn->Index] = server->Conns[last];
+    server->Conns[conn->Index]->Index = conn->Index;
+    server->ConnCount--;
+    free(conn);
+}
+
+/* Drive a connection until it needs the socket to become ready again */
+static void serve(AssetServer* server, AssetConn* conn) {
+    for (;;) {
+        if (conn->Responding) {
+            enum AssetSendResult result = send_response(server, conn);
+            if (result == ASSET_SEND_ERROR) {
+                close_conn(server, conn);
+                return;
+            }
+            conn->LastActive = monotonic_ms();
+            if (result == ASSET_SEND_PENDING) {
+                /* Only writability matters until the response is out */
+                if (!conn->WantWrite) {
+                    conn->WantWrite = true;
+                    event_loop_modify(server->Loop, &conn->Source, EVENT_WRITE);
+                }
+                return;
+            }
+            if (!conn->KeepAlive) {
+                close_conn(server, conn);
+                return;
+            }
+        }
+        if (conn->WantWrite) {
+            conn->WantWrite = false;
+            event_loop_modify(server->Loop, &conn->Source, EVENT_READ);
+        }
+
+        /* Answer pipelined requests already buffered before reading more */
+        if (start_response(server, conn)) {
+            continue;
+        }
+        if (conn->PeerClosed) {
+            close_conn(server, conn);
+            return;
+        }
+        size_t before = conn->Used;
+        if (!read_requests(conn)) {
+            close_conn(server, conn);
+            return;
+        }
+        if (conn->Used == before && !conn->PeerClosed) {
+            return;
+        }
+        conn->LastActive = monotonic_ms();
+    }
+}
+
+/* Connection readiness */
+static void on_conn_event(EventLoop* loop, EventSource* source, uint32_t events) {
+    AssetServer* server = (AssetServer*)event_loop_get_data(loop);
+    AssetConn* conn = (AssetConn*)source;
+    if ((events & EVENT_ERROR) && !(events & (EVENT_READ | EVENT_WRITE))) {
+        close_conn(server, conn);
+        return;
+    }
+    serve(server, conn);
+}
+
+/* Accept new connections */
+static void on_listener_event(EventLoop* loop, EventSource* source, uint32_t events) {
+    AssetServer* server = (AssetServer*)event_loop_get_data(loop);
+    (void)events;
+    for (;;) {
+        int client_fd = accept(source->FD, NULL, NULL);
+        if (client_fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+        if (server->ConnCount >= ASSET_MAX_CONNS || !set_nonblocking(client_fd)) {
+            close(client_fd);
+            continue;
+        }
+        int opt = 1;
+        setsockopt(client_fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+        AssetConn* conn = (AssetConn*)malloc(sizeof(AssetConn));
+        if (conn == NULL) {
+            close(client_fd);
+            continue;
+        }
+        memset(conn, 0, offsetof(AssetConn, Header));
+        conn->File = -1;
+        conn->LastActive = monotonic_ms();
+        event_source_init(&conn->Source, client_fd, on_conn_event);
+        if (!add_conn(server, conn)) {
+            close(client_fd);
+            free(conn);
+            continue;
+        }
+        if (!event_loop_add(server->Loop, &conn->Source, EVENT_READ)) {
+            close_conn(server, conn);
+        }
+    }
+}
+
+/* Wakeup fd readiness, only ever a stop request */
+static void on_wakeup_event(EventLoop* loop, EventSource* source, uint32_t events) {
+    char buffer[64];
+    (void)loop;
+    (void)events;
+    while (read(source->FD, buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+/* Close keep-alive connections that went quiet */
+static void sweep_idle(AssetServer* server) {
+    int64_t now = monotonic_ms();
+    if (now - server->LastSweep < POLL_TIMEOUT_MS) {
+        return;
+    }
+    server->LastSweep = now;
+    for (int i = server->ConnCount - 1; i >= 0; i--) {
+        AssetConn* conn = server->Conns[i];
+        if (now - conn->LastActive >= ASSET_IDLE_TIMEOUT_MS) {
+            close_conn(server, conn);
+        }
+    }
+}
+
+/* Server thread body */
+static void* asset_server_thread(void* arg) {
+    AssetServer* server = (AssetServer*)arg;
+
+    /* Signals are for the game thread */
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    while (__atomic_load_n(&server->Running, __ATOMIC_ACQUIRE)) {
+        if (event_loop_poll(server->Loop, POLL_TIMEOUT_MS) < 0) {
+            perror("asset server");
+            break;
+        }
+        sweep_idle(server);
+    }
+    return NULL;
+}
+
+/* Release everything start set up */
+static void release_resources(AssetServer* server) {
+    while (server->ConnCount > 0) {
+        close_conn(server, server->Conns[server->ConnCount - 1]);
+    }
+    free(server->Conns);
+    server->Conns = NULL;
+    server->ConnCapacity = 0;
+    event_loop_free(server->Loop);
+    server->Loop = NULL;
+    if (server->Socket >= 0) {
+        close(server->Socket);
+        server->Socket = -1;
+    }
+    asset_cache_free(server->Cache);
+    server->Cache = NULL;
+    asset_pack_close(server->Pack);
+    server->Pack = NULL;
+    if (server->RootFD >= 0) {
+        close(server->RootFD);
+        server->RootFD = -1;
+    }
+    if (server->WakeReadFD >= 0) {
+        close(server->WakeReadFD);
+    }
+    if (server->WakeWriteFD >= 0 && server->WakeWriteFD != server->WakeReadFD) {
+        close(server->WakeWriteFD);
+    }
+    server->WakeReadFD = -1;
+    server->WakeWriteFD = -1;
+}
+
 /* Create new asset server */
-AssetServer* asset_server_create(int port) {
+AssetServer* asset_server_create(int port, const char* root, const char* pack) {
     AssetServer* server = (AssetServer*)malloc(sizeof(AssetServer));
     if (server == NULL) {
         return NULL;
@@ -38,7 +970,17 @@ AssetServer* asset_server_create(int port) {
     memset(server, 0, sizeof(AssetServer));
     server->Port = port;
     server->Socket = -1;
-    server->Running = false;
+    server->RootFD = -1;
+    server->WakeReadFD = -1;
+    server->WakeWriteFD = -1;
+    server->Root = strdup(root != NULL ? root : ASSET_SERVER_DEFAULT_ROOT);
+    server->PackPath = pack != NULL ? strdup(pack) : NULL;
+    if (server->Root == NULL || (pack != NULL && server->PackPath == NULL)) {
+        free(server->Root);
+        free(server->PackPath);
+        free(server);
+        return NULL;
+    }
     return server;
 }
 
@@ -46,66 +988,90 @@ AssetServer* asset_server_create(int port) {
 void asset_server_free(AssetServer* server) {
     if (server != NULL) {
         asset_server_stop(server);
+        free(server->Root);
+        free(server->PackPath);
         free(server);
     }
 }
 
 /* Start asset server */
 bool asset_server_start(AssetServer* server) {
-    if (server == NULL) {
+    if (server == NULL || server->Started) {
         return false;
     }
 
-    /* Create socket */
-    server->Socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (server->Socket < 0) {
+    if (server->PackPath != NULL) {
+        server->Pack = asset_pack_open(server->PackPath);
+        if (server->Pack == NULL) {
+            fprintf(stderr, "Asset server: cannot use pack %s, serving %s\n", server->PackPath, server->Root);
+        }
+    }
+    /* With a pack the root is only a fallback for files added since it was built */
+    server->RootFD = open(server->Root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (server->RootFD < 0 && server->Pack == NULL) {
+        fprintf(stderr, "Asset server: cannot open root %s: %s\n", server->Root, strerror(errno));
         return false;
     }
-
-    /* Set socket options */
-    int opt = 1;
-    if (setsockopt(server->Socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        close(server->Socket);
-        server->Socket = -1;
+    server->Socket = create_listen_socket(server->Port);
+    server->Conns = (AssetConn**)malloc(INITIAL_CONN_CAPACITY * sizeof(AssetConn*));
+    server->ConnCapacity = INITIAL_CONN_CAPACITY;
+    server->Loop = event_loop_create(EVENT_LOOP_DEFAULT_BATCH);
+    if (server->Socket < 0 || server->Conns == NULL || server->Loop == NULL || !create_wakeup(server)) {
+        fprintf(stderr, "Asset server: cannot listen on port %d\n", server->Port);
+        release_resources(server);
         return false;
     }
 
-    /* Bind socket */
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(server->Port);
-
-    if (bind(server->Socket, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        close(server->Socket);
-        server->Socket = -1;
+    event_loop_set_data(server->Loop, server);
+    event_source_init(&server->Listener, server->Socket, on_listener_event);
+    event_source_init(&server->Wakeup, server->WakeReadFD, on_wakeup_event);
+    if (!event_loop_add(server->Loop, &server->Listener, EVENT_READ) ||
+        !event_loop_add(server->Loop, &server->Wakeup, EVENT_READ)) {
+        release_resources(server);
         return false;
     }
 
-    /* Listen for connections */
-    if (listen(server->Socket, 5) < 0) {
-        close(server->Socket);
-        server->Socket = -1;
-        return false;
+    /* Without a cache every file is still served, straight from disk */
+    server->Cache = server->Pack != NULL ? asset_cache_create_from_pack(server->Pack) :
+                                           asset_cache_create(server->RootFD);
+    if (server->Cache == NULL) {
+        fprintf(stderr, "Asset server: cache not built, serving from disk\n");
+    } else {
+        AssetCacheStats stats;
+        asset_cache_get_stats(server->Cache, &stats);
+        printf("Asset cache: %d files, %lld bytes from %s, %lld bytes of precompressed variants saving %lld, "
+               "built in %lld ms\n",
+               stats.Files, (long long)stats.Bytes, server->Pack != NULL ? server->PackPath : server->Root,
+               (long long)stats.VariantBytes, (long long)stats.VariantSaved, (long long)stats.BuildMs);
     }
 
-    server->Running = true;
+    server->LastSweep = monotonic_ms();
+    __atomic_store_n(&server->Running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&server->Thread, NULL, asset_server_thread, server) != 0) {
+        server->Running = false;
+        release_resources(server);
+        return false;
+    }
+    server->Started = true;
+    printf("Asset server serving %s on port %d\n", server->Pack != NULL ? server->PackPath : server->Root,
+           server->Port);
     return true;
 }
 
 /* Stop asset server */
 void asset_server_stop(AssetServer* server) {
-    if (server != NULL && server->Socket >= 0) {
-        close(server->Socket);
-        server->Socket = -1;
-        server->Running = false;
+    if (server != NULL && server->Started) {
+        __atomic_store_n(&server->Running, false, __ATOMIC_RELEASE);
+        wake(server);
+        pthread_join(server->Thread, NULL);
+        server->Started = false;
+        release_resources(server);
     }
 }
 
 /* Check if running */
 bool asset_server_is_running(AssetServer* server) {
-    return server != NULL && server->Running;
+    return server != NULL && __atomic_load_n(&server->Running, __ATOMIC_ACQUIRE);
 }
 
 /* Get port */
@@ -113,10 +1079,12 @@ int asset_server_get_port(AssetServer* server) {
     return server != NULL ? server->Port : 0;
 }
 
-/* Accept connection (non-blocking, returns -1 if no connection) */
-int asset_server_accept(AssetServer* server) {
-    if (server == NULL || server->Socket < 0) {
-        return -1;
+/* Requests answered and bytes written since start */
+void asset_server_get_stats(AssetServer* server, int64_t* requests, int64_t* bytes_sent) {
+    if (requests != NULL) {
+        *requests = server != NULL ? __atomic_load_n(&server->Requests, __ATOMIC_RELAXED) : 0;
+    }
+    if (bytes_sent != NULL) {
+        *bytes_sent = server != NULL ? __atomic_load_n(&server->BytesSent, __ATOMIC_RELAXED) : 0;
     }
-    return accept(server->Socket, NULL, NULL);
-}
\ No newline at end of file
+}
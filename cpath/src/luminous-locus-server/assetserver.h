@@ -6,17 +6,25 @@
 #define ASSETSERVER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+/* Directory served when none is given, relative to the working directory */
+#define ASSET_SERVER_DEFAULT_ROOT "exec"
 
 /* Asset server */
 typedef struct AssetServer AssetServer;
 
-/* Create server */
-AssetServer* asset_server_create(int port);
+/*
+ * Create server for the files under root. When pack names an asset pack
+ * its contents are served from the mapping, and root only for files the
+ * pack does not hold; NULL serves the root alone.
+ */
+AssetServer* asset_server_create(int port, const char* root, const char* pack);
 
 /* Free server */
 void asset_server_free(AssetServer* server);
 
-/* Start/stop */
+/* Start/stop the server thread */
 bool asset_server_start(AssetServer* server);
 void asset_server_stop(AssetServer* server);
 
@@ -24,7 +32,7 @@ void asset_server_stop(AssetServer* server);
 bool asset_server_is_running(AssetServer* server);
 int asset_server_get_port(AssetServer* server);
 
-/* Accept connection */
-int asset_server_accept(AssetServer* server);
+/* Requests answered and bytes written since start, safe from any thread */
+void asset_server_get_stats(AssetServer* server, int64_t* requests, int64_t* bytes_sent);
 
-#endif /* ASSETSERVER_H */
\ No newline at end of file
+#endif /* ASSETSERVER_H */
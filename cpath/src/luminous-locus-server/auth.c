@@ -1,14 +1,31 @@
 /*
  * Luminous Locus Auth Module
  * Authentication and user management
+ *
+ * Logins are checked off the network threads: a reactor queues an
+ * AuthJob and gets it back through the job's Done callback, which runs
+ * on a worker. Checking a password is where a deliberately slow hash
+ * goes, so a burst of logins at round start only lengthens the queue
+ * instead of stalling the event loops. Secrets are compared in constant
+ * time. A reconnect with the same password skips the check while the
+ * database still holds the hash it was verified against, which a
+ * reload that changes or removes the user invalidates. The cache holds
+ * only a SipHash digest of login, password and hash under a key drawn
+ * at startup, never the password itself.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/random.h>
 #include "model.h"
 #include "json_db.h"
+#include "auth.h"
 
 /* Guest info constant */
 static const UserInfo GuestInfo = {
@@ -20,6 +37,62 @@ static const UserInfo GuestInfo = {
 /* Error codes */
 const int ErrNotAuthenticated = -1;
 
+/* Digest width of a cached verification */
+#define AUTH_DIGEST_SIZE 16
+
+/* One verified login */
+typedef struct AuthCacheEntry {
+    int64_t Verified;       /* monotonic ns, 0 marks a free slot */
+    uint8_t Digest[AUTH_DIGEST_SIZE];   /* keyed digest of login, password and hash */
+} AuthCacheEntry;
+
+/* Auth worker pool */
+struct AuthPool {
+    json_db_t* DB;
+    pthread_t* Threads;
+    int ThreadCount;
+    pthread_mutex_t Mutex;
+    pthread_cond_t Ready;
+    AuthJob* Head;
+    AuthJob* Tail;
+    int Queued;
+    bool Stopping;
+    pthread_mutex_t CacheMutex;
+    uint64_t CacheKey[2];
+    bool CacheKeyed;        /* no key, no cache */
+    AuthCacheEntry Cache[AUTH_CACHE_SLOTS];
+};
+
+/* Monotonic time in nanoseconds */
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Compare secrets without an early exit */
+bool auth_equal(const char* expected, const char* given) {
+    size_t e = 0;
+    size_t g = 0;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < AUTH_SECRET_WIDTH; i++) {
+        unsigned char a = (unsigned char)expected[e];
+        unsigned char b = (unsigned char)given[g];
+        diff |= a ^ b;
+        /* Stay on the terminator once reached */
+        e += a != 0;
+        g += b != 0;
+    }
+    /* Anything past the width never matches */
+    diff |= (unsigned char)expected[e] | (unsigned char)given[g];
+    return diff == 0;
+}
+
+/* Check a password against the stored hash, the place for a slow KDF */
+static bool verify_password(const UserInfo* user, const char* password) {
+    return auth_equal(user->Passhash, password);
+}
+
 /* Authenticate user against database */
 int authenticate(json_db_t* db, const char* username, const char* passhash, bool is_guest, UserInfo* result) {
     if (is_guest) {
@@ -28,17 +101,262 @@ int authenticate(json_db_t* db, const char* username, const char* passhash, bool
         return 0;
     }
 
-    UserInfo* info = json_db_get_user(db, username);
-    if (info == NULL) {
+    UserInfo info;
+    if (!json_db_get_user(db, username, &info)) {
         return ErrNotAuthenticated;
     }
 
-    if (strcmp(info->Passhash, passhash) != 0) {
-        free(info);
+    if (!verify_password(&info, passhash)) {
         return ErrNotAuthenticated;
     }
 
-    memcpy(result, info, sizeof(UserInfo));
-    free(info);
+    memcpy(result, &info, sizeof(UserInfo));
     return 0;
-}
\ No newline at end of file
+}
+
+/* Rotate left */
+static inline uint64_t rotl64(uint64_t x, int bits) {
+    return (x << bits) | (x >> (64 - bits));
+}
+
+/* One SipHash round */
+#define SIPROUND(v0, v1, v2, v3)                                                            \
+    do {                                                                                    \
+        v0 += v1; v1 = rotl64(v1, 13); v1 ^= v0; v0 = rotl64(v0, 32);                       \
+        v2 += v3; v3 = rotl64(v3, 16); v3 ^= v2;                                            \
+        v0 += v3; v3 = rotl64(v3, 21); v3 ^= v0;                                            \
+        v2 += v1; v1 = rotl64(v1, 17); v1 ^= v2; v2 = rotl64(v2, 32);                       \
+    } while (0)
+
+/* SipHash-2-4 with 128-bit output */
+static void siphash128(const uint64_t key[2], const uint8_t* data, size_t length, uint8_t out[16]) {
+    uint64_t v0 = key[0] ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = key[1] ^ 0x646f72616e646f6dULL ^ 0xee;
+    uint64_t v2 = key[0] ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = key[1] ^ 0x7465646279746573ULL;
+
+    size_t full = length & ~(size_t)7;
+    for (size_t i = 0; i < full; i += 8) {
+        uint64_t m = 0;
+        for (int b = 0; b < 8; b++) {
+            m |= (uint64_t)data[i + b] << (8 * b);
+        }
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+    uint64_t last = (uint64_t)length << 56;
+    for (size_t b = 0; b < (length & 7); b++) {
+        last |= (uint64_t)data[full + b] << (8 * b);
+    }
+    v3 ^= last;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xee;
+    for (int r = 0; r < 4; r++) {
+        SIPROUND(v0, v1, v2, v3);
+    }
+    uint64_t low = v0 ^ v1 ^ v2 ^ v3;
+    v1 ^= 0xdd;
+    for (int r = 0; r < 4; r++) {
+        SIPROUND(v0, v1, v2, v3);
+    }
+    uint64_t high = v0 ^ v1 ^ v2 ^ v3;
+    for (int b = 0; b < 8; b++) {
+        out[b] = (uint8_t)(low >> (8 * b));
+        out[8 + b] = (uint8_t)(high >> (8 * b));
+    }
+}
+
+/* Keyed digest of a login, the password given and the hash it was checked against */
+static void cache_digest(AuthPool* pool, const UserInfo* user, const char* password, uint8_t digest[AUTH_DIGEST_SIZE]) {
+    uint8_t buffer[sizeof(user->Login) + AUTH_SECRET_WIDTH + sizeof(user->Passhash)];
+    size_t length = 0;
+    /* NUL separators keep the three fields apart */
+    const char* fields[3] = {user->Login, password, user->Passhash};
+    size_t limits[3] = {sizeof(user->Login), AUTH_SECRET_WIDTH, sizeof(user->Passhash)};
+    for (int f = 0; f < 3; f++) {
+        size_t field_length = strnlen(fields[f], limits[f] - 1);
+        memcpy(buffer + length, fields[f], field_length);
+        length += field_length;
+        buffer[length++] = 0;
+    }
+    siphash128(pool->CacheKey, buffer, length, digest);
+    explicit_bzero(buffer, sizeof(buffer));
+}
+
+/* Cache slot of a login */
+static AuthCacheEntry* cache_slot(AuthPool* pool, const char* login) {
+    uint32_t hash = 2166136261u;
+    for (const char* p = login; *p != '\0'; p++) {
+        hash = (hash ^ (unsigned char)*p) * 16777619u;
+    }
+    return &pool->Cache[hash % AUTH_CACHE_SLOTS];
+}
+
+/* This password passed against this hash recently */
+static bool cache_check(AuthPool* pool, const UserInfo* user, const char* password, int64_t now) {
+    if (!pool->CacheKeyed) {
+        return false;
+    }
+    uint8_t digest[AUTH_DIGEST_SIZE];
+    cache_digest(pool, user, password, digest);
+    AuthCacheEntry* entry = cache_slot(pool, user->Login);
+    pthread_mutex_lock(&pool->CacheMutex);
+    unsigned char diff = 0;
+    for (int i = 0; i < AUTH_DIGEST_SIZE; i++) {
+        diff |= entry->Digest[i] ^ digest[i];
+    }
+    bool hit = entry->Verified != 0 && now - entry->Verified < AUTH_CACHE_TTL_NS && diff == 0;
+    pthread_mutex_unlock(&pool->CacheMutex);
+    return hit;
+}
+
+/* Remember a verification, replacing whatever shared the slot */
+static void cache_store(AuthPool* pool, const UserInfo* user, const char* password, int64_t now) {
+    if (!pool->CacheKeyed) {
+        return;
+    }
+    uint8_t digest[AUTH_DIGEST_SIZE];
+    cache_digest(pool, user, password, digest);
+    AuthCacheEntry* entry = cache_slot(pool, user->Login);
+    pthread_mutex_lock(&pool->CacheMutex);
+    entry->Verified = now;
+    memcpy(entry->Digest, digest, sizeof(digest));
+    pthread_mutex_unlock(&pool->CacheMutex);
+}
+
+/* Check one job, filling its result */
+static void run_job(AuthPool* pool, AuthJob* job) {
+    job->Result = ErrNotAuthenticated;
+    if (job->IsGuest) {
+        memcpy(&job->Info, &GuestInfo, sizeof(UserInfo));
+        job->Result = 0;
+        return;
+    }
+    if (!json_db_get_user(pool->DB, job->Login, &job->Info)) {
+        return;
+    }
+
+    int64_t now = monotonic_ns();
+    if (cache_check(pool, &job->Info, job->Password, now)) {
+        job->Cached = true;
+        job->Result = 0;
+    } else if (verify_password(&job->Info, job->Password)) {
+        cache_store(pool, &job->Info, job->Password, now);
+        job->Result = 0;
+    }
+}
+
+/* Worker thread, takes jobs until the pool stops */
+static void* auth_worker(void* arg) {
+    AuthPool* pool = (AuthPool*)arg;
+    for (;;) {
+        pthread_mutex_lock(&pool->Mutex);
+        while (pool->Head == NULL && !pool->Stopping) {
+            pthread_cond_wait(&pool->Ready, &pool->Mutex);
+        }
+        if (pool->Stopping) {
+            pthread_mutex_unlock(&pool->Mutex);
+            return NULL;
+        }
+        AuthJob* job = pool->Head;
+        pool->Head = job->Next;
+        if (pool->Head == NULL) {
+            pool->Tail = NULL;
+        }
+        pool->Queued--;
+        pthread_mutex_unlock(&pool->Mutex);
+
+        job->Next = NULL;
+        run_job(pool, job);
+        /* The password is not needed past the check */
+        explicit_bzero(job->Password, sizeof(job->Password));
+        job->Done(job);
+    }
+}
+
+/* Create auth worker pool */
+AuthPool* auth_pool_create(json_db_t* db, int threads) {
+    AuthPool* pool = (AuthPool*)calloc(1, sizeof(AuthPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->DB = db;
+    if (threads <= 0) {
+        threads = AUTH_POOL_DEFAULT_THREADS;
+    }
+    pool->Threads = (pthread_t*)calloc(threads, sizeof(pthread_t));
+    pthread_mutex_init(&pool->Mutex, NULL);
+    pthread_cond_init(&pool->Ready, NULL);
+    pthread_mutex_init(&pool->CacheMutex, NULL);
+    pool->CacheKeyed = getrandom(pool->CacheKey, sizeof(pool->CacheKey), 0) == (ssize_t)sizeof(pool->CacheKey);
+    if (pool->Threads == NULL) {
+        auth_pool_free(pool);
+        return NULL;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        if (pthread_create(&pool->Threads[i], NULL, auth_worker, pool) != 0) {
+            break;
+        }
+        pool->ThreadCount++;
+    }
+    if (pool->ThreadCount == 0) {
+        auth_pool_free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/* Free auth worker pool */
+void auth_pool_free(AuthPool* pool) {
+    if (pool != NULL) {
+        pthread_mutex_lock(&pool->Mutex);
+        pool->Stopping = true;
+        pthread_cond_broadcast(&pool->Ready);
+        pthread_mutex_unlock(&pool->Mutex);
+        for (int i = 0; i < pool->ThreadCount; i++) {
+            pthread_join(pool->Threads[i], NULL);
+        }
+
+        AuthJob* job = pool->Head;
+        while (job != NULL) {
+            AuthJob* next = job->Next;
+            free(job);
+            job = next;
+        }
+        pthread_mutex_destroy(&pool->Mutex);
+        pthread_cond_destroy(&pool->Ready);
+        pthread_mutex_destroy(&pool->CacheMutex);
+        free(pool->Threads);
+        free(pool);
+    }
+}
+
+/* Queue a login for the workers */
+bool auth_pool_submit(AuthPool* pool, AuthJob* job) {
+    if (pool == NULL || job == NULL || job->Done == NULL) {
+        return false;
+    }
+    job->Next = NULL;
+    job->Cached = false;
+
+    pthread_mutex_lock(&pool->Mutex);
+    bool queued = !pool->Stopping && pool->Queued < AUTH_QUEUE_MAX;
+    if (queued) {
+        if (pool->Tail != NULL) {
+            pool->Tail->Next = job;
+        } else {
+            pool->Head = job;
+        }
+        pool->Tail = job;
+        pool->Queued++;
+        pthread_cond_signal(&pool->Ready);
+    }
+    pthread_mutex_unlock(&pool->Mutex);
+    return queued;
+}
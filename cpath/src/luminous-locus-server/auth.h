@@ -0,0 +1,67 @@
+/*
+ * Luminous Locus Auth Header
+ */
+
+#ifndef AUTH_H
+#define AUTH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "model.h"
+#include "json_db.h"
+
+/* Worker threads checking logins */
+#define AUTH_POOL_DEFAULT_THREADS 2
+
+/* Logins waiting for a worker before new ones are turned away */
+#define AUTH_QUEUE_MAX 1024
+
+/* Verified logins remembered for reconnects, and for how long */
+#define AUTH_CACHE_SLOTS 256
+#define AUTH_CACHE_TTL_NS (600LL * 1000000000LL)
+
+/* Error codes */
+extern const int ErrNotAuthenticated;
+
+/* Check a login against the database and fill result, 0 or ErrNotAuthenticated */
+int authenticate(json_db_t* db, const char* username, const char* passhash, bool is_guest, UserInfo* result);
+
+/* Longest secret auth_equal compares, terminator included */
+#define AUTH_SECRET_WIDTH 128
+
+/* Compare two secrets shorter than AUTH_SECRET_WIDTH in time that depends on neither */
+bool auth_equal(const char* expected, const char* given);
+
+/* One login to check, malloc'd by the submitter */
+typedef struct AuthJob AuthJob;
+
+/* Called on a worker thread once a job is checked, the job then belongs to the callee */
+typedef void (*AuthDoneFn)(AuthJob* job);
+
+struct AuthJob {
+    AuthJob* Next;          /* the submitter's to use once done */
+    AuthDoneFn Done;
+    void* Owner;
+    int ClientID;
+    bool IsGuest;
+    char Login[64];
+    char Password[128];
+    int64_t Submitted;      /* monotonic ns, for the submitter's latency */
+    int Result;             /* 0 or ErrNotAuthenticated */
+    bool Cached;            /* passed on a recent verification */
+    UserInfo Info;
+};
+
+/* Worker threads fed by one queue */
+typedef struct AuthPool AuthPool;
+
+/* Create pool checking against db */
+AuthPool* auth_pool_create(json_db_t* db, int threads);
+
+/* Stop the workers and free the pool, queued jobs are freed unchecked */
+void auth_pool_free(AuthPool* pool);
+
+/* Queue a job, false when the queue is full or the pool stopping */
+bool auth_pool_submit(AuthPool* pool, AuthJob* job);
+
+#endif /* AUTH_H */
@@ -1,129 +1,224 @@
 /*
  * Luminous Locus Client Module
  * Client state management
+ *
+ * The registry is a slot map. An ID is (generation << CLIENT_SLOT_BITS |
+ * slot) scaled by the partition stride, so IDs stay striped across
+ * reactors while lookup is a divide, a mask and a generation compare.
+ * Free slots form a list threaded through the slot table. Live clients
+ * sit in a dense array, with their cold details in a parallel one, and
+ * removal swaps the last client into the hole.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
 #include <time.h>
 #include "model.h"
 #include "telemetry.h"
+#include "client.h"
 
-/* Client states */
-enum ClientState {
-    CLIENT_DISCONNECTED,
-    CLIENT_CONNECTING,
-    CLIENT_LOGGED_IN,
-    CLIENT_ACTIVE
-};
+/* Slot map sizing */
+#define CLIENT_SLOT_BITS 12
+#define CLIENT_SLOT_MASK ((1 << CLIENT_SLOT_BITS) - 1)
+#define MAX_CLIENTS (1 << CLIENT_SLOT_BITS)
+#define INITIAL_CLIENTS 64
 
-/* Client structure */
-struct Client {
-    int ID;
-    char Address[64];
-    int Port;
-    char Login[64];
-    bool IsMaster;
-    bool IsAdmin;
-    enum ClientState State;
-    time_t LastSeen;
-    float PositionX;
-    float PositionY;
-    float PositionZ;
-};
+/* No free slot */
+#define SLOT_NONE -1
 
-/* Client registry for managing multiple clients */
-#define MAX_CLIENTS 256
+/* One slot, Index is the dense position when live or the next free slot */
+typedef struct ClientSlot {
+    uint32_t Generation;
+    int Index;
+    bool Live;
+} ClientSlot;
 
 struct ClientRegistry {
-    int next_id;
+    int first_id;
+    int id_stride;
+    uint32_t generation_limit;   /* generations that fit an int ID */
     int count;
-    struct Client* clients[MAX_CLIENTS];
+    int capacity;
+    int free_head;
+    ClientSlot* slots;
+    struct Client* clients;      /* dense, hot */
+    struct ClientInfo* infos;    /* dense, cold, same order */
+    int* dense_slot;             /* slot of each dense entry */
 };
 
+/* Grow the slot table and dense arrays */
+static bool client_registry_grow(ClientRegistry* reg) {
+    if (reg->capacity >= MAX_CLIENTS) {
+        return false;
+    }
+    int capacity = reg->capacity > 0 ? reg->capacity * 2 : INITIAL_CLIENTS;
+    if (capacity > MAX_CLIENTS) {
+        capacity = MAX_CLIENTS;
+    }
+
+    ClientSlot* slots = (ClientSlot*)realloc(reg->slots, (size_t)capacity * sizeof(ClientSlot));
+    if (slots == NULL) {
+        return false;
+    }
+    reg->slots = slots;
+    struct Client* clients = (struct Client*)realloc(reg->clients, (size_t)capacity * sizeof(struct Client));
+    if (clients == NULL) {
+        return false;
+    }
+    reg->clients = clients;
+    struct ClientInfo* infos = (struct ClientInfo*)realloc(reg->infos, (size_t)capacity * sizeof(struct ClientInfo));
+    if (infos == NULL) {
+        return false;
+    }
+    reg->infos = infos;
+    int* dense_slot = (int*)realloc(reg->dense_slot, (size_t)capacity * sizeof(int));
+    if (dense_slot == NULL) {
+        return false;
+    }
+    reg->dense_slot = dense_slot;
+
+    /* New slots go on the free list in order */
+    for (int i = capacity - 1; i >= reg->capacity; i--) {
+        reg->slots[i].Generation = 0;
+        reg->slots[i].Live = false;
+        reg->slots[i].Index = reg->free_head;
+        reg->free_head = i;
+    }
+    reg->capacity = capacity;
+    return true;
+}
+
+/* Map an ID to its slot, -1 when it is not live */
+static int client_registry_slot(ClientRegistry* reg, int client_id) {
+    if (reg == NULL || client_id < reg->first_id || (client_id - reg->first_id) % reg->id_stride != 0) {
+        return -1;
+    }
+    int local = (client_id - reg->first_id) / reg->id_stride;
+    int slot = local & CLIENT_SLOT_MASK;
+    uint32_t generation = (uint32_t)local >> CLIENT_SLOT_BITS;
+    if (slot >= reg->capacity || !reg->slots[slot].Live || reg->slots[slot].Generation != generation) {
+        return -1;
+    }
+    return slot;
+}
+
 /* Create new client registry */
 ClientRegistry* client_registry_create(void) {
+    return client_registry_create_partition(0, 1);
+}
+
+/* Create registry partition */
+ClientRegistry* client_registry_create_partition(int first_id, int stride) {
     ClientRegistry* reg = (ClientRegistry*)malloc(sizeof(ClientRegistry));
     if (reg == NULL) {
         return NULL;
     }
     memset(reg, 0, sizeof(ClientRegistry));
+    reg->first_id = first_id > 0 ? first_id : 0;
+    reg->id_stride = stride > 0 ? stride : 1;
+    /* Whole generations below INT_MAX, so every ID of every slot is a positive int */
+    int64_t local_max = (INT_MAX - reg->first_id) / reg->id_stride;
+    reg->generation_limit = (uint32_t)((local_max + 1) >> CLIENT_SLOT_BITS);
+    reg->free_head = SLOT_NONE;
+    if (!client_registry_grow(reg)) {
+        client_registry_free(reg);
+        return NULL;
+    }
     return reg;
 }
 
 /* Free client registry */
 void client_registry_free(ClientRegistry* reg) {
     if (reg != NULL) {
-        for (int i = 0; i < MAX_CLIENTS; i++) {
-            if (reg->clients[i] != NULL) {
-                free(reg->clients[i]);
-            }
-        }
+        free(reg->slots);
+        free(reg->clients);
+        free(reg->infos);
+        free(reg->dense_slot);
         free(reg);
     }
 }
 
 /* Register new client */
 int client_registry_register(ClientRegistry* reg, const char* address, int port, const char* login, bool is_admin) {
-    if (reg->count >= MAX_CLIENTS) {
+    if (reg == NULL || (reg->free_head == SLOT_NONE && !client_registry_grow(reg))) {
         return -1;
     }
 
-    struct Client* client = (struct Client*)malloc(sizeof(struct Client));
-    if (client == NULL) {
-        return -1;
-    }
+    int slot = reg->free_head;
+    ClientSlot* entry = &reg->slots[slot];
+    reg->free_head = entry->Index;
+    entry->Live = true;
+    entry->Index = reg->count;
+    reg->dense_slot[reg->count] = slot;
 
+    int local = (int)(entry->Generation << CLIENT_SLOT_BITS) | slot;
+    struct Client* client = &reg->clients[reg->count];
     memset(client, 0, sizeof(struct Client));
-    client->ID = reg->next_id++;
-    strncpy(client->Address, address, sizeof(client->Address) - 1);
-    client->Port = port;
-    strncpy(client->Login, login, sizeof(client->Login) - 1);
+    client->ID = reg->first_id + local * reg->id_stride;
     client->IsAdmin = is_admin;
     client->State = CLIENT_CONNECTING;
     client->LastSeen = time(NULL);
 
-    /* Find empty slot */
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (reg->clients[i] == NULL) {
-            reg->clients[i] = client;
-            reg->count++;
-            return client->ID;
-        }
-    }
+    struct ClientInfo* info = &reg->infos[reg->count];
+    memset(info, 0, sizeof(struct ClientInfo));
+    strncpy(info->Address, address, sizeof(info->Address) - 1);
+    info->Port = port;
+    strncpy(info->Login, login, sizeof(info->Login) - 1);
 
-    free(client);
-    return -1;
+    reg->count++;
+    return client->ID;
 }
 
 /* Remove client */
 bool client_registry_remove(ClientRegistry* reg, int client_id) {
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (reg->clients[i] != NULL && reg->clients[i]->ID == client_id) {
-            free(reg->clients[i]);
-            reg->clients[i] = NULL;
-            reg->count--;
-            return true;
-        }
-    }
-    return false;
+    int slot = client_registry_slot(reg, client_id);
+    if (slot < 0) {
+        return false;
+    }
+
+    /* Keep the dense arrays packed */
+    int index = reg->slots[slot].Index;
+    int last = --reg->count;
+    if (index != last) {
+        reg->clients[index] = reg->clients[last];
+        reg->infos[index] = reg->infos[last];
+        reg->dense_slot[index] = reg->dense_slot[last];
+        reg->slots[reg->dense_slot[index]].Index = index;
+    }
+
+    /* A new generation makes the old ID stale */
+    ClientSlot* entry = &reg->slots[slot];
+    entry->Live = false;
+    entry->Generation = (entry->Generation + 1) % reg->generation_limit;
+    entry->Index = reg->free_head;
+    reg->free_head = slot;
+    return true;
 }
 
 /* Get client by ID */
 struct Client* client_registry_get(ClientRegistry* reg, int client_id) {
-    for (int i = 0; i < MAX_CLIENTS; i++) {
-        if (reg->clients[i] != NULL && reg->clients[i]->ID == client_id) {
-            return reg->clients[i];
-        }
-    }
-    return NULL;
+    int slot = client_registry_slot(reg, client_id);
+    return slot >= 0 ? &reg->clients[reg->slots[slot].Index] : NULL;
+}
+
+/* Get client details by ID */
+struct ClientInfo* client_registry_get_info(ClientRegistry* reg, int client_id) {
+    int slot = client_registry_slot(reg, client_id);
+    return slot >= 0 ? &reg->infos[reg->slots[slot].Index] : NULL;
 }
 
 /* Get client count */
 int client_registry_count(ClientRegistry* reg) {
-    return reg->count;
+    return reg != NULL ? reg->count : 0;
+}
+
+/* Get live client by dense index */
+struct Client* client_registry_at(ClientRegistry* reg, int index) {
+    return reg != NULL && index >= 0 && index < reg->count ? &reg->clients[index] : NULL;
 }
 
 /* Check if client is master */
@@ -131,6 +226,11 @@ bool client_is_master(struct Client* client) {
     return client != NULL && client->IsMaster;
 }
 
+/* Check if client passed its login */
+bool client_is_logged_in(struct Client* client) {
+    return client != NULL && (client->State == CLIENT_LOGGED_IN || client->State == CLIENT_ACTIVE);
+}
+
 /* Update client position */
 void client_update_position(struct Client* client, float x, float y, float z) {
     if (client != NULL) {
@@ -146,4 +246,4 @@ void client_mark_active(struct Client* client) {
         client->LastSeen = time(NULL);
         client->State = CLIENT_ACTIVE;
     }
-}
\ No newline at end of file
+}
@@ -6,37 +6,55 @@
 #define CLIENT_H
 
 #include <stdbool.h>
+#include <time.h>
 #include "model.h"
 
 /* Client state */
 enum ClientState {
     CLIENT_DISCONNECTED,
     CLIENT_CONNECTING,
+    CLIENT_AUTHENTICATING,
     CLIENT_LOGGED_IN,
     CLIENT_ACTIVE
 };
 
-/* Client structure */
+struct Conn;
+
+/* Client structure, the fields touched every tick */
 struct Client {
     int ID;
-    char Address[64];
-    int Port;
-    char Login[64];
+    struct Conn* Conn;
+    enum ClientState State;
     bool IsMaster;
     bool IsAdmin;
-    enum ClientState State;
     time_t LastSeen;
     float PositionX;
     float PositionY;
     float PositionZ;
 };
 
-/* Client registry */
+/* Rarely used client details, kept apart from struct Client */
+struct ClientInfo {
+    char Address[64];
+    int Port;
+    char Login[64];
+};
+
+/*
+ * Client registry, a generational slot map. IDs encode a slot and its
+ * reuse count, so an ID kept after its client left is rejected instead
+ * of resolving to whoever took the slot. Live clients are packed in one
+ * array; pointers returned by the registry stay valid until the next
+ * register or remove.
+ */
 typedef struct ClientRegistry ClientRegistry;
 
 /* Create registry */
 ClientRegistry* client_registry_create(void);
 
+/* Create registry partition handing out first_id, first_id + stride, ... */
+ClientRegistry* client_registry_create_partition(int first_id, int stride);
+
 /* Free registry */
 void client_registry_free(ClientRegistry* reg);
 
@@ -46,15 +64,24 @@ int client_registry_register(ClientRegistry* reg, const char* address, int port,
 /* Remove client */
 bool client_registry_remove(ClientRegistry* reg, int client_id);
 
-/* Get client by ID */
+/* Get client by ID, NULL for unknown or stale IDs */
 struct Client* client_registry_get(ClientRegistry* reg, int client_id);
 
+/* Get details of a client by ID */
+struct ClientInfo* client_registry_get_info(ClientRegistry* reg, int client_id);
+
 /* Get client count */
 int client_registry_count(ClientRegistry* reg);
 
+/* Live clients, index 0 to count - 1 */
+struct Client* client_registry_at(ClientRegistry* reg, int index);
+
 /* Check if client is master */
 bool client_is_master(struct Client* client);
 
+/* Check if client passed its login */
+bool client_is_logged_in(struct Client* client);
+
 /* Update client position */
 void client_update_position(struct Client* client, float x, float y, float z);
 
@@ -8,40 +8,94 @@
 #include <string.h>
 #include <stdbool.h>
 #include <time.h>
+#include <errno.h>
 
 #ifdef _WIN32
     #include <winsock2.h>
     #include <ws2tcpip.h>
     #include <windows.h>
     #define close closesocket
+    #define CONN_WOULD_BLOCK() (WSAGetLastError() == WSAEWOULDBLOCK)
 #else
     #include <sys/types.h>
     #include <sys/socket.h>
+    #include <unistd.h>
+    #define CONN_WOULD_BLOCK() (errno == EAGAIN || errno == EWOULDBLOCK)
 #endif
 #include "model.h"
 #include "client.h"
 #include "message.h"
+#include "ring_buffer.h"
+#include "write_queue.h"
+#include "slow_consumer.h"
+#include "client_conn.h"
 
-/* Connection states */
-enum ConnState {
-    CONN_NEW,
-    CONN_READING,
-    CONN_CLOSED
-};
+/* Connection buffer, grows up to the largest message plus its header */
+#define BUFFER_MIN_SIZE 4096
+#define BUFFER_MAX_SIZE (2 * 1024 * 1024)
 
-/* Connection buffer */
-#define BUFFER_SIZE 8192
+/* Default pool slab */
+#define CONN_POOL_DEFAULT_SLAB 64
 
 struct Conn {
+    EventSource Source;  /* must stay first, see conn_from_source */
+    UringRecv* Recv;     /* io_uring backend only */
     int FD;
+    int ClientID;
+    int Index;
     enum ConnState State;
     char LastAddr[64];
     int LastPort;
-    char Buffer[BUFFER_SIZE];
-    size_t BufferUsed;
+    RingBuffer Input;
+    WriteQueue Output;
+    bool WantWrite;      /* armed for writability */
+    SlowTracker Slow;
     bool IsMaster;
+    bool Handshaken;     /* protocol version received */
+    bool Compact;        /* negotiated compact bodies at login */
+    StreamEncoder* Encoder;  /* stream compression, NULL until negotiated */
+    StreamDecoder* Decoder;
+    StreamStats Stream;
+    ConnPool* Pool;      /* owning pool, NULL when malloc'd */
+    Conn* NextFree;
 };
 
+/* One block of pooled connections */
+typedef struct ConnSlab {
+    struct ConnSlab* Next;
+    size_t Count;
+    Conn Items[];
+} ConnSlab;
+
+struct ConnPool {
+    ConnSlab* Slabs;
+    Conn* FreeList;
+    size_t SlabSize;
+    size_t InUse;
+};
+
+/* Reset connection for a new socket, the ring storage is reused */
+static void conn_reset(Conn* conn, int fd) {
+    event_source_init(&conn->Source, fd, NULL);
+    conn->Recv = NULL;
+    conn->FD = fd;
+    conn->ClientID = -1;
+    conn->Index = -1;
+    conn->State = CONN_NEW;
+    conn->LastAddr[0] = '\0';
+    conn->LastPort = 0;
+    conn->IsMaster = false;
+    conn->Handshaken = false;
+    conn->Compact = false;
+    conn->Encoder = NULL;
+    conn->Decoder = NULL;
+    memset(&conn->Stream, 0, sizeof(conn->Stream));
+    conn->WantWrite = false;
+    conn->NextFree = NULL;
+    slow_tracker_init(&conn->Slow, 0, 0);
+    write_queue_init(&conn->Output, WRITE_QUEUE_DEFAULT_HIGH_WATER);
+}
+
 /* Create new connection */
 Conn* conn_create(int fd) {
     Conn* conn = (Conn*)malloc(sizeof(Conn));
@@ -49,10 +103,11 @@ Conn* conn_create(int fd) {
         return NULL;
     }
     memset(conn, 0, sizeof(Conn));
-    conn->FD = fd;
-    conn->State = CONN_NEW;
-    conn->BufferUsed = 0;
-    conn->IsMaster = false;
+    if (!ring_buffer_init(&conn->Input, BUFFER_MIN_SIZE, BUFFER_MAX_SIZE)) {
+        free(conn);
+        return NULL;
+    }
+    conn_reset(conn, fd);
     return conn;
 }
 
@@ -62,11 +117,113 @@ void conn_free(Conn* conn) {
         /* Close socket if still open */
         if (conn->FD >= 0) {
             close(conn->FD);
+            conn->FD = -1;
         }
+        stream_encoder_free(conn->Encoder);
+        stream_decoder_free(conn->Decoder);
+        conn->Encoder = NULL;
+        conn->Decoder = NULL;
+        if (conn->Pool != NULL) {
+            conn_pool_release(conn->Pool, conn);
+            return;
+        }
+        ring_buffer_destroy(&conn->Input);
+        write_queue_destroy(&conn->Output);
         free(conn);
     }
 }
 
+/* Create connection pool */
+ConnPool* conn_pool_create(size_t slab_size) {
+    ConnPool* pool = (ConnPool*)malloc(sizeof(ConnPool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->Slabs = NULL;
+    pool->FreeList = NULL;
+    pool->SlabSize = slab_size > 0 ? slab_size : CONN_POOL_DEFAULT_SLAB;
+    pool->InUse = 0;
+    return pool;
+}
+
+/* Free connection pool, every connection must have been released */
+void conn_pool_free(ConnPool* pool) {
+    if (pool != NULL) {
+        ConnSlab* slab = pool->Slabs;
+        while (slab != NULL) {
+            ConnSlab* next = slab->Next;
+            for (size_t i = 0; i < slab->Count; i++) {
+                ring_buffer_destroy(&slab->Items[i].Input);
+            }
+            free(slab);
+            slab = next;
+        }
+        free(pool);
+    }
+}
+
+/* Add a slab to the free list */
+static bool conn_pool_grow(ConnPool* pool) {
+    ConnSlab* slab = (ConnSlab*)calloc(1, sizeof(ConnSlab) + pool->SlabSize * sizeof(Conn));
+    if (slab == NULL) {
+        return false;
+    }
+    slab->Count = pool->SlabSize;
+    slab->Next = pool->Slabs;
+    pool->Slabs = slab;
+
+    for (size_t i = slab->Count; i > 0; i--) {
+        Conn* conn = &slab->Items[i - 1];
+        conn->FD = -1;
+        conn->Pool = pool;
+        conn->NextFree = pool->FreeList;
+        pool->FreeList = conn;
+    }
+    return true;
+}
+
+/* Take a connection from the pool */
+Conn* conn_pool_acquire(ConnPool* pool, int fd) {
+    if (pool == NULL) {
+        return NULL;
+    }
+    if (pool->FreeList == NULL && !conn_pool_grow(pool)) {
+        return NULL;
+    }
+
+    Conn* conn = pool->FreeList;
+    /* Ring storage is allocated on first use and kept across reuse */
+    if (conn->Input.Data == NULL && !ring_buffer_init(&conn->Input, BUFFER_MIN_SIZE, BUFFER_MAX_SIZE)) {
+        return NULL;
+    }
+    pool->FreeList = conn->NextFree;
+    pool->InUse++;
+    conn_reset(conn, fd);
+    return conn;
+}
+
+/* Return a connection to the pool */
+void conn_pool_release(ConnPool* pool, Conn* conn) {
+    if (pool == NULL || conn == NULL) {
+        return;
+    }
+    if (conn->FD >= 0) {
+        close(conn->FD);
+        conn->FD = -1;
+    }
+    ring_buffer_clear(&conn->Input);
+    write_queue_destroy(&conn->Output);
+    conn->State = CONN_CLOSED;
+    conn->NextFree = pool->FreeList;
+    pool->FreeList = conn;
+    pool->InUse--;
+}
+
+/* Connections handed out */
+size_t conn_pool_in_use(ConnPool* pool) {
+    return pool != NULL ? pool->InUse : 0;
+}
+
 /* Get file descriptor */
 int conn_get_fd(Conn* conn) {
     return conn != NULL ? conn->FD : -1;
@@ -77,6 +234,59 @@ bool conn_is_closed(Conn* conn) {
     return conn == NULL || conn->State == CONN_CLOSED;
 }
 
+/* Mark connection as closed */
+void conn_mark_closed(Conn* conn) {
+    if (conn != NULL) {
+        conn->State = CONN_CLOSED;
+    }
+}
+
+/* Get event source */
+EventSource* conn_get_source(Conn* conn) {
+    return conn != NULL ? &conn->Source : NULL;
+}
+
+/* Get connection from its event source */
+Conn* conn_from_source(EventSource* source) {
+    return (Conn*)source;
+}
+
+/* Set io_uring recv */
+void conn_set_recv(Conn* conn, UringRecv* recv) {
+    if (conn != NULL) {
+        conn->Recv = recv;
+    }
+}
+
+/* Get io_uring recv */
+UringRecv* conn_get_recv(Conn* conn) {
+    return conn != NULL ? conn->Recv : NULL;
+}
+
+/* Set owning client */
+void conn_set_client_id(Conn* conn, int client_id) {
+    if (conn != NULL) {
+        conn->ClientID = client_id;
+    }
+}
+
+/* Get owning client */
+int conn_get_client_id(Conn* conn) {
+    return conn != NULL ? conn->ClientID : -1;
+}
+
+/* Set table index */
+void conn_set_index(Conn* conn, int index) {
+    if (conn != NULL) {
+        conn->Index = index;
+    }
+}
+
+/* Get table index */
+int conn_get_index(Conn* conn) {
+    return conn != NULL ? conn->Index : -1;
+}
+
 /* Mark connection as master */
 void conn_set_master(Conn* conn, bool is_master) {
     if (conn != NULL) {
@@ -89,6 +299,67 @@ bool conn_is_master(Conn* conn) {
     return conn != NULL && conn->IsMaster;
 }
 
+/* Mark protocol version as received */
+void conn_set_handshaken(Conn* conn, bool handshaken) {
+    if (conn != NULL) {
+        conn->Handshaken = handshaken;
+    }
+}
+
+/* Check if protocol version was received */
+bool conn_is_handshaken(Conn* conn) {
+    return conn != NULL && conn->Handshaken;
+}
+
+/* Mark compact bodies as negotiated */
+void conn_set_compact(Conn* conn, bool compact) {
+    if (conn != NULL) {
+        conn->Compact = compact;
+    }
+}
+
+/* Check if compact bodies were negotiated */
+bool conn_is_compact(Conn* conn) {
+    return conn != NULL && conn->Compact;
+}
+
+/* Set up stream compression */
+bool conn_enable_compression(Conn* conn) {
+    if (conn == NULL || conn->Encoder != NULL) {
+        return false;
+    }
+    conn->Encoder = stream_encoder_create();
+    conn->Decoder = stream_decoder_create();
+    if (conn->Encoder == NULL || conn->Decoder == NULL) {
+        stream_encoder_free(conn->Encoder);
+        stream_decoder_free(conn->Decoder);
+        conn->Encoder = NULL;
+        conn->Decoder = NULL;
+        return false;
+    }
+    return true;
+}
+
+/* Check if stream compression was negotiated */
+bool conn_is_compressed(Conn* conn) {
+    return conn != NULL && conn->Encoder != NULL;
+}
+
+/* Get encoder */
+StreamEncoder* conn_get_encoder(Conn* conn) {
+    return conn != NULL ? conn->Encoder : NULL;
+}
+
+/* Get decoder */
+StreamDecoder* conn_get_decoder(Conn* conn) {
+    return conn != NULL ? conn->Decoder : NULL;
+}
+
+/* Get compression counters */
+StreamStats* conn_get_stream_stats(Conn* conn) {
+    return conn != NULL ? &conn->Stream : NULL;
+}
+
 /* Update address info */
 void conn_update_addr(Conn* conn, const char* addr, int port) {
     if (conn != NULL) {
@@ -107,39 +378,165 @@ int conn_get_port(Conn* conn) {
     return conn != NULL ? conn->LastPort : 0;
 }
 
-/* Add data to buffer */
+/* Add data to buffer, grows the ring when needed */
 size_t conn_add_buffer(Conn* conn, const char* data, size_t length) {
-    if (conn == NULL || conn->BufferUsed + length > BUFFER_SIZE) {
+    if (conn == NULL || !ring_buffer_append(&conn->Input, data, length)) {
         return 0;
     }
-    memcpy(conn->Buffer + conn->BufferUsed, data, length);
-    conn->BufferUsed += length;
     return length;
 }
 
-/* Get buffer data */
+/* Get buffer data, contiguous */
 const char* conn_get_buffer(Conn* conn) {
-    return conn != NULL ? conn->Buffer : NULL;
+    return conn != NULL ? ring_buffer_peek(&conn->Input) : NULL;
 }
 
 /* Get buffer used */
 size_t conn_get_buffer_used(Conn* conn) {
-    return conn != NULL ? conn->BufferUsed : 0;
+    return conn != NULL ? ring_buffer_used(&conn->Input) : 0;
+}
+
+/* Get largest amount the buffer can grow to hold */
+size_t conn_get_buffer_capacity(Conn* conn) {
+    return conn != NULL ? ring_buffer_max_capacity(&conn->Input) : 0;
 }
 
 /* Clear buffer */
 void conn_clear_buffer(Conn* conn) {
     if (conn != NULL) {
-        conn->BufferUsed = 0;
+        ring_buffer_clear(&conn->Input);
     }
 }
 
-/* Consume buffer data */
+/* Consume buffer data, only moves the ring head */
 size_t conn_consume_buffer(Conn* conn, size_t amount) {
-    if (conn == NULL || amount > conn->BufferUsed) {
-        return 0;
+    return conn != NULL ? ring_buffer_consume(&conn->Input, amount) : 0;
+}
+
+/* Set outbound high-water mark */
+void conn_set_high_water(Conn* conn, size_t high_water) {
+    if (conn != NULL) {
+        conn->Output.HighWater = high_water > 0 ? high_water : WRITE_QUEUE_DEFAULT_HIGH_WATER;
+    }
+}
+
+/* Queue bytes for sending */
+bool conn_queue_output(Conn* conn, const void* data, size_t length) {
+    return conn != NULL && write_queue_push(&conn->Output, data, length);
+}
+
+/* Queue a frame for sending */
+bool conn_queue_frame(Conn* conn, uint32_t kind, const void* body, uint32_t length) {
+    return conn != NULL && write_queue_push_frame(&conn->Output, kind, body, length);
+}
+
+/* Queue a shared frame by reference */
+bool conn_queue_shared(Conn* conn, SharedFrame* frame) {
+    return conn != NULL && write_queue_push_shared(&conn->Output, frame);
+}
+
+/* Get queued output */
+size_t conn_get_output_bytes(Conn* conn) {
+    return conn != NULL ? write_queue_bytes(&conn->Output) : 0;
+}
+
+/* Describe queued output for a completion-based send */
+int conn_gather_output(Conn* conn, struct iovec* iov, int max) {
+    return conn != NULL ? write_queue_gather(&conn->Output, iov, max) : 0;
+}
+
+/* Retire output a completion-based send wrote */
+void conn_advance_output(Conn* conn, size_t written) {
+    if (conn != NULL) {
+        write_queue_advance(&conn->Output, written);
+    }
+}
+
+/* Drop unsent output */
+void conn_discard_output(Conn* conn) {
+    if (conn != NULL) {
+        write_queue_discard(&conn->Output);
+    }
+}
+
+/* Flush queued output */
+enum ConnWriteResult conn_flush(Conn* conn, size_t* bytes_written) {
+    if (conn == NULL || conn->State == CONN_CLOSED) {
+        if (bytes_written != NULL) {
+            *bytes_written = 0;
+        }
+        return CONN_WRITE_ERROR;
+    }
+    switch (write_queue_flush(&conn->Output, conn->FD, bytes_written)) {
+        case WRITE_QUEUE_DONE:
+            return CONN_WRITE_DONE;
+        case WRITE_QUEUE_PENDING:
+            return CONN_WRITE_PENDING;
+        default:
+            return CONN_WRITE_ERROR;
+    }
+}
+
+/* Mark as armed for writability */
+void conn_set_want_write(Conn* conn, bool want_write) {
+    if (conn != NULL) {
+        conn->WantWrite = want_write;
+    }
+}
+
+/* Check if armed for writability */
+bool conn_wants_write(Conn* conn) {
+    return conn != NULL && conn->WantWrite;
+}
+
+/* Get slow consumer bookkeeping */
+SlowTracker* conn_get_slow_tracker(Conn* conn) {
+    return conn != NULL ? &conn->Slow : NULL;
+}
+
+/* Read available data */
+enum ConnReadResult conn_read(Conn* conn, size_t* bytes_read) {
+    size_t total = 0;
+    enum ConnReadResult result = CONN_READ_AGAIN;
+
+    if (conn == NULL || conn->State == CONN_CLOSED) {
+        return CONN_READ_CLOSED;
+    }
+
+    conn->State = CONN_READING;
+    for (;;) {
+        size_t space = 0;
+        char* out = ring_buffer_write_space(&conn->Input, &space);
+        if (space == 0) {
+            /* Full on entry means the caller already consumed what it could */
+            if (total == 0 && ring_buffer_grow(&conn->Input)) {
+                continue;
+            }
+            result = CONN_READ_FULL;
+            break;
+        }
+
+        ssize_t got = recv(conn->FD, out, space, 0);
+        if (got > 0) {
+            ring_buffer_commit(&conn->Input, (size_t)got);
+            total += (size_t)got;
+            continue;
+        }
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got < 0 && CONN_WOULD_BLOCK()) {
+            result = CONN_READ_AGAIN;
+            break;
+        }
+
+        conn->State = CONN_CLOSED;
+        result = CONN_READ_CLOSED;
+        break;
+    }
+
+    if (bytes_read != NULL) {
+        *bytes_read = total;
     }
-    memmove(conn->Buffer, conn->Buffer + amount, conn->BufferUsed - amount);
-    conn->BufferUsed -= amount;
-    return amount;
+    return result;
 }
\ No newline at end of file
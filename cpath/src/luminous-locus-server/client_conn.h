@@ -6,6 +6,13 @@
 #define CLIENT_CONN_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "event_loop.h"
+#include "shared_frame.h"
+#include "slow_consumer.h"
+#include "stream_codec.h"
+#include "uring.h"
 
 /* Connection state */
 enum ConnState {
@@ -14,25 +21,83 @@ enum ConnState {
     CONN_CLOSED
 };
 
+/* Read result */
+enum ConnReadResult {
+    CONN_READ_AGAIN,   /* socket drained until EAGAIN */
+    CONN_READ_FULL,    /* buffer full, consume and read again (grows if still full) */
+    CONN_READ_CLOSED   /* peer closed or socket error */
+};
+
+/* Write result */
+enum ConnWriteResult {
+    CONN_WRITE_DONE,     /* output queue drained */
+    CONN_WRITE_PENDING,  /* socket full, wait for EVENT_WRITE */
+    CONN_WRITE_ERROR     /* peer gone or socket error */
+};
+
 /* Connection structure */
 typedef struct Conn Conn;
 
+/* Slab pool of connections, single-threaded */
+typedef struct ConnPool ConnPool;
+
 /* Create connection */
 Conn* conn_create(int fd);
 
-/* Free connection */
+/* Free connection, pooled connections go back to their pool */
 void conn_free(Conn* conn);
 
+/* Connection pool, slab_size connections are allocated at a time */
+ConnPool* conn_pool_create(size_t slab_size);
+void conn_pool_free(ConnPool* pool);
+Conn* conn_pool_acquire(ConnPool* pool, int fd);
+void conn_pool_release(ConnPool* pool, Conn* conn);
+size_t conn_pool_in_use(ConnPool* pool);
+
 /* Get file descriptor */
 int conn_get_fd(Conn* conn);
 
 /* Check if closed */
 bool conn_is_closed(Conn* conn);
 
+/* Mark closed */
+void conn_mark_closed(Conn* conn);
+
+/* Event loop registration, the source is the first member of Conn */
+EventSource* conn_get_source(Conn* conn);
+Conn* conn_from_source(EventSource* source);
+
+/* io_uring recv, NULL on epoll and once the recv has ended */
+void conn_set_recv(Conn* conn, UringRecv* recv);
+UringRecv* conn_get_recv(Conn* conn);
+
+/* Owning client */
+void conn_set_client_id(Conn* conn, int client_id);
+int conn_get_client_id(Conn* conn);
+
+/* Position in the owner's connection table */
+void conn_set_index(Conn* conn, int index);
+int conn_get_index(Conn* conn);
+
 /* Master status */
 void conn_set_master(Conn* conn, bool is_master);
 bool conn_is_master(Conn* conn);
 
+/* Protocol handshake */
+void conn_set_handshaken(Conn* conn, bool handshaken);
+bool conn_is_handshaken(Conn* conn);
+
+/* Body encoding sent to the client, JSON unless it asked for compact */
+void conn_set_compact(Conn* conn, bool compact);
+bool conn_is_compact(Conn* conn);
+
+/* Stream compression, both directions, set up once the client asks at login */
+bool conn_enable_compression(Conn* conn);
+bool conn_is_compressed(Conn* conn);
+StreamEncoder* conn_get_encoder(Conn* conn);
+StreamDecoder* conn_get_decoder(Conn* conn);
+StreamStats* conn_get_stream_stats(Conn* conn);
+
 /* Address info */
 void conn_update_addr(Conn* conn, const char* addr, int port);
 const char* conn_get_addr(Conn* conn);
@@ -42,7 +107,36 @@ int conn_get_port(Conn* conn);
 size_t conn_add_buffer(Conn* conn, const char* data, size_t length);
 const char* conn_get_buffer(Conn* conn);
 size_t conn_get_buffer_used(Conn* conn);
+size_t conn_get_buffer_capacity(Conn* conn);
 void conn_clear_buffer(Conn* conn);
 size_t conn_consume_buffer(Conn* conn, size_t amount);
 
+/* Read from the non-blocking socket until EAGAIN or the buffer is full */
+enum ConnReadResult conn_read(Conn* conn, size_t* bytes_read);
+
+/* Outbound queue, pushes fail once queued bytes would pass the high-water mark */
+void conn_set_high_water(Conn* conn, size_t high_water);
+bool conn_queue_output(Conn* conn, const void* data, size_t length);
+bool conn_queue_frame(Conn* conn, uint32_t kind, const void* body, uint32_t length);
+bool conn_queue_shared(Conn* conn, SharedFrame* frame);
+size_t conn_get_output_bytes(Conn* conn);
+
+/* Queued output for io_uring, buffers stay valid until advanced past */
+struct iovec;
+int conn_gather_output(Conn* conn, struct iovec* iov, int max);
+void conn_advance_output(Conn* conn, size_t written);
+
+/* Drop output not yet started on the wire */
+void conn_discard_output(Conn* conn);
+
+/* Write queued output until drained or the socket is full */
+enum ConnWriteResult conn_flush(Conn* conn, size_t* bytes_written);
+
+/* Writability interest, tracked so the loop is only modified on change; with io_uring, a send in flight */
+void conn_set_want_write(Conn* conn, bool want_write);
+bool conn_wants_write(Conn* conn);
+
+/* Slow consumer bookkeeping, owned by the connection's reactor */
+SlowTracker* conn_get_slow_tracker(Conn* conn);
+
 #endif /* CLIENT_CONN_H */
\ No newline at end of file
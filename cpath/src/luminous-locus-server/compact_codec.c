@@ -0,0 +1,325 @@
+/*
+ * Luminous Locus Compact Codec Module
+ * Binary bodies (protocol v3) for the per-tick message kinds
+ *
+ * A compact body is COMPACT_MARKER followed by fields. Each field is a
+ * varint tag, the interned key code shifted left once with the wire
+ * type in the low bit, then either a varint (integers, zigzag encoded)
+ * or a varint length and the string bytes. Zero and empty fields are
+ * left out, and unknown codes are skipped by wire type, so either side
+ * may add fields later. The marker can never begin a JSON text, which
+ * makes every body self-describing: decoders pick the codec per body
+ * and JSON stays the fallback for clients that never asked for v3.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#include "model.h"
+#include "json_encode.h"
+#include "compact_codec.h"
+
+/* Longest varint, 64 bits in 7-bit groups */
+#define VARINT_MAX 10
+
+/* Wire types */
+#define WIRE_VARINT 0
+#define WIRE_BYTES 1
+
+/* Interned keys, the code is the index */
+enum CompactKey {
+    KEY_ID = 1,
+    KEY_KEY,
+    KEY_OBJ,
+    KEY_ACTION,
+    KEY_HASH,
+    KEY_TICK
+};
+
+static const char* const key_names[] = { NULL, "id", "key", "obj", "action", "hash", "tick" };
+
+/* Field types */
+enum CompactFieldType {
+    COMPACT_FIELD_INT,
+    COMPACT_FIELD_HASH32,   /* sent as its unsigned 32-bit pattern */
+    COMPACT_FIELD_STRING
+};
+
+typedef struct CompactField {
+    enum CompactKey Key;
+    enum CompactFieldType Type;
+    size_t Offset;
+    size_t Size;
+} CompactField;
+
+typedef struct CompactLayout {
+    const CompactField* Fields;
+    int Count;
+    size_t Size;
+} CompactLayout;
+
+#define FIELD(type, member, field_type, key) \
+    { key, field_type, offsetof(type, member), sizeof(((type*)0)->member) }
+#define LAYOUT(type, fields) { fields, (int)(sizeof(fields) / sizeof(fields[0])), sizeof(type) }
+
+static const CompactField input_fields[] = {
+    FIELD(MessageInput, ID, COMPACT_FIELD_INT, KEY_ID),
+    FIELD(MessageInput, Key, COMPACT_FIELD_STRING, KEY_KEY),
+};
+
+static const CompactField ordinary_fields[] = {
+    FIELD(MessageOrdinary, ID, COMPACT_FIELD_INT, KEY_ID),
+    FIELD(MessageOrdinary, Key, COMPACT_FIELD_STRING, KEY_KEY),
+};
+
+static const CompactField mouse_click_fields[] = {
+    FIELD(MessageMouseClick, ID, COMPACT_FIELD_INT, KEY_ID),
+    FIELD(MessageMouseClick, Object, COMPACT_FIELD_INT, KEY_OBJ),
+    FIELD(MessageMouseClick, Action, COMPACT_FIELD_STRING, KEY_ACTION),
+};
+
+static const CompactField hash_fields[] = {
+    FIELD(MessageHash, Hash, COMPACT_FIELD_HASH32, KEY_HASH),
+    FIELD(MessageHash, Tick, COMPACT_FIELD_INT, KEY_TICK),
+};
+
+static const CompactLayout input_layout = LAYOUT(MessageInput, input_fields);
+static const CompactLayout ordinary_layout = LAYOUT(MessageOrdinary, ordinary_fields);
+static const CompactLayout mouse_click_layout = LAYOUT(MessageMouseClick, mouse_click_fields);
+static const CompactLayout hash_layout = LAYOUT(MessageHash, hash_fields);
+static const CompactLayout new_tick_layout = { NULL, 0, 0 };
+
+/* Get layout for kind */
+static const CompactLayout* layout_for_kind(int kind) {
+    switch (kind) {
+        case MSGID_INPUT:
+            return &input_layout;
+        case MSGID_ORDINARY:
+            return &ordinary_layout;
+        case MSGID_MOUSECLICK:
+            return &mouse_click_layout;
+        case MSGID_HASH:
+            return &hash_layout;
+        case MSGID_NEWTICK:
+            return &new_tick_layout;
+        default:
+            return NULL;
+    }
+}
+
+/* Write varint */
+static size_t put_varint(char* out, uint64_t value) {
+    size_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (char)(value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (char)value;
+    return n;
+}
+
+/* Read varint, false when truncated or longer than 64 bits */
+static bool get_varint(const char** p, const char* end, uint64_t* value) {
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (*p == end) {
+            return false;
+        }
+        unsigned char byte = (unsigned char)*(*p)++;
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Zigzag, small negatives stay short */
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+/* Undo zigzag */
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+/* Length of a string field, or its size when it is not terminated */
+static size_t field_length(const char* source, size_t size) {
+    const char* nul = (const char*)memchr(source, '\0', size);
+    return nul != NULL ? (size_t)(nul - source) : size;
+}
+
+/* Check supported kinds */
+bool compact_supports(int kind) {
+    return layout_for_kind(kind) != NULL;
+}
+
+/* Check for compact body */
+bool compact_is_body(const char* body, size_t length) {
+    return body != NULL && length > 0 && (unsigned char)body[0] == COMPACT_MARKER;
+}
+
+/* Encode compact body */
+size_t compact_encode(int kind, const void* message, char* out, size_t capacity) {
+    const CompactLayout* layout = layout_for_kind(kind);
+    if (layout == NULL || out == NULL || capacity == 0 || (message == NULL && layout->Count > 0)) {
+        return 0;
+    }
+    const char* base = (const char*)message;
+    char* p = out;
+    char* end = out + capacity;
+    *p++ = (char)COMPACT_MARKER;
+
+    for (int i = 0; i < layout->Count; i++) {
+        const CompactField* field = &layout->Fields[i];
+        const char* source = base + field->Offset;
+        if (field->Type == COMPACT_FIELD_STRING) {
+            size_t length = field_length(source, field->Size);
+            if (length == 0) {
+                continue;
+            }
+            if ((size_t)(end - p) < 2 * VARINT_MAX + length) {
+                return 0;
+            }
+            p += put_varint(p, ((uint64_t)field->Key << 1) | WIRE_BYTES);
+            p += put_varint(p, length);
+            memcpy(p, source, length);
+            p += length;
+        } else {
+            int value = *(const int*)source;
+            if (value == 0) {
+                continue;
+            }
+            if ((size_t)(end - p) < 2 * VARINT_MAX) {
+                return 0;
+            }
+            uint64_t wire = field->Type == COMPACT_FIELD_HASH32 ? (uint64_t)(uint32_t)value : zigzag(value);
+            p += put_varint(p, ((uint64_t)field->Key << 1) | WIRE_VARINT);
+            p += put_varint(p, wire);
+        }
+    }
+    return (size_t)(p - out);
+}
+
+/* Decode compact body */
+bool compact_decode(int kind, const char* body, size_t length, void* out) {
+    const CompactLayout* layout = layout_for_kind(kind);
+    if (layout == NULL || out == NULL || !compact_is_body(body, length)) {
+        return false;
+    }
+    memset(out, 0, layout->Size);
+    char* base = (char*)out;
+    const char* p = body + 1;
+    const char* end = body + length;
+
+    while (p < end) {
+        uint64_t tag = 0;
+        uint64_t value = 0;
+        if (!get_varint(&p, end, &tag) || !get_varint(&p, end, &value)) {
+            return false;
+        }
+        unsigned wire = (unsigned)(tag & 1);
+        if (wire == WIRE_BYTES && value > (uint64_t)(end - p)) {
+            return false;
+        }
+
+        const CompactField* field = NULL;
+        for (int i = 0; i < layout->Count; i++) {
+            if ((uint64_t)layout->Fields[i].Key == tag >> 1) {
+                field = &layout->Fields[i];
+                break;
+            }
+        }
+        if (field == NULL) {
+            /* Unknown key, skip by wire type */
+            if (wire == WIRE_BYTES) {
+                p += value;
+            }
+            continue;
+        }
+
+        char* target = base + field->Offset;
+        switch (field->Type) {
+            case COMPACT_FIELD_STRING:
+                if (wire != WIRE_BYTES || value >= field->Size) {
+                    return false;
+                }
+                memcpy(target, p, (size_t)value);
+                target[value] = '\0';
+                p += value;
+                break;
+            case COMPACT_FIELD_HASH32:
+                if (wire != WIRE_VARINT || value > UINT32_MAX) {
+                    return false;
+                }
+                *(int*)target = (int)(int32_t)(uint32_t)value;
+                break;
+            case COMPACT_FIELD_INT: {
+                int64_t number = unzigzag(value);
+                if (wire != WIRE_VARINT || number < INT_MIN || number > INT_MAX) {
+                    return false;
+                }
+                *(int*)target = (int)number;
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+/* Encode JSON body */
+size_t compact_encode_json(int kind, const void* message, char* out, size_t capacity) {
+    const CompactLayout* layout = layout_for_kind(kind);
+    if (layout == NULL || out == NULL || capacity < 2 || (message == NULL && layout->Count > 0)) {
+        return 0;
+    }
+    const char* base = (const char*)message;
+    char* p = out;
+    char* end = out + capacity;
+    *p++ = '{';
+
+    for (int i = 0; i < layout->Count; i++) {
+        const CompactField* field = &layout->Fields[i];
+        const char* name = key_names[field->Key];
+        size_t name_length = strlen(name);
+        /* Comma, quoted key, colon, and the largest integer or the quotes of a string */
+        if ((size_t)(end - p) < name_length + 4 + JSON_ENCODE_INT_MAX + 1) {
+            return 0;
+        }
+        if (i > 0) {
+            *p++ = ',';
+        }
+        *p++ = '"';
+        memcpy(p, name, name_length);
+        p += name_length;
+        *p++ = '"';
+        *p++ = ':';
+
+        const char* source = base + field->Offset;
+        if (field->Type == COMPACT_FIELD_STRING) {
+            if (field_length(source, field->Size) == field->Size) {
+                return 0;
+            }
+            *p++ = '"';
+            p = json_encode_string(p, end - 2, source);
+            if (p == NULL) {
+                return 0;
+            }
+            *p++ = '"';
+        } else {
+            p += json_encode_int(p, *(const int*)source);
+        }
+    }
+
+    if (p == end) {
+        return 0;
+    }
+    *p++ = '}';
+    return (size_t)(p - out);
+}
@@ -0,0 +1,48 @@
+/*
+ * Luminous Locus Compact Codec Header
+ */
+
+#ifndef COMPACT_CODEC_H
+#define COMPACT_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "model.h"
+
+/* First byte of every compact body, never the start of a JSON text */
+#define COMPACT_MARKER 0xB3
+
+/* MessageLogin.Protocol asking for compact bodies (protocol v3) */
+#define COMPACT_PROTOCOL_VERSION 3
+
+/* Room for the compact form of any supported struct */
+#define COMPACT_BODY_MAX 512
+
+/* Room for the JSON form of any supported struct, every string escaped */
+#define COMPACT_JSON_MAX 1024
+
+/* Any struct with a compact form */
+typedef union CompactMessage {
+    MessageInput Input;
+    MessageOrdinary Ordinary;
+    MessageMouseClick MouseClick;
+    MessageHash Hash;
+} CompactMessage;
+
+/* Kinds with a compact form: input, ordinary, mouse click, hash, new tick */
+bool compact_supports(int kind);
+
+/* Body is in the compact form */
+bool compact_is_body(const char* body, size_t length);
+
+/* Encode a struct as a compact body, returns its size or 0 when it does not fit */
+size_t compact_encode(int kind, const void* message, char* out, size_t capacity);
+
+/* Decode a compact body into its struct, which is zeroed first */
+bool compact_decode(int kind, const char* body, size_t length, void* out);
+
+/* Encode a struct as a JSON body for clients without compact support */
+size_t compact_encode_json(int kind, const void* message, char* out, size_t capacity);
+
+#endif /* COMPACT_CODEC_H */
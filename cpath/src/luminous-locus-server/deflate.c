@@ -0,0 +1,620 @@
+/*
+ * Luminous Locus Deflate Module
+ * RFC 1951 deflate with RFC 1950 zlib and RFC 1952 gzip framing
+ *
+ * Used offline-style, once per asset at startup, so it favours ratio
+ * over speed within a simple design: hash chains over a 32 KB window,
+ * greedy matching of at least four bytes, and a single block coded with
+ * the fixed Huffman tables. Four byte matches keep every match no longer
+ * than its literals would be, which bounds the output at nine bits per
+ * input byte. Dynamic tables would gain a little more on text; assets
+ * that need it can ship their own .gz next to the original.
+ *
+ * The inflater reads any conforming stream (stored, fixed and dynamic
+ * blocks) into a buffer the caller sizes, decoding Huffman codes a bit
+ * at a time against canonical code counts. It only runs offline, on PNG
+ * data, so simplicity wins over table-driven speed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "deflate.h"
+
+/* Deflate window and match limits */
+#define WINDOW_SIZE 32768
+#define WINDOW_MASK (WINDOW_SIZE - 1)
+#define MIN_MATCH 4
+#define MAX_MATCH 258
+
+/* Chain search effort */
+#define HASH_BITS 15
+#define HASH_SIZE (1 << HASH_BITS)
+#define MAX_CHAIN 64
+#define GOOD_MATCH 128
+
+/* End of block symbol */
+#define END_OF_BLOCK 256
+
+/* gzip member framing */
+#define GZIP_HEADER_SIZE 10
+#define GZIP_TRAILER_SIZE 8
+
+/* zlib stream framing */
+#define ZLIB_HEADER_SIZE 2
+#define ZLIB_TRAILER_SIZE 4
+
+/* Longest Huffman code and the size of each alphabet */
+#define MAX_CODE_BITS 15
+#define LITERAL_SYMBOLS 288
+#define DISTANCE_SYMBOLS 30
+#define CODE_LENGTH_SYMBOLS 19
+
+/* Length symbols 257..285 */
+static const uint16_t g_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t g_length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+
+/* Distance symbols 0..29 */
+static const uint16_t g_distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+    6145, 8193, 12289, 16385, 24577,
+};
+static const uint8_t g_distance_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+
+static uint32_t g_crc_table[256];
+static pthread_once_t g_crc_once = PTHREAD_ONCE_INIT;
+
+/* LSB-first bit output, the caller guarantees room */
+typedef struct BitWriter {
+    unsigned char* Out;
+    size_t Position;
+    uint64_t Bits;
+    int Count;
+} BitWriter;
+
+/* Fixed Huffman code of a literal/length symbol, bit-reversed for output */
+typedef struct FixedCode {
+    uint16_t Code;
+    uint8_t Bits;
+} FixedCode;
+
+/* LSB-first bit input over a whole stream */
+typedef struct BitReader {
+    const unsigned char* In;
+    size_t Length;
+    size_t Position;
+    uint32_t Bits;
+    int Count;
+    bool Overrun;
+} BitReader;
+
+/* Canonical Huffman decoding table: codes per length, then symbols in code order */
+typedef struct Huffman {
+    uint16_t Counts[MAX_CODE_BITS + 1];
+    uint16_t Symbols[LITERAL_SYMBOLS];
+} Huffman;
+
+/* Fill the CRC table */
+static void crc_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++) {
+            c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+        }
+        g_crc_table[i] = c;
+    }
+}
+
+/* Update a CRC-32 */
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length) {
+    pthread_once(&g_crc_once, crc_init);
+    const unsigned char* p = (const unsigned char*)data;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = g_crc_table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* Update an Adler-32, in runs short enough that the sums cannot overflow */
+uint32_t adler32_update(uint32_t adler, const void* data, size_t length) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (length > 0) {
+        size_t run = length < 5552 ? length : 5552;
+        length -= run;
+        while (run-- > 0) {
+            a += *p++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return b << 16 | a;
+}
+
+/* Reverse the low bits of a Huffman code, deflate sends codes MSB first */
+static uint16_t reverse_bits(uint16_t code, int bits) {
+    uint16_t reversed = 0;
+    for (int i = 0; i < bits; i++) {
+        reversed = (uint16_t)(reversed << 1 | (code & 1));
+        code >>= 1;
+    }
+    return reversed;
+}
+
+/* Build the fixed literal/length table of RFC 1951 3.2.6 */
+static void fixed_codes(FixedCode* codes) {
+    for (int symbol = 0; symbol < 288; symbol++) {
+        uint16_t code;
+        int bits;
+        if (symbol < 144) {
+            code = (uint16_t)(0x30 + symbol);
+            bits = 8;
+        } else if (symbol < 256) {
+            code = (uint16_t)(0x190 + symbol - 144);
+            bits = 9;
+        } else if (symbol < 280) {
+            code = (uint16_t)(symbol - 256);
+            bits = 7;
+        } else {
+            code = (uint16_t)(0xc0 + symbol - 280);
+            bits = 8;
+        }
+        codes[symbol].Code = reverse_bits(code, bits);
+        codes[symbol].Bits = (uint8_t)bits;
+    }
+}
+
+/* Append bits */
+static void put_bits(BitWriter* writer, uint32_t value, int bits) {
+    writer->Bits |= (uint64_t)value << writer->Count;
+    writer->Count += bits;
+    while (writer->Count >= 8) {
+        writer->Out[writer->Position++] = (unsigned char)writer->Bits;
+        writer->Bits >>= 8;
+        writer->Count -= 8;
+    }
+}
+
+/* Pad to a byte boundary */
+static void flush_bits(BitWriter* writer) {
+    if (writer->Count > 0) {
+        writer->Out[writer->Position++] = (unsigned char)writer->Bits;
+    }
+    writer->Bits = 0;
+    writer->Count = 0;
+}
+
+/* Write a match as length and distance symbols with their extra bits */
+static void put_match(BitWriter* writer, const FixedCode* codes, size_t length, size_t distance) {
+    int symbol = 28;
+    while (g_length_base[symbol] > length) {
+        symbol--;
+    }
+    put_bits(writer, codes[257 + symbol].Code, codes[257 + symbol].Bits);
+    put_bits(writer, (uint32_t)(length - g_length_base[symbol]), g_length_extra[symbol]);
+
+    int code = 29;
+    while (g_distance_base[code] > distance) {
+        code--;
+    }
+    put_bits(writer, reverse_bits((uint16_t)code, 5), 5);
+    put_bits(writer, (uint32_t)(distance - g_distance_base[code]), g_distance_extra[code]);
+}
+
+/* Hash the four bytes at p */
+static uint32_t hash4(const unsigned char* p) {
+    uint32_t sequence = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Chain a position into the hash table */
+static void insert(int32_t* head, int32_t* prev, const unsigned char* data, size_t position) {
+    uint32_t hash = hash4(data + position);
+    prev[position & WINDOW_MASK] = head[hash];
+    head[hash] = (int32_t)position;
+}
+
+/* Longest match for the position, walking its chain */
+static size_t longest_match(const int32_t* head, const int32_t* prev, const unsigned char* data, size_t position,
+                            size_t length, size_t* distance) {
+    size_t limit = length - position < MAX_MATCH ? length - position : MAX_MATCH;
+    size_t best = 0;
+    int32_t candidate = head[hash4(data + position)];
+    for (int chain = 0; chain < MAX_CHAIN && candidate >= 0; chain++) {
+        size_t from = (size_t)candidate;
+        if (position - from > WINDOW_SIZE) {
+            break;
+        }
+        if (data[from + best] == data[position + best]) {
+            size_t run = 0;
+            while (run < limit && data[from + run] == data[position + run]) {
+                run++;
+            }
+            if (run > best) {
+                best = run;
+                *distance = position - from;
+                if (best >= GOOD_MATCH || best == limit) {
+                    break;
+                }
+            }
+        }
+        int32_t next = prev[from & WINDOW_MASK];
+        if (next >= candidate) {
+            break;
+        }
+        candidate = next;
+    }
+    return best;
+}
+
+/* Worst case raw deflate size */
+size_t deflate_bound(size_t length) {
+    return length + length / 8 + 8;
+}
+
+/* Worst case gzip size */
+size_t gzip_bound(size_t length) {
+    return deflate_bound(length) + GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE;
+}
+
+/* Worst case zlib size */
+size_t zlib_bound(size_t length) {
+    return deflate_bound(length) + ZLIB_HEADER_SIZE + ZLIB_TRAILER_SIZE;
+}
+
+/* Compress to one fixed Huffman block */
+size_t deflate_compress(const void* data, size_t length, char* out, size_t capacity) {
+    if (out == NULL || (data == NULL && length > 0) || capacity < deflate_bound(length) ||
+        length > (size_t)INT32_MAX) {
+        return 0;
+    }
+    int32_t* head = (int32_t*)malloc(HASH_SIZE * sizeof(int32_t));
+    int32_t* prev = (int32_t*)malloc(WINDOW_SIZE * sizeof(int32_t));
+    if (head == NULL || prev == NULL) {
+        free(head);
+        free(prev);
+        return 0;
+    }
+    memset(head, 0xff, HASH_SIZE * sizeof(int32_t));
+
+    FixedCode codes[288];
+    fixed_codes(codes);
+
+    const unsigned char* bytes = (const unsigned char*)data;
+    BitWriter writer = {(unsigned char*)out, 0, 0, 0};
+    put_bits(&writer, 1, 1);    /* final block */
+    put_bits(&writer, 1, 2);    /* fixed Huffman */
+
+    size_t position = 0;
+    while (position < length) {
+        size_t match = 0;
+        size_t distance = 0;
+        if (length - position >= MIN_MATCH) {
+            match = longest_match(head, prev, bytes, position, length, &distance);
+            insert(head, prev, bytes, position);
+        }
+        if (match < MIN_MATCH) {
+            put_bits(&writer, codes[bytes[position]].Code, codes[bytes[position]].Bits);
+            position++;
+            continue;
+        }
+        put_match(&writer, codes, match, distance);
+        /* Positions inside the match stay findable for later ones */
+        size_t end = position + match;
+        for (position++; position < end; position++) {
+            if (length - position >= MIN_MATCH) {
+                insert(head, prev, bytes, position);
+            }
+        }
+    }
+    put_bits(&writer, codes[END_OF_BLOCK].Code, codes[END_OF_BLOCK].Bits);
+    flush_bits(&writer);
+
+    free(head);
+    free(prev);
+    return writer.Position;
+}
+
+/* Compress to a gzip member */
+size_t gzip_compress(const void* data, size_t length, char* out, size_t capacity) {
+    if (out == NULL || capacity < gzip_bound(length)) {
+        return 0;
+    }
+    static const unsigned char header[GZIP_HEADER_SIZE] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+    memcpy(out, header, sizeof(header));
+    size_t body = deflate_compress(data, length, out + GZIP_HEADER_SIZE, capacity - GZIP_HEADER_SIZE);
+    if (body == 0) {
+        return 0;
+    }
+
+    unsigned char* trailer = (unsigned char*)out + GZIP_HEADER_SIZE + body;
+    uint32_t crc = crc32_update(0, data, length);
+    uint32_t size = (uint32_t)length;
+    for (int i = 0; i < 4; i++) {
+        trailer[i] = (unsigned char)(crc >> (8 * i));
+        trailer[4 + i] = (unsigned char)(size >> (8 * i));
+    }
+    return GZIP_HEADER_SIZE + body + GZIP_TRAILER_SIZE;
+}
+
+/* Compress to a zlib stream */
+size_t zlib_compress(const void* data, size_t length, char* out, size_t capacity) {
+    if (out == NULL || capacity < zlib_bound(length)) {
+        return 0;
+    }
+    /* 32 KB window, default level, header checksum making it a multiple of 31 */
+    out[0] = 0x78;
+    out[1] = (char)0x9c;
+    size_t body = deflate_compress(data, length, out + ZLIB_HEADER_SIZE, capacity - ZLIB_HEADER_SIZE);
+    if (body == 0) {
+        return 0;
+    }
+
+    unsigned char* trailer = (unsigned char*)out + ZLIB_HEADER_SIZE + body;
+    uint32_t adler = adler32_update(1, data, length);
+    for (int i = 0; i < 4; i++) {
+        trailer[i] = (unsigned char)(adler >> (24 - 8 * i));
+    }
+    return ZLIB_HEADER_SIZE + body + ZLIB_TRAILER_SIZE;
+}
+
+/* Take bits, zeros past the end with Overrun set */
+static uint32_t get_bits(BitReader* reader, int bits) {
+    while (reader->Count < bits) {
+        if (reader->Position == reader->Length) {
+            reader->Overrun = true;
+            return 0;
+        }
+        reader->Bits |= (uint32_t)reader->In[reader->Position++] << reader->Count;
+        reader->Count += 8;
+    }
+    uint32_t value = reader->Bits & ((1u << bits) - 1);
+    reader->Bits >>= bits;
+    reader->Count -= bits;
+    return value;
+}
+
+/* Build a decoding table from code lengths, false when the lengths oversubscribe the code space */
+static bool build_huffman(Huffman* huffman, const uint8_t* lengths, int count) {
+    memset(huffman->Counts, 0, sizeof(huffman->Counts));
+    for (int symbol = 0; symbol < count; symbol++) {
+        huffman->Counts[lengths[symbol]]++;
+    }
+    int left = 1;
+    for (int bits = 1; bits <= MAX_CODE_BITS; bits++) {
+        left = (left << 1) - huffman->Counts[bits];
+        if (left < 0) {
+            return false;
+        }
+    }
+    uint16_t offsets[MAX_CODE_BITS + 1];
+    offsets[1] = 0;
+    for (int bits = 1; bits < MAX_CODE_BITS; bits++) {
+        offsets[bits + 1] = (uint16_t)(offsets[bits] + huffman->Counts[bits]);
+    }
+    for (int symbol = 0; symbol < count; symbol++) {
+        if (lengths[symbol] != 0) {
+            huffman->Symbols[offsets[lengths[symbol]]++] = (uint16_t)symbol;
+        }
+    }
+    /* Incomplete codes are legal, a code that is never completed is caught while decoding */
+    return true;
+}
+
+/* Decode one symbol, -1 for a code the table does not hold */
+static int decode_symbol(BitReader* reader, const Huffman* huffman) {
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int bits = 1; bits <= MAX_CODE_BITS; bits++) {
+        code |= (int)get_bits(reader, 1);
+        int count = huffman->Counts[bits];
+        if (code - first < count) {
+            return huffman->Symbols[index + code - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+/* Copy a stored block */
+static bool inflate_stored(BitReader* reader, unsigned char* out, size_t capacity, size_t* produced) {
+    reader->Bits = 0;
+    reader->Count = 0;
+    if (reader->Length - reader->Position < 4) {
+        return false;
+    }
+    const unsigned char* p = reader->In + reader->Position;
+    size_t length = (size_t)p[0] | (size_t)p[1] << 8;
+    if ((size_t)(p[2] | p[3] << 8) != (~length & 0xffff)) {
+        return false;
+    }
+    reader->Position += 4;
+    if (reader->Length - reader->Position < length || capacity - *produced < length) {
+        return false;
+    }
+    memcpy(out + *produced, reader->In + reader->Position, length);
+    reader->Position += length;
+    *produced += length;
+    return true;
+}
+
+/* Decode literals and matches until the end of the block */
+static bool inflate_codes(BitReader* reader, const Huffman* literals, const Huffman* distances, unsigned char* out,
+                          size_t capacity, size_t* produced) {
+    for (;;) {
+        int symbol = decode_symbol(reader, literals);
+        if (symbol < 0 || reader->Overrun) {
+            return false;
+        }
+        if (symbol < 256) {
+            if (*produced == capacity) {
+                return false;
+            }
+            out[(*produced)++] = (unsigned char)symbol;
+            continue;
+        }
+        if (symbol == END_OF_BLOCK) {
+            return true;
+        }
+        symbol -= 257;
+        if (symbol >= 29) {
+            return false;
+        }
+        size_t length = g_length_base[symbol] + get_bits(reader, g_length_extra[symbol]);
+        int code = decode_symbol(reader, distances);
+        if (code < 0 || code >= DISTANCE_SYMBOLS) {
+            return false;
+        }
+        size_t distance = g_distance_base[code] + get_bits(reader, g_distance_extra[code]);
+        if (reader->Overrun || distance > *produced || capacity - *produced < length) {
+            return false;
+        }
+        /* Byte by byte, a match may overlap the bytes it produces */
+        unsigned char* to = out + *produced;
+        for (size_t i = 0; i < length; i++) {
+            to[i] = to[(ptrdiff_t)i - (ptrdiff_t)distance];
+        }
+        *produced += length;
+    }
+}
+
+/* Read the code length tables of a dynamic block */
+static bool read_dynamic_tables(BitReader* reader, Huffman* literals, Huffman* distances) {
+    static const uint8_t order[CODE_LENGTH_SYMBOLS] = {
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15,
+    };
+    int literal_count = (int)get_bits(reader, 5) + 257;
+    int distance_count = (int)get_bits(reader, 5) + 1;
+    int length_count = (int)get_bits(reader, 4) + 4;
+    if (literal_count > 286 || distance_count > DISTANCE_SYMBOLS) {
+        return false;
+    }
+
+    uint8_t lengths[LITERAL_SYMBOLS + DISTANCE_SYMBOLS];
+    memset(lengths, 0, sizeof(lengths));
+    for (int i = 0; i < length_count; i++) {
+        lengths[order[i]] = (uint8_t)get_bits(reader, 3);
+    }
+    Huffman lengths_code;
+    if (!build_huffman(&lengths_code, lengths, CODE_LENGTH_SYMBOLS)) {
+        return false;
+    }
+
+    int total = literal_count + distance_count;
+    memset(lengths, 0, sizeof(lengths));
+    for (int index = 0; index < total;) {
+        int symbol = decode_symbol(reader, &lengths_code);
+        if (symbol < 0 || reader->Overrun) {
+            return false;
+        }
+        if (symbol < 16) {
+            lengths[index++] = (uint8_t)symbol;
+            continue;
+        }
+        uint8_t repeat_length = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (index == 0) {
+                return false;
+            }
+            repeat_length = lengths[index - 1];
+            repeat = 3 + (int)get_bits(reader, 2);
+        } else if (symbol == 17) {
+            repeat = 3 + (int)get_bits(reader, 3);
+        } else {
+            repeat = 11 + (int)get_bits(reader, 7);
+        }
+        if (index + repeat > total) {
+            return false;
+        }
+        while (repeat-- > 0) {
+            lengths[index++] = repeat_length;
+        }
+    }
+    /* A block must be able to end */
+    if (lengths[END_OF_BLOCK] == 0) {
+        return false;
+    }
+    return build_huffman(literals, lengths, literal_count) &&
+           build_huffman(distances, lengths + literal_count, distance_count);
+}
+
+/* Inflate a raw deflate stream */
+bool deflate_decompress(const void* data, size_t length, char* out, size_t capacity, size_t* out_length) {
+    if (data == NULL || out == NULL || out_length == NULL) {
+        return false;
+    }
+    BitReader reader = {(const unsigned char*)data, length, 0, 0, 0, false};
+    unsigned char* bytes = (unsigned char*)out;
+    size_t produced = 0;
+    Huffman* literals = (Huffman*)malloc(2 * sizeof(Huffman));
+    if (literals == NULL) {
+        return false;
+    }
+    Huffman* distances = literals + 1;
+
+    bool ok = true;
+    bool last = false;
+    while (ok && !last) {
+        last = get_bits(&reader, 1) != 0;
+        uint32_t type = get_bits(&reader, 2);
+        if (reader.Overrun) {
+            ok = false;
+        } else if (type == 0) {
+            ok = inflate_stored(&reader, bytes, capacity, &produced);
+        } else if (type == 1) {
+            uint8_t lengths[LITERAL_SYMBOLS + DISTANCE_SYMBOLS];
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            memset(lengths + LITERAL_SYMBOLS, 5, DISTANCE_SYMBOLS);
+            build_huffman(literals, lengths, LITERAL_SYMBOLS);
+            build_huffman(distances, lengths + LITERAL_SYMBOLS, DISTANCE_SYMBOLS);
+            ok = inflate_codes(&reader, literals, distances, bytes, capacity, &produced);
+        } else if (type == 2) {
+            ok = read_dynamic_tables(&reader, literals, distances) &&
+                 inflate_codes(&reader, literals, distances, bytes, capacity, &produced);
+        } else {
+            ok = false;
+        }
+    }
+    free(literals);
+    *out_length = produced;
+    return ok;
+}
+
+/* Inflate a zlib stream */
+bool zlib_decompress(const void* data, size_t length, char* out, size_t capacity, size_t* out_length) {
+    const unsigned char* p = (const unsigned char*)data;
+    if (p == NULL || out_length == NULL || length < ZLIB_HEADER_SIZE + ZLIB_TRAILER_SIZE) {
+        return false;
+    }
+    /* Deflate only, no preset dictionary, valid header checksum */
+    if ((p[0] & 0x0f) != 8 || (p[0] >> 4) > 7 || (p[1] & 0x20) != 0 || (p[0] << 8 | p[1]) % 31 != 0) {
+        return false;
+    }
+    if (!deflate_decompress(p + ZLIB_HEADER_SIZE, length - ZLIB_HEADER_SIZE - ZLIB_TRAILER_SIZE, out, capacity,
+                            out_length)) {
+        return false;
+    }
+    const unsigned char* trailer = p + length - ZLIB_TRAILER_SIZE;
+    uint32_t expected = (uint32_t)trailer[0] << 24 | (uint32_t)trailer[1] << 16 | (uint32_t)trailer[2] << 8 |
+                        trailer[3];
+    return adler32_update(1, out, *out_length) == expected;
+}
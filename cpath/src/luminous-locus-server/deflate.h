@@ -0,0 +1,41 @@
+/*
+ * Luminous Locus Deflate Header
+ */
+
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* CRC-32 as used by gzip and PNG, pass 0 to start */
+uint32_t crc32_update(uint32_t crc, const void* data, size_t length);
+
+/* Adler-32 as used by zlib, pass 1 to start */
+uint32_t adler32_update(uint32_t adler, const void* data, size_t length);
+
+/* Output size that always fits length input bytes */
+size_t deflate_bound(size_t length);
+size_t gzip_bound(size_t length);
+size_t zlib_bound(size_t length);
+
+/* Raw deflate stream, returns its size or 0 when capacity is below deflate_bound */
+size_t deflate_compress(const void* data, size_t length, char* out, size_t capacity);
+
+/* Deflate wrapped in a gzip member, returns its size or 0 when capacity is below gzip_bound */
+size_t gzip_compress(const void* data, size_t length, char* out, size_t capacity);
+
+/* Deflate wrapped in a zlib stream, as PNG stores it; returns its size or 0 when capacity is below zlib_bound */
+size_t zlib_compress(const void* data, size_t length, char* out, size_t capacity);
+
+/*
+ * Inflate a raw deflate stream into out. False when the stream is
+ * malformed or would not fit; out_length is the size produced.
+ */
+bool deflate_decompress(const void* data, size_t length, char* out, size_t capacity, size_t* out_length);
+
+/* Inflate a zlib stream, checking its header and Adler-32 */
+bool zlib_decompress(const void* data, size_t length, char* out, size_t capacity, size_t* out_length);
+
+#endif /* DEFLATE_H */
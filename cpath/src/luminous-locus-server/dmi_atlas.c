@@ -0,0 +1,639 @@
+/*
+ * Luminous Locus DMI Atlas Module
+ * Every icon state packed into a few large texture pages
+ *
+ * A client drawing from hundreds of separate sheets fetches and decodes
+ * each one and works out where every frame sits before it can draw. The
+ * builder does that once, offline: it decodes each .dmi, cuts it into
+ * frames using the compiled state table, and keeps one copy of each
+ * distinct frame (doors, floors and uniforms repeat a lot of them,
+ * transparent frames most of all). The distinct frames are placed
+ * tallest first on shelves across pages of at most 2048x2048, and an
+ * index maps every (icon, state, dir, frame) to its rectangle. Builds
+ * are deterministic: the same sheets added in the same order give the
+ * same pages and index.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "asset_cache.h"
+#include "png_codec.h"
+#include "dmi_meta.h"
+#include "dmi_atlas.h"
+
+/* Slot of an empty dedup table entry */
+#define EMPTY_SLOT UINT32_MAX
+
+/* One .dmi added */
+typedef struct AtlasIcon {
+    char* Path;
+    uint32_t FirstState;
+    uint32_t StateCount;
+} AtlasIcon;
+
+/* Sort key of a distinct frame when placing */
+typedef struct Placement {
+    uint16_t Height;
+    uint16_t Width;
+    uint32_t Unique;
+} Placement;
+
+/* One distinct frame */
+typedef struct AtlasFrame {
+    uint64_t Hash;
+    uint16_t Width;
+    uint16_t Height;
+    size_t Pixels;              /* offset into the pixel arena */
+    uint32_t Rect;              /* placement order, DMI_ATLAS_NO_RECT until placed */
+    uint16_t Page;
+    uint16_t X;
+    uint16_t Y;
+} AtlasFrame;
+
+struct DmiAtlasBuilder {
+    AtlasIcon* Icons;
+    uint32_t IconCount;
+    uint32_t IconCapacity;
+    DmiAtlasState* States;
+    uint32_t StateCount;
+    uint32_t StateCapacity;
+    uint32_t* Frames;           /* distinct frame number per sheet frame */
+    uint32_t FrameCount;
+    uint32_t FrameCapacity;
+    AtlasFrame* Unique;
+    uint32_t UniqueCount;
+    uint32_t UniqueCapacity;
+    uint8_t* Arena;             /* distinct frames' RGBA, back to back */
+    size_t ArenaUsed;
+    size_t ArenaCapacity;
+    uint32_t* Table;            /* open addressing over Unique */
+    uint32_t TableMask;
+    char* Names;                /* state names, NUL-terminated */
+    uint32_t NamesUsed;
+    uint32_t NamesCapacity;
+    bool Failed;                /* out of memory while adding */
+    char** Pages;
+    size_t* PageLengths;
+    int PageCount;
+    char* Index;
+    size_t IndexLength;
+    DmiAtlasStats Stats;
+};
+
+/* Make room for one more item in a growable array, returns the array or NULL when out of memory */
+static void* reserve(void* items, uint32_t* capacity, uint32_t count, size_t item_size) {
+    if (count < *capacity) {
+        return items;
+    }
+    uint32_t grown = *capacity > 0 ? *capacity * 2 : 64;
+    void* resized = realloc(items, (size_t)grown * item_size);
+    if (resized != NULL) {
+        *capacity = grown;
+    }
+    return resized;
+}
+
+/* Append a state name, returns its offset or UINT32_MAX when out of memory */
+static uint32_t append_name(DmiAtlasBuilder* builder, const char* name, size_t length) {
+    while (builder->NamesCapacity - builder->NamesUsed <= length) {
+        uint32_t capacity = builder->NamesCapacity > 0 ? builder->NamesCapacity * 2 : 4096;
+        char* names = (char*)realloc(builder->Names, capacity);
+        if (names == NULL) {
+            return UINT32_MAX;
+        }
+        builder->Names = names;
+        builder->NamesCapacity = capacity;
+    }
+    uint32_t offset = builder->NamesUsed;
+    memcpy(builder->Names + offset, name, length);
+    builder->Names[offset + length] = '\0';
+    builder->NamesUsed += (uint32_t)length + 1;
+    return offset;
+}
+
+/* Double the dedup table */
+static bool grow_table(DmiAtlasBuilder* builder) {
+    uint32_t size = builder->Table != NULL ? (builder->TableMask + 1) * 2 : 1024;
+    uint32_t* table = (uint32_t*)malloc(size * sizeof(uint32_t));
+    if (table == NULL) {
+        return false;
+    }
+    memset(table, 0xff, size * sizeof(uint32_t));
+    for (uint32_t i = 0; i < builder->UniqueCount; i++) {
+        uint32_t slot = (uint32_t)builder->Unique[i].Hash & (size - 1);
+        while (table[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & (size - 1);
+        }
+        table[slot] = i;
+    }
+    free(builder->Table);
+    builder->Table = table;
+    builder->TableMask = size - 1;
+    return true;
+}
+
+/* Number of the distinct frame with these pixels, adding it when new; UINT32_MAX when out of memory */
+static uint32_t intern_frame(DmiAtlasBuilder* builder, const uint8_t* pixels, uint16_t width, uint16_t height) {
+    size_t length = (size_t)width * height * 4;
+    uint64_t hash = asset_hash64(pixels, length) ^ ((uint64_t)width << 48 | (uint64_t)height << 32);
+    if ((builder->UniqueCount + 1) * 2 > builder->TableMask + 1 && !grow_table(builder)) {
+        return UINT32_MAX;
+    }
+    uint32_t slot = (uint32_t)hash & builder->TableMask;
+    for (; builder->Table[slot] != EMPTY_SLOT; slot = (slot + 1) & builder->TableMask) {
+        const AtlasFrame* frame = &builder->Unique[builder->Table[slot]];
+        if (frame->Hash == hash && frame->Width == width && frame->Height == height &&
+            memcmp(builder->Arena + frame->Pixels, pixels, length) == 0) {
+            return builder->Table[slot];
+        }
+    }
+
+    if (builder->ArenaCapacity - builder->ArenaUsed < length) {
+        size_t capacity = builder->ArenaCapacity > 0 ? builder->ArenaCapacity : 1024 * 1024;
+        while (capacity - builder->ArenaUsed < length) {
+            capacity *= 2;
+        }
+        uint8_t* arena = (uint8_t*)realloc(builder->Arena, capacity);
+        if (arena == NULL) {
+            return UINT32_MAX;
+        }
+        builder->Arena = arena;
+        builder->ArenaCapacity = capacity;
+    }
+    AtlasFrame* unique = (AtlasFrame*)reserve(builder->Unique, &builder->UniqueCapacity, builder->UniqueCount,
+                                              sizeof(AtlasFrame));
+    if (unique == NULL) {
+        return UINT32_MAX;
+    }
+    builder->Unique = unique;
+    AtlasFrame* frame = &builder->Unique[builder->UniqueCount];
+    memset(frame, 0, sizeof(AtlasFrame));
+    frame->Hash = hash;
+    frame->Width = width;
+    frame->Height = height;
+    frame->Pixels = builder->ArenaUsed;
+    frame->Rect = DMI_ATLAS_NO_RECT;
+    memcpy(builder->Arena + builder->ArenaUsed, pixels, length);
+    builder->ArenaUsed += length;
+    builder->Table[slot] = builder->UniqueCount;
+    return builder->UniqueCount++;
+}
+
+/* Cut one state's frames out of the sheet */
+static bool add_state(DmiAtlasBuilder* builder, const DmiMeta* meta, const DmiStateRecord* record,
+                      const PngImage* image, uint8_t* scratch) {
+    uint16_t width = meta->Header->Width;
+    uint16_t height = meta->Header->Height;
+    uint32_t columns = image->Width / width;
+    const char* name = dmi_meta_state_name(meta, record);
+    DmiAtlasState* states = (DmiAtlasState*)reserve(builder->States, &builder->StateCapacity, builder->StateCount,
+                                                    sizeof(DmiAtlasState));
+    if (states == NULL) {
+        return false;
+    }
+    builder->States = states;
+    DmiAtlasState* state = &builder->States[builder->StateCount];
+    memset(state, 0, sizeof(DmiAtlasState));
+    state->NameOffset = append_name(builder, name, record->NameLength);
+    state->NameLength = record->NameLength;
+    state->Dirs = record->Dirs;
+    state->Frames = record->Frames;
+    state->FirstFrame = builder->FrameCount;
+    if (state->NameOffset == UINT32_MAX) {
+        return false;
+    }
+    builder->StateCount++;
+
+    /* Frames follow the sheet: frame-major, dirs within each frame */
+    bool fits = width + 2 * DMI_ATLAS_PADDING <= DMI_ATLAS_PAGE_SIZE &&
+                height + 2 * DMI_ATLAS_PADDING <= DMI_ATLAS_PAGE_SIZE;
+    uint32_t count = (uint32_t)record->Dirs * record->Frames;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t sheet_index = record->FirstIcon + i;
+        uint32_t x = sheet_index % columns * width;
+        uint32_t y = sheet_index / columns * height;
+        uint32_t unique = DMI_ATLAS_NO_RECT;
+        if (fits && y + height <= image->Height) {
+            for (uint16_t row = 0; row < height; row++) {
+                memcpy(scratch + (size_t)row * width * 4, image->Pixels + ((size_t)(y + row) * image->Width + x) * 4,
+                       (size_t)width * 4);
+            }
+            unique = intern_frame(builder, scratch, width, height);
+            if (unique == UINT32_MAX) {
+                return false;
+            }
+        }
+        uint32_t* frames = (uint32_t*)reserve(builder->Frames, &builder->FrameCapacity, builder->FrameCount,
+                                              sizeof(uint32_t));
+        if (frames == NULL) {
+            return false;
+        }
+        builder->Frames = frames;
+        builder->Frames[builder->FrameCount++] = unique;
+    }
+    return true;
+}
+
+/* Create builder */
+DmiAtlasBuilder* dmi_atlas_builder_create(void) {
+    return (DmiAtlasBuilder*)calloc(1, sizeof(DmiAtlasBuilder));
+}
+
+/* Free builder */
+void dmi_atlas_builder_free(DmiAtlasBuilder* builder) {
+    if (builder == NULL) {
+        return;
+    }
+    for (uint32_t i = 0; i < builder->IconCount; i++) {
+        free(builder->Icons[i].Path);
+    }
+    for (int i = 0; i < builder->PageCount; i++) {
+        free(builder->Pages[i]);
+    }
+    free(builder->Icons);
+    free(builder->States);
+    free(builder->Frames);
+    free(builder->Unique);
+    free(builder->Arena);
+    free(builder->Table);
+    free(builder->Names);
+    free(builder->Pages);
+    free(builder->PageLengths);
+    free(builder->Index);
+    free(builder);
+}
+
+/* Add a sheet */
+bool dmi_atlas_builder_add(DmiAtlasBuilder* builder, const char* path, const void* sheet, size_t sheet_length,
+                           const void* states, size_t states_length) {
+    DmiMeta meta;
+    if (builder == NULL || path == NULL || builder->Index != NULL || !dmi_meta_view(states, states_length, &meta) ||
+        meta.Header->Width == 0 || meta.Header->Height == 0) {
+        return false;
+    }
+    PngImage image;
+    if (!png_decode(sheet, sheet_length, &image)) {
+        return false;
+    }
+    if (image.Width < meta.Header->Width) {
+        png_image_free(&image);
+        return false;
+    }
+
+    uint8_t* scratch = (uint8_t*)malloc((size_t)meta.Header->Width * meta.Header->Height * 4);
+    AtlasIcon* icons = (AtlasIcon*)reserve(builder->Icons, &builder->IconCapacity, builder->IconCount,
+                                           sizeof(AtlasIcon));
+    bool ok = scratch != NULL && icons != NULL;
+    if (icons != NULL) {
+        builder->Icons = icons;
+    }
+    if (ok) {
+        AtlasIcon* icon = &builder->Icons[builder->IconCount];
+        icon->Path = strdup(path);
+        icon->FirstState = builder->StateCount;
+        icon->StateCount = meta.Header->StateCount;
+        ok = icon->Path != NULL;
+        builder->IconCount += ok;
+    }
+    for (uint32_t i = 0; ok && i < meta.Header->StateCount; i++) {
+        ok = add_state(builder, &meta, &meta.States[i], &image, scratch);
+    }
+    free(scratch);
+    png_image_free(&image);
+
+    /* Running out of memory halfway through a sheet spoils the whole atlas */
+    builder->Failed |= !ok;
+    builder->Stats.Sheets += ok;
+    return ok;
+}
+
+/* Order distinct frames tallest first, then widest, then as added */
+static int compare_placement(const void* a, const void* b) {
+    const Placement* left = (const Placement*)a;
+    const Placement* right = (const Placement*)b;
+    if (left->Height != right->Height) {
+        return left->Height > right->Height ? -1 : 1;
+    }
+    if (left->Width != right->Width) {
+        return left->Width > right->Width ? -1 : 1;
+    }
+    return left->Unique < right->Unique ? -1 : left->Unique > right->Unique;
+}
+
+/* Assign every distinct frame a page and position, shelf by shelf; returns the page count */
+static int place_frames(DmiAtlasBuilder* builder, DmiAtlasPage* pages, int max_pages) {
+    Placement* order = (Placement*)malloc((builder->UniqueCount + 1) * sizeof(Placement));
+    if (order == NULL) {
+        return -1;
+    }
+    for (uint32_t i = 0; i < builder->UniqueCount; i++) {
+        order[i].Height = builder->Unique[i].Height;
+        order[i].Width = builder->Unique[i].Width;
+        order[i].Unique = i;
+    }
+    qsort(order, builder->UniqueCount, sizeof(Placement), compare_placement);
+
+    int page = 0;
+    uint32_t x = DMI_ATLAS_PADDING;
+    uint32_t y = DMI_ATLAS_PADDING;
+    uint32_t shelf = 0;
+    for (uint32_t i = 0; i < builder->UniqueCount; i++) {
+        AtlasFrame* frame = &builder->Unique[order[i].Unique];
+        if (x + frame->Width + DMI_ATLAS_PADDING > DMI_ATLAS_PAGE_SIZE) {
+            x = DMI_ATLAS_PADDING;
+            y += shelf + DMI_ATLAS_PADDING;
+            shelf = 0;
+        }
+        if (y + frame->Height + DMI_ATLAS_PADDING > DMI_ATLAS_PAGE_SIZE) {
+            page++;
+            x = DMI_ATLAS_PADDING;
+            y = DMI_ATLAS_PADDING;
+            shelf = 0;
+        }
+        if (page == max_pages) {
+            free(order);
+            return -1;
+        }
+        frame->Rect = i;
+        frame->Page = (uint16_t)page;
+        frame->X = (uint16_t)x;
+        frame->Y = (uint16_t)y;
+        x += frame->Width + DMI_ATLAS_PADDING;
+        shelf = frame->Height > shelf ? frame->Height : shelf;
+        /* Pages are cut to what they hold, padding included */
+        if (x > pages[page].Width) {
+            pages[page].Width = (uint16_t)x;
+        }
+        if (y + frame->Height + DMI_ATLAS_PADDING > pages[page].Height) {
+            pages[page].Height = (uint16_t)(y + frame->Height + DMI_ATLAS_PADDING);
+        }
+    }
+    free(order);
+    return builder->UniqueCount > 0 ? page + 1 : 0;
+}
+
+/* Draw and encode one page */
+static bool encode_page(DmiAtlasBuilder* builder, int page, const DmiAtlasPage* size) {
+    size_t stride = (size_t)size->Width * 4;
+    uint8_t* pixels = (uint8_t*)calloc((size_t)size->Height, stride);
+    if (pixels == NULL) {
+        return false;
+    }
+    for (uint32_t i = 0; i < builder->UniqueCount; i++) {
+        const AtlasFrame* frame = &builder->Unique[i];
+        if (frame->Page != page) {
+            continue;
+        }
+        size_t row_length = (size_t)frame->Width * 4;
+        for (uint16_t row = 0; row < frame->Height; row++) {
+            memcpy(pixels + (size_t)(frame->Y + row) * stride + (size_t)frame->X * 4,
+                   builder->Arena + frame->Pixels + row * row_length, row_length);
+        }
+    }
+    builder->Pages[page] = png_encode(pixels, size->Width, size->Height, &builder->PageLengths[page]);
+    free(pixels);
+    return builder->Pages[page] != NULL;
+}
+
+/* Round up to 4 bytes */
+static size_t align4(size_t length) {
+    return (length + 3) & ~(size_t)3;
+}
+
+/* Order icons by path */
+static int compare_icons(const void* a, const void* b) {
+    return strcmp(((const AtlasIcon*)a)->Path, ((const AtlasIcon*)b)->Path);
+}
+
+/* Lay out the index */
+static bool write_index(DmiAtlasBuilder* builder, const DmiAtlasPage* pages, int page_count) {
+    qsort(builder->Icons, builder->IconCount, sizeof(AtlasIcon), compare_icons);
+    uint64_t names_length = builder->NamesUsed;
+    for (uint32_t i = 0; i < builder->IconCount; i++) {
+        names_length += strlen(builder->Icons[i].Path) + 1;
+    }
+    size_t pages_at = sizeof(DmiAtlasHeader);
+    size_t icons_at = align4(pages_at + (size_t)page_count * sizeof(DmiAtlasPage));
+    size_t states_at = icons_at + (size_t)builder->IconCount * sizeof(DmiAtlasIcon);
+    size_t frames_at = states_at + (size_t)builder->StateCount * sizeof(DmiAtlasState);
+    size_t rects_at = frames_at + (size_t)builder->FrameCount * sizeof(uint32_t);
+    size_t names_at = rects_at + (size_t)builder->UniqueCount * sizeof(DmiAtlasRect);
+    size_t length = align4(names_at + names_length);
+    if (names_length > UINT32_MAX) {
+        return false;
+    }
+    char* index = (char*)calloc(1, length);
+    if (index == NULL) {
+        return false;
+    }
+
+    DmiAtlasHeader* header = (DmiAtlasHeader*)index;
+    memcpy(header->Magic, DMI_ATLAS_MAGIC, sizeof(header->Magic));
+    header->PageCount = (uint16_t)page_count;
+    header->IconCount = builder->IconCount;
+    header->StateCount = builder->StateCount;
+    header->FrameCount = builder->FrameCount;
+    header->RectCount = builder->UniqueCount;
+    header->NamesLength = (uint32_t)names_length;
+    memcpy(index + pages_at, pages, (size_t)page_count * sizeof(DmiAtlasPage));
+    memcpy(index + states_at, builder->States, (size_t)builder->StateCount * sizeof(DmiAtlasState));
+    memcpy(index + names_at, builder->Names, builder->NamesUsed);
+
+    /* Icon paths follow the state names */
+    DmiAtlasIcon* icons = (DmiAtlasIcon*)(index + icons_at);
+    uint32_t name_offset = builder->NamesUsed;
+    for (uint32_t i = 0; i < builder->IconCount; i++) {
+        size_t path_length = strlen(builder->Icons[i].Path);
+        icons[i].NameOffset = name_offset;
+        icons[i].NameLength = (uint32_t)path_length;
+        icons[i].FirstState = builder->Icons[i].FirstState;
+        icons[i].StateCount = builder->Icons[i].StateCount;
+        memcpy(index + names_at + name_offset, builder->Icons[i].Path, path_length + 1);
+        name_offset += (uint32_t)path_length + 1;
+    }
+    uint32_t* frames = (uint32_t*)(index + frames_at);
+    for (uint32_t i = 0; i < builder->FrameCount; i++) {
+        uint32_t unique = builder->Frames[i];
+        frames[i] = unique != DMI_ATLAS_NO_RECT ? builder->Unique[unique].Rect : DMI_ATLAS_NO_RECT;
+    }
+    DmiAtlasRect* rects = (DmiAtlasRect*)(index + rects_at);
+    for (uint32_t i = 0; i < builder->UniqueCount; i++) {
+        const AtlasFrame* frame = &builder->Unique[i];
+        DmiAtlasRect* rect = &rects[frame->Rect];
+        rect->Page = frame->Page;
+        rect->X = frame->X;
+        rect->Y = frame->Y;
+        rect->Width = frame->Width;
+        rect->Height = frame->Height;
+    }
+    builder->Index = index;
+    builder->IndexLength = length;
+    return true;
+}
+
+/* Place, draw and index */
+bool dmi_atlas_builder_finish(DmiAtlasBuilder* builder) {
+    if (builder == NULL || builder->Failed || builder->Index != NULL) {
+        return false;
+    }
+    /* Every frame fits a page on its own, so there are never more pages than frames */
+    int max_pages = builder->UniqueCount < UINT16_MAX ? (int)builder->UniqueCount + 1 : UINT16_MAX;
+    DmiAtlasPage* pages = (DmiAtlasPage*)calloc((size_t)max_pages, sizeof(DmiAtlasPage));
+    int page_count = pages != NULL ? place_frames(builder, pages, max_pages) : -1;
+    if (page_count < 0) {
+        free(pages);
+        return false;
+    }
+    builder->Pages = (char**)calloc((size_t)page_count + 1, sizeof(char*));
+    builder->PageLengths = (size_t*)calloc((size_t)page_count + 1, sizeof(size_t));
+    bool ok = builder->Pages != NULL && builder->PageLengths != NULL;
+    if (ok) {
+        builder->PageCount = page_count;
+    }
+    for (int i = 0; ok && i < page_count; i++) {
+        ok = encode_page(builder, i, &pages[i]);
+    }
+    ok = ok && write_index(builder, pages, page_count);
+    free(pages);
+
+    builder->Stats.Frames = (int)builder->FrameCount;
+    builder->Stats.UniqueFrames = (int)builder->UniqueCount;
+    builder->Stats.Pages = page_count;
+    return ok;
+}
+
+/* Page count */
+int dmi_atlas_builder_page_count(const DmiAtlasBuilder* builder) {
+    return builder != NULL && builder->Index != NULL ? builder->PageCount : 0;
+}
+
+/* Encoded page */
+const char* dmi_atlas_builder_page(const DmiAtlasBuilder* builder, int page, size_t* length) {
+    if (builder == NULL || builder->Index == NULL || page < 0 || page >= builder->PageCount || length == NULL) {
+        return NULL;
+    }
+    *length = builder->PageLengths[page];
+    return builder->Pages[page];
+}
+
+/* Encoded index */
+const char* dmi_atlas_builder_index(const DmiAtlasBuilder* builder, size_t* length) {
+    if (builder == NULL || builder->Index == NULL || length == NULL) {
+        return NULL;
+    }
+    *length = builder->IndexLength;
+    return builder->Index;
+}
+
+/* Builder summary */
+void dmi_atlas_builder_get_stats(const DmiAtlasBuilder* builder, DmiAtlasStats* stats) {
+    if (stats == NULL) {
+        return;
+    }
+    if (builder == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    *stats = builder->Stats;
+}
+
+/* Whether a name lies inside the names section and is terminated there */
+static bool name_fits(const DmiAtlas* atlas, uint32_t offset, uint32_t length) {
+    return (uint64_t)offset + length < atlas->Header->NamesLength && atlas->Names[offset + length] == '\0';
+}
+
+/* Check an index */
+bool dmi_atlas_view(const void* index, size_t length, DmiAtlas* atlas) {
+    if (index == NULL || atlas == NULL || length < sizeof(DmiAtlasHeader) || ((uintptr_t)index & 3) != 0) {
+        return false;
+    }
+    const DmiAtlasHeader* header = (const DmiAtlasHeader*)index;
+    if (memcmp(header->Magic, DMI_ATLAS_MAGIC, sizeof(header->Magic)) != 0) {
+        return false;
+    }
+    uint64_t pages_at = sizeof(DmiAtlasHeader);
+    uint64_t icons_at = align4(pages_at + (uint64_t)header->PageCount * sizeof(DmiAtlasPage));
+    uint64_t states_at = icons_at + (uint64_t)header->IconCount * sizeof(DmiAtlasIcon);
+    uint64_t frames_at = states_at + (uint64_t)header->StateCount * sizeof(DmiAtlasState);
+    uint64_t rects_at = frames_at + (uint64_t)header->FrameCount * sizeof(uint32_t);
+    uint64_t names_at = rects_at + (uint64_t)header->RectCount * sizeof(DmiAtlasRect);
+    if (names_at + header->NamesLength > length) {
+        return false;
+    }
+
+    const char* base = (const char*)index;
+    atlas->Header = header;
+    atlas->Pages = (const DmiAtlasPage*)(base + pages_at);
+    atlas->Icons = (const DmiAtlasIcon*)(base + icons_at);
+    atlas->States = (const DmiAtlasState*)(base + states_at);
+    atlas->Frames = (const uint32_t*)(base + frames_at);
+    atlas->Rects = (const DmiAtlasRect*)(base + rects_at);
+    atlas->Names = base + names_at;
+    for (uint32_t i = 0; i < header->IconCount; i++) {
+        const DmiAtlasIcon* icon = &atlas->Icons[i];
+        if (!name_fits(atlas, icon->NameOffset, icon->NameLength) ||
+            (uint64_t)icon->FirstState + icon->StateCount > header->StateCount ||
+            (i > 0 && strcmp(atlas->Names + atlas->Icons[i - 1].NameOffset, atlas->Names + icon->NameOffset) >= 0)) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->StateCount; i++) {
+        const DmiAtlasState* state = &atlas->States[i];
+        if (!name_fits(atlas, state->NameOffset, state->NameLength) ||
+            (uint64_t)state->FirstFrame + (uint64_t)state->Dirs * state->Frames > header->FrameCount) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->FrameCount; i++) {
+        if (atlas->Frames[i] != DMI_ATLAS_NO_RECT && atlas->Frames[i] >= header->RectCount) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->RectCount; i++) {
+        const DmiAtlasRect* rect = &atlas->Rects[i];
+        if (rect->Page >= header->PageCount || rect->X + rect->Width > atlas->Pages[rect->Page].Width ||
+            rect->Y + rect->Height > atlas->Pages[rect->Page].Height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Find a frame */
+const DmiAtlasRect* dmi_atlas_find(const DmiAtlas* atlas, const char* icon, const char* state, int dir, int frame) {
+    if (atlas == NULL || atlas->Header == NULL || icon == NULL || state == NULL || dir < 0 || frame < 0) {
+        return NULL;
+    }
+    uint32_t low = 0;
+    uint32_t high = atlas->Header->IconCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (strcmp(atlas->Names + atlas->Icons[middle].NameOffset, icon) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == atlas->Header->IconCount || strcmp(atlas->Names + atlas->Icons[low].NameOffset, icon) != 0) {
+        return NULL;
+    }
+
+    /* Few states per icon, and the first of a repeated name wins as in dmi_meta */
+    const DmiAtlasIcon* found = &atlas->Icons[low];
+    for (uint32_t i = 0; i < found->StateCount; i++) {
+        const DmiAtlasState* record = &atlas->States[found->FirstState + i];
+        if (strcmp(atlas->Names + record->NameOffset, state) != 0) {
+            continue;
+        }
+        if (dir >= record->Dirs || frame >= record->Frames) {
+            return NULL;
+        }
+        uint32_t rect = atlas->Frames[record->FirstFrame + (uint32_t)frame * record->Dirs + (uint32_t)dir];
+        return rect != DMI_ATLAS_NO_RECT ? &atlas->Rects[rect] : NULL;
+    }
+    return NULL;
+}
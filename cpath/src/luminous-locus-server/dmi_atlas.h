@@ -0,0 +1,132 @@
+/*
+ * Luminous Locus DMI Atlas Header
+ */
+
+#ifndef DMI_ATLAS_H
+#define DMI_ATLAS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* First bytes of an atlas index */
+#define DMI_ATLAS_MAGIC "ATL1"
+
+/* Largest atlas page, within what every client GPU accepts */
+#define DMI_ATLAS_PAGE_SIZE 2048
+
+/* Transparent pixels left between frames so filtering never bleeds */
+#define DMI_ATLAS_PADDING 1
+
+/* Frames entry of an icon that is missing from its sheet or too large for a page */
+#define DMI_ATLAS_NO_RECT UINT32_MAX
+
+/* Where an asset pack stores the atlas, pages are DMI_ATLAS_PAGE_PREFIX "<n>.png" */
+#define DMI_ATLAS_INDEX_PATH "atlas/index.atlas"
+#define DMI_ATLAS_PAGE_PREFIX "atlas/"
+
+/*
+ * Atlas index, little-endian, every section 4-byte aligned: header,
+ * pages, icons sorted by path, states in sheet order per icon, one rect
+ * number per frame, rects, then the NUL-terminated names. A frame's
+ * entry is at the state's FirstFrame + frame * Dirs + dir, the order
+ * the sheet itself uses; frames with identical pixels share one rect.
+ */
+typedef struct DmiAtlasHeader {
+    char Magic[4];
+    uint16_t PageCount;
+    uint16_t Reserved;
+    uint32_t IconCount;
+    uint32_t StateCount;
+    uint32_t FrameCount;
+    uint32_t RectCount;
+    uint32_t NamesLength;
+    uint32_t Reserved2;
+} DmiAtlasHeader;
+
+/* Page size in pixels */
+typedef struct DmiAtlasPage {
+    uint16_t Width;
+    uint16_t Height;
+} DmiAtlasPage;
+
+/* One .dmi */
+typedef struct DmiAtlasIcon {
+    uint32_t NameOffset;    /* path of the .dmi below the asset root */
+    uint32_t NameLength;
+    uint32_t FirstState;
+    uint32_t StateCount;
+} DmiAtlasIcon;
+
+/* One icon state, delays and hotspots stay in the .dmi.states table */
+typedef struct DmiAtlasState {
+    uint32_t NameOffset;
+    uint16_t NameLength;
+    uint8_t Dirs;
+    uint8_t Reserved;
+    uint16_t Frames;
+    uint16_t Reserved2;
+    uint32_t FirstFrame;
+} DmiAtlasState;
+
+/* Where a frame's pixels are */
+typedef struct DmiAtlasRect {
+    uint16_t Page;
+    uint16_t X;
+    uint16_t Y;
+    uint16_t Width;
+    uint16_t Height;
+    uint16_t Reserved;
+} DmiAtlasRect;
+
+/* Checked view of an index, pointers into it */
+typedef struct DmiAtlas {
+    const DmiAtlasHeader* Header;
+    const DmiAtlasPage* Pages;
+    const DmiAtlasIcon* Icons;
+    const DmiAtlasState* States;
+    const uint32_t* Frames;
+    const DmiAtlasRect* Rects;
+    const char* Names;
+} DmiAtlas;
+
+/* Builder summary */
+typedef struct DmiAtlasStats {
+    int Sheets;
+    int Frames;             /* frames referenced by the states */
+    int UniqueFrames;       /* distinct pixel contents, one rect each */
+    int Pages;
+} DmiAtlasStats;
+
+/* Atlas under construction */
+typedef struct DmiAtlasBuilder DmiAtlasBuilder;
+
+/* Create/free builder */
+DmiAtlasBuilder* dmi_atlas_builder_create(void);
+void dmi_atlas_builder_free(DmiAtlasBuilder* builder);
+
+/*
+ * Add one .dmi, given its PNG bytes and its compiled state table (see
+ * dmi_meta). False when the sheet cannot be decoded or the table does
+ * not check out, which leaves the builder as it was, or when memory ran
+ * out, after which finish fails too.
+ */
+bool dmi_atlas_builder_add(DmiAtlasBuilder* builder, const char* path, const void* sheet, size_t sheet_length,
+                           const void* states, size_t states_length);
+
+/* Place every frame and encode the pages and index, false when out of memory */
+bool dmi_atlas_builder_finish(DmiAtlasBuilder* builder);
+
+/* Results of finish, owned by the builder */
+int dmi_atlas_builder_page_count(const DmiAtlasBuilder* builder);
+const char* dmi_atlas_builder_page(const DmiAtlasBuilder* builder, int page, size_t* length);
+const char* dmi_atlas_builder_index(const DmiAtlasBuilder* builder, size_t* length);
+void dmi_atlas_builder_get_stats(const DmiAtlasBuilder* builder, DmiAtlasStats* stats);
+
+/* Check an index and point a view at it */
+bool dmi_atlas_view(const void* index, size_t length, DmiAtlas* atlas);
+
+/* Rect of one frame of one direction, NULL when there is none */
+const DmiAtlasRect* dmi_atlas_find(const DmiAtlas* atlas, const char* icon, const char* state, int dir, int frame);
+
+#endif /* DMI_ATLAS_H */
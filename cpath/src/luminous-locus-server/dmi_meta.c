@@ -0,0 +1,612 @@
+/*
+ * Luminous Locus DMI Metadata Module
+ * Binary state tables compiled from .dmi.json sidecars
+ *
+ * Every .dmi sheet ships with a JSON sidecar listing its states, and a
+ * client used to parse it and work out where each frame sits before it
+ * could draw anything. The compiled table answers that without parsing:
+ * a fixed header, one record per state in sheet order (so the sheet
+ * index of a frame is a multiply and an add), a name-sorted index for
+ * lookups, the frame delays and the names. It is built once by the pack
+ * builder and read in place from the mapped pack.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "dmi_meta.h"
+
+/* Deepest nesting skipped over in unknown values */
+#define MAX_DEPTH 32
+
+/* Longest state name kept */
+#define MAX_NAME 0xffff
+
+/* Sidecar being parsed */
+typedef struct Parser {
+    const char* P;
+    const char* End;
+    bool Failed;
+} Parser;
+
+/* Growable array */
+typedef struct Buffer {
+    char* Data;
+    size_t Used;
+    size_t Capacity;
+} Buffer;
+
+/* One state as parsed, before layout */
+typedef struct ParsedState {
+    size_t NameOffset;
+    size_t NameLength;
+    long Dirs;
+    long Frames;
+    long Loop;
+    bool Rewind;
+    bool Hotspot;
+    long HotspotX;
+    long HotspotY;
+    size_t DelayOffset;     /* in floats, SIZE_MAX when none */
+    size_t DelayCount;
+} ParsedState;
+
+/* Everything the sidecar says */
+typedef struct Sidecar {
+    long Width;
+    long Height;
+    Buffer States;          /* ParsedState */
+    Buffer Delays;          /* float */
+    Buffer Names;           /* char, NUL after each */
+} Sidecar;
+
+/* Make room for more bytes, false when out of memory */
+static bool buffer_reserve(Buffer* buffer, size_t more) {
+    if (buffer->Used + more <= buffer->Capacity) {
+        return true;
+    }
+    size_t capacity = buffer->Capacity > 0 ? buffer->Capacity : 256;
+    while (capacity < buffer->Used + more) {
+        capacity *= 2;
+    }
+    char* data = (char*)realloc(buffer->Data, capacity);
+    if (data == NULL) {
+        return false;
+    }
+    buffer->Data = data;
+    buffer->Capacity = capacity;
+    return true;
+}
+
+/* Append bytes */
+static bool buffer_append(Buffer* buffer, const void* data, size_t length) {
+    if (!buffer_reserve(buffer, length)) {
+        return false;
+    }
+    memcpy(buffer->Data + buffer->Used, data, length);
+    buffer->Used += length;
+    return true;
+}
+
+/* Skip whitespace */
+static void skip_space(Parser* parser) {
+    while (parser->P < parser->End &&
+           (*parser->P == ' ' || *parser->P == '\t' || *parser->P == '\n' || *parser->P == '\r')) {
+        parser->P++;
+    }
+}
+
+/* Consume one expected character */
+static bool expect(Parser* parser, char c) {
+    skip_space(parser);
+    if (parser->P < parser->End && *parser->P == c) {
+        parser->P++;
+        return true;
+    }
+    parser->Failed = true;
+    return false;
+}
+
+/* Consume c if it is next */
+static bool accept(Parser* parser, char c) {
+    skip_space(parser);
+    if (parser->P < parser->End && *parser->P == c) {
+        parser->P++;
+        return true;
+    }
+    return false;
+}
+
+/* Hex digit value, -1 when not one */
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/* Parse a string, unescaped into out when it is not NULL */
+static bool parse_string(Parser* parser, Buffer* out) {
+    if (!expect(parser, '"')) {
+        return false;
+    }
+    while (parser->P < parser->End && *parser->P != '"') {
+        char c = *parser->P++;
+        char utf8[4];
+        size_t length = 1;
+        utf8[0] = c;
+        if (c == '\\') {
+            if (parser->P == parser->End) {
+                break;
+            }
+            char escape = *parser->P++;
+            switch (escape) {
+                case 'b': utf8[0] = '\b'; break;
+                case 'f': utf8[0] = '\f'; break;
+                case 'n': utf8[0] = '\n'; break;
+                case 'r': utf8[0] = '\r'; break;
+                case 't': utf8[0] = '\t'; break;
+                case 'u': {
+                    unsigned code = 0;
+                    for (int i = 0; i < 4; i++) {
+                        int digit = parser->P < parser->End ? hex_value(*parser->P++) : -1;
+                        if (digit < 0) {
+                            parser->Failed = true;
+                            return false;
+                        }
+                        code = code << 4 | (unsigned)digit;
+                    }
+                    /* Surrogate pairs are not needed for state names, keep the code unit as is */
+                    if (code < 0x80) {
+                        utf8[0] = (char)code;
+                    } else if (code < 0x800) {
+                        utf8[0] = (char)(0xc0 | code >> 6);
+                        utf8[1] = (char)(0x80 | (code & 0x3f));
+                        length = 2;
+                    } else {
+                        utf8[0] = (char)(0xe0 | code >> 12);
+                        utf8[1] = (char)(0x80 | ((code >> 6) & 0x3f));
+                        utf8[2] = (char)(0x80 | (code & 0x3f));
+                        length = 3;
+                    }
+                    break;
+                }
+                default: utf8[0] = escape; break;
+            }
+        }
+        if (out != NULL && !buffer_append(out, utf8, length)) {
+            parser->Failed = true;
+            return false;
+        }
+    }
+    return expect(parser, '"');
+}
+
+/* Parse a number */
+static bool parse_number(Parser* parser, double* value) {
+    skip_space(parser);
+    char text[64];
+    size_t length = 0;
+    while (parser->P < parser->End && length + 1 < sizeof(text)) {
+        char c = *parser->P;
+        if (!(c >= '0' && c <= '9') && c != '+' && c != '-' && c != '.' && c != 'e' && c != 'E') {
+            break;
+        }
+        text[length++] = c;
+        parser->P++;
+    }
+    text[length] = '\0';
+    char* end = NULL;
+    *value = strtod(text, &end);
+    if (length == 0 || *end != '\0') {
+        parser->Failed = true;
+        return false;
+    }
+    return true;
+}
+
+/* Skip any value */
+static bool skip_value(Parser* parser, int depth) {
+    skip_space(parser);
+    if (parser->P == parser->End || depth > MAX_DEPTH) {
+        parser->Failed = true;
+        return false;
+    }
+    char c = *parser->P;
+    if (c == '"') {
+        return parse_string(parser, NULL);
+    }
+    if (c == '{' || c == '[') {
+        char close = c == '{' ? '}' : ']';
+        parser->P++;
+        if (accept(parser, close)) {
+            return true;
+        }
+        do {
+            if (c == '{' && (!parse_string(parser, NULL) || !expect(parser, ':'))) {
+                return false;
+            }
+            if (!skip_value(parser, depth + 1)) {
+                return false;
+            }
+        } while (accept(parser, ','));
+        return expect(parser, close);
+    }
+    if (c == 't' || c == 'f' || c == 'n') {
+        const char* word = c == 't' ? "true" : c == 'f' ? "false" : "null";
+        size_t length = strlen(word);
+        if ((size_t)(parser->End - parser->P) < length || memcmp(parser->P, word, length) != 0) {
+            parser->Failed = true;
+            return false;
+        }
+        parser->P += length;
+        return true;
+    }
+    double ignored;
+    return parse_number(parser, &ignored);
+}
+
+/* Compare the key just parsed */
+static bool key_is(const Buffer* key, const char* name) {
+    return key->Used == strlen(name) && memcmp(key->Data, name, key->Used) == 0;
+}
+
+/* Parse an object, calling member for each key; the key buffer is reused */
+static bool parse_object(Parser* parser, Buffer* key, bool (*member)(Parser*, Buffer*, void*), void* data) {
+    if (!expect(parser, '{')) {
+        return false;
+    }
+    if (accept(parser, '}')) {
+        return true;
+    }
+    do {
+        key->Used = 0;
+        if (!parse_string(parser, key) || !expect(parser, ':') || !member(parser, key, data)) {
+            parser->Failed = true;
+            return false;
+        }
+    } while (accept(parser, ','));
+    return expect(parser, '}');
+}
+
+/* Parse an array of numbers into up to capacity values, returns the count seen */
+static size_t parse_numbers(Parser* parser, double* values, size_t capacity, Buffer* all) {
+    size_t count = 0;
+    if (!expect(parser, '[')) {
+        return 0;
+    }
+    if (accept(parser, ']')) {
+        return 0;
+    }
+    do {
+        double value;
+        if (!parse_number(parser, &value)) {
+            return 0;
+        }
+        if (count < capacity) {
+            values[count] = value;
+        }
+        if (all != NULL) {
+            float delay = (float)value;
+            if (!buffer_append(all, &delay, sizeof(delay))) {
+                parser->Failed = true;
+                return 0;
+            }
+        }
+        count++;
+    } while (accept(parser, ','));
+    expect(parser, ']');
+    return count;
+}
+
+/* Member of info */
+static bool info_member(Parser* parser, Buffer* key, void* data) {
+    Sidecar* sidecar = (Sidecar*)data;
+    double value;
+    if (key_is(key, "width")) {
+        bool ok = parse_number(parser, &value);
+        sidecar->Width = (long)value;
+        return ok;
+    }
+    if (key_is(key, "height")) {
+        bool ok = parse_number(parser, &value);
+        sidecar->Height = (long)value;
+        return ok;
+    }
+    return skip_value(parser, 1);
+}
+
+/* Member of one state */
+static bool state_member(Parser* parser, Buffer* key, void* data) {
+    Sidecar* sidecar = (Sidecar*)data;
+    ParsedState* state = (ParsedState*)(sidecar->States.Data + sidecar->States.Used) - 1;
+    double value;
+    if (key_is(key, "state")) {
+        state->NameOffset = sidecar->Names.Used;
+        if (!parse_string(parser, &sidecar->Names)) {
+            return false;
+        }
+        state->NameLength = sidecar->Names.Used - state->NameOffset;
+        return state->NameLength <= MAX_NAME && buffer_append(&sidecar->Names, "", 1);
+    }
+    if (key_is(key, "dirs") || key_is(key, "frames") || key_is(key, "loop") || key_is(key, "rewind")) {
+        if (!parse_number(parser, &value)) {
+            return false;
+        }
+        long number = (long)value;
+        if (key_is(key, "dirs")) {
+            state->Dirs = number;
+        } else if (key_is(key, "frames")) {
+            state->Frames = number;
+        } else if (key_is(key, "loop")) {
+            state->Loop = number;
+        } else {
+            state->Rewind = number != 0;
+        }
+        return true;
+    }
+    if (key_is(key, "delay")) {
+        size_t before = sidecar->Delays.Used / sizeof(float);
+        state->DelayCount = parse_numbers(parser, NULL, 0, &sidecar->Delays);
+        state->DelayOffset = before;
+        return !parser->Failed;
+    }
+    if (key_is(key, "hotspot")) {
+        double point[3] = {0, 0, 0};
+        size_t count = parse_numbers(parser, point, 3, NULL);
+        state->Hotspot = count >= 2;
+        state->HotspotX = (long)point[0];
+        state->HotspotY = (long)point[1];
+        return !parser->Failed;
+    }
+    return skip_value(parser, 1);
+}
+
+/* Member of the sidecar */
+static bool sidecar_member(Parser* parser, Buffer* key, void* data) {
+    Sidecar* sidecar = (Sidecar*)data;
+    if (key_is(key, "info")) {
+        Buffer inner = {0};
+        bool ok = parse_object(parser, &inner, info_member, sidecar);
+        free(inner.Data);
+        return ok;
+    }
+    if (key_is(key, "states")) {
+        if (!expect(parser, '[')) {
+            return false;
+        }
+        if (accept(parser, ']')) {
+            return true;
+        }
+        Buffer inner = {0};
+        bool ok = true;
+        do {
+            ParsedState state;
+            memset(&state, 0, sizeof(state));
+            state.Dirs = 1;
+            state.Frames = 1;
+            state.NameOffset = SIZE_MAX;
+            state.DelayOffset = SIZE_MAX;
+            ok = buffer_append(&sidecar->States, &state, sizeof(state)) &&
+                 parse_object(parser, &inner, state_member, sidecar);
+            ParsedState* added = (ParsedState*)(sidecar->States.Data + sidecar->States.Used) - 1;
+            if (ok && added->NameOffset == SIZE_MAX) {
+                /* A state may be unnamed, which is the sheet's default state */
+                added->NameOffset = sidecar->Names.Used;
+                ok = buffer_append(&sidecar->Names, "", 1);
+            }
+        } while (ok && accept(parser, ','));
+        free(inner.Data);
+        return ok && expect(parser, ']');
+    }
+    return skip_value(parser, 1);
+}
+
+/* Pixel width of a PNG, 0 when it is not one */
+static uint32_t png_width(const void* sheet, size_t length) {
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    const unsigned char* p = (const unsigned char*)sheet;
+    if (p == NULL || length < 24 || memcmp(p, signature, 8) != 0 || memcmp(p + 12, "IHDR", 4) != 0) {
+        return 0;
+    }
+    return (uint32_t)p[16] << 24 | (uint32_t)p[17] << 16 | (uint32_t)p[18] << 8 | p[19];
+}
+
+/* Round up to 4 bytes */
+static size_t align4(size_t length) {
+    return (length + 3) & ~(size_t)3;
+}
+
+/* Lay the parsed sidecar out as a table */
+static void* layout(const Sidecar* sidecar, uint32_t sheet_width, size_t* length) {
+    const ParsedState* parsed = (const ParsedState*)sidecar->States.Data;
+    size_t count = sidecar->States.Used / sizeof(ParsedState);
+
+    /* Delays are copied per state, padded or cut to its frame count */
+    size_t delay_count = 0;
+    uint64_t icons = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (parsed[i].Dirs < 1 || parsed[i].Dirs > 255 || parsed[i].Frames < 1 || parsed[i].Frames > 0xffff) {
+            return NULL;
+        }
+        if (parsed[i].DelayOffset != SIZE_MAX) {
+            delay_count += (size_t)parsed[i].Frames;
+        }
+        icons += (uint64_t)parsed[i].Dirs * (uint64_t)parsed[i].Frames;
+    }
+    if (icons > UINT32_MAX || sidecar->Names.Used > UINT32_MAX) {
+        return NULL;
+    }
+
+    size_t states_at = sizeof(DmiMetaHeader);
+    size_t sorted_at = states_at + count * sizeof(DmiStateRecord);
+    size_t delays_at = sorted_at + count * sizeof(uint32_t);
+    size_t names_at = delays_at + delay_count * sizeof(float);
+    size_t total = align4(names_at + sidecar->Names.Used);
+    char* table = (char*)calloc(1, total);
+    if (table == NULL) {
+        return NULL;
+    }
+
+    DmiMetaHeader* header = (DmiMetaHeader*)table;
+    memcpy(header->Magic, DMI_META_MAGIC, sizeof(header->Magic));
+    header->Width = (uint16_t)sidecar->Width;
+    header->Height = (uint16_t)sidecar->Height;
+    header->Columns = (uint16_t)(sheet_width / (uint32_t)sidecar->Width);
+    header->StateCount = (uint32_t)count;
+    header->IconCount = (uint32_t)icons;
+    header->DelayCount = (uint32_t)delay_count;
+    header->NamesLength = (uint32_t)sidecar->Names.Used;
+
+    DmiStateRecord* records = (DmiStateRecord*)(table + states_at);
+    float* delays = (float*)(table + delays_at);
+    const float* source_delays = (const float*)sidecar->Delays.Data;
+    uint32_t first_icon = 0;
+    size_t delay_used = 0;
+    for (size_t i = 0; i < count; i++) {
+        const ParsedState* state = &parsed[i];
+        DmiStateRecord* record = &records[i];
+        record->NameOffset = (uint32_t)state->NameOffset;
+        record->NameLength = (uint16_t)state->NameLength;
+        record->Dirs = (uint8_t)state->Dirs;
+        record->Frames = (uint16_t)state->Frames;
+        record->Loop = (uint16_t)(state->Loop > 0 && state->Loop < 0xffff ? state->Loop : 0);
+        record->Flags = (uint8_t)((state->Rewind ? DMI_STATE_REWIND : 0) | (state->Hotspot ? DMI_STATE_HOTSPOT : 0));
+        record->HotspotX = (int16_t)state->HotspotX;
+        record->HotspotY = (int16_t)state->HotspotY;
+        record->FirstIcon = first_icon;
+        first_icon += (uint32_t)(state->Dirs * state->Frames);
+        record->DelayOffset = DMI_META_NO_DELAY;
+        if (state->DelayOffset != SIZE_MAX) {
+            record->DelayOffset = (uint32_t)delay_used;
+            for (long frame = 0; frame < state->Frames; frame++) {
+                delays[delay_used++] = (size_t)frame < state->DelayCount
+                                           ? source_delays[state->DelayOffset + (size_t)frame]
+                                           : 1.0f;
+            }
+        }
+    }
+
+    /* Stable insertion sort by name, so the first of repeated names stays first */
+    uint32_t* sorted = (uint32_t*)(table + sorted_at);
+    const char* names = sidecar->Names.Data;
+    for (size_t i = 0; i < count; i++) {
+        uint32_t index = (uint32_t)i;
+        size_t j = i;
+        while (j > 0 && strcmp(names + records[sorted[j - 1]].NameOffset, names + records[index].NameOffset) > 0) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = index;
+    }
+
+    if (sidecar->Names.Used > 0) {
+        memcpy(table + names_at, sidecar->Names.Data, sidecar->Names.Used);
+    }
+    *length = total;
+    return table;
+}
+
+/* Compile a sidecar */
+void* dmi_meta_compile(const char* json, size_t json_length, const void* sheet, size_t sheet_length,
+                       size_t* length) {
+    if (json == NULL || length == NULL) {
+        return NULL;
+    }
+    Sidecar sidecar;
+    memset(&sidecar, 0, sizeof(sidecar));
+    Parser parser = {json, json + json_length, false};
+    Buffer key = {0};
+    bool ok = parse_object(&parser, &key, sidecar_member, &sidecar) && !parser.Failed;
+    free(key.Data);
+
+    void* table = NULL;
+    if (ok && sidecar.Width > 0 && sidecar.Width <= 0xffff && sidecar.Height > 0 && sidecar.Height <= 0xffff) {
+        table = layout(&sidecar, png_width(sheet, sheet_length), length);
+    }
+    free(sidecar.States.Data);
+    free(sidecar.Delays.Data);
+    free(sidecar.Names.Data);
+    return table;
+}
+
+/* Check a table */
+bool dmi_meta_view(const void* table, size_t length, DmiMeta* meta) {
+    if (table == NULL || meta == NULL || length < sizeof(DmiMetaHeader) || ((uintptr_t)table & 3) != 0) {
+        return false;
+    }
+    const DmiMetaHeader* header = (const DmiMetaHeader*)table;
+    if (memcmp(header->Magic, DMI_META_MAGIC, sizeof(header->Magic)) != 0) {
+        return false;
+    }
+    uint64_t states_at = sizeof(DmiMetaHeader);
+    uint64_t sorted_at = states_at + (uint64_t)header->StateCount * sizeof(DmiStateRecord);
+    uint64_t delays_at = sorted_at + (uint64_t)header->StateCount * sizeof(uint32_t);
+    uint64_t names_at = delays_at + (uint64_t)header->DelayCount * sizeof(float);
+    if (names_at + header->NamesLength > length) {
+        return false;
+    }
+
+    const char* base = (const char*)table;
+    meta->Header = header;
+    meta->States = (const DmiStateRecord*)(base + states_at);
+    meta->Sorted = (const uint32_t*)(base + sorted_at);
+    meta->Delays = (const float*)(base + delays_at);
+    meta->Names = base + names_at;
+    for (uint32_t i = 0; i < header->StateCount; i++) {
+        const DmiStateRecord* state = &meta->States[i];
+        if ((uint64_t)state->NameOffset + state->NameLength >= header->NamesLength ||
+            meta->Names[state->NameOffset + state->NameLength] != '\0' || meta->Sorted[i] >= header->StateCount ||
+            (state->DelayOffset != DMI_META_NO_DELAY &&
+             (uint64_t)state->DelayOffset + state->Frames > header->DelayCount)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Find a state */
+const DmiStateRecord* dmi_meta_find(const DmiMeta* meta, const char* state) {
+    if (meta == NULL || meta->Header == NULL || state == NULL) {
+        return NULL;
+    }
+    uint32_t low = 0;
+    uint32_t high = meta->Header->StateCount;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        const DmiStateRecord* record = &meta->States[meta->Sorted[middle]];
+        if (strcmp(meta->Names + record->NameOffset, state) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low < meta->Header->StateCount) {
+        const DmiStateRecord* record = &meta->States[meta->Sorted[low]];
+        if (strcmp(meta->Names + record->NameOffset, state) == 0) {
+            return record;
+        }
+    }
+    return NULL;
+}
+
+/* Get state name */
+const char* dmi_meta_state_name(const DmiMeta* meta, const DmiStateRecord* state) {
+    return meta != NULL && state != NULL ? meta->Names + state->NameOffset : "";
+}
+
+/* Sheet index of a frame */
+uint32_t dmi_meta_icon_index(const DmiStateRecord* state, int dir, int frame) {
+    if (state == NULL) {
+        return 0;
+    }
+    return state->FirstIcon + (uint32_t)frame * state->Dirs + (uint32_t)dir;
+}
@@ -0,0 +1,83 @@
+/*
+ * Luminous Locus DMI Metadata Header
+ */
+
+#ifndef DMI_META_H
+#define DMI_META_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* First bytes of a compiled state table */
+#define DMI_META_MAGIC "DMI1"
+
+/* DmiStateRecord.Flags */
+#define DMI_STATE_REWIND  0x01
+#define DMI_STATE_HOTSPOT 0x02
+
+/* DmiStateRecord.DelayOffset of a state without delays */
+#define DMI_META_NO_DELAY UINT32_MAX
+
+/*
+ * Compiled state table, little-endian, every section 4-byte aligned:
+ * header, states in sheet order, state numbers sorted by name, delays,
+ * then the NUL-terminated names.
+ */
+typedef struct DmiMetaHeader {
+    char Magic[4];
+    uint16_t Width;         /* icon size in pixels */
+    uint16_t Height;
+    uint16_t Columns;       /* icons per sheet row, 0 when the sheet was not given */
+    uint16_t Reserved;
+    uint32_t StateCount;
+    uint32_t IconCount;     /* icons in the sheet, dirs * frames summed over states */
+    uint32_t DelayCount;
+    uint32_t NamesLength;
+    uint32_t Reserved2;
+} DmiMetaHeader;
+
+/* One icon state */
+typedef struct DmiStateRecord {
+    uint32_t NameOffset;
+    uint16_t NameLength;
+    uint8_t Dirs;
+    uint8_t Flags;
+    uint16_t Frames;
+    uint16_t Loop;          /* 0 loops forever */
+    uint32_t FirstIcon;     /* sheet index of frame 0, dir 0 */
+    uint32_t DelayOffset;   /* first of Frames delays in ticks, or DMI_META_NO_DELAY */
+    int16_t HotspotX;
+    int16_t HotspotY;
+} DmiStateRecord;
+
+/* Checked view of a compiled table, pointers into it */
+typedef struct DmiMeta {
+    const DmiMetaHeader* Header;
+    const DmiStateRecord* States;
+    const uint32_t* Sorted;
+    const float* Delays;
+    const char* Names;
+} DmiMeta;
+
+/*
+ * Compile a .dmi.json sidecar. The sheet is the .dmi itself, read only
+ * for its pixel width, and may be NULL. Returns a malloc'd table, or
+ * NULL when the JSON is not a sidecar.
+ */
+void* dmi_meta_compile(const char* json, size_t json_length, const void* sheet, size_t sheet_length,
+                       size_t* length);
+
+/* Check a compiled table and point a view at it */
+bool dmi_meta_view(const void* table, size_t length, DmiMeta* meta);
+
+/* State by name, the first one in sheet order when names repeat */
+const DmiStateRecord* dmi_meta_find(const DmiMeta* meta, const char* state);
+
+/* Name of a state */
+const char* dmi_meta_state_name(const DmiMeta* meta, const DmiStateRecord* state);
+
+/* Sheet index of one frame of one direction */
+uint32_t dmi_meta_icon_index(const DmiStateRecord* state, int dir, int frame);
+
+#endif /* DMI_META_H */
@@ -0,0 +1,420 @@
+/*
+ * Luminous Locus Event Loop Module
+ * Readiness based reactor
+ *
+ * Linux uses epoll in edge-triggered mode, every other platform falls
+ * back to a level-triggered poll() set. Handlers must drain their fd
+ * until EAGAIN so both backends behave the same way.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+    #include <windows.h>
+    #define poll WSAPoll
+#else
+    #include <unistd.h>
+    #include <fcntl.h>
+    #ifdef __linux__
+        #include <sys/epoll.h>
+    #else
+        #include <poll.h>
+    #endif
+#endif
+#include "event_loop.h"
+
+#ifdef __linux__
+
+/* Event loop state */
+struct EventLoop {
+    int EpollFD;
+    int MaxEvents;
+    void* Data;
+    struct epoll_event* Ready;
+    int ReadyCount;
+    int ReadyIndex;
+};
+
+/* Translate event flags to epoll flags */
+static uint32_t to_epoll(uint32_t events) {
+    uint32_t result = EPOLLET | EPOLLRDHUP;
+    if (events & EVENT_READ) {
+        result |= EPOLLIN;
+    }
+    if (events & EVENT_WRITE) {
+        result |= EPOLLOUT;
+    }
+    return result;
+}
+
+/* Translate epoll flags to event flags */
+static uint32_t from_epoll(uint32_t events) {
+    uint32_t result = 0;
+    if (events & EPOLLIN) {
+        result |= EVENT_READ;
+    }
+    if (events & EPOLLOUT) {
+        result |= EVENT_WRITE;
+    }
+    if (events & EPOLLERR) {
+        result |= EVENT_ERROR;
+    }
+    if (events & (EPOLLHUP | EPOLLRDHUP)) {
+        result |= EVENT_HANGUP;
+    }
+    return result;
+}
+
+/* Create new event loop */
+EventLoop* event_loop_create(int max_events) {
+    EventLoop* loop = (EventLoop*)malloc(sizeof(EventLoop));
+    if (loop == NULL) {
+        return NULL;
+    }
+    memset(loop, 0, sizeof(EventLoop));
+
+    loop->MaxEvents = max_events > 0 ? max_events : EVENT_LOOP_DEFAULT_BATCH;
+    loop->Ready = (struct epoll_event*)calloc(loop->MaxEvents, sizeof(struct epoll_event));
+    loop->EpollFD = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->Ready == NULL || loop->EpollFD < 0) {
+        if (loop->EpollFD >= 0) {
+            close(loop->EpollFD);
+        }
+        free(loop->Ready);
+        free(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+/* Free event loop */
+void event_loop_free(EventLoop* loop) {
+    if (loop != NULL) {
+        close(loop->EpollFD);
+        free(loop->Ready);
+        free(loop);
+    }
+}
+
+/* Register source */
+bool event_loop_add(EventLoop* loop, EventSource* source, uint32_t events) {
+    if (loop == NULL || source == NULL || source->FD < 0) {
+        return false;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = to_epoll(events);
+    ev.data.ptr = source;
+    if (epoll_ctl(loop->EpollFD, EPOLL_CTL_ADD, source->FD, &ev) < 0) {
+        return false;
+    }
+    source->Events = events;
+    return true;
+}
+
+/* Update interest set */
+bool event_loop_modify(EventLoop* loop, EventSource* source, uint32_t events) {
+    if (loop == NULL || source == NULL || source->FD < 0) {
+        return false;
+    }
+    if (source->Events == events) {
+        return true;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = to_epoll(events);
+    ev.data.ptr = source;
+    if (epoll_ctl(loop->EpollFD, EPOLL_CTL_MOD, source->FD, &ev) < 0) {
+        return false;
+    }
+    source->Events = events;
+    return true;
+}
+
+/* Re-arm source */
+bool event_loop_rearm(EventLoop* loop, EventSource* source) {
+    if (loop == NULL || source == NULL || source->FD < 0) {
+        return false;
+    }
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = to_epoll(source->Events);
+    ev.data.ptr = source;
+    return epoll_ctl(loop->EpollFD, EPOLL_CTL_MOD, source->FD, &ev) == 0;
+}
+
+/* Unregister source */
+bool event_loop_remove(EventLoop* loop, EventSource* source) {
+    if (loop == NULL || source == NULL || source->FD < 0) {
+        return false;
+    }
+
+    /* Drop pending events of this batch, the owner may be freed next */
+    for (int i = loop->ReadyIndex; i < loop->ReadyCount; i++) {
+        if (loop->Ready[i].data.ptr == source) {
+            loop->Ready[i].data.ptr = NULL;
+        }
+    }
+
+    return epoll_ctl(loop->EpollFD, EPOLL_CTL_DEL, source->FD, NULL) == 0;
+}
+
+/* Wait for events and dispatch */
+int event_loop_poll(EventLoop* loop, int timeout_ms) {
+    if (loop == NULL) {
+        return -1;
+    }
+
+    int ready = epoll_wait(loop->EpollFD, loop->Ready, loop->MaxEvents, timeout_ms);
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    loop->ReadyCount = ready;
+    for (loop->ReadyIndex = 0; loop->ReadyIndex < ready; ) {
+        struct epoll_event* ev = &loop->Ready[loop->ReadyIndex++];
+        EventSource* source = (EventSource*)ev->data.ptr;
+        if (source != NULL && source->Handler != NULL) {
+            source->Handler(loop, source, from_epoll(ev->events));
+        }
+    }
+    loop->ReadyCount = 0;
+    loop->ReadyIndex = 0;
+
+    return ready;
+}
+
+#else /* !__linux__ */
+
+/* Event loop state */
+struct EventLoop {
+    struct pollfd* Fds;
+    EventSource** Sources;
+    int Count;
+    int Capacity;
+    bool Dispatching;
+    bool HasHoles;
+    void* Data;
+};
+
+/* Translate event flags to poll flags */
+static short to_poll(uint32_t events) {
+    short result = 0;
+    if (events & EVENT_READ) {
+        result |= POLLIN;
+    }
+    if (events & EVENT_WRITE) {
+        result |= POLLOUT;
+    }
+    return result;
+}
+
+/* Translate poll flags to event flags */
+static uint32_t from_poll(short events) {
+    uint32_t result = 0;
+    if (events & POLLIN) {
+        result |= EVENT_READ;
+    }
+    if (events & POLLOUT) {
+        result |= EVENT_WRITE;
+    }
+    if (events & (POLLERR | POLLNVAL)) {
+        result |= EVENT_ERROR;
+    }
+    if (events & POLLHUP) {
+        result |= EVENT_HANGUP;
+    }
+    return result;
+}
+
+/* Create new event loop */
+EventLoop* event_loop_create(int max_events) {
+    EventLoop* loop = (EventLoop*)malloc(sizeof(EventLoop));
+    if (loop == NULL) {
+        return NULL;
+    }
+    memset(loop, 0, sizeof(EventLoop));
+
+    loop->Capacity = max_events > 0 ? max_events : EVENT_LOOP_DEFAULT_BATCH;
+    loop->Fds = (struct pollfd*)calloc(loop->Capacity, sizeof(struct pollfd));
+    loop->Sources = (EventSource**)calloc(loop->Capacity, sizeof(EventSource*));
+    if (loop->Fds == NULL || loop->Sources == NULL) {
+        free(loop->Fds);
+        free(loop->Sources);
+        free(loop);
+        return NULL;
+    }
+    return loop;
+}
+
+/* Free event loop */
+void event_loop_free(EventLoop* loop) {
+    if (loop != NULL) {
+        free(loop->Fds);
+        free(loop->Sources);
+        free(loop);
+    }
+}
+
+/* Register source */
+bool event_loop_add(EventLoop* loop, EventSource* source, uint32_t events) {
+    if (loop == NULL || source == NULL || source->FD < 0) {
+        return false;
+    }
+
+    if (loop->Count == loop->Capacity) {
+        int capacity = loop->Capacity * 2;
+        struct pollfd* fds = (struct pollfd*)realloc(loop->Fds, capacity * sizeof(struct pollfd));
+        if (fds == NULL) {
+            return false;
+        }
+        loop->Fds = fds;
+        EventSource** sources = (EventSource**)realloc(loop->Sources, capacity * sizeof(EventSource*));
+        if (sources == NULL) {
+            return false;
+        }
+        loop->Sources = sources;
+        loop->Capacity = capacity;
+    }
+
+    source->Slot = loop->Count++;
+    source->Events = events;
+    loop->Fds[source->Slot].fd = source->FD;
+    loop->Fds[source->Slot].events = to_poll(events);
+    loop->Fds[source->Slot].revents = 0;
+    loop->Sources[source->Slot] = source;
+    return true;
+}
+
+/* Update interest set */
+bool event_loop_modify(EventLoop* loop, EventSource* source, uint32_t events) {
+    if (loop == NULL || source == NULL || source->Slot < 0 || source->Slot >= loop->Count) {
+        return false;
+    }
+    source->Events = events;
+    loop->Fds[source->Slot].events = to_poll(events);
+    return true;
+}
+
+/* Re-arm source, poll is level-triggered and sees pending readiness anyway */
+bool event_loop_rearm(EventLoop* loop, EventSource* source) {
+    return loop != NULL && source != NULL && source->Slot >= 0 && source->Slot < loop->Count;
+}
+
+/* Drop empty slots left behind by removals during dispatch */
+static void compact(EventLoop* loop) {
+    int used = 0;
+    for (int i = 0; i < loop->Count; i++) {
+        if (loop->Sources[i] != NULL) {
+            loop->Fds[used] = loop->Fds[i];
+            loop->Sources[used] = loop->Sources[i];
+            loop->Sources[used]->Slot = used;
+            used++;
+        }
+    }
+    loop->Count = used;
+    loop->HasHoles = false;
+}
+
+/* Unregister source */
+bool event_loop_remove(EventLoop* loop, EventSource* source) {
+    if (loop == NULL || source == NULL || source->Slot < 0 || source->Slot >= loop->Count) {
+        return false;
+    }
+
+    int slot = source->Slot;
+    source->Slot = -1;
+    if (loop->Dispatching) {
+        loop->Sources[slot] = NULL;
+        loop->Fds[slot].fd = -1;
+        loop->HasHoles = true;
+        return true;
+    }
+
+    /* Swap with the last entry to keep removal O(1) */
+    int last = --loop->Count;
+    if (slot != last) {
+        loop->Fds[slot] = loop->Fds[last];
+        loop->Sources[slot] = loop->Sources[last];
+        loop->Sources[slot]->Slot = slot;
+    }
+    return true;
+}
+
+/* Wait for events and dispatch */
+int event_loop_poll(EventLoop* loop, int timeout_ms) {
+    if (loop == NULL) {
+        return -1;
+    }
+
+    int ready = poll(loop->Fds, loop->Count, timeout_ms);
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+
+    int dispatched = 0;
+    int count = loop->Count;
+    loop->Dispatching = true;
+    for (int i = 0; i < count && dispatched < ready; i++) {
+        EventSource* source = loop->Sources[i];
+        short revents = loop->Fds[i].revents;
+        if (source == NULL || revents == 0) {
+            continue;
+        }
+        loop->Fds[i].revents = 0;
+        dispatched++;
+        if (source->Handler != NULL) {
+            source->Handler(loop, source, from_poll(revents));
+        }
+    }
+    loop->Dispatching = false;
+
+    if (loop->HasHoles) {
+        compact(loop);
+    }
+    return dispatched;
+}
+
+#endif /* __linux__ */
+
+/* Set loop user data */
+void event_loop_set_data(EventLoop* loop, void* data) {
+    if (loop != NULL) {
+        loop->Data = data;
+    }
+}
+
+/* Get loop user data */
+void* event_loop_get_data(EventLoop* loop) {
+    return loop != NULL ? loop->Data : NULL;
+}
+
+/* Init source fields */
+void event_source_init(EventSource* source, int fd, EventHandler handler) {
+    if (source != NULL) {
+        source->FD = fd;
+        source->Events = 0;
+        source->Handler = handler;
+        source->Slot = -1;
+    }
+}
+
+/* Switch fd to non-blocking mode */
+bool set_nonblocking(int fd) {
+#ifdef _WIN32
+    u_long mode = 1;
+    return ioctlsocket(fd, FIONBIO, &mode) == 0;
+#else
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) {
+        return false;
+    }
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
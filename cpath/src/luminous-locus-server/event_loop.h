@@ -0,0 +1,66 @@
+/*
+ * Luminous Locus Event Loop Header
+ */
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Event flags */
+#define EVENT_READ   0x01
+#define EVENT_WRITE  0x02
+#define EVENT_ERROR  0x04
+#define EVENT_HANGUP 0x08
+
+/* Default number of events fetched per wakeup */
+#define EVENT_LOOP_DEFAULT_BATCH 256
+
+/* Event loop */
+typedef struct EventLoop EventLoop;
+typedef struct EventSource EventSource;
+
+/* Event callback, receives the source that became ready */
+typedef void (*EventHandler)(EventLoop* loop, EventSource* source, uint32_t events);
+
+/*
+ * Event source, embedded as the first member of the object that owns
+ * the fd (Conn, client_t, ...) so the kernel hands that object straight
+ * back to us on wakeup.
+ */
+struct EventSource {
+    int FD;
+    uint32_t Events;
+    EventHandler Handler;
+    int Slot;
+};
+
+/* Create event loop */
+EventLoop* event_loop_create(int max_events);
+
+/* Free event loop */
+void event_loop_free(EventLoop* loop);
+
+/* Register/update/unregister a source */
+bool event_loop_add(EventLoop* loop, EventSource* source, uint32_t events);
+bool event_loop_modify(EventLoop* loop, EventSource* source, uint32_t events);
+bool event_loop_remove(EventLoop* loop, EventSource* source);
+
+/* Re-arm a source with its current interest, edge-triggered backends then report readiness already pending */
+bool event_loop_rearm(EventLoop* loop, EventSource* source);
+
+/* Wait for events and dispatch them, returns dispatched count or -1 */
+int event_loop_poll(EventLoop* loop, int timeout_ms);
+
+/* Loop-wide user data, handed to every handler through the loop */
+void event_loop_set_data(EventLoop* loop, void* data);
+void* event_loop_get_data(EventLoop* loop);
+
+/* Init source fields */
+void event_source_init(EventSource* source, int fd, EventHandler handler);
+
+/* Switch fd to non-blocking mode */
+bool set_nonblocking(int fd);
+
+#endif /* EVENT_LOOP_H */
@@ -0,0 +1,91 @@
+/*
+ * Luminous Locus Frame Module
+ * Incremental protocol v2 frame decoder
+ *
+ * The reader never copies: callers feed it whatever their connection
+ * buffer holds, take zero or more frames out and drop the consumed
+ * prefix afterwards. A partial header or body simply stays buffered
+ * until the next read completes it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "model.h"
+#include "message.h"
+#include "frame.h"
+
+/* Read big-endian 32-bit value */
+static uint32_t read_be32(const char* data) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) |
+           ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+}
+
+/* Write big-endian 32-bit value */
+static void write_be32(char* out, uint32_t value) {
+    unsigned char* bytes = (unsigned char*)out;
+    bytes[0] = (unsigned char)(value >> 24);
+    bytes[1] = (unsigned char)(value >> 16);
+    bytes[2] = (unsigned char)(value >> 8);
+    bytes[3] = (unsigned char)value;
+}
+
+/* Init reader */
+void frame_reader_init(FrameReader* reader, const char* data, size_t available, size_t capacity) {
+    if (reader != NULL) {
+        reader->Data = data;
+        reader->Available = available;
+        reader->Offset = 0;
+        reader->Capacity = capacity;
+    }
+}
+
+/* Get next frame */
+enum FrameResult frame_reader_next(FrameReader* reader, FrameView* frame) {
+    if (reader == NULL || frame == NULL) {
+        return FRAME_INVALID;
+    }
+
+    size_t left = reader->Available - reader->Offset;
+    if (left < FRAME_HEADER_SIZE) {
+        return FRAME_INCOMPLETE;
+    }
+
+    const char* header = reader->Data + reader->Offset;
+    uint32_t length = read_be32(header);
+    uint32_t kind = read_be32(header + 4);
+    if (kind == 0) {
+        return FRAME_INVALID;
+    }
+
+    /* Reject oversized frames before their body is buffered */
+    int max_length = get_max_message_length((int)kind);
+    if ((max_length > 0 && length > (uint32_t)max_length) ||
+        reader->Capacity < FRAME_HEADER_SIZE || (size_t)length > reader->Capacity - FRAME_HEADER_SIZE) {
+        return FRAME_TOO_LARGE;
+    }
+
+    if (left - FRAME_HEADER_SIZE < length) {
+        return FRAME_INCOMPLETE;
+    }
+
+    frame->Kind = kind;
+    frame->Length = length;
+    frame->Body = header + FRAME_HEADER_SIZE;
+    reader->Offset += FRAME_HEADER_SIZE + length;
+    return FRAME_OK;
+}
+
+/* Get consumed bytes */
+size_t frame_reader_consumed(const FrameReader* reader) {
+    return reader != NULL ? reader->Offset : 0;
+}
+
+/* Encode header */
+void frame_write_header(char* out, uint32_t kind, uint32_t length) {
+    write_be32(out, length);
+    write_be32(out + 4, kind);
+}
@@ -0,0 +1,55 @@
+/*
+ * Luminous Locus Frame Header
+ * Protocol v2 framing: [body size][message type][body]
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Header is two big-endian 32-bit fields */
+#define FRAME_HEADER_SIZE 8
+
+/* Protocol version sent by clients before the first frame */
+#define FRAME_PROTOCOL_VERSION "S132"
+#define FRAME_PROTOCOL_VERSION_SIZE 4
+
+/* Decode result */
+enum FrameResult {
+    FRAME_OK,          /* complete frame returned */
+    FRAME_INCOMPLETE,  /* need more bytes */
+    FRAME_TOO_LARGE,   /* declared body exceeds the limit for its kind */
+    FRAME_INVALID      /* malformed header */
+};
+
+/* View of one frame, Body points into the reader's buffer */
+typedef struct FrameView {
+    uint32_t Kind;
+    uint32_t Length;
+    const char* Body;
+} FrameView;
+
+/* Walks complete frames in a byte buffer without copying */
+typedef struct FrameReader {
+    const char* Data;
+    size_t Available;
+    size_t Offset;     /* bytes of complete frames consumed so far */
+    size_t Capacity;   /* largest frame the caller can ever buffer */
+} FrameReader;
+
+/* Start reading frames from data */
+void frame_reader_init(FrameReader* reader, const char* data, size_t available, size_t capacity);
+
+/* Get next frame, the size limit is checked as soon as the header is in */
+enum FrameResult frame_reader_next(FrameReader* reader, FrameView* frame);
+
+/* Bytes the caller may drop from the front of its buffer */
+size_t frame_reader_consumed(const FrameReader* reader);
+
+/* Encode a header */
+void frame_write_header(char* out, uint32_t kind, uint32_t length);
+
+#endif /* FRAME_H */
@@ -0,0 +1,201 @@
+/*
+ * Luminous Locus Handoff Queue Module
+ * Reactor to game thread hand-off
+ *
+ * Reactors own sockets and decode frames, the game thread owns game
+ * state. Everything crossing that boundary goes through this queue as
+ * an Envelope, so neither side touches the other's data.
+ *
+ * The queue is a bounded multi-producer, single-consumer ring. A push
+ * takes a free-slot credit and a position with one atomic add each,
+ * fills the slot and publishes it with its sequence number, so
+ * reactors never wait on each other or on the game thread. The game
+ * thread takes published slots in order and returns the credits in
+ * one add per batch. The mutex and condition variable only come into
+ * play while the game thread sleeps on an empty queue.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <pthread.h>
+#include "message.h"
+#include "handoff.h"
+
+/* Keeps producer and consumer counters on separate cache lines */
+#define HANDOFF_CACHE_LINE 64
+
+/* One ring slot, Sequence is position + 1 once Item is published */
+typedef struct HandoffSlot {
+    uint64_t Sequence;
+    Envelope* Item;
+} HandoffSlot;
+
+/* Bounded ring of envelopes */
+struct HandoffQueue {
+    HandoffSlot* Slots;
+    size_t Capacity;
+    size_t Mask;
+    char Pad0[HANDOFF_CACHE_LINE];
+    int64_t Free;           /* slots not yet reserved, producers take, consumer returns */
+    uint64_t Tail;          /* next position to reserve */
+    char Pad1[HANDOFF_CACHE_LINE];
+    uint64_t Head;          /* next position to consume, consumer only */
+    char Pad2[HANDOFF_CACHE_LINE];
+    pthread_mutex_t Mutex;  /* only for sleeping, never on the push fast path */
+    pthread_cond_t NotEmpty;
+    int Sleeping;
+    int Woken;
+};
+
+/* Round up to a power of two */
+static size_t round_pow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/* Create new queue */
+HandoffQueue* handoff_queue_create(size_t capacity) {
+    HandoffQueue* queue = (HandoffQueue*)malloc(sizeof(HandoffQueue));
+    if (queue == NULL) {
+        return NULL;
+    }
+    memset(queue, 0, sizeof(HandoffQueue));
+
+    queue->Capacity = round_pow2(capacity > 0 ? capacity : HANDOFF_DEFAULT_CAPACITY);
+    queue->Mask = queue->Capacity - 1;
+    queue->Free = (int64_t)queue->Capacity;
+    queue->Slots = (HandoffSlot*)calloc(queue->Capacity, sizeof(HandoffSlot));
+    if (queue->Slots == NULL) {
+        free(queue);
+        return NULL;
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&queue->NotEmpty, &attr);
+    pthread_condattr_destroy(&attr);
+    pthread_mutex_init(&queue->Mutex, NULL);
+    return queue;
+}
+
+/* Take published envelopes in order, stops at a slot still being filled */
+static size_t take(HandoffQueue* queue, Envelope** out, size_t max) {
+    uint64_t head = queue->Head;
+    size_t taken = 0;
+    while (taken < max) {
+        HandoffSlot* slot = &queue->Slots[head & queue->Mask];
+        if (__atomic_load_n(&slot->Sequence, __ATOMIC_ACQUIRE) != head + 1) {
+            break;
+        }
+        out[taken++] = __atomic_load_n(&slot->Item, __ATOMIC_RELAXED);
+        head++;
+    }
+    if (taken > 0) {
+        queue->Head = head;
+        /* Release: the slots are read before producers may reuse them */
+        __atomic_add_fetch(&queue->Free, (int64_t)taken, __ATOMIC_RELEASE);
+    }
+    return taken;
+}
+
+/* Check for a published envelope at the head */
+static bool ready(HandoffQueue* queue) {
+    HandoffSlot* slot = &queue->Slots[queue->Head & queue->Mask];
+    return __atomic_load_n(&slot->Sequence, __ATOMIC_SEQ_CST) == queue->Head + 1;
+}
+
+/* Free queue */
+void handoff_queue_free(HandoffQueue* queue) {
+    if (queue != NULL) {
+        Envelope* env = NULL;
+        while (take(queue, &env, 1) == 1) {
+            envelope_discard(env);
+        }
+        pthread_cond_destroy(&queue->NotEmpty);
+        pthread_mutex_destroy(&queue->Mutex);
+        free(queue->Slots);
+        free(queue);
+    }
+}
+
+/* Push envelope */
+bool handoff_queue_push(HandoffQueue* queue, Envelope* env) {
+    if (queue == NULL || env == NULL) {
+        return false;
+    }
+
+    /* Reserve a slot, then a position; both are single atomic adds */
+    if (__atomic_sub_fetch(&queue->Free, 1, __ATOMIC_ACQUIRE) < 0) {
+        __atomic_add_fetch(&queue->Free, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    uint64_t position = __atomic_fetch_add(&queue->Tail, 1, __ATOMIC_RELAXED);
+    HandoffSlot* slot = &queue->Slots[position & queue->Mask];
+    /* Atomic, the credit keeps the slot free but does not order us after its last use */
+    __atomic_store_n(&slot->Item, env, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->Sequence, position + 1, __ATOMIC_RELEASE);
+
+    /* Pairs with the consumer announcing sleep before its last check */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&queue->Sleeping, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&queue->Mutex);
+        pthread_cond_signal(&queue->NotEmpty);
+        pthread_mutex_unlock(&queue->Mutex);
+    }
+    return true;
+}
+
+/* Drain envelopes */
+size_t handoff_queue_drain(HandoffQueue* queue, Envelope** out, size_t max, int timeout_ms) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t deadline = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec + (int64_t)timeout_ms * 1000000LL;
+    return handoff_queue_drain_until(queue, out, max, timeout_ms > 0 ? deadline : 0);
+}
+
+/* Drain queue, waiting until an absolute deadline */
+size_t handoff_queue_drain_until(HandoffQueue* queue, Envelope** out, size_t max, int64_t deadline_ns) {
+    if (queue == NULL || out == NULL || max == 0) {
+        return 0;
+    }
+
+    size_t taken = take(queue, out, max);
+    if (taken == 0 && deadline_ns > 0 && !__atomic_load_n(&queue->Woken, __ATOMIC_ACQUIRE)) {
+        struct timespec deadline;
+        deadline.tv_sec = (time_t)(deadline_ns / 1000000000LL);
+        deadline.tv_nsec = (long)(deadline_ns % 1000000000LL);
+
+        pthread_mutex_lock(&queue->Mutex);
+        __atomic_store_n(&queue->Sleeping, 1, __ATOMIC_SEQ_CST);
+        while (!ready(queue) && !__atomic_load_n(&queue->Woken, __ATOMIC_SEQ_CST)) {
+            if (pthread_cond_timedwait(&queue->NotEmpty, &queue->Mutex, &deadline) == ETIMEDOUT) {
+                break;
+            }
+        }
+        __atomic_store_n(&queue->Sleeping, 0, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&queue->Mutex);
+        taken = take(queue, out, max);
+    }
+    __atomic_store_n(&queue->Woken, 0, __ATOMIC_RELAXED);
+    return taken;
+}
+
+/* Wake consumer */
+void handoff_queue_wake(HandoffQueue* queue) {
+    if (queue != NULL) {
+        pthread_mutex_lock(&queue->Mutex);
+        __atomic_store_n(&queue->Woken, 1, __ATOMIC_SEQ_CST);
+        pthread_cond_signal(&queue->NotEmpty);
+        pthread_mutex_unlock(&queue->Mutex);
+    }
+}
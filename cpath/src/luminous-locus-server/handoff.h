@@ -0,0 +1,37 @@
+/*
+ * Luminous Locus Handoff Queue Header
+ */
+
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "message.h"
+
+/* Default queue capacity */
+#define HANDOFF_DEFAULT_CAPACITY 65536
+
+/* Queue of envelopes from the reactors to the game thread */
+typedef struct HandoffQueue HandoffQueue;
+
+/* Create queue, capacity is rounded up to a power of two */
+HandoffQueue* handoff_queue_create(size_t capacity);
+
+/* Free queue, envelopes still queued are freed too */
+void handoff_queue_free(HandoffQueue* queue);
+
+/* Push from any reactor without locking, returns false when the queue is full */
+bool handoff_queue_push(HandoffQueue* queue, Envelope* env);
+
+/* Pop up to max envelopes, waits up to timeout_ms when empty */
+size_t handoff_queue_drain(HandoffQueue* queue, Envelope** out, size_t max, int timeout_ms);
+
+/* Same, but waits until an absolute CLOCK_MONOTONIC deadline in nanoseconds */
+size_t handoff_queue_drain_until(HandoffQueue* queue, Envelope** out, size_t max, int64_t deadline_ns);
+
+/* Wake a waiting consumer */
+void handoff_queue_wake(HandoffQueue* queue);
+
+#endif /* HANDOFF_H */
@@ -0,0 +1,257 @@
+/*
+ * Luminous Locus Hash Ring Module
+ * Tick-indexed verification of client state hashes
+ *
+ * A requested tick occupies slot tick % HASH_RING_SIZE. Reports are
+ * tallied as they arrive: once one hash holds a strict majority of the
+ * clients asked, every report that differs is flagged right away, and
+ * late ones are flagged on arrival. A tick whose reports never reach a
+ * majority is settled on timeout by the majority of what did arrive.
+ * Slot storage grows with the client count and is reused afterwards, so
+ * a steady game does not allocate here.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "hash_ring.h"
+
+#define HASH_RING_MASK (HASH_RING_SIZE - 1)
+#define HASH_SLOT_MIN_CAPACITY 16
+
+/* One client's report */
+typedef struct HashReport {
+    int ClientID;
+    int32_t Hash;
+    bool Flagged;
+} HashReport;
+
+/* Clients that reported one hash value */
+typedef struct HashTally {
+    int32_t Hash;
+    int Count;
+} HashTally;
+
+/* Reports of one tick */
+typedef struct HashSlot {
+    int64_t Tick;        /* -1 when unused */
+    int Expected;
+    bool Resolved;
+    int Majority;        /* tally index, -1 until a hash holds a majority */
+    HashReport* Reports;
+    int ReportCount;
+    HashTally* Tallies;
+    int TallyCount;
+    int Capacity;        /* of both arrays */
+} HashSlot;
+
+struct HashRing {
+    HashSlot Slots[HASH_RING_SIZE];
+    HashMismatchFn OnMismatch;
+    void* Data;
+    int64_t Resolved;
+    int64_t Mismatches;
+    int64_t Undecided;
+};
+
+/* Flag one report */
+static void flag_report(HashRing* ring, HashSlot* slot, HashReport* report) {
+    if (!report->Flagged) {
+        report->Flagged = true;
+        ring->Mismatches++;
+        if (ring->OnMismatch != NULL) {
+            ring->OnMismatch(ring->Data, report->ClientID, slot->Tick);
+        }
+    }
+}
+
+/* Flag every report that differs from the majority */
+static void flag_minority(HashRing* ring, HashSlot* slot) {
+    int32_t hash = slot->Tallies[slot->Majority].Hash;
+    for (int i = 0; i < slot->ReportCount; i++) {
+        if (slot->Reports[i].Hash != hash) {
+            flag_report(ring, slot, &slot->Reports[i]);
+        }
+    }
+}
+
+/* Close a tick, falling back to the majority of the reports received */
+static void resolve_slot(HashRing* ring, HashSlot* slot) {
+    if (slot->Tick < 0 || slot->Resolved) {
+        return;
+    }
+    slot->Resolved = true;
+    if (slot->Majority < 0) {
+        for (int i = 0; i < slot->TallyCount; i++) {
+            if (slot->Tallies[i].Count * 2 > slot->ReportCount) {
+                slot->Majority = i;
+                break;
+            }
+        }
+        if (slot->Majority < 0) {
+            if (slot->TallyCount > 1) {
+                ring->Undecided++;
+            }
+            ring->Resolved++;
+            return;
+        }
+        flag_minority(ring, slot);
+    }
+    ring->Resolved++;
+}
+
+/* Make room for expected reports */
+static bool reserve_slot(HashSlot* slot, int expected) {
+    if (expected <= slot->Capacity) {
+        return true;
+    }
+    int capacity = slot->Capacity > 0 ? slot->Capacity : HASH_SLOT_MIN_CAPACITY;
+    while (capacity < expected) {
+        capacity *= 2;
+    }
+    HashReport* reports = (HashReport*)realloc(slot->Reports, (size_t)capacity * sizeof(HashReport));
+    if (reports == NULL) {
+        return false;
+    }
+    slot->Reports = reports;
+    HashTally* tallies = (HashTally*)realloc(slot->Tallies, (size_t)capacity * sizeof(HashTally));
+    if (tallies == NULL) {
+        return false;
+    }
+    slot->Tallies = tallies;
+    slot->Capacity = capacity;
+    return true;
+}
+
+/* Create ring */
+HashRing* hash_ring_create(HashMismatchFn on_mismatch, void* data) {
+    HashRing* ring = (HashRing*)malloc(sizeof(HashRing));
+    if (ring == NULL) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(HashRing));
+    for (int i = 0; i < HASH_RING_SIZE; i++) {
+        ring->Slots[i].Tick = -1;
+        ring->Slots[i].Majority = -1;
+    }
+    ring->OnMismatch = on_mismatch;
+    ring->Data = data;
+    return ring;
+}
+
+/* Free ring */
+void hash_ring_free(HashRing* ring) {
+    if (ring != NULL) {
+        for (int i = 0; i < HASH_RING_SIZE; i++) {
+            free(ring->Slots[i].Reports);
+            free(ring->Slots[i].Tallies);
+        }
+        free(ring);
+    }
+}
+
+/* Open a tick */
+bool hash_ring_open(HashRing* ring, int64_t tick, int expected) {
+    if (ring == NULL || tick < 0 || expected <= 0) {
+        return false;
+    }
+    HashSlot* slot = &ring->Slots[tick & HASH_RING_MASK];
+    if (slot->Tick == tick) {
+        return true;
+    }
+    /* The previous occupant is a full ring behind, settle it first */
+    resolve_slot(ring, slot);
+    if (!reserve_slot(slot, expected)) {
+        slot->Tick = -1;
+        return false;
+    }
+    slot->Tick = tick;
+    slot->Expected = expected;
+    slot->Resolved = false;
+    slot->Majority = -1;
+    slot->ReportCount = 0;
+    slot->TallyCount = 0;
+    return true;
+}
+
+/* Record a report */
+enum HashReportResult hash_ring_report(HashRing* ring, int64_t tick, int client_id, int32_t hash) {
+    if (ring == NULL || tick < 0) {
+        return HASH_REPORT_UNKNOWN;
+    }
+    HashSlot* slot = &ring->Slots[tick & HASH_RING_MASK];
+    if (slot->Tick != tick) {
+        return HASH_REPORT_UNKNOWN;
+    }
+
+    for (int i = 0; i < slot->ReportCount; i++) {
+        if (slot->Reports[i].ClientID == client_id) {
+            return HASH_REPORT_DUPLICATE;
+        }
+    }
+    /* More replies than clients asked, someone joined in between */
+    if (slot->ReportCount == slot->Capacity && !reserve_slot(slot, slot->Capacity + 1)) {
+        return HASH_REPORT_FAILED;
+    }
+
+    HashReport* report = &slot->Reports[slot->ReportCount++];
+    report->ClientID = client_id;
+    report->Hash = hash;
+    report->Flagged = false;
+
+    int index = 0;
+    while (index < slot->TallyCount && slot->Tallies[index].Hash != hash) {
+        index++;
+    }
+    if (index == slot->TallyCount) {
+        slot->Tallies[slot->TallyCount].Hash = hash;
+        slot->Tallies[slot->TallyCount].Count = 0;
+        slot->TallyCount++;
+    }
+    slot->Tallies[index].Count++;
+
+    if (slot->Majority < 0) {
+        if (slot->Tallies[index].Count * 2 > slot->Expected) {
+            /* Majority settled, earlier dissenters are now known */
+            slot->Majority = index;
+            flag_minority(ring, slot);
+        }
+    } else if (index != slot->Majority) {
+        flag_report(ring, slot, report);
+    }
+
+    if (!slot->Resolved && slot->ReportCount >= slot->Expected) {
+        resolve_slot(ring, slot);
+    }
+    return HASH_REPORT_OK;
+}
+
+/* Expire overdue ticks */
+void hash_ring_expire(HashRing* ring, int64_t now, int64_t timeout) {
+    if (ring == NULL) {
+        return;
+    }
+    for (int i = 0; i < HASH_RING_SIZE; i++) {
+        HashSlot* slot = &ring->Slots[i];
+        if (slot->Tick >= 0 && !slot->Resolved && now - slot->Tick >= timeout) {
+            resolve_slot(ring, slot);
+        }
+    }
+}
+
+/* Get resolved ticks */
+int64_t hash_ring_get_resolved(HashRing* ring) {
+    return ring != NULL ? ring->Resolved : 0;
+}
+
+/* Get flagged reports */
+int64_t hash_ring_get_mismatches(HashRing* ring) {
+    return ring != NULL ? ring->Mismatches : 0;
+}
+
+/* Get ticks without a majority */
+int64_t hash_ring_get_undecided(HashRing* ring) {
+    return ring != NULL ? ring->Undecided : 0;
+}
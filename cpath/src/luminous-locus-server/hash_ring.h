@@ -0,0 +1,49 @@
+/*
+ * Luminous Locus Hash Ring Header
+ */
+
+#ifndef HASH_RING_H
+#define HASH_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Ticks tracked at once, power of two */
+#define HASH_RING_SIZE 64
+
+/* Report result */
+enum HashReportResult {
+    HASH_REPORT_OK,
+    HASH_REPORT_UNKNOWN,     /* tick was never requested or already recycled */
+    HASH_REPORT_DUPLICATE,   /* client already reported this tick */
+    HASH_REPORT_FAILED       /* out of memory */
+};
+
+/* Called for every client whose hash disagrees with the majority */
+typedef void (*HashMismatchFn)(void* data, int client_id, int64_t tick);
+
+/* Per-tick hash verification */
+typedef struct HashRing HashRing;
+
+/* Create ring */
+HashRing* hash_ring_create(HashMismatchFn on_mismatch, void* data);
+
+/* Free ring */
+void hash_ring_free(HashRing* ring);
+
+/* Start collecting hashes for a tick, expected is the number of clients asked */
+bool hash_ring_open(HashRing* ring, int64_t tick, int expected);
+
+/* Record one client's hash, mismatches are reported as soon as a majority exists */
+enum HashReportResult hash_ring_report(HashRing* ring, int64_t tick, int client_id, int32_t hash);
+
+/* Settle ticks opened at least timeout ticks before now with the reports at hand */
+void hash_ring_expire(HashRing* ring, int64_t now, int64_t timeout);
+
+/* Counters */
+int64_t hash_ring_get_resolved(HashRing* ring);
+int64_t hash_ring_get_mismatches(HashRing* ring);
+int64_t hash_ring_get_undecided(HashRing* ring);
+
+#endif /* HASH_RING_H */
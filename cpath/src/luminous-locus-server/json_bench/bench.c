@@ -0,0 +1,282 @@
+/*
+ * Luminous Locus JSON Bench
+ * Compares the schema decoder with a tree-building parser
+ *
+ * The baseline parses each body into a malloc'd tree of key/value nodes
+ * and then copies the wanted values into the struct, the way a generic
+ * JSON library would be used. Both decode the same bodies the same
+ * number of times; results are printed as ns per body and MB/s.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include "../model.h"
+#include "../json_decode.h"
+
+/* Configuration */
+#define DEFAULT_ITERATIONS 200000
+
+/* Baseline tree node, one per value */
+typedef struct Node {
+    enum { NODE_STRING, NODE_NUMBER, NODE_BOOL, NODE_NULL, NODE_OBJECT, NODE_ARRAY } Type;
+    char* Key;
+    char* String;
+    double Number;
+    bool Bool;
+    struct Node* Child;
+    struct Node* Next;
+} Node;
+
+typedef struct BenchCase {
+    const char* Name;
+    int Kind;
+    const char* Body;
+    size_t Length;
+} BenchCase;
+
+static const char* cursor;
+
+/* Skip whitespace */
+static void tree_space(void) {
+    while (*cursor == ' ' || *cursor == '\n' || *cursor == '\r' || *cursor == '\t') {
+        cursor++;
+    }
+}
+
+/* Parse a string into a fresh buffer */
+static char* tree_string(void) {
+    const char* start = ++cursor;
+    size_t length = 0;
+    while (*cursor != '"' && *cursor != '\0') {
+        cursor += *cursor == '\\' ? 2 : 1;
+    }
+    length = (size_t)(cursor - start);
+    char* out = (char*)malloc(length + 1);
+    size_t n = 0;
+    for (const char* p = start; p < cursor; p++) {
+        if (*p == '\\') {
+            p++;
+            switch (*p) {
+                case 'n': out[n++] = '\n'; break;
+                case 't': out[n++] = '\t'; break;
+                case 'r': out[n++] = '\r'; break;
+                case 'b': out[n++] = '\b'; break;
+                case 'f': out[n++] = '\f'; break;
+                default: out[n++] = *p; break;
+            }
+        } else {
+            out[n++] = *p;
+        }
+    }
+    out[n] = '\0';
+    if (*cursor == '"') {
+        cursor++;
+    }
+    return out;
+}
+
+/* Parse any value */
+static Node* tree_value(void) {
+    Node* node = (Node*)calloc(1, sizeof(Node));
+    tree_space();
+    if (*cursor == '{' || *cursor == '[') {
+        bool object = *cursor == '{';
+        node->Type = object ? NODE_OBJECT : NODE_ARRAY;
+        cursor++;
+        Node** tail = &node->Child;
+        tree_space();
+        while (*cursor != '}' && *cursor != ']' && *cursor != '\0') {
+            char* key = NULL;
+            if (object) {
+                key = tree_string();
+                tree_space();
+                cursor++;
+            }
+            Node* child = tree_value();
+            child->Key = key;
+            *tail = child;
+            tail = &child->Next;
+            tree_space();
+            if (*cursor == ',') {
+                cursor++;
+                tree_space();
+            }
+        }
+        if (*cursor != '\0') {
+            cursor++;
+        }
+    } else if (*cursor == '"') {
+        node->Type = NODE_STRING;
+        node->String = tree_string();
+    } else if (*cursor == 't' || *cursor == 'f') {
+        node->Type = NODE_BOOL;
+        node->Bool = *cursor == 't';
+        cursor += node->Bool ? 4 : 5;
+    } else if (*cursor == 'n') {
+        node->Type = NODE_NULL;
+        cursor += 4;
+    } else {
+        char* end = NULL;
+        node->Type = NODE_NUMBER;
+        node->Number = strtod(cursor, &end);
+        cursor = end;
+    }
+    return node;
+}
+
+/* Free a tree */
+static void tree_free(Node* node) {
+    while (node != NULL) {
+        Node* next = node->Next;
+        tree_free(node->Child);
+        free(node->Key);
+        free(node->String);
+        free(node);
+        node = next;
+    }
+}
+
+/* Find a member */
+static Node* tree_get(Node* object, const char* key) {
+    for (Node* child = object->Child; child != NULL; child = child->Next) {
+        if (child->Key != NULL && strcmp(child->Key, key) == 0) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+/* Copy a string member */
+static void tree_copy(Node* object, const char* key, char* out, size_t size) {
+    Node* node = tree_get(object, key);
+    if (node != NULL && node->Type == NODE_STRING) {
+        strncpy(out, node->String, size - 1);
+        out[size - 1] = '\0';
+    }
+}
+
+/* Get an integer member */
+static int tree_int(Node* object, const char* key) {
+    Node* node = tree_get(object, key);
+    return node != NULL && node->Type == NODE_NUMBER ? (int)node->Number : 0;
+}
+
+/* Baseline decode of one body */
+static void tree_decode(const BenchCase* bench, void* out) {
+    cursor = bench->Body;
+    Node* root = tree_value();
+    switch (bench->Kind) {
+        case MSGID_LOGIN: {
+            MessageLogin* login = (MessageLogin*)out;
+            memset(login, 0, sizeof(*login));
+            tree_copy(root, "login", login->Login, sizeof(login->Login));
+            tree_copy(root, "password", login->Password, sizeof(login->Password));
+            tree_copy(root, "game_version", login->GameVersion, sizeof(login->GameVersion));
+            Node* guest = tree_get(root, "guest");
+            login->IsGuest = guest != NULL && guest->Type == NODE_BOOL && guest->Bool;
+            break;
+        }
+        case MSGID_OOCMESSAGE: {
+            MessageOOC* ooc = (MessageOOC*)out;
+            memset(ooc, 0, sizeof(*ooc));
+            tree_copy(root, "login", ooc->Login, sizeof(ooc->Login));
+            tree_copy(root, "text", ooc->Text, sizeof(ooc->Text));
+            break;
+        }
+        case MSGID_HASH: {
+            MessageHash* hash = (MessageHash*)out;
+            hash->Hash = tree_int(root, "hash");
+            hash->Tick = tree_int(root, "tick");
+            break;
+        }
+        default: {
+            MessageInput* input = (MessageInput*)out;
+            memset(input, 0, sizeof(*input));
+            input->ID = tree_int(root, "id");
+            tree_copy(root, "key", input->Key, sizeof(input->Key));
+            break;
+        }
+    }
+    tree_free(root);
+}
+
+/* Get time in ns */
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Build the OOC body, about 1 KB of chat with escapes */
+static const char* make_ooc_body(void) {
+    static char body[1200];
+    const char* line = "Anyone seen the captain? He said \\\"meet at the bridge\\\"\\n";
+    size_t n = (size_t)sprintf(body, "{\"login\":\"assistant\",\"text\":\"");
+    while (n + strlen(line) < 1000) {
+        memcpy(body + n, line, strlen(line));
+        n += strlen(line);
+    }
+    strcpy(body + n, "\"}");
+    return body;
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? atoi(argv[1]) : DEFAULT_ITERATIONS;
+    if (iterations <= 0) {
+        iterations = DEFAULT_ITERATIONS;
+    }
+
+    BenchCase cases[] = {
+        { "login", MSGID_LOGIN,
+          "{\"login\":\"crewmember\",\"password\":\"hunter2\",\"guest\":false,\"game_version\":\"v0.3.1\"}", 0 },
+        { "ooc", MSGID_OOCMESSAGE, make_ooc_body(), 0 },
+        { "hash", MSGID_HASH, "{\"hash\":3735928559,\"tick\":104857}", 0 },
+        { "input", MSGID_INPUT, "{\"id\":42,\"key\":\"SOUTH_KEY\"}", 0 },
+    };
+    int count = (int)(sizeof(cases) / sizeof(cases[0]));
+
+#if defined(__AVX2__)
+    printf("Scanner: AVX2\n");
+#elif defined(__SSE2__)
+    printf("Scanner: SSE2\n");
+#else
+    printf("Scanner: scalar\n");
+#endif
+    printf("%-8s %8s %12s %12s %10s %10s\n", "body", "bytes", "tree ns", "schema ns", "tree MB/s", "schema MB/s");
+
+    /* Largest struct any case decodes into */
+    static char out[sizeof(MessageOOC)];
+    volatile int sink = 0;
+
+    for (int i = 0; i < count; i++) {
+        BenchCase* bench = &cases[i];
+        bench->Length = strlen(bench->Body);
+
+        double start = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            tree_decode(bench, out);
+            sink += out[0];
+        }
+        double tree_ns = (now_ns() - start) / iterations;
+
+        start = now_ns();
+        for (int n = 0; n < iterations; n++) {
+            if (json_decode_message(bench->Kind, bench->Body, bench->Length, out) != JSON_DECODE_OK) {
+                printf("Decode failed for %s\n", bench->Name);
+                return 1;
+            }
+            sink += out[0];
+        }
+        double schema_ns = (now_ns() - start) / iterations;
+
+        printf("%-8s %8zu %12.1f %12.1f %10.1f %10.1f\n", bench->Name, bench->Length, tree_ns, schema_ns,
+               bench->Length * 1e3 / tree_ns, bench->Length * 1e3 / schema_ns);
+    }
+    (void)sink;
+    return 0;
+}
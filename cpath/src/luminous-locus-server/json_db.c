@@ -1,23 +1,412 @@
 /*
  * Luminous Locus JSON Database Module
  * User authentication storage
+ *
+ * db/auth.json is loaded into an open-addressing table keyed by login,
+ * whose strings are interned into one block owned by the table, so a
+ * lookup is a hash, a short probe and a copy, with nothing allocated. A
+ * background thread watches the file's directory with inotify and, when
+ * the file is rewritten or renamed into place, parses it into a fresh
+ * table and swaps the pointer, RCU style: readers announce themselves in
+ * one of two counters chosen by an epoch, and the old table is freed
+ * once the counter of the epoch it served drains. A file that does not
+ * parse leaves the old table in service, so logins never wait on the
+ * file and never see half of an edit.
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#ifdef __linux__
+    #include <poll.h>
+    #include <unistd.h>
+    #include <sys/eventfd.h>
+    #include <sys/inotify.h>
+#endif
 #include "model.h"
+#include "json_decode.h"
+#include "json_db.h"
 
-/* Auth file name */
-#define JSONDB_AUTH_FILE "auth.json"
+/* Larger files are refused rather than read */
+#define JSONDB_MAX_FILE_SIZE (16 * 1024 * 1024)
+
+/* Smallest table, keeps an empty database probe-able */
+#define JSONDB_MIN_SLOTS 8
+
+/* One login, strings are offsets into the table's block */
+typedef struct AuthEntry {
+    uint64_t Hash;          /* 0 marks a free slot */
+    uint32_t Login;
+    uint32_t Passhash;
+    uint16_t LoginLength;
+    uint16_t PasshashLength;
+    bool IsAdmin;
+} AuthEntry;
+
+/* Immutable once published */
+typedef struct AuthTable {
+    AuthEntry* Slots;
+    uint32_t Mask;
+    int Count;
+    char* Strings;
+} AuthTable;
+
+/* State of one load */
+typedef struct TableBuilder {
+    AuthTable* Table;
+    size_t StringsLength;
+    size_t StringsCapacity;
+    uint32_t* Interned;     /* string offset + 1, 0 marks a free slot */
+    uint32_t InternedMask;
+    int Members;
+    bool Counting;          /* first pass, only count members */
+    bool TooLong;
+} TableBuilder;
 
 /* JSON database structure */
 struct json_db_t {
-    /* User database - implemented as hash map simulation */
-    void* users;
+    char* Path;
+    const char* Name;       /* file name within Directory */
+    char* Directory;
+    AuthTable* Current;
+    unsigned Epoch;
+    int Readers[2];         /* readers inside each epoch's table */
+    int64_t Reloads;
+    int Inotify;
+    int WakeFD;
+    pthread_t Thread;
+    bool Watching;
 };
 
+/* FNV-1a, never 0 so 0 can mark free slots */
+static uint64_t login_hash(const char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+/* Smallest power of two at least twice count */
+static uint32_t slots_for(int count) {
+    uint32_t slots = JSONDB_MIN_SLOTS;
+    while (slots < (uint32_t)count * 2) {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+/* Free table */
+static void table_free(AuthTable* table) {
+    if (table != NULL) {
+        free(table->Slots);
+        free(table->Strings);
+        free(table);
+    }
+}
+
+/* Create table for count logins with room for strings_capacity bytes of strings */
+static AuthTable* table_create(int count, size_t strings_capacity) {
+    AuthTable* table = (AuthTable*)calloc(1, sizeof(AuthTable));
+    if (table == NULL) {
+        return NULL;
+    }
+    uint32_t slots = slots_for(count);
+    table->Slots = (AuthEntry*)calloc(slots, sizeof(AuthEntry));
+    table->Mask = slots - 1;
+    table->Strings = (char*)malloc(strings_capacity > 0 ? strings_capacity : 1);
+    if (table->Slots == NULL || table->Strings == NULL) {
+        table_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+/* Slot holding login, or the free slot where it would go */
+static AuthEntry* table_probe(const AuthTable* table, const char* login, size_t length, uint64_t hash) {
+    uint32_t i = (uint32_t)hash & table->Mask;
+    for (;;) {
+        AuthEntry* entry = &table->Slots[i];
+        if (entry->Hash == 0 || (entry->Hash == hash && entry->LoginLength == length &&
+                                 memcmp(table->Strings + entry->Login, login, length) == 0)) {
+            return entry;
+        }
+        i = (i + 1) & table->Mask;
+    }
+}
+
+/* Offset of a copy of the string, shared with an equal one already stored */
+static uint32_t intern(TableBuilder* builder, const char* data, size_t length) {
+    AuthTable* table = builder->Table;
+    uint32_t i = (uint32_t)login_hash(data, length) & builder->InternedMask;
+    while (builder->Interned[i] != 0) {
+        uint32_t offset = builder->Interned[i] - 1;
+        if (memcmp(table->Strings + offset, data, length) == 0 && table->Strings[offset + length] == '\0') {
+            return offset;
+        }
+        i = (i + 1) & builder->InternedMask;
+    }
+
+    /* Capacity was sized from the file, unescaping only shrinks strings */
+    uint32_t offset = (uint32_t)builder->StringsLength;
+    memcpy(table->Strings + offset, data, length);
+    table->Strings[offset + length] = '\0';
+    builder->StringsLength += length + 1;
+    builder->Interned[i] = offset + 1;
+    return offset;
+}
+
+/* Add one member of the file, a later duplicate login replaces the earlier */
+static void add_user(void* data, const char* key, size_t key_length, const void* value) {
+    TableBuilder* builder = (TableBuilder*)data;
+    const UserInfo* user = (const UserInfo*)value;
+    builder->Members++;
+    if (builder->Counting || builder->TooLong) {
+        return;
+    }
+    if (key_length >= sizeof(user->Login)) {
+        builder->TooLong = true;
+        return;
+    }
+
+    AuthTable* table = builder->Table;
+    uint64_t hash = login_hash(key, key_length);
+    AuthEntry* entry = table_probe(table, key, key_length, hash);
+    if (entry->Hash == 0) {
+        entry->Hash = hash;
+        entry->Login = intern(builder, key, key_length);
+        entry->LoginLength = (uint16_t)key_length;
+        table->Count++;
+    }
+    size_t passhash_length = strlen(user->Passhash);
+    entry->Passhash = intern(builder, user->Passhash, passhash_length);
+    entry->PasshashLength = (uint16_t)passhash_length;
+    entry->IsAdmin = user->IsAdmin;
+}
+
+/* Read a whole file, returns malloc'd bytes or NULL with errno set */
+static char* read_file(const char* path, size_t* length) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    char* data = NULL;
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    if (size > JSONDB_MAX_FILE_SIZE) {
+        errno = EFBIG;
+    } else if (size >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (char*)malloc((size_t)size + 1);
+        if (data != NULL && fread(data, 1, (size_t)size, file) != (size_t)size) {
+            free(data);
+            data = NULL;
+            errno = EIO;
+        }
+    }
+    fclose(file);
+    *length = (size_t)(size > 0 ? size : 0);
+    return data;
+}
+
+/* Parse the file at path into a new table, NULL with a reason on failure */
+static AuthTable* table_load(const char* path, const char** error) {
+    size_t length = 0;
+    char* text = read_file(path, &length);
+    if (text == NULL) {
+        *error = strerror(errno);
+        return NULL;
+    }
+
+    /* Count first so neither the table nor the strings ever grow */
+    const JsonSchema* schema = json_schema_user_info();
+    UserInfo user;
+    TableBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.Counting = true;
+    enum JsonDecodeResult result = json_decode_map(schema, text, length, &user, add_user, &builder);
+    if (result != JSON_DECODE_OK) {
+        *error = json_decode_result_name(result);
+        free(text);
+        return NULL;
+    }
+
+    int members = builder.Members;
+    uint32_t interned = slots_for(members * 2);
+    builder.Members = 0;
+    builder.Counting = false;
+    builder.StringsCapacity = length + 1;
+    builder.Table = table_create(members, builder.StringsCapacity);
+    builder.Interned = (uint32_t*)calloc(interned, sizeof(uint32_t));
+    builder.InternedMask = interned - 1;
+    if (builder.Table == NULL || builder.Interned == NULL) {
+        *error = strerror(ENOMEM);
+        result = JSON_DECODE_UNKNOWN;
+    } else {
+        result = json_decode_map(schema, text, length, &user, add_user, &builder);
+        if (result != JSON_DECODE_OK) {
+            *error = json_decode_result_name(result);
+        } else if (builder.TooLong) {
+            *error = "login too long";
+            result = JSON_DECODE_TOO_LONG;
+        }
+    }
+    free(builder.Interned);
+    free(text);
+    if (result != JSON_DECODE_OK) {
+        table_free(builder.Table);
+        return NULL;
+    }
+
+    /* Hand back what the strings did not use */
+    char* strings = (char*)realloc(builder.Table->Strings, builder.StringsLength > 0 ? builder.StringsLength : 1);
+    if (strings != NULL) {
+        builder.Table->Strings = strings;
+    }
+    return builder.Table;
+}
+
+/* Enter the current epoch, returns it for read_unlock */
+static unsigned read_lock(json_db_t* db) {
+    for (;;) {
+        unsigned epoch = __atomic_load_n(&db->Epoch, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&db->Readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&db->Epoch, __ATOMIC_SEQ_CST) == epoch) {
+            return epoch;
+        }
+        /* A swap happened in between, count in the new epoch instead */
+        __atomic_sub_fetch(&db->Readers[epoch & 1], 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+/* Leave an epoch */
+static void read_unlock(json_db_t* db, unsigned epoch) {
+    __atomic_sub_fetch(&db->Readers[epoch & 1], 1, __ATOMIC_RELEASE);
+}
+
+/* Publish a table and free the one it replaces once no reader holds it */
+static void table_swap(json_db_t* db, AuthTable* table) {
+    AuthTable* old = __atomic_exchange_n(&db->Current, table, __ATOMIC_SEQ_CST);
+    unsigned epoch = __atomic_load_n(&db->Epoch, __ATOMIC_RELAXED);
+    __atomic_store_n(&db->Epoch, epoch + 1, __ATOMIC_SEQ_CST);
+    while (__atomic_load_n(&db->Readers[epoch & 1], __ATOMIC_SEQ_CST) != 0) {
+        sched_yield();
+    }
+    table_free(old);
+}
+
+/* Users in the current table */
+static int user_count(json_db_t* db) {
+    unsigned epoch = read_lock(db);
+    int count = __atomic_load_n(&db->Current, __ATOMIC_SEQ_CST)->Count;
+    read_unlock(db, epoch);
+    return count;
+}
+
+/* Load the file again, keeping the current table when it does not load */
+static void reload(json_db_t* db) {
+    const char* error = NULL;
+    AuthTable* table = table_load(db->Path, &error);
+    if (table == NULL) {
+        fprintf(stderr, "Auth database: %s not reloaded (%s), keeping %d users\n", db->Path, error,
+                user_count(db));
+        return;
+    }
+    table_swap(db, table);
+    __atomic_add_fetch(&db->Reloads, 1, __ATOMIC_RELAXED);
+    printf("Auth database: reloaded %d users from %s\n", table->Count, db->Path);
+}
+
+#ifdef __linux__
+/* Watcher thread, reloads after each batch of events naming the file */
+static void* json_db_thread(void* arg) {
+    json_db_t* db = (json_db_t*)arg;
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    struct pollfd fds[2];
+    fds[0].fd = db->Inotify;
+    fds[0].events = POLLIN;
+    fds[1].fd = db->WakeFD;
+    fds[1].events = POLLIN;
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        bool changed = false;
+        ssize_t length;
+        while ((length = read(db->Inotify, events, sizeof(events))) > 0) {
+            for (char* p = events; p < events + length;) {
+                const struct inotify_event* event = (const struct inotify_event*)p;
+                if (event->len > 0 && strcmp(event->name, db->Name) == 0) {
+                    changed = true;
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        if (changed) {
+            reload(db);
+        }
+    }
+    return NULL;
+}
+
+/* Watch the directory, which also sees the file being renamed into place */
+static bool start_watching(json_db_t* db) {
+    db->Inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    db->WakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (db->Inotify < 0 || db->WakeFD < 0 ||
+        inotify_add_watch(db->Inotify, db->Directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ||
+        pthread_create(&db->Thread, NULL, json_db_thread, db) != 0) {
+        fprintf(stderr, "Auth database: cannot watch %s (%s), changes need a restart\n", db->Directory,
+                strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+/* Stop the watcher thread */
+static void stop_watching(json_db_t* db) {
+    if (db->Watching) {
+        uint64_t one = 1;
+        ssize_t ignored = write(db->WakeFD, &one, sizeof(one));
+        (void)ignored;
+        pthread_join(db->Thread, NULL);
+    }
+    if (db->Inotify >= 0) {
+        close(db->Inotify);
+    }
+    if (db->WakeFD >= 0) {
+        close(db->WakeFD);
+    }
+}
+#else
+/* No inotify, the file is read once */
+static bool start_watching(json_db_t* db) {
+    (void)db;
+    return false;
+}
+
+/* Nothing to stop */
+static void stop_watching(json_db_t* db) {
+    (void)db;
+}
+#endif
+
 /* Create new JSON database */
 json_db_t* json_db_create(const char* path) {
     json_db_t* db = (json_db_t*)malloc(sizeof(json_db_t));
@@ -25,32 +414,78 @@ json_db_t* json_db_create(const char* path) {
         return NULL;
     }
     memset(db, 0, sizeof(json_db_t));
+    db->Inotify = -1;
+    db->WakeFD = -1;
+
+    db->Path = strdup(path != NULL ? path : JSONDB_AUTH_FILE);
+    const char* slash = db->Path != NULL ? strrchr(db->Path, '/') : NULL;
+    if (db->Path != NULL) {
+        db->Name = slash != NULL ? slash + 1 : db->Path;
+        db->Directory = slash != NULL ? strndup(db->Path, slash == db->Path ? 1 : (size_t)(slash - db->Path))
+                                      : strdup(".");
+    }
+
+    const char* error = NULL;
+    db->Current = db->Path != NULL ? table_load(db->Path, &error) : NULL;
+    if (db->Current == NULL) {
+        if (error != NULL) {
+            fprintf(stderr, "Auth database: cannot load %s (%s), only guests can log in\n", db->Path, error);
+        }
+        db->Current = table_create(0, 0);
+    }
+    if (db->Path == NULL || db->Directory == NULL || db->Current == NULL) {
+        json_db_free(db);
+        return NULL;
+    }
+    printf("Auth database: %d users from %s\n", db->Current->Count, db->Path);
+    db->Watching = start_watching(db);
     return db;
 }
 
 /* Free JSON database */
 void json_db_free(json_db_t* db) {
     if (db != NULL) {
+        stop_watching(db);
+        table_free(db->Current);
+        free(db->Path);
+        free(db->Directory);
         free(db);
     }
 }
 
 /* Get user info from database */
-UserInfo* json_db_get_user(json_db_t* db, const char* username) {
-    /* TODO: Implement actual JSON parsing */
-    /* For now, return NULL indicating user not found */
-    (void)db;
-    (void)username;
-    return NULL;
+bool json_db_get_user(json_db_t* db, const char* username, UserInfo* info) {
+    if (db == NULL || username == NULL) {
+        return false;
+    }
+    size_t length = strlen(username);
+    uint64_t hash = login_hash(username, length);
+
+    unsigned epoch = read_lock(db);
+    const AuthTable* table = __atomic_load_n(&db->Current, __ATOMIC_SEQ_CST);
+    const AuthEntry* entry = table_probe(table, username, length, hash);
+    bool found = entry->Hash != 0;
+    if (found && info != NULL) {
+        memcpy(info->Login, table->Strings + entry->Login, (size_t)entry->LoginLength + 1);
+        memcpy(info->Passhash, table->Strings + entry->Passhash, (size_t)entry->PasshashLength + 1);
+        info->IsAdmin = entry->IsAdmin;
+    }
+    read_unlock(db, epoch);
+    return found;
 }
 
 /* Check if user is admin */
 bool json_db_is_admin(json_db_t* db, const char* username) {
-    UserInfo* info = json_db_get_user(db, username);
-    if (info == NULL) {
-        return false;
+    UserInfo info;
+    return json_db_get_user(db, username, &info) && info.IsAdmin;
+}
+
+/* Users loaded and reloads since start */
+void json_db_get_stats(json_db_t* db, int* users, int64_t* reloads) {
+    if (users != NULL) {
+        *users = db != NULL ? user_count(db) : 0;
+    }
+    if (reloads != NULL) {
+        *reloads = db != NULL ? __atomic_load_n(&db->Reloads, __ATOMIC_RELAXED) : 0;
     }
-    bool result = info->IsAdmin;
-    free(info);
-    return result;
-}
\ No newline at end of file
+}
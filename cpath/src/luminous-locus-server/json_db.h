@@ -6,21 +6,32 @@
 #define JSON_DB_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "model.h"
 
+/* Auth database read when no other path is given */
+#define JSONDB_AUTH_FILE "db/auth.json"
+
 /* JSON database handle */
 typedef struct json_db_t json_db_t;
 
-/* Create database from path */
+/*
+ * Create database from path, reloaded in the background whenever the
+ * file is rewritten or replaced. A file that cannot be loaded at start
+ * leaves the database empty, so only guests log in until it is fixed.
+ */
 json_db_t* json_db_create(const char* path);
 
 /* Free database */
 void json_db_free(json_db_t* db);
 
-/* Get user info */
-UserInfo* json_db_get_user(json_db_t* db, const char* username);
+/* Copy a user's info into info, false if there is no such login. Never allocates or waits on a reload */
+bool json_db_get_user(json_db_t* db, const char* username, UserInfo* info);
 
 /* Check if user is admin */
 bool json_db_is_admin(json_db_t* db, const char* username);
 
-#endif /* JSON_DB_H */
\ No newline at end of file
+/* Users loaded and reloads since start */
+void json_db_get_stats(json_db_t* db, int* users, int64_t* reloads);
+
+#endif /* JSON_DB_H */
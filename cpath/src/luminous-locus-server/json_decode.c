@@ -0,0 +1,821 @@
+/*
+ * Luminous Locus JSON Decode Module
+ * Allocation-free decoding of protocol bodies into model.h structs
+ *
+ * Bodies are flat objects with a handful of known keys, so instead of
+ * building a tree every message kind has a table mapping keys to struct
+ * fields. Values are written straight into the fields as the object is
+ * read; strings are unescaped in place of the copy and rejected if they
+ * do not fit the buffer declared in model.h. Runs of plain string bytes
+ * and the structure of skipped values are found 16 or 32 bytes at a
+ * time with SSE2 or AVX2 when the compiler targets them (-mavx2), with
+ * a scalar loop for the tail and other targets.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <limits.h>
+#if defined(__AVX2__) || defined(__SSE2__)
+    #include <immintrin.h>
+#endif
+#include "model.h"
+#include "json_decode.h"
+
+/* Nesting allowed inside skipped values */
+#define JSON_MAX_DEPTH 32
+
+/* Longest key a schema can match, longer keys are skipped as unknown */
+#define JSON_MAX_KEY 32
+
+/* Larger magnitudes never fit a field, stop accumulating there */
+#define JSON_NUMBER_LIMIT 10000000000LL
+
+/* Field types */
+enum JsonFieldType {
+    JSON_FIELD_INT,
+    JSON_FIELD_HASH32,   /* 32-bit hash, either signedness accepted */
+    JSON_FIELD_BOOL,
+    JSON_FIELD_STRING    /* char array, NUL terminated */
+};
+
+/* Field flags */
+#define JSON_FIELD_REQUIRED 0x1
+
+typedef struct JsonField {
+    const char* Key;
+    size_t KeyLength;
+    enum JsonFieldType Type;
+    unsigned Flags;
+    size_t Offset;
+    size_t Size;
+} JsonField;
+
+struct JsonSchema {
+    const JsonField* Fields;
+    int Count;
+    size_t Size;
+};
+
+typedef struct JsonCursor {
+    const char* P;
+    const char* End;
+} JsonCursor;
+
+#define FIELD(type, member, field_type, key, flags) \
+    { key, sizeof(key) - 1, field_type, flags, offsetof(type, member), sizeof(((type*)0)->member) }
+#define SCHEMA(type, fields) { fields, (int)(sizeof(fields) / sizeof(fields[0])), sizeof(type) }
+#define EMPTY_SCHEMA(type) { NULL, 0, sizeof(type) }
+
+/* Key names follow the Griefly protocol */
+static const JsonField input_fields[] = {
+    FIELD(MessageInput, ID, JSON_FIELD_INT, "id", 0),
+    FIELD(MessageInput, Key, JSON_FIELD_STRING, "key", 0),
+};
+
+static const JsonField chat_fields[] = {
+    FIELD(MessageChat, ID, JSON_FIELD_INT, "id", 0),
+    FIELD(MessageChat, Type, JSON_FIELD_STRING, "type", 0),
+    FIELD(MessageChat, Text, JSON_FIELD_STRING, "text", 0),
+};
+
+static const JsonField login_fields[] = {
+    FIELD(MessageLogin, Login, JSON_FIELD_STRING, "login", 0),
+    FIELD(MessageLogin, Password, JSON_FIELD_STRING, "password", 0),
+    FIELD(MessageLogin, IsGuest, JSON_FIELD_BOOL, "guest", 0),
+    FIELD(MessageLogin, GameVersion, JSON_FIELD_STRING, "game_version", 0),
+    FIELD(MessageLogin, Protocol, JSON_FIELD_INT, "protocol", 0),
+    FIELD(MessageLogin, Compression, JSON_FIELD_INT, "compression", 0),
+};
+
+static const JsonField hash_fields[] = {
+    FIELD(MessageHash, Hash, JSON_FIELD_HASH32, "hash", JSON_FIELD_REQUIRED),
+    FIELD(MessageHash, Tick, JSON_FIELD_INT, "tick", JSON_FIELD_REQUIRED),
+};
+
+static const JsonField request_hash_fields[] = {
+    FIELD(MessageRequestHash, Tick, JSON_FIELD_INT, "tick", 0),
+};
+
+static const JsonField successful_connect_fields[] = {
+    FIELD(MessageSuccessfulConnect, ID, JSON_FIELD_INT, "id", 0),
+    FIELD(MessageSuccessfulConnect, MapURL, JSON_FIELD_STRING, "map", 0),
+};
+
+static const JsonField map_upload_fields[] = {
+    FIELD(MessageMapUpload, Tick, JSON_FIELD_INT, "tick", 0),
+    FIELD(MessageMapUpload, MapURL, JSON_FIELD_STRING, "url_to_upload_map", 0),
+};
+
+static const JsonField new_client_fields[] = {
+    FIELD(MessageNewClient, ID, JSON_FIELD_INT, "id", 0),
+};
+
+static const JsonField current_connections_fields[] = {
+    FIELD(MessageCurrentConnections, Amount, JSON_FIELD_INT, "amount", 0),
+};
+
+static const JsonField ordinary_fields[] = {
+    FIELD(MessageOrdinary, ID, JSON_FIELD_INT, "id", 0),
+    FIELD(MessageOrdinary, Key, JSON_FIELD_STRING, "key", 0),
+};
+
+static const JsonField just_message_fields[] = {
+    FIELD(MessageJustMessage, ID, JSON_FIELD_INT, "id", 0),
+    FIELD(MessageJustMessage, Text, JSON_FIELD_STRING, "text", 0),
+};
+
+static const JsonField mouse_click_fields[] = {
+    FIELD(MessageMouseClick, ID, JSON_FIELD_INT, "id", 0),
+    FIELD(MessageMouseClick, Object, JSON_FIELD_INT, "obj", 0),
+    FIELD(MessageMouseClick, Action, JSON_FIELD_STRING, "action", 0),
+};
+
+static const JsonField ooc_fields[] = {
+    FIELD(MessageOOC, Login, JSON_FIELD_STRING, "login", 0),
+    FIELD(MessageOOC, Text, JSON_FIELD_STRING, "text", 0),
+};
+
+static const JsonField ping_fields[] = {
+    FIELD(MessagePing, ID, JSON_FIELD_INT, "id", 0),
+    FIELD(MessagePing, PingID, JSON_FIELD_STRING, "ping_id", 0),
+};
+
+/* Values of db/auth.json, keyed by login */
+static const JsonField user_info_fields[] = {
+    FIELD(UserInfo, Passhash, JSON_FIELD_STRING, "passhash", JSON_FIELD_REQUIRED),
+    FIELD(UserInfo, IsAdmin, JSON_FIELD_BOOL, "is-admin", 0),
+};
+
+static const JsonSchema input_schema = SCHEMA(MessageInput, input_fields);
+static const JsonSchema chat_schema = SCHEMA(MessageChat, chat_fields);
+static const JsonSchema login_schema = SCHEMA(MessageLogin, login_fields);
+static const JsonSchema hash_schema = SCHEMA(MessageHash, hash_fields);
+static const JsonSchema restart_schema = EMPTY_SCHEMA(MessageRestart);
+static const JsonSchema next_tick_schema = EMPTY_SCHEMA(MessageNextTick);
+static const JsonSchema request_hash_schema = SCHEMA(MessageRequestHash, request_hash_fields);
+static const JsonSchema successful_connect_schema = SCHEMA(MessageSuccessfulConnect, successful_connect_fields);
+static const JsonSchema map_upload_schema = SCHEMA(MessageMapUpload, map_upload_fields);
+static const JsonSchema new_tick_schema = EMPTY_SCHEMA(MessageNewTick);
+static const JsonSchema new_client_schema = SCHEMA(MessageNewClient, new_client_fields);
+static const JsonSchema current_connections_schema = SCHEMA(MessageCurrentConnections, current_connections_fields);
+static const JsonSchema ordinary_schema = SCHEMA(MessageOrdinary, ordinary_fields);
+static const JsonSchema just_message_schema = SCHEMA(MessageJustMessage, just_message_fields);
+static const JsonSchema mouse_click_schema = SCHEMA(MessageMouseClick, mouse_click_fields);
+static const JsonSchema ooc_schema = SCHEMA(MessageOOC, ooc_fields);
+static const JsonSchema ping_schema = SCHEMA(MessagePing, ping_fields);
+static const JsonSchema user_info_schema = SCHEMA(UserInfo, user_info_fields);
+
+/* First '"', '\\' or control character at or after p, end if none */
+static const char* scan_string(const char* p, const char* end) {
+#if defined(__AVX2__)
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    const __m256i backslash32 = _mm256_set1_epi8('\\');
+    const __m256i control32 = _mm256_set1_epi8(0x1f);
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote32), _mm256_cmpeq_epi8(v, backslash32));
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(_mm256_min_epu8(v, control32), v));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i quote16 = _mm_set1_epi8('"');
+    const __m128i backslash16 = _mm_set1_epi8('\\');
+    const __m128i control16 = _mm_set1_epi8(0x1f);
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote16), _mm_cmpeq_epi8(v, backslash16));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(_mm_min_epu8(v, control16), v));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && (unsigned char)*p >= 0x20) {
+        p++;
+    }
+    return p;
+}
+
+/* First '"', '{', '}', '[' or ']' at or after p, end if none */
+static const char* scan_structural(const char* p, const char* end) {
+    /* Setting bit 5 folds '[' onto '{' and ']' onto '}' */
+#if defined(__AVX2__)
+    const __m256i quote32 = _mm256_set1_epi8('"');
+    const __m256i fold32 = _mm256_set1_epi8(0x20);
+    const __m256i open32 = _mm256_set1_epi8('{');
+    const __m256i close32 = _mm256_set1_epi8('}');
+    while (end - p >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        __m256i folded = _mm256_or_si256(v, fold32);
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(folded, open32), _mm256_cmpeq_epi8(folded, close32));
+        hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, quote32));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(hit);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i quote16 = _mm_set1_epi8('"');
+    const __m128i fold16 = _mm_set1_epi8(0x20);
+    const __m128i open16 = _mm_set1_epi8('{');
+    const __m128i close16 = _mm_set1_epi8('}');
+    while (end - p >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)p);
+        __m128i folded = _mm_or_si128(v, fold16);
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(folded, open16), _mm_cmpeq_epi8(folded, close16));
+        hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, quote16));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+        p += 16;
+    }
+#endif
+    while (p < end) {
+        char folded = (char)(*p | 0x20);
+        if (*p == '"' || folded == '{' || folded == '}') {
+            break;
+        }
+        p++;
+    }
+    return p;
+}
+
+/* Skip JSON whitespace */
+static void skip_space(JsonCursor* c) {
+    while (c->P < c->End && (*c->P == ' ' || *c->P == '\n' || *c->P == '\r' || *c->P == '\t')) {
+        c->P++;
+    }
+}
+
+/* Parse four hex digits */
+static bool read_hex4(const char* p, const char* end, unsigned* value) {
+    if (end - p < 4) {
+        return false;
+    }
+    unsigned result = 0;
+    for (int i = 0; i < 4; i++) {
+        char ch = p[i];
+        result <<= 4;
+        if (ch >= '0' && ch <= '9') {
+            result |= (unsigned)(ch - '0');
+        } else if ((ch | 0x20) >= 'a' && (ch | 0x20) <= 'f') {
+            result |= (unsigned)((ch | 0x20) - 'a' + 10);
+        } else {
+            return false;
+        }
+    }
+    *value = result;
+    return true;
+}
+
+/* Encode a code point as UTF-8 */
+static size_t utf8_encode(unsigned cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xc0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xe0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (cp & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (cp & 0x3f));
+    return 4;
+}
+
+/* Append to a bounded output, remembering overflow instead of stopping */
+static void append(char* out, size_t capacity, size_t* length, bool* overflow, const char* data, size_t count) {
+    if (out != NULL && !*overflow) {
+        if (*length + count < capacity) {
+            memcpy(out + *length, data, count);
+        } else {
+            *overflow = true;
+        }
+    }
+    *length += count;
+}
+
+/*
+ * Read the string at the cursor into out (capacity includes the NUL),
+ * or just skip it when out is NULL. An overlong string is still read to
+ * its end, so the caller may skip it and carry on.
+ */
+static enum JsonDecodeResult read_string(JsonCursor* c, char* out, size_t capacity, size_t* length) {
+    const char* p = c->P + 1;
+    size_t n = 0;
+    bool overflow = false;
+
+    for (;;) {
+        const char* q = scan_string(p, c->End);
+        append(out, capacity, &n, &overflow, p, (size_t)(q - p));
+        if (q == c->End) {
+            return JSON_DECODE_SYNTAX;
+        }
+        if (*q == '"') {
+            c->P = q + 1;
+            if (out != NULL && !overflow) {
+                out[n] = '\0';
+            }
+            *length = n;
+            return overflow ? JSON_DECODE_TOO_LONG : JSON_DECODE_OK;
+        }
+        if (*q != '\\' || q + 1 == c->End) {
+            /* Raw control character or truncated escape */
+            return JSON_DECODE_SYNTAX;
+        }
+
+        char decoded[4];
+        size_t decoded_length = 1;
+        p = q + 2;
+        switch (q[1]) {
+            case '"':
+            case '\\':
+            case '/':
+                decoded[0] = q[1];
+                break;
+            case 'b':
+                decoded[0] = '\b';
+                break;
+            case 'f':
+                decoded[0] = '\f';
+                break;
+            case 'n':
+                decoded[0] = '\n';
+                break;
+            case 'r':
+                decoded[0] = '\r';
+                break;
+            case 't':
+                decoded[0] = '\t';
+                break;
+            case 'u': {
+                unsigned cp = 0;
+                if (!read_hex4(p, c->End, &cp)) {
+                    return JSON_DECODE_SYNTAX;
+                }
+                p += 4;
+                if (cp >= 0xd800 && cp <= 0xdbff) {
+                    /* High surrogate, the low half must follow */
+                    unsigned low = 0;
+                    if (c->End - p < 6 || p[0] != '\\' || p[1] != 'u' || !read_hex4(p + 2, c->End, &low) ||
+                        low < 0xdc00 || low > 0xdfff) {
+                        return JSON_DECODE_SYNTAX;
+                    }
+                    p += 6;
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                } else if (cp >= 0xdc00 && cp <= 0xdfff) {
+                    return JSON_DECODE_SYNTAX;
+                }
+                decoded_length = utf8_encode(cp, decoded);
+                break;
+            }
+            default:
+                return JSON_DECODE_SYNTAX;
+        }
+        append(out, capacity, &n, &overflow, decoded, decoded_length);
+    }
+}
+
+/* Read a number, integral is false for fractions, exponents and huge values */
+static enum JsonDecodeResult read_number(JsonCursor* c, long long* value, bool* integral) {
+    const char* p = c->P;
+    bool negative = false;
+    long long result = 0;
+    bool fits = true;
+
+    if (p < c->End && *p == '-') {
+        negative = true;
+        p++;
+    }
+    if (p == c->End || *p < '0' || *p > '9') {
+        return JSON_DECODE_SYNTAX;
+    }
+    if (*p == '0') {
+        p++;
+    } else {
+        while (p < c->End && *p >= '0' && *p <= '9') {
+            if (result < JSON_NUMBER_LIMIT) {
+                result = result * 10 + (*p - '0');
+            } else {
+                fits = false;
+            }
+            p++;
+        }
+    }
+
+    bool whole = true;
+    if (p < c->End && *p == '.') {
+        p++;
+        if (p == c->End || *p < '0' || *p > '9') {
+            return JSON_DECODE_SYNTAX;
+        }
+        while (p < c->End && *p >= '0' && *p <= '9') {
+            p++;
+        }
+        whole = false;
+    }
+    if (p < c->End && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < c->End && (*p == '+' || *p == '-')) {
+            p++;
+        }
+        if (p == c->End || *p < '0' || *p > '9') {
+            return JSON_DECODE_SYNTAX;
+        }
+        while (p < c->End && *p >= '0' && *p <= '9') {
+            p++;
+        }
+        whole = false;
+    }
+
+    c->P = p;
+    *value = negative ? -result : result;
+    *integral = whole && fits;
+    return JSON_DECODE_OK;
+}
+
+/* Match a literal, true/false/null */
+static bool read_literal(JsonCursor* c, const char* literal, size_t length) {
+    if ((size_t)(c->End - c->P) < length || memcmp(c->P, literal, length) != 0) {
+        return false;
+    }
+    c->P += length;
+    return true;
+}
+
+/* Skip an object or array, strings inside are read so their brackets do not count */
+static enum JsonDecodeResult skip_container(JsonCursor* c) {
+    const char* p = c->P;
+    int depth = 0;
+    for (;;) {
+        p = scan_structural(p, c->End);
+        if (p == c->End) {
+            return JSON_DECODE_SYNTAX;
+        }
+        if (*p == '"') {
+            size_t length = 0;
+            c->P = p;
+            enum JsonDecodeResult result = read_string(c, NULL, 0, &length);
+            if (result != JSON_DECODE_OK) {
+                return result;
+            }
+            p = c->P;
+            continue;
+        }
+        if ((*p | 0x20) == '{') {
+            if (++depth > JSON_MAX_DEPTH) {
+                return JSON_DECODE_SYNTAX;
+            }
+        } else if (--depth == 0) {
+            c->P = p + 1;
+            return JSON_DECODE_OK;
+        }
+        p++;
+    }
+}
+
+/* Skip a value of an unknown key */
+static enum JsonDecodeResult skip_value(JsonCursor* c) {
+    long long number = 0;
+    bool integral = false;
+    size_t length = 0;
+
+    switch (*c->P) {
+        case '"':
+            return read_string(c, NULL, 0, &length);
+        case '{':
+        case '[':
+            return skip_container(c);
+        case 't':
+            return read_literal(c, "true", 4) ? JSON_DECODE_OK : JSON_DECODE_SYNTAX;
+        case 'f':
+            return read_literal(c, "false", 5) ? JSON_DECODE_OK : JSON_DECODE_SYNTAX;
+        case 'n':
+            return read_literal(c, "null", 4) ? JSON_DECODE_OK : JSON_DECODE_SYNTAX;
+        default:
+            return read_number(c, &number, &integral);
+    }
+}
+
+/* Read a value into its field */
+static enum JsonDecodeResult read_field(JsonCursor* c, const JsonField* field, char* base) {
+    char* target = base + field->Offset;
+    long long number = 0;
+    bool integral = false;
+    size_t length = 0;
+
+    if (*c->P == 'n') {
+        /* null leaves the field empty */
+        memset(target, 0, field->Size);
+        return read_literal(c, "null", 4) ? JSON_DECODE_OK : JSON_DECODE_SYNTAX;
+    }
+
+    switch (field->Type) {
+        case JSON_FIELD_STRING:
+            if (*c->P != '"') {
+                return JSON_DECODE_TYPE;
+            }
+            return read_string(c, target, field->Size, &length);
+        case JSON_FIELD_BOOL:
+            if (read_literal(c, "true", 4)) {
+                *(bool*)target = true;
+            } else if (read_literal(c, "false", 5)) {
+                *(bool*)target = false;
+            } else {
+                return JSON_DECODE_TYPE;
+            }
+            return JSON_DECODE_OK;
+        case JSON_FIELD_INT:
+        case JSON_FIELD_HASH32: {
+            if (*c->P != '-' && (*c->P < '0' || *c->P > '9')) {
+                return JSON_DECODE_TYPE;
+            }
+            enum JsonDecodeResult result = read_number(c, &number, &integral);
+            if (result != JSON_DECODE_OK) {
+                return result;
+            }
+            long long max = field->Type == JSON_FIELD_HASH32 ? (long long)UINT32_MAX : INT_MAX;
+            if (!integral || number < INT_MIN || number > max) {
+                return JSON_DECODE_TYPE;
+            }
+            *(int*)target = (int)(int32_t)(uint32_t)number;
+            return JSON_DECODE_OK;
+        }
+        default:
+            return JSON_DECODE_TYPE;
+    }
+}
+
+/* Field with this key, index through index_out */
+static const JsonField* find_field(const JsonSchema* schema, const char* key, size_t length, int* index_out) {
+    for (int i = 0; i < schema->Count; i++) {
+        const JsonField* field = &schema->Fields[i];
+        if (field->KeyLength == length && memcmp(field->Key, key, length) == 0) {
+            *index_out = i;
+            return field;
+        }
+    }
+    return NULL;
+}
+
+/* Get schema for kind */
+const JsonSchema* json_schema_for_kind(int kind) {
+    switch (kind) {
+        case MSGID_INPUT:
+        case MSGID_GUI:
+            return &input_schema;
+        case MSGID_LOGIN:
+            return &login_schema;
+        case MSGID_HASH:
+            return &hash_schema;
+        case MSGID_RESTART:
+            return &restart_schema;
+        case MSGID_NEXTTICK:
+            return &next_tick_schema;
+        case MSGID_REQUESTHASH:
+            return &request_hash_schema;
+        case MSGID_SUCCESSFULCONNECT:
+            return &successful_connect_schema;
+        case MSGID_MAPUPLOAD:
+            return &map_upload_schema;
+        case MSGID_NEWTICK:
+            return &new_tick_schema;
+        case MSGID_NEWCLIENT:
+            return &new_client_schema;
+        case MSGID_CURRENTCONNECTIONS:
+            return &current_connections_schema;
+        case MSGID_ORDINARY:
+            return &ordinary_schema;
+        case MSGID_JUSTMESSAGE:
+            return &just_message_schema;
+        case MSGID_MOUSECLICK:
+            return &mouse_click_schema;
+        case MSGID_OOCMESSAGE:
+            return &ooc_schema;
+        case MSGID_PING:
+            return &ping_schema;
+        default:
+            return NULL;
+    }
+}
+
+/* Get chat schema */
+const JsonSchema* json_schema_chat(void) {
+    return &chat_schema;
+}
+
+/* Get auth database schema */
+const JsonSchema* json_schema_user_info(void) {
+    return &user_info_schema;
+}
+
+/* Get struct size */
+size_t json_schema_size(const JsonSchema* schema) {
+    return schema != NULL ? schema->Size : 0;
+}
+
+/* Decode body */
+enum JsonDecodeResult json_decode(const JsonSchema* schema, const char* body, size_t length, void* out) {
+    if (schema == NULL || out == NULL) {
+        return JSON_DECODE_UNKNOWN;
+    }
+    memset(out, 0, schema->Size);
+
+    JsonCursor c;
+    c.P = body;
+    c.End = body != NULL ? body + length : NULL;
+    unsigned seen = 0;
+
+    skip_space(&c);
+    if (c.P != c.End) {
+        /* Zero-length bodies stand for {} */
+        if (*c.P != '{') {
+            return JSON_DECODE_SYNTAX;
+        }
+        c.P++;
+        skip_space(&c);
+        if (c.P < c.End && *c.P == '}') {
+            c.P++;
+        } else {
+            for (;;) {
+                skip_space(&c);
+                if (c.P == c.End || *c.P != '"') {
+                    return JSON_DECODE_SYNTAX;
+                }
+                char key[JSON_MAX_KEY + 1];
+                size_t key_length = 0;
+                const JsonField* field = NULL;
+                int index = 0;
+                enum JsonDecodeResult result = read_string(&c, key, sizeof(key), &key_length);
+                if (result == JSON_DECODE_OK) {
+                    field = find_field(schema, key, key_length, &index);
+                } else if (result != JSON_DECODE_TOO_LONG) {
+                    return result;
+                }
+
+                skip_space(&c);
+                if (c.P == c.End || *c.P != ':') {
+                    return JSON_DECODE_SYNTAX;
+                }
+                c.P++;
+                skip_space(&c);
+                if (c.P == c.End) {
+                    return JSON_DECODE_SYNTAX;
+                }
+
+                if (field != NULL) {
+                    result = read_field(&c, field, (char*)out);
+                    seen |= 1u << index;
+                } else {
+                    result = skip_value(&c);
+                }
+                if (result != JSON_DECODE_OK) {
+                    return result;
+                }
+
+                skip_space(&c);
+                if (c.P == c.End) {
+                    return JSON_DECODE_SYNTAX;
+                }
+                if (*c.P == '}') {
+                    c.P++;
+                    break;
+                }
+                if (*c.P != ',') {
+                    return JSON_DECODE_SYNTAX;
+                }
+                c.P++;
+            }
+        }
+        skip_space(&c);
+        if (c.P != c.End) {
+            return JSON_DECODE_SYNTAX;
+        }
+    }
+
+    for (int i = 0; i < schema->Count; i++) {
+        if ((schema->Fields[i].Flags & JSON_FIELD_REQUIRED) && !(seen & (1u << i))) {
+            return JSON_DECODE_MISSING;
+        }
+    }
+    return JSON_DECODE_OK;
+}
+
+/* Decode body by kind */
+enum JsonDecodeResult json_decode_message(int kind, const char* body, size_t length, void* out) {
+    return json_decode(json_schema_for_kind(kind), body, length, out);
+}
+
+/* Decode an object of objects */
+enum JsonDecodeResult json_decode_map(const JsonSchema* schema, const char* body, size_t length, void* value,
+                                      JsonMapVisitor visit, void* data) {
+    if (schema == NULL || value == NULL || visit == NULL) {
+        return JSON_DECODE_UNKNOWN;
+    }
+
+    JsonCursor c;
+    c.P = body;
+    c.End = body != NULL ? body + length : NULL;
+
+    skip_space(&c);
+    if (c.P == c.End || *c.P != '{') {
+        return JSON_DECODE_SYNTAX;
+    }
+    c.P++;
+    skip_space(&c);
+    if (c.P < c.End && *c.P == '}') {
+        c.P++;
+    } else {
+        for (;;) {
+            skip_space(&c);
+            if (c.P == c.End || *c.P != '"') {
+                return JSON_DECODE_SYNTAX;
+            }
+            char key[JSON_MAP_MAX_KEY + 1];
+            size_t key_length = 0;
+            enum JsonDecodeResult result = read_string(&c, key, sizeof(key), &key_length);
+            if (result != JSON_DECODE_OK) {
+                return result;
+            }
+
+            skip_space(&c);
+            if (c.P == c.End || *c.P != ':') {
+                return JSON_DECODE_SYNTAX;
+            }
+            c.P++;
+            skip_space(&c);
+            if (c.P == c.End || *c.P != '{') {
+                return c.P == c.End ? JSON_DECODE_SYNTAX : JSON_DECODE_TYPE;
+            }
+
+            /* Find the member's extent, then decode it like a body */
+            const char* start = c.P;
+            result = skip_container(&c);
+            if (result == JSON_DECODE_OK) {
+                result = json_decode(schema, start, (size_t)(c.P - start), value);
+            }
+            if (result != JSON_DECODE_OK) {
+                return result;
+            }
+            visit(data, key, key_length, value);
+
+            skip_space(&c);
+            if (c.P == c.End) {
+                return JSON_DECODE_SYNTAX;
+            }
+            if (*c.P == '}') {
+                c.P++;
+                break;
+            }
+            if (*c.P != ',') {
+                return JSON_DECODE_SYNTAX;
+            }
+            c.P++;
+        }
+    }
+    skip_space(&c);
+    return c.P == c.End ? JSON_DECODE_OK : JSON_DECODE_SYNTAX;
+}
+
+/* Get result name */
+const char* json_decode_result_name(enum JsonDecodeResult result) {
+    switch (result) {
+        case JSON_DECODE_OK:
+            return "ok";
+        case JSON_DECODE_SYNTAX:
+            return "syntax error";
+        case JSON_DECODE_TOO_LONG:
+            return "string too long";
+        case JSON_DECODE_TYPE:
+            return "wrong type";
+        case JSON_DECODE_MISSING:
+            return "missing key";
+        case JSON_DECODE_UNKNOWN:
+            return "unknown message";
+        default:
+            return "unknown";
+    }
+}
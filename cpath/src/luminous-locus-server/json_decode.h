@@ -0,0 +1,63 @@
+/*
+ * Luminous Locus JSON Decode Header
+ */
+
+#ifndef JSON_DECODE_H
+#define JSON_DECODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Decode result */
+enum JsonDecodeResult {
+    JSON_DECODE_OK,
+    JSON_DECODE_SYNTAX,     /* not a well-formed JSON object */
+    JSON_DECODE_TOO_LONG,   /* string does not fit its model.h buffer */
+    JSON_DECODE_TYPE,       /* value of the wrong type or out of range */
+    JSON_DECODE_MISSING,    /* required key absent */
+    JSON_DECODE_UNKNOWN     /* no schema for the message kind */
+};
+
+/* Key to struct field mapping of one message struct */
+typedef struct JsonSchema JsonSchema;
+
+/* Schema of the struct behind a message kind, NULL if there is none */
+const JsonSchema* json_schema_for_kind(int kind);
+
+/* Schema of MessageChat, which has no kind of its own */
+const JsonSchema* json_schema_chat(void);
+
+/* Schema of a UserInfo in db/auth.json, the login being its key */
+const JsonSchema* json_schema_user_info(void);
+
+/* Size of the struct a schema fills */
+size_t json_schema_size(const JsonSchema* schema);
+
+/*
+ * Decode a JSON object body into out, which is zeroed first. Unknown
+ * keys are skipped, strings are unescaped straight into their fields.
+ * Nothing is allocated.
+ */
+enum JsonDecodeResult json_decode(const JsonSchema* schema, const char* body, size_t length, void* out);
+
+/* Same, schema looked up by message kind */
+enum JsonDecodeResult json_decode_message(int kind, const char* body, size_t length, void* out);
+
+/* Longest key json_decode_map reads, longer keys give JSON_DECODE_TOO_LONG */
+#define JSON_MAP_MAX_KEY 255
+
+/* Called with each unescaped key of a map and its decoded value */
+typedef void (*JsonMapVisitor)(void* data, const char* key, size_t key_length, const void* value);
+
+/*
+ * Decode an object whose members are all objects of one schema, such as
+ * db/auth.json, into value one member at a time and pass each to visit.
+ * Stops at the first member that does not decode and returns why.
+ */
+enum JsonDecodeResult json_decode_map(const JsonSchema* schema, const char* body, size_t length, void* value,
+                                      JsonMapVisitor visit, void* data);
+
+/* Result name for logs */
+const char* json_decode_result_name(enum JsonDecodeResult result);
+
+#endif /* JSON_DECODE_H */
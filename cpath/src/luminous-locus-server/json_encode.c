@@ -0,0 +1,210 @@
+/*
+ * Luminous Locus JSON Encode Module
+ * Fixed-shape server frames written in one pass
+ *
+ * Server-originated messages have fixed keys, so their bodies are a few
+ * constant fragments around one or two values. Each encoder copies the
+ * fragments, converts integers two digits at a time from a table and
+ * writes the frame header last, once the body length is known. Frames
+ * go straight into the caller's buffer; nothing is formatted twice.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "model.h"
+#include "frame.h"
+#include "json_encode.h"
+
+/* Copy a string literal fragment and advance */
+#define PUT(p, fragment) (memcpy((p), (fragment), sizeof(fragment) - 1), (p) += sizeof(fragment) - 1)
+
+/* "00" through "99" */
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+static const char hex_digits[] = "0123456789abcdef";
+
+/* Write integer */
+size_t json_encode_int(char* out, int64_t value) {
+    char buffer[JSON_ENCODE_INT_MAX];
+    char* p = buffer + sizeof(buffer);
+    uint64_t v = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+
+    while (v >= 100) {
+        unsigned pair = (unsigned)(v % 100);
+        v /= 100;
+        p -= 2;
+        memcpy(p, digit_pairs + pair * 2, 2);
+    }
+    if (v >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + v * 2, 2);
+    } else {
+        *--p = (char)('0' + v);
+    }
+    if (value < 0) {
+        *--p = '-';
+    }
+
+    size_t length = (size_t)(buffer + sizeof(buffer) - p);
+    memcpy(out, p, length);
+    return length;
+}
+
+/* Write escaped string */
+char* json_encode_string(char* p, const char* end, const char* text) {
+    if (text == NULL) {
+        return p;
+    }
+    for (; *text != '\0'; text++) {
+        unsigned char ch = (unsigned char)*text;
+        if (ch >= 0x20 && ch != '"' && ch != '\\') {
+            if (p == end) {
+                return NULL;
+            }
+            *p++ = (char)ch;
+            continue;
+        }
+        bool short_escape = ch == '"' || ch == '\\' || ch == '\n' || ch == '\r' || ch == '\t';
+        if (end - p < (short_escape ? 2 : 6)) {
+            return NULL;
+        }
+        *p++ = '\\';
+        switch (ch) {
+            case '"':
+            case '\\':
+                *p++ = (char)ch;
+                break;
+            case '\n':
+                *p++ = 'n';
+                break;
+            case '\r':
+                *p++ = 'r';
+                break;
+            case '\t':
+                *p++ = 't';
+                break;
+            default:
+                PUT(p, "u00");
+                *p++ = hex_digits[ch >> 4];
+                *p++ = hex_digits[ch & 0xf];
+                break;
+        }
+    }
+    return p;
+}
+
+/* Patch the header in front of a finished body */
+static size_t finish_frame(char* out, uint32_t kind, const char* end) {
+    size_t length = (size_t)(end - out) - FRAME_HEADER_SIZE;
+    frame_write_header(out, kind, (uint32_t)length);
+    return FRAME_HEADER_SIZE + length;
+}
+
+/* Frame of the form {"key":value} */
+static size_t encode_int_frame(char* out, size_t capacity, uint32_t kind, const char* open, size_t open_length,
+                               int64_t value) {
+    if (out == NULL || capacity < FRAME_HEADER_SIZE + open_length + JSON_ENCODE_INT_MAX + 1) {
+        return 0;
+    }
+    char* p = out + FRAME_HEADER_SIZE;
+    memcpy(p, open, open_length);
+    p += open_length;
+    p += json_encode_int(p, value);
+    *p++ = '}';
+    return finish_frame(out, kind, p);
+}
+
+/* Frame of the form {"key":"text"} */
+static size_t encode_string_frame(char* out, size_t capacity, uint32_t kind, const char* open, size_t open_length,
+                                  const char* text) {
+    if (out == NULL || capacity < FRAME_HEADER_SIZE + open_length + 2) {
+        return 0;
+    }
+    char* p = out + FRAME_HEADER_SIZE;
+    memcpy(p, open, open_length);
+    p = json_encode_string(p + open_length, out + capacity - 2, text);
+    if (p == NULL) {
+        return 0;
+    }
+    PUT(p, "\"}");
+    return finish_frame(out, kind, p);
+}
+
+/* Encode successful connect */
+size_t json_encode_successful_connect(char* out, size_t capacity, int id, const char* map) {
+    static const char open[] = "{\"id\":";
+    static const char map_key[] = ",\"map\":\"";
+    if (out == NULL || capacity < FRAME_HEADER_SIZE + sizeof(open) + sizeof(map_key) + JSON_ENCODE_INT_MAX) {
+        return 0;
+    }
+    char* p = out + FRAME_HEADER_SIZE;
+    PUT(p, open);
+    p += json_encode_int(p, id);
+    PUT(p, map_key);
+    p = json_encode_string(p, out + capacity - 2, map);
+    if (p == NULL) {
+        return 0;
+    }
+    PUT(p, "\"}");
+    return finish_frame(out, MSGID_SUCCESSFULCONNECT, p);
+}
+
+/* Encode new client */
+size_t json_encode_new_client(char* out, size_t capacity, int id) {
+    static const char open[] = "{\"id\":";
+    return encode_int_frame(out, capacity, MSGID_NEWCLIENT, open, sizeof(open) - 1, id);
+}
+
+/* Encode current connections */
+size_t json_encode_current_connections(char* out, size_t capacity, int amount) {
+    static const char open[] = "{\"amount\":";
+    return encode_int_frame(out, capacity, MSGID_CURRENTCONNECTIONS, open, sizeof(open) - 1, amount);
+}
+
+/* Encode request hash */
+size_t json_encode_request_hash(char* out, size_t capacity, int64_t tick) {
+    static const char open[] = "{\"tick\":";
+    return encode_int_frame(out, capacity, MSGID_REQUESTHASH, open, sizeof(open) - 1, tick);
+}
+
+/* Encode error */
+size_t json_encode_error(char* out, size_t capacity, int kind, const char* text) {
+    static const char version_open[] = "{\"correct_game_version\":\"";
+    static const char message_open[] = "{\"message\":\"";
+
+    switch (kind) {
+        case MSGID_WRONGGAMEVERSION:
+            return encode_string_frame(out, capacity, (uint32_t)kind, version_open, sizeof(version_open) - 1, text);
+        case MSGID_INTERNALSERVERERROR:
+            return encode_string_frame(out, capacity, (uint32_t)kind, message_open, sizeof(message_open) - 1, text);
+        case MSGID_WRONGAUTH:
+        case MSGID_UNDEFINEDERROR:
+        case MSGID_SERVEREXIT:
+        case MSGID_NOMASTER:
+        case MSGID_OUTOFSYNC:
+        case MSGID_TOOSLOW:
+        case MSGID_SERVERRESTARTING: {
+            if (out == NULL || capacity < FRAME_HEADER_SIZE + 2) {
+                return 0;
+            }
+            char* p = out + FRAME_HEADER_SIZE;
+            PUT(p, "{}");
+            return finish_frame(out, (uint32_t)kind, p);
+        }
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,49 @@
+/*
+ * Luminous Locus JSON Encode Header
+ */
+
+#ifndef JSON_ENCODE_H
+#define JSON_ENCODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Room for any frame whose body holds only integers */
+#define JSON_ENCODE_INT_FRAME_MAX 64
+
+/* Longest decimal int64, sign included */
+#define JSON_ENCODE_INT_MAX 20
+
+/* Write value in decimal, no terminating NUL, returns characters written */
+size_t json_encode_int(char* out, int64_t value);
+
+/* Write text escaped, without quotes, returns the end or NULL if it does not fit before end */
+char* json_encode_string(char* out, const char* end, const char* text);
+
+/*
+ * The encoders below write a whole protocol v2 frame, header then body,
+ * to out and return its size, or 0 when capacity is too small. Strings
+ * are escaped; a NULL string encodes as "".
+ */
+
+/* MSGID_SUCCESSFULCONNECT {"id":id,"map":map} */
+size_t json_encode_successful_connect(char* out, size_t capacity, int id, const char* map);
+
+/* MSGID_NEWCLIENT {"id":id} */
+size_t json_encode_new_client(char* out, size_t capacity, int id);
+
+/* MSGID_CURRENTCONNECTIONS {"amount":amount} */
+size_t json_encode_current_connections(char* out, size_t capacity, int amount);
+
+/* MSGID_REQUESTHASH {"tick":tick} */
+size_t json_encode_request_hash(char* out, size_t capacity, int64_t tick);
+
+/*
+ * Error kinds 401-409. text fills the correct game version of
+ * MSGID_WRONGGAMEVERSION and the message of MSGID_INTERNALSERVERERROR,
+ * the other errors have empty bodies and ignore it.
+ */
+size_t json_encode_error(char* out, size_t capacity, int kind, const char* text);
+
+#endif /* JSON_ENCODE_H */
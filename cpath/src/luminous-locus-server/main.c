@@ -11,6 +11,7 @@
 #include <stdbool.h>
 #include <time.h>
 #include <signal.h>
+#include <errno.h>
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -20,7 +21,6 @@
 #else
     #include <unistd.h>
     #include <sys/socket.h>
-    #include <sys/select.h>
     #include <netinet/in.h>
     #include <arpa/inet.h>
 #endif
@@ -32,29 +32,93 @@
 #include "client_conn.h"
 #include "json_db.h"
 #include "assetserver.h"
+#include "asset_pack.h"
+#include "handoff.h"
+#include "reactor.h"
+#include "write_queue.h"
+#include "shared_frame.h"
+#include "tick_clock.h"
+#include "tick_batch.h"
+#include "slow_consumer.h"
+#include "hash_ring.h"
+#include "message_pool.h"
+#include "json_encode.h"
+#include "compact_codec.h"
+#include "stream_codec.h"
 
 /* Server configuration */
 #define DEFAULT_PORT 8766
 #define DEFAULT_ASSET_PORT 8767
-#define SELECT_TIMEOUT_SEC 1
+#define DEFAULT_TICK_INTERVAL 100
+#define DEFAULT_HASH_INTERVAL 10    /* ticks between hash requests */
+#define HASH_TIMEOUT_TICKS 50       /* ticks a hash request stays open */
+#define GAME_BATCH_SIZE 1024
+#define MAX_REACTORS 64
 
 /* Global state */
 static volatile sig_atomic_t g_running = 1;
 static bool g_restart_requested = false;
 
 /* Server state structure */
+typedef struct ServerState ServerState;
 struct ServerState {
     int Port;
-    int Socket;
-    ClientRegistry* Clients;
+    Reactor** Reactors;
+    int ReactorCount;
+    HandoffQueue* Inbound;
+    int* ActiveClients;
+    int ActiveCount;
+    int ActiveCapacity;
+    int AnnouncedCount;         /* ActiveCount as last sent in MSGID_CURRENTCONNECTIONS */
     StatsCollector* Telemetry;
     AssetServer* AssetServer;
     json_db_t* DB;
+    AuthPool* Auth;             /* checks logins off the reactor threads */
     bool MasterIsHere;
+    TickClock* Clock;
+    TickBatch* Inputs;          /* inputs relayed with the next NEWTICK */
+    SharedFrame* NewTickFrame;  /* encoded once, reused by ticks without input */
+    SharedFrame* CompactNewTickFrame;
+    HashRing* Hashes;           /* reported hashes of requested ticks */
+    SharedFrame* OutOfSyncFrame;
+    int HashInterval;
 };
 
+static void on_hash_mismatch(void* data, int client_id, int64_t tick);
+
+/* Free server state */
+static void server_state_free(ServerState* state) {
+    if (state != NULL) {
+        /* Queued envelopes live in reactor arenas, free them first */
+        for (int i = 0; i < state->ReactorCount; i++) {
+            reactor_stop(state->Reactors[i]);
+        }
+        /* Workers hand finished logins to reactors, stop them before the reactors go */
+        auth_pool_free(state->Auth);
+        handoff_queue_free(state->Inbound);
+        for (int i = 0; i < state->ReactorCount; i++) {
+            reactor_free(state->Reactors[i]);
+        }
+        free(state->Reactors);
+        free(state->ActiveClients);
+        tick_clock_free(state->Clock);
+        tick_batch_free(state->Inputs);
+        shared_frame_release(state->NewTickFrame);
+        shared_frame_release(state->CompactNewTickFrame);
+        hash_ring_free(state->Hashes);
+        shared_frame_release(state->OutOfSyncFrame);
+        stats_collector_free(state->Telemetry);
+        json_db_free(state->DB);
+        asset_server_free(state->AssetServer);
+        free(state);
+    }
+}
+
 /* Create new server state */
-static ServerState* server_state_create(int port) {
+static ServerState* server_state_create(int port, int asset_port, const char* asset_root, const char* asset_pack,
+                                        const char* auth_db, int auth_threads, int reactor_count, bool use_uring,
+                                        size_t high_water, size_t compress_threshold, int tick_interval,
+                                        int hash_interval, const SlowPolicy* slow) {
     ServerState* state = (ServerState*)malloc(sizeof(ServerState));
     if (state == NULL) {
         return NULL;
@@ -62,27 +126,54 @@ static ServerState* server_state_create(int port) {
 
     memset(state, 0, sizeof(ServerState));
     state->Port = port;
-    state->Clients = client_registry_create();
+    state->Inbound = handoff_queue_create(HANDOFF_DEFAULT_CAPACITY);
     state->Telemetry = stats_collector_create();
-    state->DB = json_db_create(JSONDB_AUTH_FILE);
-    state->AssetServer = asset_server_create(DEFAULT_ASSET_PORT);
+    state->DB = json_db_create(auth_db);
+    state->Auth = auth_pool_create(state->DB, auth_threads);
+    state->AssetServer = asset_server_create(asset_port, asset_root, asset_pack);
     state->MasterIsHere = false;
+    state->Reactors = (Reactor**)calloc(reactor_count, sizeof(Reactor*));
+    state->Clock = tick_clock_create(tick_interval);
+    state->Inputs = tick_batch_create();
+    state->NewTickFrame = shared_frame_create(MSGID_NEWTICK, "{}", 2);
+    char newtick[COMPACT_BODY_MAX];
+    size_t newtick_length = compact_encode(MSGID_NEWTICK, NULL, newtick, sizeof(newtick));
+    state->CompactNewTickFrame = shared_frame_create(MSGID_NEWTICK, newtick, (uint32_t)newtick_length);
+    state->Hashes = hash_ring_create(on_hash_mismatch, state);
+    state->OutOfSyncFrame = shared_frame_create(MSGID_OUTOFSYNC, "{}", 2);
+    state->HashInterval = hash_interval;
+    if (state->Inbound == NULL || state->Auth == NULL || state->Reactors == NULL || state->Clock == NULL ||
+        state->Inputs == NULL || state->NewTickFrame == NULL || state->CompactNewTickFrame == NULL ||
+        state->Hashes == NULL || state->OutOfSyncFrame == NULL) {
+        server_state_free(state);
+        return NULL;
+    }
 
-    return state;
-}
-
-/* Free server state */
-static void server_state_free(ServerState* state) {
-    if (state != NULL) {
-        if (state->Socket >= 0) {
-            close(state->Socket);
+    /* One reactor per core, each with its own SO_REUSEPORT socket */
+    for (int i = 0; i < reactor_count; i++) {
+        ReactorConfig config;
+        config.Index = i;
+        config.Count = reactor_count;
+        config.Port = port;
+        config.UseUring = use_uring;
+        config.Telemetry = state->Telemetry;
+        config.Inbound = state->Inbound;
+        config.HighWater = high_water;
+        config.Slow = *slow;
+        config.CompressThreshold = compress_threshold;
+        config.Auth = state->Auth;
+
+        /* Client IDs are striped over the full count, so a missing reactor would strand its share */
+        state->Reactors[i] = reactor_create(&config);
+        if (state->Reactors[i] == NULL) {
+            fprintf(stderr, "Reactor %d of %d failed to start\n", i + 1, reactor_count);
+            server_state_free(state);
+            return NULL;
         }
-        client_registry_free(state->Clients);
-        stats_collector_free(state->Telemetry);
-        json_db_free(state->DB);
-        asset_server_free(state->AssetServer);
-        free(state);
+        state->ReactorCount++;
     }
+
+    return state;
 }
 
 /* Signal handler */
@@ -91,97 +182,287 @@ static void signal_handler(int sig) {
     g_running = 0;
 }
 
-/* Initialize server socket */
-static bool init_server_socket(int port, int* socket_out) {
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) {
-        return false;
+/* Number of reactors to run by default */
+static int default_reactor_count(void) {
+#ifdef _SC_NPROCESSORS_ONLN
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores > 0) {
+        return cores > MAX_REACTORS ? MAX_REACTORS : (int)cores;
+    }
+#endif
+    return 1;
+}
+
+/* Client joined, remember it for fan-out */
+static void add_active_client(ServerState* state, int client_id) {
+    if (state->ActiveCount == state->ActiveCapacity) {
+        int capacity = state->ActiveCapacity > 0 ? state->ActiveCapacity * 2 : 64;
+        int* clients = (int*)realloc(state->ActiveClients, capacity * sizeof(int));
+        if (clients == NULL) {
+            return;
+        }
+        state->ActiveClients = clients;
+        state->ActiveCapacity = capacity;
+    }
+    state->ActiveClients[state->ActiveCount++] = client_id;
+}
+
+/* Client left */
+static void remove_active_client(ServerState* state, int client_id) {
+    for (int i = 0; i < state->ActiveCount; i++) {
+        if (state->ActiveClients[i] == client_id) {
+            state->ActiveClients[i] = state->ActiveClients[--state->ActiveCount];
+            return;
+        }
+    }
+}
+
+/* Send one encoded frame to every client, each reactor gets a single reference */
+static void broadcast_frame(ServerState* state, SharedFrame* frame, unsigned flags) {
+    for (int i = 0; i < state->ReactorCount; i++) {
+        reactor_broadcast(state->Reactors[i], frame, flags);
+    }
+}
+
+/* Send one encoded frame to a single client through its reactor */
+static void send_frame(ServerState* state, int client_id, SharedFrame* frame) {
+    int index = reactor_index_for_client(client_id, state->ReactorCount);
+    if (index < state->ReactorCount) {
+        reactor_send_shared(state->Reactors[index], client_id, frame);
     }
+}
 
-    int opt = 1;
-    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        close(sock);
-        return false;
+/* Hash ring verdict, the client disagrees with the majority */
+static void on_hash_mismatch(void* data, int client_id, int64_t tick) {
+    ServerState* state = (ServerState*)data;
+    printf("Client %d out of sync at tick %lld\n", client_id, (long long)tick);
+    send_frame(state, client_id, state->OutOfSyncFrame);
+}
+
+/* Broadcast a tick, clients on compact bodies get the compact encoding */
+static void broadcast_tick(ServerState* state, SharedFrame* frame, SharedFrame* compact) {
+    for (int i = 0; i < state->ReactorCount; i++) {
+        reactor_broadcast_encoded(state->Reactors[i], frame, compact, REACTOR_FRAME_TICK);
     }
+}
 
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = INADDR_ANY;
-    addr.sin_port = htons(port);
+/* Any reactor has a client on compact bodies */
+static bool has_compact_clients(ServerState* state) {
+    for (int i = 0; i < state->ReactorCount; i++) {
+        if (reactor_compact_clients(state->Reactors[i]) > 0) {
+            return true;
+        }
+    }
+    return false;
+}
 
-    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
-        close(sock);
-        return false;
+/* Ask every client for its state hash at this tick */
+static void request_hashes(ServerState* state, uint64_t tick) {
+    char encoded[JSON_ENCODE_INT_FRAME_MAX];
+    if (!hash_ring_open(state->Hashes, (int64_t)tick, state->ActiveCount)) {
+        return;
     }
+    size_t length = json_encode_request_hash(encoded, sizeof(encoded), (int64_t)tick);
+    SharedFrame* frame = shared_frame_copy(encoded, length);
+    if (frame != NULL) {
+        broadcast_frame(state, frame, 0);
+        shared_frame_release(frame);
+    }
+}
 
-    if (listen(sock, 10) < 0) {
-        close(sock);
-        return false;
+/* Relay a message body to everyone, serialized once */
+static void broadcast_message(ServerState* state, int kind, const char* body, size_t length, unsigned flags) {
+    SharedFrame* frame = shared_frame_create((uint32_t)kind, body, (uint32_t)length);
+    if (frame != NULL) {
+        broadcast_frame(state, frame, flags);
+        shared_frame_release(frame);
     }
+}
 
-    *socket_out = sock;
-    return true;
+/* Tell everyone a client joined */
+static void announce_new_client(ServerState* state, int client_id) {
+    char encoded[JSON_ENCODE_INT_FRAME_MAX];
+    size_t length = json_encode_new_client(encoded, sizeof(encoded), client_id);
+    SharedFrame* frame = shared_frame_copy(encoded, length);
+    if (frame != NULL) {
+        broadcast_frame(state, frame, 0);
+        shared_frame_release(frame);
+    }
+}
+
+/* Send the connection count once per tick it changed in, so a burst of joins costs one frame */
+static void announce_connections(ServerState* state) {
+    char encoded[JSON_ENCODE_INT_FRAME_MAX];
+    if (state->ActiveCount == state->AnnouncedCount) {
+        return;
+    }
+    size_t length = json_encode_current_connections(encoded, sizeof(encoded), state->ActiveCount);
+    SharedFrame* frame = shared_frame_copy(encoded, length);
+    if (frame != NULL) {
+        broadcast_frame(state, frame, 0);
+        shared_frame_release(frame);
+        state->AnnouncedCount = state->ActiveCount;
+    }
 }
 
-/* Accept new connections */
-static void accept_connections(ServerState* state) {
-    struct sockaddr_in addr;
-    socklen_t addrlen = sizeof(addr);
-
-    int client_fd = accept(state->Socket, (struct sockaddr*)&addr, &addrlen);
-    if (client_fd >= 0) {
-        char addr_str[64];
-        inet_ntop(AF_INET, &addr.sin_addr, addr_str, sizeof(addr_str));
-
-        int client_id = client_registry_register(state->Clients, addr_str, ntohs(addr.sin_port), "", false);
-        if (client_id >= 0) {
-            stats_collector_add_client(state->Telemetry);
-            printf("New connection from %s:%d (ID: %d)\n", addr_str, ntohs(addr.sin_port), client_id);
-        } else {
-            close(client_fd);
+/* Handle one envelope from a reactor */
+static void handle_envelope(ServerState* state, Envelope* env) {
+    int kind = envelope_get_kind(env);
+    int from = envelope_get_from(env);
+
+    switch (kind) {
+        case MSGID_NEWCLIENT:
+            add_active_client(state, from);
+            announce_new_client(state, from);
+            break;
+        case MSGID_EXIT:
+            remove_active_client(state, from);
+            break;
+        case MSGID_INPUT:
+        case MSGID_ORDINARY:
+        case MSGID_MOUSECLICK:
+            /* Lockstep input, goes out with the next tick */
+            stats_collector_record_incoming(state->Telemetry);
+            tick_batch_add(state->Inputs, from, kind, envelope_get_body(env), envelope_get_body_length(env));
+            break;
+        case MSGID_HASH: {
+            /* Decoded by the reactor, a body that did not decode comes without one */
+            const MessageHash* hash = (const MessageHash*)envelope_get_message(env);
+            stats_collector_record_incoming(state->Telemetry);
+            if (hash != NULL) {
+                hash_ring_report(state->Hashes, hash->Tick, from, hash->Hash);
+            }
+            break;
         }
+        case MSGID_OOCMESSAGE:
+            stats_collector_record_incoming(state->Telemetry);
+            /* Chat is the first thing a lagging client stops receiving */
+            broadcast_message(state, kind, envelope_get_body(env), envelope_get_body_length(env),
+                              REACTOR_FRAME_NONESSENTIAL);
+            break;
+        default:
+            stats_collector_record_incoming(state->Telemetry);
+            break;
     }
+
+    envelope_discard(env);
 }
 
-/* Process incoming messages */
-static void process_messages(ServerState* state) {
-    (void)state;
-    /* Message processing logic would go here */
-    /* This is where incoming messages would be handled */
+/* Run one game tick */
+static void run_tick(ServerState* state, int64_t now) {
+    TickStats before;
+    TickStats after;
+
+    tick_clock_get_stats(state->Clock, &before);
+    uint64_t tick = tick_clock_begin(state->Clock, now);
+
+    /* The tick's inputs and its NEWTICK marker travel as one buffer */
+    if (tick_batch_count(state->Inputs) > 0) {
+        /* The compact encoding is only built while someone reads it */
+        SharedFrame* compact = NULL;
+        SharedFrame* frame = tick_batch_finish(state->Inputs, has_compact_clients(state) ? &compact : NULL);
+        if (frame != NULL) {
+            broadcast_tick(state, frame, compact);
+            shared_frame_release(frame);
+        }
+        shared_frame_release(compact);
+    } else {
+        broadcast_tick(state, state->NewTickFrame, state->CompactNewTickFrame);
+    }
+
+    /* Sample hashes right after the tick they describe */
+    if (state->HashInterval > 0 && state->ActiveCount > 0 && tick % (uint64_t)state->HashInterval == 0) {
+        request_hashes(state, tick);
+    }
+    hash_ring_expire(state->Hashes, (int64_t)tick, HASH_TIMEOUT_TICKS);
+    announce_connections(state);
+
+    tick_clock_end(state->Clock, tick_clock_now());
+    tick_clock_get_stats(state->Clock, &after);
+    stats_collector_record_tick(state->Telemetry, after.LastLateness, after.LastDuration,
+                                (int64_t)(after.Missed - before.Missed));
+    if (after.Missed > before.Missed) {
+        printf("Tick %llu ran %lld us late, skipped %llu deadlines\n", (unsigned long long)after.Ticks,
+               (long long)(after.LastLateness / 1000), (unsigned long long)(after.Missed - before.Missed));
+    }
 }
 
-/* Handle client disconnections */
-static void handle_disconnections(ServerState* state) {
-    (void)state;
-    /* Disconnection handling would go here */
+/* Print tick timing summary */
+static void print_tick_report(ServerState* state) {
+    int64_t avg_lateness, max_lateness, avg_duration, max_duration;
+    stats_collector_get_tick_timing(state->Telemetry, &avg_lateness, &max_lateness, &avg_duration, &max_duration);
+    printf("Ticks: %lld (missed %lld), lateness avg %lld us max %lld us, duration avg %lld us max %lld us\n",
+           (long long)stats_collector_get_ticks(state->Telemetry),
+           (long long)stats_collector_get_ticks_missed(state->Telemetry), (long long)avg_lateness,
+           (long long)max_lateness, (long long)avg_duration, (long long)max_duration);
+
+    int64_t warnings, dropped, evictions;
+    stats_collector_get_slow(state->Telemetry, &warnings, &dropped, &evictions);
+    printf("Slow clients: %lld warnings, %lld frames shed, %lld evicted\n", (long long)warnings,
+           (long long)dropped, (long long)evictions);
+    int64_t raw, wire, bypassed, codec_us;
+    stats_collector_get_compression(state->Telemetry, &raw, &wire, &bypassed, &codec_us);
+    printf("Compression: %lld -> %lld bytes (%.1f%%) in %lld us, %lld bytes under threshold\n", (long long)raw,
+           (long long)wire, raw > 0 ? 100.0 * (double)wire / (double)raw : 100.0, (long long)codec_us,
+           (long long)bypassed);
+    int64_t compressed_conns, conn_codec_us;
+    double best_ratio, worst_ratio;
+    stats_collector_get_connection_compression(state->Telemetry, &compressed_conns, &best_ratio, &worst_ratio,
+                                               &conn_codec_us);
+    printf("Compressed connections: %lld closed, ratio best %.1f%% worst %.1f%%, at most %lld us codec time each\n",
+           (long long)compressed_conns, best_ratio, worst_ratio, (long long)conn_codec_us);
+    printf("Hash checks: %lld ticks, %lld out of sync, %lld without majority\n",
+           (long long)hash_ring_get_resolved(state->Hashes), (long long)hash_ring_get_mismatches(state->Hashes),
+           (long long)hash_ring_get_undecided(state->Hashes));
+
+    MessagePoolStats pools;
+    message_pool_get_stats(-1, &pools);
+    printf("Message pools: %lld hits, %lld misses, %lld released\n", (long long)pools.Hits,
+           (long long)pools.Misses, (long long)pools.Released);
+
+    int64_t asset_requests, asset_bytes;
+    asset_server_get_stats(state->AssetServer, &asset_requests, &asset_bytes);
+    printf("Assets: %lld requests, %lld bytes sent\n", (long long)asset_requests, (long long)asset_bytes);
+
+    int users;
+    int64_t reloads;
+    json_db_get_stats(state->DB, &users, &reloads);
+    printf("Auth database: %d users, %lld reloads\n", users, (long long)reloads);
+
+    int64_t logins, failed, cached, max_latency;
+    stats_collector_get_logins(state->Telemetry, &logins, &failed, &cached, &max_latency);
+    printf("Logins: %lld (%lld failed, %lld from cache), latency p50 %lld us p90 %lld us p99 %lld us max %lld us\n",
+           (long long)logins, (long long)failed, (long long)cached,
+           (long long)stats_collector_get_login_percentile(state->Telemetry, 50),
+           (long long)stats_collector_get_login_percentile(state->Telemetry, 90),
+           (long long)stats_collector_get_login_percentile(state->Telemetry, 99), (long long)max_latency);
 }
 
-/* Main server loop */
-static void server_loop(ServerState* state) {
-    printf("Server started on port %d\n", state->Port);
+/* Game thread loop, the only owner of game state */
+static void game_loop(ServerState* state) {
+    Envelope* batch[GAME_BATCH_SIZE];
+
+    printf("Server started on port %d (%d reactors, %s backend, %lld ms ticks)\n", state->Port,
+           state->ReactorCount, reactor_is_uring(state->Reactors[0]) ? "io_uring" : "epoll",
+           (long long)(tick_clock_interval(state->Clock) / 1000000));
     printf("Waiting for connections...\n");
 
     while (g_running) {
-        /* Use select for multiplexing */
-        fd_set read_fds;
-        FD_ZERO(&read_fds);
-        FD_SET(state->Socket, &read_fds);
-
-        struct timeval timeout;
-        timeout.tv_sec = SELECT_TIMEOUT_SEC;
-        timeout.tv_usec = 0;
-
-        int ready = select(state->Socket + 1, &read_fds, NULL, NULL, &timeout);
-        if (ready > 0) {
-            accept_connections(state);
+        /* Sleep until traffic arrives or the next absolute tick deadline */
+        size_t count = handoff_queue_drain_until(state->Inbound, batch, GAME_BATCH_SIZE,
+                                                 tick_clock_deadline(state->Clock));
+        for (size_t i = 0; i < count; i++) {
+            handle_envelope(state, batch[i]);
         }
 
-        /* Process messages and handle disconnections */
-        process_messages(state);
-        handle_disconnections(state);
+        int64_t now = tick_clock_now();
+        if (tick_clock_due(state->Clock, now)) {
+            run_tick(state, now);
+        }
     }
 
+    print_tick_report(state);
+
     if (g_restart_requested) {
         printf("Restarting server...\n");
     } else {
@@ -189,12 +470,44 @@ static void server_loop(ServerState* state) {
     }
 }
 
+/* Build an asset pack and report it, the exit status of -build-pack */
+static int build_pack(const char* root, const char* out_path) {
+    AssetPackBuildStats stats;
+    if (!asset_pack_build(root, out_path, &stats)) {
+        fprintf(stderr, "Failed to build asset pack %s from %s\n", out_path, root);
+        return 1;
+    }
+    printf("Packed %s into %s: %d files, %d gzip variants, %d state tables, %lld bytes\n", root, out_path,
+           stats.Files, stats.Variants, stats.StateTables, (long long)stats.Bytes);
+    printf("Atlas: %d frames, %d after removing duplicates, on %d pages\n", stats.AtlasFrames,
+           stats.AtlasUniqueFrames, stats.AtlasPages);
+    return 0;
+}
+
 /* Print usage information */
 static void print_usage(const char* program) {
     printf("Usage: %s [options]\n", program);
     printf("Options:\n");
     printf("  -port <port>     Set server port (default: %d)\n", DEFAULT_PORT);
-    printf("  -asset-port <p> Set asset server port (default: %d)\n", DEFAULT_ASSET_PORT);
+    printf("  -asset-port <p> Set asset server port, 0 disables (default: %d)\n", DEFAULT_ASSET_PORT);
+    printf("  -asset-root <dir> Directory served by the asset server (default: %s)\n", ASSET_SERVER_DEFAULT_ROOT);
+    printf("  -asset-pack <file> Serve assets from a pack, the root only for files it lacks\n");
+    printf("  -build-pack <dir> <file> Pack the assets under dir into file, then exit\n");
+    printf("  -auth-db <file> Login database, reloaded when it changes (default: %s)\n", JSONDB_AUTH_FILE);
+    printf("  -auth-threads <n> Threads checking logins (default: %d)\n", AUTH_POOL_DEFAULT_THREADS);
+    printf("  -io-backend <b> I/O backend: epoll or uring (default: epoll)\n");
+    printf("  -reactors <n>   Network threads (default: one per core)\n");
+    printf("  -tick-interval <ms> Game tick length (default: %d)\n", DEFAULT_TICK_INTERVAL);
+    printf("  -high-water <b> Queued bytes per client before it is dropped (default: %d)\n",
+           WRITE_QUEUE_DEFAULT_HIGH_WATER);
+    printf("  -compress-threshold <b> Smallest frame sent compressed to clients that ask (default: %d)\n",
+           STREAM_CODEC_DEFAULT_THRESHOLD);
+    printf("  -hash-interval <n> Ticks between MSGID_REQUESTHASH, 0 disables (default: %d)\n",
+           DEFAULT_HASH_INTERVAL);
+    printf("  -slow-bytes <b> Evict a client with this much unsent output (0 disables)\n");
+    printf("  -slow-ticks <n> Evict a client whose output has waited this many ticks (0 disables)\n");
+    printf("  -slow-stall-ms <ms> Evict a client whose socket accepted nothing for this long (0 disables)\n");
+    printf("  -slow-hash-ticks <n> Evict a client silent on MSGID_HASH this many ticks (0 disables)\n");
     printf("  -restart        Enable auto-restart\n");
     printf("  -help           Show this help message\n");
 }
@@ -203,7 +516,21 @@ static void print_usage(const char* program) {
 int main(int argc, char* argv[]) {
     int port = DEFAULT_PORT;
     int asset_port = DEFAULT_ASSET_PORT;
+    const char* asset_root = ASSET_SERVER_DEFAULT_ROOT;
+    const char* asset_pack = NULL;
+    const char* auth_db = JSONDB_AUTH_FILE;
+    int auth_threads = AUTH_POOL_DEFAULT_THREADS;
+    const char* pack_root = NULL;
+    const char* pack_out = NULL;
     bool auto_restart = false;
+    bool use_uring = false;
+    int reactor_count = default_reactor_count();
+    size_t high_water = WRITE_QUEUE_DEFAULT_HIGH_WATER;
+    size_t compress_threshold = STREAM_CODEC_DEFAULT_THRESHOLD;
+    int tick_interval = DEFAULT_TICK_INTERVAL;
+    int hash_interval = DEFAULT_HASH_INTERVAL;
+    SlowPolicy slow;
+    slow_policy_defaults(&slow);
 
     /* Parse arguments */
     for (int i = 1; i < argc; i++) {
@@ -211,6 +538,51 @@ int main(int argc, char* argv[]) {
             port = atoi(argv[++i]);
         } else if (strcmp(argv[i], "-asset-port") == 0 && i + 1 < argc) {
             asset_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-asset-root") == 0 && i + 1 < argc) {
+            asset_root = argv[++i];
+        } else if (strcmp(argv[i], "-asset-pack") == 0 && i + 1 < argc) {
+            asset_pack = argv[++i];
+        } else if (strcmp(argv[i], "-build-pack") == 0 && i + 2 < argc) {
+            pack_root = argv[++i];
+            pack_out = argv[++i];
+        } else if (strcmp(argv[i], "-auth-db") == 0 && i + 1 < argc) {
+            auth_db = argv[++i];
+        } else if (strcmp(argv[i], "-auth-threads") == 0 && i + 1 < argc) {
+            auth_threads = atoi(argv[++i]);
+            if (auth_threads < 1) {
+                auth_threads = 1;
+            }
+        } else if (strcmp(argv[i], "-io-backend") == 0 && i + 1 < argc) {
+            use_uring = strcmp(argv[++i], "uring") == 0;
+        } else if (strcmp(argv[i], "-reactors") == 0 && i + 1 < argc) {
+            reactor_count = atoi(argv[++i]);
+            if (reactor_count < 1 || reactor_count > MAX_REACTORS) {
+                reactor_count = default_reactor_count();
+            }
+        } else if (strcmp(argv[i], "-tick-interval") == 0 && i + 1 < argc) {
+            tick_interval = atoi(argv[++i]);
+            if (tick_interval <= 0) {
+                tick_interval = DEFAULT_TICK_INTERVAL;
+            }
+        } else if (strcmp(argv[i], "-high-water") == 0 && i + 1 < argc) {
+            long value = atol(argv[++i]);
+            high_water = value > 0 ? (size_t)value : WRITE_QUEUE_DEFAULT_HIGH_WATER;
+        } else if (strcmp(argv[i], "-compress-threshold") == 0 && i + 1 < argc) {
+            long value = atol(argv[++i]);
+            compress_threshold = value > 0 ? (size_t)value : STREAM_CODEC_DEFAULT_THRESHOLD;
+        } else if (strcmp(argv[i], "-hash-interval") == 0 && i + 1 < argc) {
+            hash_interval = atoi(argv[++i]);
+            if (hash_interval < 0) {
+                hash_interval = DEFAULT_HASH_INTERVAL;
+            }
+        } else if (strcmp(argv[i], "-slow-bytes") == 0 && i + 1 < argc) {
+            slow_thresholds_scale(&slow.QueueBytes, atoll(argv[++i]));
+        } else if (strcmp(argv[i], "-slow-ticks") == 0 && i + 1 < argc) {
+            slow_thresholds_scale(&slow.QueueTicks, atoll(argv[++i]));
+        } else if (strcmp(argv[i], "-slow-stall-ms") == 0 && i + 1 < argc) {
+            slow_thresholds_scale(&slow.StallMs, atoll(argv[++i]));
+        } else if (strcmp(argv[i], "-slow-hash-ticks") == 0 && i + 1 < argc) {
+            slow_thresholds_scale(&slow.HashTicks, atoll(argv[++i]));
         } else if (strcmp(argv[i], "-restart") == 0) {
             auto_restart = true;
         } else if (strcmp(argv[i], "-help") == 0) {
@@ -219,31 +591,38 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (pack_root != NULL) {
+        return build_pack(pack_root, pack_out);
+    }
+
+    /* Nothing asks for hashes, so silence on them means nothing */
+    if (hash_interval == 0) {
+        slow_thresholds_scale(&slow.HashTicks, 0);
+    }
+
     /* Set up signal handlers */
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
 
-    /* Create server state */
-    ServerState* state = server_state_create(port);
+    /* Create server state and bind reactors */
+    ServerState* state = server_state_create(port, asset_port, asset_root, asset_pack, auth_db, auth_threads,
+                                             reactor_count, use_uring, high_water, compress_threshold, tick_interval,
+                                             hash_interval, &slow);
     if (state == NULL) {
         fprintf(stderr, "Failed to create server state\n");
         return 1;
     }
 
-    /* Initialize socket */
-    if (!init_server_socket(port, &state->Socket)) {
-        fprintf(stderr, "Failed to initialize server socket\n");
-        server_state_free(state);
-        return 1;
-    }
-
     /* Start asset server */
-    if (asset_port != 0) {
-        asset_server_start(state->AssetServer);
+    if (asset_port != 0 && !asset_server_start(state->AssetServer)) {
+        fprintf(stderr, "Asset server not started, clients cannot download assets\n");
     }
 
-    /* Run main loop */
-    server_loop(state);
+    /* Start network threads, then run the game loop on this one */
+    for (int i = 0; i < state->ReactorCount; i++) {
+        reactor_start(state->Reactors[i]);
+    }
+    game_loop(state);
 
     /* Clean up */
     server_state_free(state);
@@ -7,6 +7,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include "model.h"
+#include "message.h"
+#include "message_pool.h"
+#include "tick_arena.h"
+#include "json_decode.h"
+#include "compact_codec.h"
 
 /* Max message length */
 #define MAX_MESSAGE_LENGTH (1 * 1024 * 1024)  /* 1 MB */
@@ -19,6 +24,9 @@ struct Envelope {
     void* Message;
     int Kind;
     int From;
+    char* Body;         /* raw JSON body, NUL terminated */
+    size_t BodyLength;
+    TickArena* Arena;   /* arena holding envelope and body, NULL on the heap */
 };
 
 /* Create new envelope */
@@ -28,65 +36,180 @@ Envelope* envelope_create(void* msg, int kind, int from) {
         env->Message = msg;
         env->Kind = kind;
         env->From = from;
+        env->Body = NULL;
+        env->BodyLength = 0;
+        env->Arena = NULL;
     }
     return env;
 }
 
+/* Create envelope for a raw frame */
+Envelope* envelope_create_frame(int kind, int from, const char* body, size_t length) {
+    Envelope* env = envelope_create(NULL, kind, from);
+    if (env == NULL) {
+        return NULL;
+    }
+    env->Body = (char*)malloc(length + 1);
+    if (env->Body == NULL) {
+        free(env);
+        return NULL;
+    }
+    memcpy(env->Body, body, length);
+    env->Body[length] = '\0';
+    env->BodyLength = length;
+    return env;
+}
+
+/* Create envelope for a raw frame in a tick arena */
+Envelope* envelope_create_frame_in(TickArena* arena, int kind, int from, const char* body, size_t length) {
+    /* Envelope and body share one bump allocation */
+    Envelope* env = (Envelope*)tick_arena_alloc(arena, sizeof(Envelope) + length + 1);
+    if (env == NULL) {
+        return envelope_create_frame(kind, from, body, length);
+    }
+    env->Message = NULL;
+    env->Kind = kind;
+    env->From = from;
+    env->Body = (char*)(env + 1);
+    memcpy(env->Body, body, length);
+    env->Body[length] = '\0';
+    env->BodyLength = length;
+    env->Arena = arena;
+    tick_arena_hold(arena);
+    return env;
+}
+
+/* Move an envelope out of its arena */
+Envelope* envelope_copy_out(Envelope* env) {
+    if (env == NULL || env->Arena == NULL) {
+        return env;
+    }
+    Envelope* copy = envelope_create_frame(env->Kind, env->From, env->Body, env->BodyLength);
+    if (copy == NULL) {
+        return NULL;
+    }
+    copy->Message = env->Message;
+    envelope_free(env);
+    return copy;
+}
+
+/* Get envelope message */
+void* envelope_get_message(Envelope* env) {
+    return env != NULL ? env->Message : NULL;
+}
+
+/* Set envelope message, the envelope's owner frees it */
+void envelope_set_message(Envelope* env, void* msg) {
+    if (env != NULL) {
+        env->Message = msg;
+    }
+}
+
+/* Get envelope kind */
+int envelope_get_kind(Envelope* env) {
+    return env != NULL ? env->Kind : 0;
+}
+
+/* Get envelope sender */
+int envelope_get_from(Envelope* env) {
+    return env != NULL ? env->From : -1;
+}
+
+/* Get raw body */
+const char* envelope_get_body(Envelope* env) {
+    return env != NULL ? env->Body : NULL;
+}
+
+/* Get raw body length */
+size_t envelope_get_body_length(Envelope* env) {
+    return env != NULL ? env->BodyLength : 0;
+}
+
 /* Free envelope */
 void envelope_free(Envelope* env) {
     if (env != NULL) {
         /* Don't free message - caller owns it */
+        if (env->Arena != NULL) {
+            /* Memory goes back when the arena is reset */
+            tick_arena_release(env->Arena);
+            return;
+        }
+        free(env->Body);
         free(env);
     }
 }
 
-/* Get concrete message based on kind */
-void* get_concrete_message(int kind) {
+/* Free envelope and message */
+void envelope_discard(Envelope* env) {
+    if (env != NULL) {
+        free_concrete_message(env->Message, env->Kind);
+        envelope_free(env);
+    }
+}
+
+/* Pool and size of the struct behind a message kind */
+static bool message_layout(int kind, int* pool, size_t* size) {
+#define LAYOUT(index, type) *pool = (index); *size = sizeof(type); return true
     switch (kind) {
         case MSGID_INPUT:
-            return malloc(sizeof(MessageInput));
-        case MSGID_CHAT:
-            return malloc(sizeof(MessageChat));
+        case MSGID_GUI:  /* Reuse MessageInput */
+            LAYOUT(0, MessageInput);
         case MSGID_LOGIN:
-            return malloc(sizeof(MessageLogin));
+            LAYOUT(1, MessageLogin);
         case MSGID_HASH:
-            return malloc(sizeof(MessageHash));
+            LAYOUT(2, MessageHash);
         case MSGID_RESTART:
-            return malloc(sizeof(MessageRestart));
+            LAYOUT(3, MessageRestart);
         case MSGID_NEXTTICK:
-            return malloc(sizeof(MessageNextTick));
+            LAYOUT(4, MessageNextTick);
         case MSGID_REQUESTHASH:
-            return malloc(sizeof(MessageRequestHash));
+            LAYOUT(5, MessageRequestHash);
         case MSGID_SUCCESSFULCONNECT:
-            return malloc(sizeof(MessageSuccessfulConnect));
+            LAYOUT(6, MessageSuccessfulConnect);
         case MSGID_MAPUPLOAD:
-            return malloc(sizeof(MessageMapUpload));
+            LAYOUT(7, MessageMapUpload);
         case MSGID_NEWTICK:
-            return malloc(sizeof(MessageNewTick));
+            LAYOUT(8, MessageNewTick);
         case MSGID_NEWCLIENT:
-            return malloc(sizeof(MessageNewClient));
+            LAYOUT(9, MessageNewClient);
         case MSGID_CURRENTCONNECTIONS:
-            return malloc(sizeof(MessageCurrentConnections));
+            LAYOUT(10, MessageCurrentConnections);
         case MSGID_ORDINARY:
-            return malloc(sizeof(MessageOrdinary));
+            LAYOUT(11, MessageOrdinary);
         case MSGID_JUSTMESSAGE:
-            return malloc(sizeof(MessageJustMessage));
-        case MSGID_GUI:
-            return malloc(sizeof(MessageInput));  /* Reuse MessageInput */
+            LAYOUT(12, MessageJustMessage);
         case MSGID_MOUSECLICK:
-            return malloc(sizeof(MessageMouseClick));
+            LAYOUT(13, MessageMouseClick);
         case MSGID_OOCMESSAGE:
-            return malloc(sizeof(MessageOOC));
+            LAYOUT(14, MessageOOC);
         case MSGID_PING:
-            return malloc(sizeof(MessagePing));
+            LAYOUT(15, MessagePing);
         default:
-            return NULL;
+            return false;
+    }
+#undef LAYOUT
+}
+
+/* Get concrete message based on kind */
+void* get_concrete_message(int kind) {
+    int pool = 0;
+    size_t size = 0;
+    if (!message_layout(kind, &pool, &size)) {
+        return NULL;
     }
+    return message_pool_get(pool, size);
 }
 
 /* Free concrete message */
 void free_concrete_message(void* msg, int kind) {
-    if (msg != NULL) {
+    int pool = 0;
+    size_t size = 0;
+    if (msg == NULL) {
+        return;
+    }
+    if (message_layout(kind, &pool, &size)) {
+        message_pool_put(pool, msg);
+    } else {
         free(msg);
     }
 }
@@ -95,17 +218,50 @@ void free_concrete_message(void* msg, int kind) {
 int get_max_message_length(int kind) {
     /* Return default max length for unknown kinds */
     switch (kind) {
-        case MSGID_CHAT:
         case MSGID_JUSTMESSAGE:
         case MSGID_OOCMESSAGE:
             return 4096;
         case MSGID_LOGIN:
             return 256;
+        case MSGID_HASH:
+            return 512;
         default:
             return MAX_MESSAGE_LENGTH;
     }
 }
 
+/* Decode a body in either encoding */
+bool message_decode_body(int kind, const char* body, size_t length, void* out) {
+    if (compact_is_body(body, length)) {
+        return compact_decode(kind, body, length, out);
+    }
+    return json_decode_message(kind, body, length, out) == JSON_DECODE_OK;
+}
+
+/* Decode a MSGID_HASH body */
+bool message_decode_hash(const char* body, size_t length, MessageHash* hash) {
+    /* Both codecs accept hashes of either signedness and wrap them */
+    if (body == NULL || hash == NULL || !message_decode_body(MSGID_HASH, body, length, hash)) {
+        return false;
+    }
+    return hash->Tick >= 0;
+}
+
+/* Decode into a pooled struct */
+void* message_decode_concrete(int kind, const char* body, size_t length) {
+    void* msg = get_concrete_message(kind);
+    if (msg == NULL) {
+        return NULL;
+    }
+    bool decoded = kind == MSGID_HASH ? message_decode_hash(body, length, (MessageHash*)msg)
+                                      : message_decode_body(kind, body, length, msg);
+    if (!decoded) {
+        free_concrete_message(msg, kind);
+        return NULL;
+    }
+    return msg;
+}
+
 /* Create envelope helper */
 Envelope* NewEnvelope(void* msg, int kind, int from) {
     return envelope_create(msg, kind, from);
@@ -7,7 +7,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "model.h"
+#include "tick_arena.h"
 
 /* Message envelope */
 typedef struct Envelope Envelope;
@@ -15,10 +17,30 @@ typedef struct Envelope Envelope;
 /* Create envelope */
 Envelope* envelope_create(void* msg, int kind, int from);
 
+/* Create envelope owning a copy of a raw frame body */
+Envelope* envelope_create_frame(int kind, int from, const char* body, size_t length);
+
+/* Same, carved from a tick arena, heap allocated when the arena is full */
+Envelope* envelope_create_frame_in(TickArena* arena, int kind, int from, const char* body, size_t length);
+
+/* Heap copy of an arena envelope that must outlive its tick, frees env unless NULL is returned */
+Envelope* envelope_copy_out(Envelope* env);
+
+/* Envelope accessors */
+void* envelope_get_message(Envelope* env);
+void envelope_set_message(Envelope* env, void* msg);
+int envelope_get_kind(Envelope* env);
+int envelope_get_from(Envelope* env);
+const char* envelope_get_body(Envelope* env);
+size_t envelope_get_body_length(Envelope* env);
+
 /* Free envelope */
 void envelope_free(Envelope* env);
 
-/* Get concrete message by kind */
+/* Free envelope together with its concrete message */
+void envelope_discard(Envelope* env);
+
+/* Get concrete message by kind, pooled per type, release with free_concrete_message */
 void* get_concrete_message(int kind);
 
 /* Free concrete message */
@@ -27,6 +49,15 @@ void free_concrete_message(void* msg, int kind);
 /* Get max message length */
 int get_max_message_length(int kind);
 
+/* Decode a JSON or compact body into the struct for kind, which is zeroed first */
+bool message_decode_body(int kind, const char* body, size_t length, void* out);
+
+/* Decode a MSGID_HASH body {"hash":N,"tick":N} */
+bool message_decode_hash(const char* body, size_t length, MessageHash* hash);
+
+/* Decode a body into a pooled struct for kind, NULL when it does not decode */
+void* message_decode_concrete(int kind, const char* body, size_t length);
+
 /* Envelope constructor */
 Envelope* NewEnvelope(void* msg, int kind, int from);
 
@@ -0,0 +1,269 @@
+/*
+ * Luminous Locus Message Pool Module
+ * Per-type freelists for concrete message structs
+ *
+ * Every thread keeps a small freelist per pool and serves gets and puts
+ * from it without locking. Messages are usually allocated on a reactor
+ * and freed on the game thread, so a list that grows past its limit
+ * hands a batch to the pool's shared depot, and an empty list takes a
+ * batch back from it. Only those batch moves take the depot lock. Free
+ * objects are linked through their own first bytes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "message_pool.h"
+
+/* Objects moved between a thread list and the depot at once */
+#define MESSAGE_POOL_BATCH 32
+
+/* Thread list length that triggers a spill to the depot */
+#define MESSAGE_POOL_THREAD_LIMIT (2 * MESSAGE_POOL_BATCH)
+
+/* Objects a depot keeps before giving them back to malloc */
+#define MESSAGE_POOL_DEPOT_LIMIT 1024
+
+/* Counters are written by the owning thread only and summed by readers */
+#define POOL_BUMP(field) __atomic_store_n(&(field), (field) + 1, __ATOMIC_RELAXED)
+#define POOL_ADD(field, value) __atomic_store_n(&(field), (field) + (value), __ATOMIC_RELAXED)
+#define POOL_GET(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+typedef struct FreeObject {
+    struct FreeObject* Next;
+} FreeObject;
+
+typedef struct FreeList {
+    FreeObject* Head;
+    int Count;
+} FreeList;
+
+/* Shared overflow of one pool */
+typedef struct Depot {
+    pthread_mutex_t Mutex;
+    FreeList List;
+} Depot;
+
+/* One thread's lists and counters */
+typedef struct ThreadCache {
+    FreeList Lists[MESSAGE_POOL_COUNT];
+    MessagePoolStats Stats[MESSAGE_POOL_COUNT];
+    struct ThreadCache* Next;
+} ThreadCache;
+
+static Depot g_depots[MESSAGE_POOL_COUNT];
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_cache_key;
+
+/* Live thread caches, plus the counters of threads that have exited */
+static pthread_mutex_t g_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ThreadCache* g_caches = NULL;
+static MessagePoolStats g_retired[MESSAGE_POOL_COUNT];
+
+static _Thread_local ThreadCache* t_cache = NULL;
+
+/* Cut up to count objects off the front of list */
+static FreeObject* list_take(FreeList* list, int count, int* taken) {
+    FreeObject* head = list->Head;
+    FreeObject* last = NULL;
+    int n = 0;
+    for (FreeObject* object = head; object != NULL && n < count; object = object->Next) {
+        last = object;
+        n++;
+    }
+    if (last != NULL) {
+        list->Head = last->Next;
+        last->Next = NULL;
+    }
+    list->Count -= n;
+    *taken = n;
+    return n > 0 ? head : NULL;
+}
+
+/* Free a detached chain */
+static void chain_free(FreeObject* chain) {
+    while (chain != NULL) {
+        FreeObject* next = chain->Next;
+        free(chain);
+        chain = next;
+    }
+}
+
+/* Move a detached chain to the depot, free it if the depot is full */
+static int depot_put(int pool, FreeObject* chain, int count) {
+    Depot* depot = &g_depots[pool];
+    bool kept = false;
+
+    pthread_mutex_lock(&depot->Mutex);
+    if (depot->List.Count + count <= MESSAGE_POOL_DEPOT_LIMIT) {
+        FreeObject* last = chain;
+        while (last->Next != NULL) {
+            last = last->Next;
+        }
+        last->Next = depot->List.Head;
+        depot->List.Head = chain;
+        depot->List.Count += count;
+        kept = true;
+    }
+    pthread_mutex_unlock(&depot->Mutex);
+
+    if (!kept) {
+        chain_free(chain);
+        return count;
+    }
+    return 0;
+}
+
+/* Return every object of a thread cache to the depots */
+static void cache_flush(ThreadCache* cache) {
+    for (int pool = 0; pool < MESSAGE_POOL_COUNT; pool++) {
+        FreeList* list = &cache->Lists[pool];
+        while (list->Head != NULL) {
+            int taken = 0;
+            FreeObject* chain = list_take(list, MESSAGE_POOL_BATCH, &taken);
+            POOL_ADD(cache->Stats[pool].Released, depot_put(pool, chain, taken));
+        }
+    }
+}
+
+/* Thread exit, keep its counters and hand its objects on */
+static void cache_destroy(void* data) {
+    ThreadCache* cache = (ThreadCache*)data;
+    cache_flush(cache);
+
+    pthread_mutex_lock(&g_registry_mutex);
+    for (ThreadCache** link = &g_caches; *link != NULL; link = &(*link)->Next) {
+        if (*link == cache) {
+            *link = cache->Next;
+            break;
+        }
+    }
+    for (int pool = 0; pool < MESSAGE_POOL_COUNT; pool++) {
+        g_retired[pool].Hits += cache->Stats[pool].Hits;
+        g_retired[pool].Misses += cache->Stats[pool].Misses;
+        g_retired[pool].Released += cache->Stats[pool].Released;
+    }
+    pthread_mutex_unlock(&g_registry_mutex);
+
+    free(cache);
+    t_cache = NULL;
+}
+
+/* One-time setup */
+static void pools_init(void) {
+    for (int pool = 0; pool < MESSAGE_POOL_COUNT; pool++) {
+        pthread_mutex_init(&g_depots[pool].Mutex, NULL);
+    }
+    pthread_key_create(&g_cache_key, cache_destroy);
+}
+
+/* Get or create the calling thread's cache */
+static ThreadCache* thread_cache(void) {
+    if (t_cache != NULL) {
+        return t_cache;
+    }
+    pthread_once(&g_once, pools_init);
+
+    ThreadCache* cache = (ThreadCache*)calloc(1, sizeof(ThreadCache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    pthread_mutex_lock(&g_registry_mutex);
+    cache->Next = g_caches;
+    g_caches = cache;
+    pthread_mutex_unlock(&g_registry_mutex);
+
+    /* The key only exists so the destructor runs at thread exit */
+    pthread_setspecific(g_cache_key, cache);
+    t_cache = cache;
+    return cache;
+}
+
+/* Take a batch from the depot into an empty thread list */
+static void cache_refill(int pool, FreeList* list) {
+    Depot* depot = &g_depots[pool];
+    int taken = 0;
+
+    pthread_mutex_lock(&depot->Mutex);
+    list->Head = list_take(&depot->List, MESSAGE_POOL_BATCH, &taken);
+    pthread_mutex_unlock(&depot->Mutex);
+    list->Count = taken;
+}
+
+/* Get object */
+void* message_pool_get(int pool, size_t size) {
+    if (size < sizeof(FreeObject)) {
+        size = sizeof(FreeObject);
+    }
+    ThreadCache* cache = pool >= 0 && pool < MESSAGE_POOL_COUNT ? thread_cache() : NULL;
+    if (cache == NULL) {
+        return malloc(size);
+    }
+
+    FreeList* list = &cache->Lists[pool];
+    if (list->Head == NULL) {
+        cache_refill(pool, list);
+    }
+    FreeObject* object = list->Head;
+    if (object == NULL) {
+        POOL_BUMP(cache->Stats[pool].Misses);
+        return malloc(size);
+    }
+    list->Head = object->Next;
+    list->Count--;
+    POOL_BUMP(cache->Stats[pool].Hits);
+    return object;
+}
+
+/* Put object */
+void message_pool_put(int pool, void* object) {
+    if (object == NULL) {
+        return;
+    }
+    ThreadCache* cache = pool >= 0 && pool < MESSAGE_POOL_COUNT ? thread_cache() : NULL;
+    if (cache == NULL) {
+        free(object);
+        return;
+    }
+
+    FreeList* list = &cache->Lists[pool];
+    FreeObject* node = (FreeObject*)object;
+    node->Next = list->Head;
+    list->Head = node;
+    list->Count++;
+
+    if (list->Count > MESSAGE_POOL_THREAD_LIMIT) {
+        /* Producer threads are elsewhere, pass the surplus to them */
+        int taken = 0;
+        FreeObject* chain = list_take(list, MESSAGE_POOL_BATCH, &taken);
+        POOL_ADD(cache->Stats[pool].Released, depot_put(pool, chain, taken));
+    }
+}
+
+/* Get counters */
+void message_pool_get_stats(int pool, MessagePoolStats* stats) {
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(MessagePoolStats));
+    int first = pool < 0 ? 0 : pool;
+    int last = pool < 0 ? MESSAGE_POOL_COUNT - 1 : pool;
+    if (first >= MESSAGE_POOL_COUNT) {
+        return;
+    }
+
+    pthread_mutex_lock(&g_registry_mutex);
+    for (int index = first; index <= last; index++) {
+        stats->Hits += g_retired[index].Hits;
+        stats->Misses += g_retired[index].Misses;
+        stats->Released += g_retired[index].Released;
+        for (ThreadCache* cache = g_caches; cache != NULL; cache = cache->Next) {
+            stats->Hits += POOL_GET(cache->Stats[index].Hits);
+            stats->Misses += POOL_GET(cache->Stats[index].Misses);
+            stats->Released += POOL_GET(cache->Stats[index].Released);
+        }
+    }
+    pthread_mutex_unlock(&g_registry_mutex);
+}
@@ -0,0 +1,30 @@
+/*
+ * Luminous Locus Message Pool Header
+ */
+
+#ifndef MESSAGE_POOL_H
+#define MESSAGE_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Number of independent pools, one per concrete message type */
+#define MESSAGE_POOL_COUNT 16
+
+/* Counters of one pool, or of all pools summed */
+typedef struct MessagePoolStats {
+    int64_t Hits;      /* served from a thread cache or the shared depot */
+    int64_t Misses;    /* fell through to malloc */
+    int64_t Released;  /* returned to malloc because the depot was full */
+} MessagePoolStats;
+
+/* Take an object of the given size from pool, malloc when it is empty */
+void* message_pool_get(int pool, size_t size);
+
+/* Give an object back to the pool it came from */
+void message_pool_put(int pool, void* object);
+
+/* Read counters, pool -1 sums every pool */
+void message_pool_get_stats(int pool, MessagePoolStats* stats);
+
+#endif /* MESSAGE_POOL_H */
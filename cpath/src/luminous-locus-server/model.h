@@ -16,6 +16,7 @@ enum MessageType {
     MSGID_HASH = 3,
     MSGID_RESTART = 4,
     MSGID_NEXTTICK = 5,
+    MSGID_COMPRESSED = 6,       /* stream compressed frames, either direction */
     MSGID_SUCCESSFULCONNECT = 201,
     MSGID_MAPUPLOAD = 202,
     MSGID_NEWTICK = 203,
@@ -76,6 +77,26 @@ struct MessageMouseClick;
 struct MessageOOC;
 struct MessagePing;
 
+/* Type names */
+typedef struct UserInfo UserInfo;
+typedef struct MessageInput MessageInput;
+typedef struct MessageChat MessageChat;
+typedef struct MessageLogin MessageLogin;
+typedef struct MessageHash MessageHash;
+typedef struct MessageRestart MessageRestart;
+typedef struct MessageNextTick MessageNextTick;
+typedef struct MessageRequestHash MessageRequestHash;
+typedef struct MessageSuccessfulConnect MessageSuccessfulConnect;
+typedef struct MessageMapUpload MessageMapUpload;
+typedef struct MessageNewTick MessageNewTick;
+typedef struct MessageNewClient MessageNewClient;
+typedef struct MessageCurrentConnections MessageCurrentConnections;
+typedef struct MessageOrdinary MessageOrdinary;
+typedef struct MessageJustMessage MessageJustMessage;
+typedef struct MessageMouseClick MessageMouseClick;
+typedef struct MessageOOC MessageOOC;
+typedef struct MessagePing MessagePing;
+
 /* User info structure */
 struct UserInfo {
     char Login[64];
@@ -100,6 +121,8 @@ struct MessageLogin {
     char Password[128];
     bool IsGuest;
     char GameVersion[64];
+    int Protocol;       /* highest body encoding the client speaks, 0 for JSON only */
+    int Compression;    /* stream codec version the client speaks, 0 for none */
 };
 
 struct MessageHash {
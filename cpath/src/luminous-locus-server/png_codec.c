@@ -0,0 +1,458 @@
+/*
+ * Luminous Locus PNG Codec Module
+ * PNG to RGBA and back, for the offline atlas builder
+ *
+ * .dmi sheets are PNGs in whatever form the editor saved them: palette
+ * images at 1 to 8 bits, RGBA, now and then grayscale. The decoder reads
+ * every non-interlaced form into plain RGBA so frames can be compared
+ * and copied byte for byte; chunk CRCs are checked and unknown critical
+ * chunks refused. The encoder always writes 8-bit RGBA, one IDAT, with
+ * each row's filter chosen by the usual smallest-sum heuristic.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "deflate.h"
+#include "png_codec.h"
+
+/* Fixed PNG framing */
+#define PNG_SIGNATURE_SIZE 8
+#define CHUNK_OVERHEAD 12
+#define IHDR_SIZE 13
+
+/* Color types */
+#define COLOR_GRAY 0
+#define COLOR_RGB 2
+#define COLOR_PALETTE 3
+#define COLOR_GRAY_ALPHA 4
+#define COLOR_RGBA 6
+
+/* Row filters */
+#define FILTER_NONE 0
+#define FILTER_SUB 1
+#define FILTER_UP 2
+#define FILTER_AVERAGE 3
+#define FILTER_PAETH 4
+#define FILTER_COUNT 5
+
+static const unsigned char g_signature[PNG_SIGNATURE_SIZE] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+
+/* Header and palette gathered from the chunks */
+typedef struct PngInfo {
+    uint32_t Width;
+    uint32_t Height;
+    int Depth;
+    int ColorType;
+    int Channels;
+    uint8_t Palette[256][4];
+    int PaletteSize;
+    bool HasKey;                /* tRNS color key for gray and RGB images */
+    uint16_t Key[3];
+    char* Compressed;           /* IDAT contents, concatenated */
+    size_t CompressedLength;
+    size_t CompressedCapacity;
+} PngInfo;
+
+/* Big-endian 32-bit load */
+static uint32_t load32(const unsigned char* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+/* Big-endian 32-bit store */
+static void store32(unsigned char* p, uint32_t value) {
+    p[0] = (unsigned char)(value >> 24);
+    p[1] = (unsigned char)(value >> 16);
+    p[2] = (unsigned char)(value >> 8);
+    p[3] = (unsigned char)value;
+}
+
+/* Channels of a color type at a bit depth, 0 when the pair is not valid PNG */
+static int channel_count(int color_type, int depth) {
+    switch (color_type) {
+        case COLOR_GRAY:
+            return depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16 ? 1 : 0;
+        case COLOR_PALETTE:
+            return depth == 1 || depth == 2 || depth == 4 || depth == 8 ? 1 : 0;
+        case COLOR_RGB:
+            return depth == 8 || depth == 16 ? 3 : 0;
+        case COLOR_GRAY_ALPHA:
+            return depth == 8 || depth == 16 ? 2 : 0;
+        case COLOR_RGBA:
+            return depth == 8 || depth == 16 ? 4 : 0;
+        default:
+            return 0;
+    }
+}
+
+/* Read IHDR */
+static bool read_header(PngInfo* info, const unsigned char* data, uint32_t length) {
+    if (length != IHDR_SIZE) {
+        return false;
+    }
+    info->Width = load32(data);
+    info->Height = load32(data + 4);
+    info->Depth = data[8];
+    info->ColorType = data[9];
+    info->Channels = channel_count(info->ColorType, info->Depth);
+    /* Deflate, adaptive filtering, no interlace */
+    return info->Width > 0 && info->Width <= PNG_MAX_DIMENSION && info->Height > 0 &&
+           info->Height <= PNG_MAX_DIMENSION && info->Channels > 0 && data[10] == 0 && data[11] == 0 && data[12] == 0;
+}
+
+/* Read PLTE */
+static bool read_palette(PngInfo* info, const unsigned char* data, uint32_t length) {
+    if (length == 0 || length % 3 != 0 || length / 3 > 256) {
+        return false;
+    }
+    info->PaletteSize = (int)(length / 3);
+    for (int i = 0; i < info->PaletteSize; i++) {
+        info->Palette[i][0] = data[3 * i];
+        info->Palette[i][1] = data[3 * i + 1];
+        info->Palette[i][2] = data[3 * i + 2];
+        info->Palette[i][3] = 0xff;
+    }
+    return true;
+}
+
+/* Read tRNS: palette alphas, or the one transparent gray or RGB value */
+static bool read_transparency(PngInfo* info, const unsigned char* data, uint32_t length) {
+    if (info->ColorType == COLOR_PALETTE) {
+        if (length > (uint32_t)info->PaletteSize) {
+            return false;
+        }
+        for (uint32_t i = 0; i < length; i++) {
+            info->Palette[i][3] = data[i];
+        }
+        return true;
+    }
+    int samples = info->ColorType == COLOR_GRAY ? 1 : info->ColorType == COLOR_RGB ? 3 : 0;
+    if (samples == 0 || length != (uint32_t)samples * 2) {
+        return false;
+    }
+    for (int i = 0; i < samples; i++) {
+        info->Key[i] = (uint16_t)(data[2 * i] << 8 | data[2 * i + 1]);
+    }
+    info->HasKey = true;
+    return true;
+}
+
+/* Append IDAT contents */
+static bool append_data(PngInfo* info, const unsigned char* data, uint32_t length) {
+    if (info->CompressedCapacity - info->CompressedLength < length) {
+        size_t capacity = info->CompressedCapacity > 0 ? info->CompressedCapacity : 65536;
+        while (capacity - info->CompressedLength < length) {
+            capacity *= 2;
+        }
+        char* grown = (char*)realloc(info->Compressed, capacity);
+        if (grown == NULL) {
+            return false;
+        }
+        info->Compressed = grown;
+        info->CompressedCapacity = capacity;
+    }
+    memcpy(info->Compressed + info->CompressedLength, data, length);
+    info->CompressedLength += length;
+    return true;
+}
+
+/* Walk the chunks up to IEND */
+static bool read_chunks(PngInfo* info, const unsigned char* data, size_t length) {
+    size_t position = PNG_SIGNATURE_SIZE;
+    bool seen_header = false;
+    bool seen_data = false;
+    while (length - position >= CHUNK_OVERHEAD) {
+        uint32_t chunk_length = load32(data + position);
+        const unsigned char* type = data + position + 4;
+        const unsigned char* body = type + 4;
+        if (chunk_length > length - position - CHUNK_OVERHEAD ||
+            crc32_update(0, type, chunk_length + 4) != load32(body + chunk_length)) {
+            return false;
+        }
+        position += CHUNK_OVERHEAD + chunk_length;
+
+        bool ok = true;
+        if (memcmp(type, "IHDR", 4) == 0) {
+            ok = !seen_header && read_header(info, body, chunk_length);
+            seen_header = true;
+        } else if (!seen_header) {
+            return false;
+        } else if (memcmp(type, "PLTE", 4) == 0) {
+            ok = !seen_data && read_palette(info, body, chunk_length);
+        } else if (memcmp(type, "tRNS", 4) == 0) {
+            ok = !seen_data && read_transparency(info, body, chunk_length);
+        } else if (memcmp(type, "IDAT", 4) == 0) {
+            ok = append_data(info, body, chunk_length);
+            seen_data = true;
+        } else if (memcmp(type, "IEND", 4) == 0) {
+            return seen_data && (info->ColorType != COLOR_PALETTE || info->PaletteSize > 0);
+        } else if ((type[0] & 0x20) == 0) {
+            /* An uppercase first letter marks a chunk the image cannot be read without */
+            return false;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return false;
+}
+
+/* Paeth predictor */
+static uint8_t paeth(uint8_t left, uint8_t up, uint8_t up_left) {
+    int estimate = left + up - up_left;
+    int to_left = abs(estimate - left);
+    int to_up = abs(estimate - up);
+    int to_up_left = abs(estimate - up_left);
+    if (to_left <= to_up && to_left <= to_up_left) {
+        return left;
+    }
+    return to_up <= to_up_left ? up : up_left;
+}
+
+/* Undo the filter of one row in place, previous is NULL for the first */
+static bool unfilter_row(uint8_t* row, const uint8_t* previous, size_t stride, size_t bpp, int filter) {
+    for (size_t i = 0; i < stride; i++) {
+        uint8_t left = i >= bpp ? row[i - bpp] : 0;
+        uint8_t up = previous != NULL ? previous[i] : 0;
+        uint8_t up_left = previous != NULL && i >= bpp ? previous[i - bpp] : 0;
+        switch (filter) {
+            case FILTER_NONE:
+                break;
+            case FILTER_SUB:
+                row[i] = (uint8_t)(row[i] + left);
+                break;
+            case FILTER_UP:
+                row[i] = (uint8_t)(row[i] + up);
+                break;
+            case FILTER_AVERAGE:
+                row[i] = (uint8_t)(row[i] + ((left + up) >> 1));
+                break;
+            case FILTER_PAETH:
+                row[i] = (uint8_t)(row[i] + paeth(left, up, up_left));
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+/* Sample c of pixel x in an unfiltered row, at the image's bit depth */
+static uint16_t sample(const PngInfo* info, const uint8_t* row, uint32_t x, int c) {
+    size_t index = (size_t)x * info->Channels + c;
+    if (info->Depth == 16) {
+        return (uint16_t)(row[2 * index] << 8 | row[2 * index + 1]);
+    }
+    if (info->Depth == 8) {
+        return row[index];
+    }
+    size_t bit = index * info->Depth;
+    int shift = 8 - info->Depth - (int)(bit % 8);
+    return (uint16_t)((row[bit / 8] >> shift) & ((1 << info->Depth) - 1));
+}
+
+/* Scale a sample to 8 bits */
+static uint8_t to8(const PngInfo* info, uint16_t value) {
+    if (info->Depth == 16) {
+        return (uint8_t)(value >> 8);
+    }
+    return (uint8_t)(value * 255 / ((1 << info->Depth) - 1));
+}
+
+/* Convert one unfiltered row to RGBA */
+static bool convert_row(const PngInfo* info, const uint8_t* row, uint8_t* out) {
+    for (uint32_t x = 0; x < info->Width; x++, out += 4) {
+        uint16_t first = sample(info, row, x, 0);
+        switch (info->ColorType) {
+            case COLOR_PALETTE:
+                if (first >= info->PaletteSize) {
+                    return false;
+                }
+                memcpy(out, info->Palette[first], 4);
+                break;
+            case COLOR_GRAY:
+                out[0] = out[1] = out[2] = to8(info, first);
+                out[3] = info->HasKey && first == info->Key[0] ? 0 : 0xff;
+                break;
+            case COLOR_GRAY_ALPHA:
+                out[0] = out[1] = out[2] = to8(info, first);
+                out[3] = to8(info, sample(info, row, x, 1));
+                break;
+            case COLOR_RGB: {
+                uint16_t green = sample(info, row, x, 1);
+                uint16_t blue = sample(info, row, x, 2);
+                out[0] = to8(info, first);
+                out[1] = to8(info, green);
+                out[2] = to8(info, blue);
+                bool keyed = info->HasKey && first == info->Key[0] && green == info->Key[1] && blue == info->Key[2];
+                out[3] = keyed ? 0 : 0xff;
+                break;
+            }
+            default:
+                for (int c = 0; c < 4; c++) {
+                    out[c] = to8(info, sample(info, row, x, c));
+                }
+                break;
+        }
+    }
+    return true;
+}
+
+/* Decode a PNG */
+bool png_decode(const void* data, size_t length, PngImage* image) {
+    if (image == NULL) {
+        return false;
+    }
+    memset(image, 0, sizeof(PngImage));
+    const unsigned char* bytes = (const unsigned char*)data;
+    if (bytes == NULL || length < PNG_SIGNATURE_SIZE || memcmp(bytes, g_signature, PNG_SIGNATURE_SIZE) != 0) {
+        return false;
+    }
+    PngInfo* info = (PngInfo*)calloc(1, sizeof(PngInfo));
+    if (info == NULL) {
+        return false;
+    }
+
+    bool ok = read_chunks(info, bytes, length);
+    size_t stride = ((size_t)info->Width * info->Channels * info->Depth + 7) / 8;
+    size_t bpp = ((size_t)info->Channels * info->Depth + 7) / 8;
+    size_t raw_length = (stride + 1) * info->Height;
+    uint8_t* raw = ok ? (uint8_t*)malloc(raw_length) : NULL;
+    uint8_t* pixels = ok ? (uint8_t*)malloc((size_t)info->Width * info->Height * 4) : NULL;
+    size_t produced = 0;
+    ok = raw != NULL && pixels != NULL &&
+         zlib_decompress(info->Compressed, info->CompressedLength, (char*)raw, raw_length, &produced) &&
+         produced == raw_length;
+
+    for (uint32_t y = 0; ok && y < info->Height; y++) {
+        uint8_t* row = raw + y * (stride + 1);
+        const uint8_t* previous = y > 0 ? row - stride : NULL;
+        ok = unfilter_row(row + 1, previous, stride, bpp, row[0]) &&
+             convert_row(info, row + 1, pixels + (size_t)y * info->Width * 4);
+    }
+
+    if (ok) {
+        image->Width = info->Width;
+        image->Height = info->Height;
+        image->Pixels = pixels;
+    } else {
+        free(pixels);
+    }
+    free(raw);
+    free(info->Compressed);
+    free(info);
+    return ok;
+}
+
+/* Free decoded pixels */
+void png_image_free(PngImage* image) {
+    if (image != NULL) {
+        free(image->Pixels);
+        memset(image, 0, sizeof(PngImage));
+    }
+}
+
+/* Filter one row with the given filter, bpp is 4 */
+static void filter_row(const uint8_t* row, const uint8_t* previous, size_t stride, int filter, uint8_t* out) {
+    for (size_t i = 0; i < stride; i++) {
+        uint8_t left = i >= 4 ? row[i - 4] : 0;
+        uint8_t up = previous != NULL ? previous[i] : 0;
+        uint8_t up_left = previous != NULL && i >= 4 ? previous[i - 4] : 0;
+        uint8_t predicted = 0;
+        if (filter == FILTER_SUB) {
+            predicted = left;
+        } else if (filter == FILTER_UP) {
+            predicted = up;
+        } else if (filter == FILTER_AVERAGE) {
+            predicted = (uint8_t)((left + up) >> 1);
+        } else if (filter == FILTER_PAETH) {
+            predicted = paeth(left, up, up_left);
+        }
+        out[i] = (uint8_t)(row[i] - predicted);
+    }
+}
+
+/* Sum of filtered bytes read as signed, smaller usually compresses better */
+static uint64_t filter_cost(const uint8_t* filtered, size_t stride) {
+    uint64_t cost = 0;
+    for (size_t i = 0; i < stride; i++) {
+        cost += filtered[i] < 128 ? filtered[i] : 256 - filtered[i];
+    }
+    return cost;
+}
+
+/* Write one chunk at out, returns its size */
+static size_t write_chunk(unsigned char* out, const char* type, const void* data, size_t length) {
+    store32(out, (uint32_t)length);
+    memcpy(out + 4, type, 4);
+    if (length > 0) {
+        memcpy(out + 8, data, length);
+    }
+    store32(out + 8 + length, crc32_update(0, out + 4, length + 4));
+    return CHUNK_OVERHEAD + length;
+}
+
+/* Encode RGBA as a PNG */
+char* png_encode(const uint8_t* pixels, uint32_t width, uint32_t height, size_t* length) {
+    if (pixels == NULL || length == NULL || width == 0 || height == 0 || width > PNG_MAX_DIMENSION ||
+        height > PNG_MAX_DIMENSION) {
+        return NULL;
+    }
+    size_t stride = (size_t)width * 4;
+    size_t raw_length = (stride + 1) * height;
+    uint8_t* raw = (uint8_t*)malloc(raw_length);
+    uint8_t* trial = (uint8_t*)malloc(stride * FILTER_COUNT);
+    size_t compressed_capacity = zlib_bound(raw_length);
+    unsigned char* png = (unsigned char*)malloc(PNG_SIGNATURE_SIZE + 3 * CHUNK_OVERHEAD + IHDR_SIZE +
+                                                compressed_capacity);
+    char* compressed = (char*)malloc(compressed_capacity);
+    if (raw == NULL || trial == NULL || png == NULL || compressed == NULL) {
+        free(raw);
+        free(trial);
+        free(png);
+        free(compressed);
+        return NULL;
+    }
+
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t* row = pixels + (size_t)y * stride;
+        const uint8_t* previous = y > 0 ? row - stride : NULL;
+        int best = FILTER_NONE;
+        uint64_t best_cost = UINT64_MAX;
+        for (int filter = 0; filter < FILTER_COUNT; filter++) {
+            filter_row(row, previous, stride, filter, trial + filter * stride);
+            uint64_t cost = filter_cost(trial + filter * stride, stride);
+            if (cost < best_cost) {
+                best = filter;
+                best_cost = cost;
+            }
+        }
+        uint8_t* out = raw + y * (stride + 1);
+        out[0] = (uint8_t)best;
+        memcpy(out + 1, trial + best * stride, stride);
+    }
+    size_t compressed_length = zlib_compress(raw, raw_length, compressed, compressed_capacity);
+
+    unsigned char header[IHDR_SIZE] = {0};
+    store32(header, width);
+    store32(header + 4, height);
+    header[8] = 8;
+    header[9] = COLOR_RGBA;
+    size_t used = PNG_SIGNATURE_SIZE;
+    memcpy(png, g_signature, PNG_SIGNATURE_SIZE);
+    used += write_chunk(png + used, "IHDR", header, IHDR_SIZE);
+    used += write_chunk(png + used, "IDAT", compressed, compressed_length);
+    used += write_chunk(png + used, "IEND", NULL, 0);
+
+    free(raw);
+    free(trial);
+    free(compressed);
+    if (compressed_length == 0) {
+        free(png);
+        return NULL;
+    }
+    *length = used;
+    return (char*)png;
+}
@@ -0,0 +1,35 @@
+/*
+ * Luminous Locus PNG Codec Header
+ */
+
+#ifndef PNG_CODEC_H
+#define PNG_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Largest width or height decoded */
+#define PNG_MAX_DIMENSION 16384
+
+/* Decoded image, 8-bit RGBA rows with no padding */
+typedef struct PngImage {
+    uint32_t Width;
+    uint32_t Height;
+    uint8_t* Pixels;
+} PngImage;
+
+/*
+ * Decode a PNG of any color type at 1 to 16 bits into RGBA, applying
+ * tRNS. Interlaced images are refused. False when the data is not a
+ * PNG this decoder reads; image is left empty then.
+ */
+bool png_decode(const void* data, size_t length, PngImage* image);
+
+/* Free decoded pixels */
+void png_image_free(PngImage* image);
+
+/* Encode RGBA as an 8-bit RGBA PNG, returns malloc'd bytes or NULL */
+char* png_encode(const uint8_t* pixels, uint32_t width, uint32_t height, size_t* length);
+
+#endif /* PNG_CODEC_H */
@@ -0,0 +1,1441 @@
+/*
+ * Luminous Locus Reactor Module
+ * One network event loop per thread
+ *
+ * Every reactor binds its own listening socket to the game port with
+ * SO_REUSEPORT, so the kernel spreads new connections across threads.
+ * A reactor owns the sockets it accepted and a partition of the client
+ * registry; client ids are striped (id % count == index) so any thread
+ * can tell which reactor owns a client. Inbound traffic is handed to
+ * the game thread as envelopes, outbound traffic comes back through
+ * reactor_send and a wakeup fd.
+ *
+ * Each tick frame that passes through the outbox advances the reactor's
+ * tick count, and every connection is then checked against the slow
+ * consumer policy; clients that fall too far behind are evicted with
+ * MSGID_TOOSLOW.
+ *
+ * Logins are checked by the auth workers, never on the reactor thread.
+ * A worker hands the finished job back through a list beside the outbox
+ * and the same wakeup fd; a failed login is answered with
+ * MSGID_WRONGAUTH and closed like an eviction.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+    #include <sys/eventfd.h>
+#endif
+#include "model.h"
+#include "client.h"
+#include "client_conn.h"
+#include "message.h"
+#include "telemetry.h"
+#include "event_loop.h"
+#include "uring.h"
+#include "handoff.h"
+#include "frame.h"
+#include "write_queue.h"
+#include "shared_frame.h"
+#include "slow_consumer.h"
+#include "tick_arena.h"
+#include "json_encode.h"
+#include "compact_codec.h"
+#include "stream_codec.h"
+#include "auth.h"
+#include "reactor.h"
+
+/* Reactor configuration */
+#define POLL_TIMEOUT_MS 1000
+#define INITIAL_CONN_CAPACITY 64
+
+/* Fan-out target covering every connection of the reactor */
+#define ALL_CLIENTS -1
+
+/* Frame queued by another thread for one client or all of them */
+typedef struct OutboundItem {
+    struct OutboundItem* Next;
+    int ClientID;
+    unsigned Flags;
+    SharedFrame* Frame;
+    SharedFrame* Compact;       /* variant for compact clients, NULL to send Frame to all */
+} OutboundItem;
+
+/* Reactor state */
+struct Reactor {
+    int Index;
+    int Count;
+    int Port;
+    int Socket;
+    EventSource Listener;
+    EventSource Wakeup;
+    int WakeReadFD;
+    int WakeWriteFD;
+    EventLoop* Loop;
+    UringLoop* Ring;
+    ConnPool* Pool;
+    Conn** Conns;
+    int ConnCount;
+    int ConnCapacity;
+    Conn** Dirty;               /* connections with fresh output this flush */
+    int DirtyCount;
+    int DirtyCapacity;
+    size_t HighWater;
+    SlowPolicy Slow;
+    uint64_t Tick;              /* tick frames seen */
+    TickArenaPair* Arenas;      /* inbound envelopes, flipped per tick */
+    bool InputPaused;           /* some connection's input waits for handoff room */
+    int ResumeCursor;
+    Envelope** Deferred;        /* control envelopes the handoff queue had no room for */
+    int DeferredCount;
+    int DeferredCapacity;
+    int CompactClients;         /* connections that negotiated compact bodies, atomic */
+    size_t CompressThreshold;   /* smaller frames skip the stream codec */
+    char* Deflate;              /* compressed frame being built, grows to the largest seen */
+    size_t DeflateCapacity;
+    char* Inflate;              /* frames unpacked from a compressed body, allocated on first use */
+    ClientRegistry* Clients;
+    StatsCollector* Telemetry;
+    HandoffQueue* Inbound;
+    AuthPool* Auth;
+    pthread_t Thread;
+    bool Started;
+    bool Running;
+    pthread_mutex_t OutboxMutex;
+    OutboundItem* OutboxHead;
+    OutboundItem* OutboxTail;
+    AuthJob* CheckedHead;       /* logins back from the auth workers, under OutboxMutex */
+    AuthJob* CheckedTail;
+};
+
+/* Monotonic time in nanoseconds */
+static int64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Create listening socket shared with sibling reactors */
+static int create_listen_socket(int port, bool reuse_port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0) {
+        return -1;
+    }
+
+    int opt = 1;
+    if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
+        close(sock);
+        return -1;
+    }
+#ifdef SO_REUSEPORT
+    if (reuse_port && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0) {
+        close(sock);
+        return -1;
+    }
+#else
+    (void)reuse_port;
+#endif
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(sock, SOMAXCONN) < 0 || !set_nonblocking(sock)) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+/* Create wakeup fd pair */
+static bool create_wakeup(Reactor* reactor) {
+#ifdef __linux__
+    reactor->WakeReadFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    reactor->WakeWriteFD = reactor->WakeReadFD;
+    return reactor->WakeReadFD >= 0;
+#else
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return false;
+    }
+    set_nonblocking(fds[0]);
+    set_nonblocking(fds[1]);
+    reactor->WakeReadFD = fds[0];
+    reactor->WakeWriteFD = fds[1];
+    return true;
+#endif
+}
+
+/* Poke the reactor thread */
+static void wake(Reactor* reactor) {
+#ifdef __linux__
+    uint64_t one = 1;
+    ssize_t ignored = write(reactor->WakeWriteFD, &one, sizeof(one));
+#else
+    char one = 1;
+    ssize_t ignored = write(reactor->WakeWriteFD, &one, sizeof(one));
+#endif
+    (void)ignored;
+}
+
+/* Clear pending wakeups */
+static void drain_wakeup(Reactor* reactor) {
+    char buffer[64];
+    while (read(reactor->WakeReadFD, buffer, sizeof(buffer)) > 0) {
+    }
+}
+
+/* Hold an envelope back until the handoff queue has room, false when out of memory */
+static bool defer_envelope(Reactor* reactor, Envelope* env) {
+    /* A held envelope may outlive its tick, so it must not pin the arena */
+    if (reactor->DeferredCount == reactor->DeferredCapacity) {
+        int capacity = reactor->DeferredCapacity > 0 ? reactor->DeferredCapacity * 2 : 16;
+        Envelope** deferred = (Envelope**)realloc(reactor->Deferred, capacity * sizeof(Envelope*));
+        if (deferred == NULL) {
+            return false;
+        }
+        reactor->Deferred = deferred;
+        reactor->DeferredCapacity = capacity;
+    }
+    Envelope* held = envelope_copy_out(env);
+    if (held == NULL) {
+        return false;
+    }
+    reactor->Deferred[reactor->DeferredCount++] = held;
+    return true;
+}
+
+/* Hand an envelope to the game thread, held back in order while its queue is full */
+static void post_envelope(Reactor* reactor, void* msg, int kind, int from) {
+    Envelope* env = envelope_create(msg, kind, from);
+    if (env == NULL) {
+        free_concrete_message(msg, kind);
+        return;
+    }
+    if (reactor->DeferredCount == 0 && handoff_queue_push(reactor->Inbound, env)) {
+        return;
+    }
+    if (!defer_envelope(reactor, env)) {
+        envelope_discard(env);
+    }
+}
+
+/* Retry held back envelopes, false while the queue is still full */
+static bool post_deferred(Reactor* reactor) {
+    int sent = 0;
+    while (sent < reactor->DeferredCount && handoff_queue_push(reactor->Inbound, reactor->Deferred[sent])) {
+        sent++;
+    }
+    if (sent > 0) {
+        reactor->DeferredCount -= sent;
+        memmove(reactor->Deferred, reactor->Deferred + sent, reactor->DeferredCount * sizeof(Envelope*));
+    }
+    return reactor->DeferredCount == 0;
+}
+
+/* Track connection in the reactor table */
+static bool add_conn(Reactor* reactor, Conn* conn) {
+    if (reactor->ConnCount == reactor->ConnCapacity) {
+        int capacity = reactor->ConnCapacity * 2;
+        Conn** conns = (Conn**)realloc(reactor->Conns, capacity * sizeof(Conn*));
+        if (conns == NULL) {
+            return false;
+        }
+        reactor->Conns = conns;
+        reactor->ConnCapacity = capacity;
+    }
+    conn_set_index(conn, reactor->ConnCount);
+    reactor->Conns[reactor->ConnCount++] = conn;
+    return true;
+}
+
+/* Remove connection from the reactor table */
+static void remove_conn(Reactor* reactor, Conn* conn) {
+    int index = conn_get_index(conn);
+    int last = --reactor->ConnCount;
+    if (index != last) {
+        reactor->Conns[index] = reactor->Conns[last];
+        conn_set_index(reactor->Conns[index], index);
+    }
+    reactor->Conns[last] = NULL;
+
+    /* Queued output marked it dirty, the flush at the end of this pass must not see it */
+    for (int i = 0; i < reactor->DirtyCount; i++) {
+        if (reactor->Dirty[i] == conn) {
+            reactor->Dirty[i--] = reactor->Dirty[--reactor->DirtyCount];
+        }
+    }
+}
+
+/* Share of raw bytes left after compression, in percent */
+static double compression_ratio(int64_t raw, int64_t wire) {
+    return raw > 0 ? 100.0 * (double)wire / (double)raw : 100.0;
+}
+
+/* Print a connection's compression counters and hand them to telemetry */
+static void report_compression(Reactor* reactor, Conn* conn) {
+    const StreamStats* stats = conn_get_stream_stats(conn);
+    stats_collector_record_connection_compression(reactor->Telemetry, stats->RawOut + stats->RawIn,
+                                                  stats->WireOut + stats->WireIn, stats->EncodeNs + stats->DecodeNs);
+    printf("Client %d compression: sent %lld -> %lld bytes (%.1f%%) in %lld us, %lld bytes under threshold; "
+           "received %lld -> %lld bytes (%.1f%%) in %lld us\n",
+           conn_get_client_id(conn), (long long)stats->RawOut, (long long)stats->WireOut,
+           compression_ratio(stats->RawOut, stats->WireOut), (long long)(stats->EncodeNs / 1000),
+           (long long)stats->BypassedOut, (long long)stats->WireIn, (long long)stats->RawIn,
+           compression_ratio(stats->RawIn, stats->WireIn), (long long)(stats->DecodeNs / 1000));
+}
+
+/* Handle client disconnection */
+static void handle_disconnection(Reactor* reactor, Conn* conn) {
+    int client_id = conn_get_client_id(conn);
+    struct ClientInfo* info = client_registry_get_info(reactor->Clients, client_id);
+    if (info != NULL) {
+        printf("Connection closed from %s:%d (ID: %d)\n", info->Address, info->Port, client_id);
+        /* The game only knows clients that logged in */
+        if (client_is_logged_in(client_registry_get(reactor->Clients, client_id))) {
+            post_envelope(reactor, NULL, MSGID_EXIT, client_id);
+        }
+    }
+
+    if (reactor->Ring == NULL) {
+        event_loop_remove(reactor->Loop, conn_get_source(conn));
+    }
+    client_registry_remove(reactor->Clients, client_id);
+    stats_collector_remove_client(reactor->Telemetry);
+    if (conn_is_compact(conn)) {
+        __atomic_sub_fetch(&reactor->CompactClients, 1, __ATOMIC_RELAXED);
+    }
+    if (conn_is_compressed(conn)) {
+        report_compression(reactor, conn);
+    }
+
+    if (reactor->Ring != NULL && conn_wants_write(conn)) {
+        /* The kernel still reads the queued buffers, free when the send completes */
+        conn_set_client_id(conn, -1);
+        conn_mark_closed(conn);
+        shutdown(conn_get_fd(conn), SHUT_RDWR);
+        return;
+    }
+    remove_conn(reactor, conn);
+    conn_free(conn);
+}
+
+/* Close from this side, the read path then sees EOF and tears the connection down */
+static void close_conn(Reactor* reactor, Conn* conn) {
+    conn_mark_closed(conn);
+    shutdown(conn_get_fd(conn), SHUT_RDWR);
+    if (reactor->Ring != NULL) {
+        /* A paused recv has to run again to read the EOF */
+        uring_loop_resume_recv(reactor->Ring, conn_get_recv(conn));
+    }
+}
+
+/* Account for a write, false once the connection is finished with */
+static bool account_write(Reactor* reactor, Conn* conn, size_t written, enum ConnWriteResult result) {
+    if (written > 0) {
+        stats_collector_bytes_sent(reactor->Telemetry, (int64_t)written);
+    }
+
+    if (result == CONN_WRITE_ERROR) {
+        close_conn(reactor, conn);
+        return false;
+    }
+
+    bool pending = result == CONN_WRITE_PENDING;
+    SlowTracker* tracker = conn_get_slow_tracker(conn);
+    if (!pending && slow_tracker_evicting(tracker)) {
+        /* TOOSLOW is in the kernel, finish the eviction */
+        close_conn(reactor, conn);
+        return false;
+    }
+    if (written > 0 || !pending) {
+        slow_tracker_progress(tracker, !pending, monotonic_ns());
+    }
+    if (pending) {
+        slow_tracker_backlog_started(tracker, reactor->Tick, monotonic_ns());
+    }
+    return true;
+}
+
+/* io_uring: hand the queue to the kernel, one send in flight per connection keeps frames in order */
+static void submit_conn(Reactor* reactor, Conn* conn) {
+    struct iovec iov[WRITE_QUEUE_MAX_IOV];
+    int count = conn_gather_output(conn, iov, WRITE_QUEUE_MAX_IOV);
+    if (count == 0) {
+        return;
+    }
+    if (!uring_loop_sendmsg(reactor->Ring, conn_get_fd(conn), iov, count, conn)) {
+        account_write(reactor, conn, 0, CONN_WRITE_ERROR);
+        return;
+    }
+    conn_set_want_write(conn, true);
+    slow_tracker_backlog_started(conn_get_slow_tracker(conn), reactor->Tick, monotonic_ns());
+}
+
+/* Write queued output, arm or disarm writability as the queue fills and drains */
+static void flush_conn(Reactor* reactor, Conn* conn) {
+    if (reactor->Ring != NULL) {
+        /* A send in flight picks up the rest when it completes */
+        if (!conn_wants_write(conn)) {
+            submit_conn(reactor, conn);
+        }
+        return;
+    }
+
+    size_t written = 0;
+    enum ConnWriteResult result = conn_flush(conn, &written);
+    if (!account_write(reactor, conn, written, result)) {
+        return;
+    }
+
+    bool pending = result == CONN_WRITE_PENDING;
+    if (pending != conn_wants_write(conn)) {
+        uint32_t events = pending ? (EVENT_READ | EVENT_WRITE) : EVENT_READ;
+        if (event_loop_modify(reactor->Loop, conn_get_source(conn), events)) {
+            conn_set_want_write(conn, pending);
+        }
+    }
+}
+
+/* Remember a connection whose queue went from empty to non-empty */
+static void mark_dirty(Reactor* reactor, Conn* conn) {
+    if (reactor->DirtyCount == reactor->DirtyCapacity) {
+        int capacity = reactor->DirtyCapacity > 0 ? reactor->DirtyCapacity * 2 : INITIAL_CONN_CAPACITY;
+        Conn** dirty = (Conn**)realloc(reactor->Dirty, capacity * sizeof(Conn*));
+        if (dirty == NULL) {
+            flush_conn(reactor, conn);
+            return;
+        }
+        reactor->Dirty = dirty;
+        reactor->DirtyCapacity = capacity;
+    }
+    reactor->Dirty[reactor->DirtyCount++] = conn;
+}
+
+/* Inbound kinds that may be dropped when the game thread is behind */
+static bool inbound_sheddable(uint32_t kind) {
+    return kind == MSGID_OOCMESSAGE;
+}
+
+/* Envelope for a raw frame, kinds the game thread reads as structs are decoded here, off its path */
+static Envelope* frame_envelope(Reactor* reactor, Conn* conn, const FrameView* frame) {
+    TickArena* arena = tick_arena_pair_current(reactor->Arenas, reactor->Tick);
+    Envelope* env = envelope_create_frame_in(arena, (int)frame->Kind, conn_get_client_id(conn), frame->Body,
+                                             frame->Length);
+    if (env != NULL && frame->Kind == MSGID_HASH) {
+        envelope_set_message(env, message_decode_concrete(MSGID_HASH, frame->Body, frame->Length));
+    }
+    return env;
+}
+
+/* Hand a raw frame to the game thread, false when its queue is full */
+static bool post_frame(Reactor* reactor, Conn* conn, const FrameView* frame) {
+    Envelope* env = frame_envelope(reactor, conn, frame);
+    if (env == NULL) {
+        return true;
+    }
+    if (!handoff_queue_push(reactor->Inbound, env)) {
+        envelope_discard(env);
+        return false;
+    }
+    return true;
+}
+
+/* Set up stream compression, an empty MSGID_COMPRESSED tells the client it may start sending */
+static void enable_compression(Reactor* reactor, Conn* conn) {
+    if (!conn_enable_compression(conn)) {
+        return;
+    }
+    bool was_idle = conn_get_output_bytes(conn) == 0 && !conn_wants_write(conn);
+    if (conn_queue_frame(conn, MSGID_COMPRESSED, NULL, 0) && was_idle) {
+        mark_dirty(reactor, conn);
+    }
+    printf("Client %d switched to compressed frames\n", conn_get_client_id(conn));
+}
+
+/* Switch a client to compact bodies and compressed frames when its login asks for them */
+static void negotiate_protocol(Reactor* reactor, Conn* conn, const MessageLogin* login) {
+    if (!conn_is_compact(conn) && login->Protocol >= COMPACT_PROTOCOL_VERSION) {
+        conn_set_compact(conn, true);
+        __atomic_add_fetch(&reactor->CompactClients, 1, __ATOMIC_RELAXED);
+        printf("Client %d switched to compact bodies\n", conn_get_client_id(conn));
+    }
+    if (!conn_is_compressed(conn) && login->Compression >= STREAM_CODEC_VERSION) {
+        enable_compression(reactor, conn);
+    }
+}
+
+/* Tell a client its login failed, closes once the error is written or the eviction linger ends */
+static void reject_login(Reactor* reactor, Conn* conn, int kind, const char* text) {
+    SlowTracker* tracker = conn_get_slow_tracker(conn);
+    if (slow_tracker_evicting(tracker)) {
+        return;
+    }
+    char encoded[128];
+    size_t length = json_encode_error(encoded, sizeof(encoded), kind, text);
+    slow_tracker_evict(tracker, &reactor->Slow, monotonic_ns());
+    if (length > 0) {
+        conn_queue_output(conn, encoded, length);
+    }
+    flush_conn(reactor, conn);
+}
+
+/* Auth worker finished a job, hand it to the reactor thread */
+static void on_login_checked(AuthJob* job) {
+    Reactor* reactor = (Reactor*)job->Owner;
+    pthread_mutex_lock(&reactor->OutboxMutex);
+    bool was_empty = reactor->OutboxHead == NULL && reactor->CheckedHead == NULL;
+    if (reactor->CheckedTail != NULL) {
+        reactor->CheckedTail->Next = job;
+    } else {
+        reactor->CheckedHead = job;
+    }
+    reactor->CheckedTail = job;
+    pthread_mutex_unlock(&reactor->OutboxMutex);
+    if (was_empty) {
+        wake(reactor);
+    }
+}
+
+/* Tell a client its login went through, maps are not handed out yet */
+static void accept_login(Reactor* reactor, Conn* conn, int client_id) {
+    char encoded[128];
+    size_t length = json_encode_successful_connect(encoded, sizeof(encoded), client_id, "no_map");
+    bool was_idle = conn_get_output_bytes(conn) == 0 && !conn_wants_write(conn);
+    if (length > 0 && conn_queue_output(conn, encoded, length) && was_idle) {
+        mark_dirty(reactor, conn);
+    }
+}
+
+/* Let a logged in client into the game, its frames and broadcasts flow from here on */
+static void admit_client(Reactor* reactor, struct Client* client) {
+    client->State = CLIENT_LOGGED_IN;
+    post_envelope(reactor, NULL, MSGID_NEWCLIENT, client->ID);
+    accept_login(reactor, client->Conn, client->ID);
+}
+
+/* Queue a login for the auth workers, without a pool logins are not checked */
+static void check_login(Reactor* reactor, struct Client* client, const MessageLogin* login) {
+    Conn* conn = client->Conn;
+    if (reactor->Auth == NULL) {
+        admit_client(reactor, client);
+        return;
+    }
+    AuthJob* job = (AuthJob*)calloc(1, sizeof(AuthJob));
+    if (job == NULL) {
+        reject_login(reactor, conn, MSGID_INTERNALSERVERERROR, "out of memory");
+        return;
+    }
+    job->Done = on_login_checked;
+    job->Owner = reactor;
+    job->ClientID = conn_get_client_id(conn);
+    job->IsGuest = login->IsGuest;
+    memcpy(job->Login, login->Login, sizeof(job->Login));
+    memcpy(job->Password, login->Password, sizeof(job->Password));
+    job->Submitted = monotonic_ns();
+    if (!auth_pool_submit(reactor->Auth, job)) {
+        free(job);
+        printf("Login queue full, turning away client %d\n", conn_get_client_id(conn));
+        reject_login(reactor, conn, MSGID_INTERNALSERVERERROR, "too many logins, try again");
+        return;
+    }
+    client->State = CLIENT_AUTHENTICATING;
+}
+
+/* Negotiate and check a login, later logins from the same client are ignored */
+static void handle_login(Reactor* reactor, Conn* conn, const FrameView* frame) {
+    struct Client* client = client_registry_get(reactor->Clients, conn_get_client_id(conn));
+    if (client == NULL || client->State != CLIENT_CONNECTING) {
+        return;
+    }
+    MessageLogin* login = (MessageLogin*)message_decode_concrete(MSGID_LOGIN, frame->Body, frame->Length);
+    if (login == NULL) {
+        return;
+    }
+    negotiate_protocol(reactor, conn, login);
+    check_login(reactor, client, login);
+    free_concrete_message(login, MSGID_LOGIN);
+}
+
+/* Apply logins the auth workers finished, clients gone meanwhile are skipped */
+static void finish_logins(Reactor* reactor, AuthJob* job) {
+    int64_t now = monotonic_ns();
+    while (job != NULL) {
+        AuthJob* next = job->Next;
+        bool ok = job->Result == 0;
+        stats_collector_record_login(reactor->Telemetry, now - job->Submitted, ok, job->Cached);
+
+        struct Client* client = client_registry_get(reactor->Clients, job->ClientID);
+        if (client != NULL && !conn_is_closed(client->Conn)) {
+            const char* name = job->IsGuest ? "guest" : job->Login;
+            if (ok) {
+                struct ClientInfo* info = client_registry_get_info(reactor->Clients, job->ClientID);
+                snprintf(info->Login, sizeof(info->Login), "%s", job->Info.Login);
+                client->IsAdmin = job->Info.IsAdmin;
+                printf("Client %d logged in as %s%s\n", job->ClientID, name, client->IsAdmin ? " (admin)" : "");
+                admit_client(reactor, client);
+            } else {
+                printf("Client %d failed to log in as %s\n", job->ClientID, name);
+                reject_login(reactor, client->Conn, MSGID_WRONGAUTH, NULL);
+            }
+        }
+        free(job);
+        job = next;
+    }
+}
+
+/* Reactor-side bookkeeping for an inbound frame, done once per frame the game thread takes or sheds */
+static void inspect_frame(Reactor* reactor, Conn* conn, const FrameView* frame) {
+    if (frame->Kind == MSGID_HASH) {
+        slow_tracker_hash(conn_get_slow_tracker(conn), reactor->Tick);
+    } else if (frame->Kind == MSGID_LOGIN) {
+        handle_login(reactor, conn, frame);
+    }
+}
+
+/* Until its login passes a client's only frame that gets through is the login */
+static bool frame_admitted(Reactor* reactor, Conn* conn, uint32_t kind) {
+    return kind == MSGID_LOGIN || client_is_logged_in(client_registry_get(reactor->Clients, conn_get_client_id(conn)));
+}
+
+/* Stop reading a client until the game thread's queue has room, TCP pushes back on it */
+static void pause_input(Reactor* reactor, Conn* conn) {
+    SlowTracker* tracker = conn_get_slow_tracker(conn);
+    if (!slow_tracker_input_paused(tracker)) {
+        printf("Game thread queue full, pausing input from client %d\n", conn_get_client_id(conn));
+    }
+    slow_tracker_pause_input(tracker, reactor->Tick);
+    reactor->InputPaused = true;
+    if (reactor->Ring != NULL) {
+        /* Leave the rest in the socket instead of the provided buffers */
+        uring_loop_pause_recv(reactor->Ring, conn_get_recv(conn));
+    }
+}
+
+/*
+ * Unpack a compressed frame and hand the frames inside to the game
+ * thread, false when the body is corrupt. The decoder cannot rewind, so
+ * frames the queue has no room for are deferred rather than left in the
+ * input buffer; *deferred tells the caller to pause the client.
+ */
+static bool post_inflated(Reactor* reactor, Conn* conn, const FrameView* compressed, bool* deferred) {
+    *deferred = false;
+    if (!conn_is_compressed(conn)) {
+        return false;
+    }
+    if (reactor->Inflate == NULL) {
+        reactor->Inflate = (char*)malloc(STREAM_CODEC_INFLATE_MAX);
+        if (reactor->Inflate == NULL) {
+            return false;
+        }
+    }
+
+    size_t length = 0;
+    int64_t started = monotonic_ns();
+    if (!stream_decode(conn_get_decoder(conn), compressed->Body, compressed->Length, reactor->Inflate,
+                       STREAM_CODEC_INFLATE_MAX, &length)) {
+        return false;
+    }
+    int64_t elapsed = monotonic_ns() - started;
+    int64_t wire = FRAME_HEADER_SIZE + (int64_t)compressed->Length;
+    StreamStats* stats = conn_get_stream_stats(conn);
+    stats->RawIn += (int64_t)length;
+    stats->WireIn += wire;
+    stats->DecodeNs += elapsed;
+    stats_collector_record_compression(reactor->Telemetry, (int64_t)length, wire, elapsed);
+
+    FrameReader reader;
+    FrameView frame;
+    enum FrameResult result;
+    frame_reader_init(&reader, reactor->Inflate, length, length);
+    while ((result = frame_reader_next(&reader, &frame)) == FRAME_OK) {
+        if (frame.Kind == MSGID_COMPRESSED) {
+            return false;
+        }
+        if (!frame_admitted(reactor, conn, frame.Kind)) {
+            continue;
+        }
+        inspect_frame(reactor, conn, &frame);
+        if (!*deferred && post_frame(reactor, conn, &frame)) {
+            continue;
+        }
+        if (inbound_sheddable(frame.Kind)) {
+            stats_collector_record_slow(reactor->Telemetry, 0, 1, 0);
+            continue;
+        }
+        Envelope* env = frame_envelope(reactor, conn, &frame);
+        if (env != NULL && !defer_envelope(reactor, env)) {
+            envelope_discard(env);
+        }
+        *deferred = true;
+    }
+    return result == FRAME_INCOMPLETE && frame_reader_consumed(&reader) == length;
+}
+
+/* Process incoming messages, extracts every complete frame in the buffer */
+static void process_messages(Reactor* reactor, Conn* conn) {
+    const char* data = conn_get_buffer(conn);
+    size_t used = conn_get_buffer_used(conn);
+    size_t start = 0;
+
+    /* Clients open with the protocol version before any frame */
+    if (!conn_is_handshaken(conn)) {
+        if (used < FRAME_PROTOCOL_VERSION_SIZE) {
+            return;
+        }
+        if (memcmp(data, FRAME_PROTOCOL_VERSION, FRAME_PROTOCOL_VERSION_SIZE) != 0) {
+            printf("Protocol version mismatch from %s:%d\n", conn_get_addr(conn), conn_get_port(conn));
+            conn_mark_closed(conn);
+            return;
+        }
+        conn_set_handshaken(conn, true);
+        start = FRAME_PROTOCOL_VERSION_SIZE;
+    }
+
+    SlowTracker* tracker = conn_get_slow_tracker(conn);
+    FrameReader reader;
+    FrameView frame;
+    enum FrameResult result;
+    size_t consumed = 0;
+    frame_reader_init(&reader, data + start, used - start, conn_get_buffer_capacity(conn) - start);
+    while ((result = frame_reader_next(&reader, &frame)) == FRAME_OK) {
+        if (slow_tracker_evicting(tracker)) {
+            /* On its way out, its input no longer reaches the game */
+            consumed = frame_reader_consumed(&reader);
+            continue;
+        }
+        if (frame.Kind != MSGID_COMPRESSED && !frame_admitted(reactor, conn, frame.Kind)) {
+            /* Not logged in yet, dropped before it reaches the game */
+            consumed = frame_reader_consumed(&reader);
+            continue;
+        }
+        if (frame.Kind == MSGID_COMPRESSED) {
+            bool deferred = false;
+            if (!post_inflated(reactor, conn, &frame, &deferred)) {
+                printf("Bad compressed frame from %s:%d, closing\n", conn_get_addr(conn), conn_get_port(conn));
+                conn_mark_closed(conn);
+                return;
+            }
+            consumed = frame_reader_consumed(&reader);
+            if (deferred) {
+                pause_input(reactor, conn);
+                conn_consume_buffer(conn, start + consumed);
+                return;
+            }
+            continue;
+        }
+        if (!post_frame(reactor, conn, &frame)) {
+            if (!inbound_sheddable(frame.Kind)) {
+                /* Keep the frame buffered and stop reading, it is inspected once it goes through */
+                pause_input(reactor, conn);
+                conn_consume_buffer(conn, start + consumed);
+                return;
+            }
+            stats_collector_record_slow(reactor->Telemetry, 0, 1, 0);
+        }
+        inspect_frame(reactor, conn, &frame);
+        consumed = frame_reader_consumed(&reader);
+    }
+    slow_tracker_resume_input(tracker);
+
+    if (result != FRAME_INCOMPLETE) {
+        printf("Bad frame from %s:%d, closing\n", conn_get_addr(conn), conn_get_port(conn));
+        conn_mark_closed(conn);
+        return;
+    }
+
+    /* Drop everything parsed in one move */
+    conn_consume_buffer(conn, start + frame_reader_consumed(&reader));
+}
+
+/* Replace the backlog with MSGID_TOOSLOW, a partially written frame is kept so the stream stays parseable */
+static void queue_eviction_notice(Conn* conn) {
+    char encoded[JSON_ENCODE_INT_FRAME_MAX];
+    size_t length = json_encode_error(encoded, sizeof(encoded), MSGID_TOOSLOW, NULL);
+    conn_discard_output(conn);
+    conn_queue_output(conn, encoded, length);
+}
+
+/* Tell a client it fell behind, closes once TOOSLOW is written or the linger ends */
+static void evict_conn(Reactor* reactor, Conn* conn, const char* reason) {
+    SlowTracker* tracker = conn_get_slow_tracker(conn);
+    if (slow_tracker_evicting(tracker)) {
+        return;
+    }
+    printf("Client %d is too slow (%s), evicting\n", conn_get_client_id(conn), reason);
+    stats_collector_record_slow(reactor->Telemetry, 0, 0, 1);
+    slow_tracker_evict(tracker, &reactor->Slow, monotonic_ns());
+
+    if (reactor->Ring != NULL && conn_wants_write(conn)) {
+        /* The kernel still reads the queued buffers */
+        tracker->NoticePending = true;
+        return;
+    }
+    queue_eviction_notice(conn);
+    flush_conn(reactor, conn);
+}
+
+/* Edge-triggered: keep reading until the socket is drained or input is paused */
+static void read_conn(Reactor* reactor, Conn* conn) {
+    SlowTracker* tracker = conn_get_slow_tracker(conn);
+    enum ConnReadResult result = CONN_READ_FULL;
+    while (result == CONN_READ_FULL && !slow_tracker_input_paused(tracker)) {
+        size_t bytes = 0;
+        result = conn_read(conn, &bytes);
+        if (bytes > 0) {
+            stats_collector_bytes_received(reactor->Telemetry, (int64_t)bytes);
+            process_messages(reactor, conn);
+        }
+    }
+
+    if (result == CONN_READ_CLOSED || conn_is_closed(conn)) {
+        handle_disconnection(reactor, conn);
+    }
+}
+
+/* Client socket became ready */
+static void on_client_event(EventLoop* loop, EventSource* source, uint32_t events) {
+    Reactor* reactor = (Reactor*)event_loop_get_data(loop);
+    Conn* conn = conn_from_source(source);
+
+    if (events & EVENT_ERROR) {
+        conn_mark_closed(conn);
+    }
+
+    if ((events & EVENT_WRITE) && !conn_is_closed(conn)) {
+        flush_conn(reactor, conn);
+        if (!(events & (EVENT_READ | EVENT_HANGUP | EVENT_ERROR)) && !conn_is_closed(conn)) {
+            return;
+        }
+    }
+
+    read_conn(reactor, conn);
+}
+
+/* Set up bookkeeping for an accepted socket, takes ownership of fd */
+static Conn* register_connection(Reactor* reactor, int client_fd, const struct sockaddr_in* addr) {
+    char addr_str[64];
+    inet_ntop(AF_INET, &addr->sin_addr, addr_str, sizeof(addr_str));
+
+    Conn* conn = conn_pool_acquire(reactor->Pool, client_fd);
+    if (conn == NULL) {
+        close(client_fd);
+        return NULL;
+    }
+    conn_update_addr(conn, addr_str, ntohs(addr->sin_port));
+    conn_set_high_water(conn, reactor->HighWater);
+    slow_tracker_init(conn_get_slow_tracker(conn), reactor->Tick, monotonic_ns());
+
+    int client_id = client_registry_register(reactor->Clients, addr_str, ntohs(addr->sin_port), "", false);
+    struct Client* client = client_registry_get(reactor->Clients, client_id);
+    if (client == NULL || !add_conn(reactor, conn)) {
+        client_registry_remove(reactor->Clients, client_id);
+        conn_free(conn);
+        return NULL;
+    }
+    client->Conn = conn;
+    conn_set_client_id(conn, client_id);
+
+    stats_collector_add_client(reactor->Telemetry);
+    printf("New connection from %s:%d (ID: %d, reactor %d)\n", addr_str, ntohs(addr->sin_port), client_id,
+           reactor->Index);
+    return conn;
+}
+
+/* Accept new connections */
+static void accept_connections(Reactor* reactor) {
+    for (;;) {
+        struct sockaddr_in addr;
+        socklen_t addrlen = sizeof(addr);
+
+        int client_fd = accept(reactor->Socket, (struct sockaddr*)&addr, &addrlen);
+        if (client_fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* EAGAIN means the backlog is drained */
+            break;
+        }
+
+        if (!set_nonblocking(client_fd)) {
+            close(client_fd);
+            continue;
+        }
+
+        Conn* conn = register_connection(reactor, client_fd, &addr);
+        if (conn == NULL) {
+            continue;
+        }
+
+        event_source_init(conn_get_source(conn), client_fd, on_client_event);
+        if (!event_loop_add(reactor->Loop, conn_get_source(conn), EVENT_READ)) {
+            handle_disconnection(reactor, conn);
+        }
+    }
+}
+
+/* Queue a frame through the connection's encoder, frames under the threshold go as they are */
+static bool queue_compressed(Reactor* reactor, Conn* conn, SharedFrame* frame) {
+    StreamStats* stats = conn_get_stream_stats(conn);
+    size_t length = shared_frame_length(frame);
+    if (length < reactor->CompressThreshold) {
+        stats->BypassedOut += (int64_t)length;
+        stats_collector_record_bypass(reactor->Telemetry, (int64_t)length);
+        return conn_queue_shared(conn, frame);
+    }
+
+    size_t bound = stream_encode_bound(length);
+    if (bound > reactor->DeflateCapacity) {
+        char* deflate = (char*)realloc(reactor->Deflate, bound);
+        if (deflate == NULL) {
+            /* Uncompressed frames are always valid on the stream */
+            return conn_queue_shared(conn, frame);
+        }
+        reactor->Deflate = deflate;
+        reactor->DeflateCapacity = bound;
+    }
+
+    int64_t started = monotonic_ns();
+    size_t written = stream_encode(conn_get_encoder(conn), shared_frame_data(frame), length, reactor->Deflate,
+                                   reactor->DeflateCapacity);
+    int64_t elapsed = monotonic_ns() - started;
+    int64_t wire = FRAME_HEADER_SIZE + (int64_t)written;
+    stats->RawOut += (int64_t)length;
+    stats->WireOut += wire;
+    stats->EncodeNs += elapsed;
+    stats_collector_record_compression(reactor->Telemetry, (int64_t)length, wire, elapsed);
+    return conn_queue_frame(conn, MSGID_COMPRESSED, reactor->Deflate, (uint32_t)written);
+}
+
+/* Queue a frame reference on one connection */
+static void deliver(Reactor* reactor, Conn* conn, SharedFrame* frame, unsigned flags) {
+    if (conn == NULL || conn_is_closed(conn)) {
+        return;
+    }
+    enum SlowLevel level = conn_get_slow_tracker(conn)->Level;
+    if (level == SLOW_EVICT || (level == SLOW_DROP && (flags & REACTOR_FRAME_NONESSENTIAL))) {
+        stats_collector_record_slow(reactor->Telemetry, 0, 1, 0);
+        return;
+    }
+    /* An empty queue that is not armed or sending cannot already be in the dirty list */
+    bool was_idle = conn_get_output_bytes(conn) == 0 && !conn_wants_write(conn);
+    bool queued = conn_is_compressed(conn) ? queue_compressed(reactor, conn, frame) : conn_queue_shared(conn, frame);
+    if (!queued) {
+        evict_conn(reactor, conn, "over the send high-water mark");
+    } else if (was_idle) {
+        mark_dirty(reactor, conn);
+    }
+}
+
+/* Retry input held back while the game thread's queue was full */
+static void resume_input(Reactor* reactor) {
+    if (!post_deferred(reactor)) {
+        return;
+    }
+    reactor->InputPaused = false;
+
+    /* Start one further each pass, so no connection is always last in line */
+    int count = reactor->ConnCount;
+    for (int n = 0; n < count; n++) {
+        Conn* conn = reactor->Conns[(reactor->ResumeCursor + n) % count];
+        if (!slow_tracker_input_paused(conn_get_slow_tracker(conn)) || conn_is_closed(conn)) {
+            continue;
+        }
+        process_messages(reactor, conn);
+        if (slow_tracker_input_paused(conn_get_slow_tracker(conn))) {
+            continue;
+        }
+        if (conn_is_closed(conn)) {
+            /* Either backend then reads EOF and tears the connection down */
+            close_conn(reactor, conn);
+        } else if (reactor->Ring == NULL) {
+            /* Edge-triggered: re-arming reports data left in the socket as a fresh event */
+            event_loop_rearm(reactor->Loop, conn_get_source(conn));
+        } else if (!uring_loop_resume_recv(reactor->Ring, conn_get_recv(conn))) {
+            /* No submission entry to spare, retried on the next pass */
+            slow_tracker_pause_input(conn_get_slow_tracker(conn), reactor->Tick);
+            reactor->InputPaused = true;
+        }
+    }
+    reactor->ResumeCursor = count > 0 ? (reactor->ResumeCursor + 1) % count : 0;
+}
+
+/* Apply the slow consumer policy to every connection, once per tick */
+static void check_slow_consumers(Reactor* reactor) {
+    int64_t now = monotonic_ns();
+    for (int i = 0; i < reactor->ConnCount; i++) {
+        Conn* conn = reactor->Conns[i];
+        SlowTracker* tracker = conn_get_slow_tracker(conn);
+        if (slow_tracker_evicting(tracker)) {
+            if (now >= tracker->EvictDeadline && tracker->EvictDeadline != 0) {
+                /* The client did not read TOOSLOW in time */
+                tracker->EvictDeadline = 0;
+                close_conn(reactor, conn);
+            }
+            continue;
+        }
+        if (conn_is_closed(conn) || !conn_is_handshaken(conn)) {
+            continue;
+        }
+        SlowSample sample;
+        slow_tracker_sample(tracker, conn_get_output_bytes(conn), reactor->Tick, now, &sample);
+        enum SlowLevel level = slow_policy_assess(&reactor->Slow, &sample);
+        if (level == SLOW_EVICT) {
+            evict_conn(reactor, conn, "policy threshold");
+            continue;
+        }
+        if (level > tracker->Level) {
+            printf("Client %d is slow (%s): %lld bytes queued for %lld ticks, stalled %lld ms, "
+                   "%lld ticks since hash\n",
+                   conn_get_client_id(conn), slow_level_name(level), (long long)sample.QueueBytes,
+                   (long long)sample.QueueTicks, (long long)sample.StallMs, (long long)sample.HashTicks);
+            stats_collector_record_slow(reactor->Telemetry, 1, 0, 0);
+        }
+        tracker->Level = level;
+    }
+}
+
+/* Move frames queued by the game thread onto connections, then flush each once */
+static void flush_outbox(Reactor* reactor) {
+    pthread_mutex_lock(&reactor->OutboxMutex);
+    OutboundItem* item = reactor->OutboxHead;
+    reactor->OutboxHead = NULL;
+    reactor->OutboxTail = NULL;
+    AuthJob* checked = reactor->CheckedHead;
+    reactor->CheckedHead = NULL;
+    reactor->CheckedTail = NULL;
+    pthread_mutex_unlock(&reactor->OutboxMutex);
+
+    bool ticked = false;
+    while (item != NULL) {
+        OutboundItem* next = item->Next;
+        if (item->Flags & REACTOR_FRAME_TICK) {
+            reactor->Tick++;
+            ticked = true;
+        }
+        if (item->ClientID == ALL_CLIENTS) {
+            /* Live clients are packed, fan-out walks one array */
+            int count = client_registry_count(reactor->Clients);
+            for (int i = 0; i < count; i++) {
+                struct Client* client = client_registry_at(reactor->Clients, i);
+                if (client_is_logged_in(client)) {
+                    bool compact = item->Compact != NULL && conn_is_compact(client->Conn);
+                    deliver(reactor, client->Conn, compact ? item->Compact : item->Frame, item->Flags);
+                }
+            }
+        } else {
+            struct Client* client = client_registry_get(reactor->Clients, item->ClientID);
+            if (client != NULL) {
+                deliver(reactor, client->Conn, item->Frame, item->Flags);
+            }
+        }
+        shared_frame_release(item->Frame);
+        shared_frame_release(item->Compact);
+        free(item);
+        item = next;
+    }
+    finish_logins(reactor, checked);
+
+    for (int i = 0; i < reactor->DirtyCount; i++) {
+        if (!conn_is_closed(reactor->Dirty[i])) {
+            flush_conn(reactor, reactor->Dirty[i]);
+        }
+    }
+    reactor->DirtyCount = 0;
+
+    /* Every tick wakes the reactor, so paused input is retried at least that often */
+    if (reactor->InputPaused || reactor->DeferredCount > 0) {
+        resume_input(reactor);
+    }
+
+    /* Measured after the flush, so only output the socket refused counts */
+    if (ticked) {
+        check_slow_consumers(reactor);
+    }
+}
+
+/* Listening socket became ready */
+static void on_listener_event(EventLoop* loop, EventSource* source, uint32_t events) {
+    (void)source;
+    (void)events;
+    accept_connections((Reactor*)event_loop_get_data(loop));
+}
+
+/* Wakeup fd became ready */
+static void on_wakeup_event(EventLoop* loop, EventSource* source, uint32_t events) {
+    (void)source;
+    (void)events;
+    Reactor* reactor = (Reactor*)event_loop_get_data(loop);
+    drain_wakeup(reactor);
+    flush_outbox(reactor);
+}
+
+/* io_uring: connection accepted by multishot accept */
+static void on_uring_accept(UringLoop* ring, int client_fd) {
+    Reactor* reactor = (Reactor*)uring_loop_get_data(ring);
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+
+    memset(&addr, 0, sizeof(addr));
+    getpeername(client_fd, (struct sockaddr*)&addr, &addrlen);
+
+    Conn* conn = register_connection(reactor, client_fd, &addr);
+    if (conn == NULL) {
+        return;
+    }
+    UringRecv* recv = uring_loop_recv(ring, client_fd, conn);
+    if (recv == NULL) {
+        handle_disconnection(reactor, conn);
+        return;
+    }
+    conn_set_recv(conn, recv);
+}
+
+/* io_uring: data landed in a provided buffer, false leaves it with the ring until input resumes */
+static bool on_uring_recv(UringLoop* ring, void* owner, const char* data, size_t length) {
+    Reactor* reactor = (Reactor*)uring_loop_get_data(ring);
+    Conn* conn = (Conn*)owner;
+
+    if (conn_is_closed(conn)) {
+        /* Already shut down, drain until EOF */
+        stats_collector_bytes_received(reactor->Telemetry, (int64_t)length);
+        return true;
+    }
+    if (conn_add_buffer(conn, data, length) == 0) {
+        process_messages(reactor, conn);
+        if (!conn_is_closed(conn) && conn_add_buffer(conn, data, length) == 0) {
+            if (slow_tracker_input_paused(conn_get_slow_tracker(conn))) {
+                /* Waiting for the game thread, not an overrun */
+                return false;
+            }
+            conn_mark_closed(conn);
+        }
+    }
+    stats_collector_bytes_received(reactor->Telemetry, (int64_t)length);
+    if (!conn_is_closed(conn)) {
+        process_messages(reactor, conn);
+    }
+    if (conn_is_closed(conn)) {
+        /* Protocol error or overrun, the recv completes with EOF and tears down */
+        shutdown(conn_get_fd(conn), SHUT_RDWR);
+    } else if (!slow_tracker_input_paused(conn_get_slow_tracker(conn))) {
+        /* Data queued before a pause can drain it, take the recv off pause too */
+        uring_loop_resume_recv(ring, conn_get_recv(conn));
+    }
+    return true;
+}
+
+/* io_uring: multishot recv finished for good */
+static void on_uring_closed(UringLoop* ring, void* owner) {
+    Conn* conn = (Conn*)owner;
+    conn_set_recv(conn, NULL);
+    handle_disconnection((Reactor*)uring_loop_get_data(ring), conn);
+}
+
+/* io_uring: a queued send completed */
+static void on_uring_sent(UringLoop* ring, void* owner, int result) {
+    Reactor* reactor = (Reactor*)uring_loop_get_data(ring);
+    Conn* conn = (Conn*)owner;
+
+    conn_set_want_write(conn, false);
+    if (conn_get_client_id(conn) < 0) {
+        /* Disconnected while the send was in flight */
+        remove_conn(reactor, conn);
+        conn_free(conn);
+        return;
+    }
+    if (conn_is_closed(conn)) {
+        return;
+    }
+
+    size_t written = result > 0 ? (size_t)result : 0;
+    conn_advance_output(conn, written);
+    SlowTracker* tracker = conn_get_slow_tracker(conn);
+    if (tracker->NoticePending) {
+        tracker->NoticePending = false;
+        queue_eviction_notice(conn);
+    }
+
+    enum ConnWriteResult status = result < 0 ? CONN_WRITE_ERROR
+                                  : conn_get_output_bytes(conn) > 0 ? CONN_WRITE_PENDING : CONN_WRITE_DONE;
+    if (account_write(reactor, conn, written, status) && status == CONN_WRITE_PENDING) {
+        submit_conn(reactor, conn);
+    }
+}
+
+/* io_uring: wakeup fd became readable */
+static void on_uring_ready(UringLoop* ring, void* owner) {
+    Reactor* reactor = (Reactor*)owner;
+    (void)ring;
+    drain_wakeup(reactor);
+    flush_outbox(reactor);
+}
+
+/* Create new reactor */
+Reactor* reactor_create(const ReactorConfig* config) {
+    if (config == NULL) {
+        return NULL;
+    }
+
+    Reactor* reactor = (Reactor*)malloc(sizeof(Reactor));
+    if (reactor == NULL) {
+        return NULL;
+    }
+    memset(reactor, 0, sizeof(Reactor));
+    reactor->Index = config->Index;
+    reactor->Count = config->Count > 0 ? config->Count : 1;
+    reactor->Port = config->Port;
+    reactor->Telemetry = config->Telemetry;
+    reactor->Inbound = config->Inbound;
+    reactor->Auth = config->Auth;
+    reactor->HighWater = config->HighWater;
+    reactor->Slow = config->Slow;
+    reactor->CompressThreshold = config->CompressThreshold > 0 ? config->CompressThreshold
+                                                               : STREAM_CODEC_DEFAULT_THRESHOLD;
+    reactor->WakeReadFD = -1;
+    reactor->WakeWriteFD = -1;
+    pthread_mutex_init(&reactor->OutboxMutex, NULL);
+
+    reactor->Socket = create_listen_socket(reactor->Port, reactor->Count > 1);
+    reactor->Conns = (Conn**)calloc(INITIAL_CONN_CAPACITY, sizeof(Conn*));
+    reactor->ConnCapacity = INITIAL_CONN_CAPACITY;
+    reactor->Pool = conn_pool_create(INITIAL_CONN_CAPACITY);
+    reactor->Clients = client_registry_create_partition(reactor->Index, reactor->Count);
+    reactor->Arenas = tick_arena_pair_create(TICK_ARENA_DEFAULT_CHUNK);
+    if (reactor->Socket < 0 || reactor->Conns == NULL || reactor->Pool == NULL || reactor->Clients == NULL ||
+        reactor->Arenas == NULL || !create_wakeup(reactor)) {
+        reactor_free(reactor);
+        return NULL;
+    }
+
+    /* Optional io_uring backend, falls back to epoll when unsupported */
+    if (config->UseUring) {
+        static const UringCallbacks callbacks = {
+            on_uring_accept,
+            on_uring_recv,
+            on_uring_closed,
+            on_uring_ready,
+            on_uring_sent
+        };
+        reactor->Ring = uring_loop_create(URING_DEFAULT_ENTRIES, &callbacks, reactor);
+        if (reactor->Ring == NULL) {
+            fprintf(stderr, "Reactor %d: io_uring not available, using epoll\n", reactor->Index);
+        }
+    }
+
+    if (reactor->Ring != NULL) {
+        if (!uring_loop_accept(reactor->Ring, reactor->Socket) ||
+            !uring_loop_watch(reactor->Ring, reactor->WakeReadFD, reactor)) {
+            reactor_free(reactor);
+            return NULL;
+        }
+        return reactor;
+    }
+
+    reactor->Loop = event_loop_create(EVENT_LOOP_DEFAULT_BATCH);
+    if (reactor->Loop == NULL) {
+        reactor_free(reactor);
+        return NULL;
+    }
+    event_loop_set_data(reactor->Loop, reactor);
+    event_source_init(&reactor->Listener, reactor->Socket, on_listener_event);
+    event_source_init(&reactor->Wakeup, reactor->WakeReadFD, on_wakeup_event);
+    if (!event_loop_add(reactor->Loop, &reactor->Listener, EVENT_READ) ||
+        !event_loop_add(reactor->Loop, &reactor->Wakeup, EVENT_READ)) {
+        reactor_free(reactor);
+        return NULL;
+    }
+    return reactor;
+}
+
+/* Free reactor */
+void reactor_free(Reactor* reactor) {
+    if (reactor != NULL) {
+        reactor_stop(reactor);
+        for (int i = 0; i < reactor->ConnCount; i++) {
+            conn_free(reactor->Conns[i]);
+        }
+        free(reactor->Conns);
+        free(reactor->Dirty);
+        free(reactor->Deflate);
+        free(reactor->Inflate);
+        conn_pool_free(reactor->Pool);
+        if (reactor->Socket >= 0) {
+            close(reactor->Socket);
+        }
+        if (reactor->WakeReadFD >= 0) {
+            close(reactor->WakeReadFD);
+        }
+        if (reactor->WakeWriteFD >= 0 && reactor->WakeWriteFD != reactor->WakeReadFD) {
+            close(reactor->WakeWriteFD);
+        }
+        event_loop_free(reactor->Loop);
+        uring_loop_free(reactor->Ring);
+        client_registry_free(reactor->Clients);
+        for (int i = 0; i < reactor->DeferredCount; i++) {
+            envelope_discard(reactor->Deferred[i]);
+        }
+        free(reactor->Deferred);
+        tick_arena_pair_free(reactor->Arenas);
+
+        OutboundItem* item = reactor->OutboxHead;
+        while (item != NULL) {
+            OutboundItem* next = item->Next;
+            shared_frame_release(item->Frame);
+            shared_frame_release(item->Compact);
+            free(item);
+            item = next;
+        }
+        AuthJob* job = reactor->CheckedHead;
+        while (job != NULL) {
+            AuthJob* next = job->Next;
+            free(job);
+            job = next;
+        }
+        pthread_mutex_destroy(&reactor->OutboxMutex);
+        free(reactor);
+    }
+}
+
+/* Reactor thread body */
+static void* reactor_thread(void* arg) {
+    Reactor* reactor = (Reactor*)arg;
+
+    /* Signals are for the game thread */
+    sigset_t mask;
+    sigfillset(&mask);
+    pthread_sigmask(SIG_BLOCK, &mask, NULL);
+
+    while (__atomic_load_n(&reactor->Running, __ATOMIC_ACQUIRE)) {
+        /* Only ready sockets are dispatched, idle clients cost nothing */
+        int result = reactor->Ring != NULL ? uring_loop_run_once(reactor->Ring, POLL_TIMEOUT_MS)
+                                           : event_loop_poll(reactor->Loop, POLL_TIMEOUT_MS);
+        if (result < 0) {
+            perror("reactor");
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* Start reactor thread */
+bool reactor_start(Reactor* reactor) {
+    if (reactor == NULL || reactor->Started) {
+        return false;
+    }
+    __atomic_store_n(&reactor->Running, true, __ATOMIC_RELEASE);
+    if (pthread_create(&reactor->Thread, NULL, reactor_thread, reactor) != 0) {
+        reactor->Running = false;
+        return false;
+    }
+    reactor->Started = true;
+    return true;
+}
+
+/* Stop reactor thread */
+void reactor_stop(Reactor* reactor) {
+    if (reactor != NULL && reactor->Started) {
+        __atomic_store_n(&reactor->Running, false, __ATOMIC_RELEASE);
+        wake(reactor);
+        pthread_join(reactor->Thread, NULL);
+        reactor->Started = false;
+    }
+}
+
+/* Append to the outbox and wake the reactor, takes a reference */
+static bool enqueue_outbound(Reactor* reactor, int client_id, SharedFrame* frame, SharedFrame* compact,
+                             unsigned flags) {
+    OutboundItem* item = (OutboundItem*)malloc(sizeof(OutboundItem));
+    if (item == NULL) {
+        return false;
+    }
+    item->Next = NULL;
+    item->ClientID = client_id;
+    item->Flags = flags;
+    item->Frame = shared_frame_retain(frame);
+    item->Compact = shared_frame_retain(compact);
+
+    pthread_mutex_lock(&reactor->OutboxMutex);
+    bool was_empty = reactor->OutboxHead == NULL;
+    if (reactor->OutboxTail != NULL) {
+        reactor->OutboxTail->Next = item;
+    } else {
+        reactor->OutboxHead = item;
+    }
+    reactor->OutboxTail = item;
+    pthread_mutex_unlock(&reactor->OutboxMutex);
+
+    /* One wakeup per batch is enough, the reactor drains the whole list */
+    if (was_empty) {
+        wake(reactor);
+    }
+    return true;
+}
+
+/* Queue bytes for a client */
+bool reactor_send(Reactor* reactor, int client_id, const void* data, size_t length) {
+    if (reactor == NULL || data == NULL || length == 0) {
+        return false;
+    }
+    SharedFrame* frame = shared_frame_copy(data, length);
+    if (frame == NULL) {
+        return false;
+    }
+    bool queued = enqueue_outbound(reactor, client_id, frame, NULL, 0);
+    shared_frame_release(frame);
+    return queued;
+}
+
+/* Queue a shared frame for a client */
+bool reactor_send_shared(Reactor* reactor, int client_id, SharedFrame* frame) {
+    if (reactor == NULL || frame == NULL) {
+        return false;
+    }
+    return enqueue_outbound(reactor, client_id, frame, NULL, 0);
+}
+
+/* Queue a shared frame for every client of the reactor */
+bool reactor_broadcast(Reactor* reactor, SharedFrame* frame, unsigned flags) {
+    if (reactor == NULL || frame == NULL) {
+        return false;
+    }
+    return enqueue_outbound(reactor, ALL_CLIENTS, frame, NULL, flags);
+}
+
+/* Queue a frame for every client, compact clients get the compact variant */
+bool reactor_broadcast_encoded(Reactor* reactor, SharedFrame* frame, SharedFrame* compact, unsigned flags) {
+    if (reactor == NULL || frame == NULL) {
+        return false;
+    }
+    return enqueue_outbound(reactor, ALL_CLIENTS, frame, compact, flags);
+}
+
+/* Get compact client count */
+int reactor_compact_clients(Reactor* reactor) {
+    return reactor != NULL ? __atomic_load_n(&reactor->CompactClients, __ATOMIC_RELAXED) : 0;
+}
+
+/* Check backend */
+bool reactor_is_uring(Reactor* reactor) {
+    return reactor != NULL && reactor->Ring != NULL;
+}
+
+/* Reactor owning a client id */
+int reactor_index_for_client(int client_id, int count) {
+    return count > 0 && client_id >= 0 ? client_id % count : 0;
+}
@@ -0,0 +1,66 @@
+/*
+ * Luminous Locus Reactor Header
+ */
+
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "handoff.h"
+#include "telemetry.h"
+#include "shared_frame.h"
+#include "slow_consumer.h"
+#include "auth.h"
+
+/* Broadcast flags */
+#define REACTOR_FRAME_TICK 0x1          /* advances the reactor's tick count */
+#define REACTOR_FRAME_NONESSENTIAL 0x2  /* may be shed for slow clients */
+
+/* Reactor thread */
+typedef struct Reactor Reactor;
+
+/* Reactor configuration */
+typedef struct ReactorConfig {
+    int Index;                  /* this reactor, 0..Count-1 */
+    int Count;                  /* total reactors, also the client id stride */
+    int Port;
+    bool UseUring;
+    StatsCollector* Telemetry;
+    HandoffQueue* Inbound;      /* decoded traffic for the game thread */
+    size_t HighWater;           /* queued bytes per client before it is dropped, 0 for default */
+    SlowPolicy Slow;            /* slow consumer thresholds */
+    size_t CompressThreshold;   /* smaller frames skip stream compression, 0 for default */
+    AuthPool* Auth;             /* checks logins, NULL lets every login through */
+} ReactorConfig;
+
+/* Create reactor, binds its own SO_REUSEPORT listening socket */
+Reactor* reactor_create(const ReactorConfig* config);
+
+/* Free reactor, stops it first */
+void reactor_free(Reactor* reactor);
+
+/* Start/stop the reactor thread */
+bool reactor_start(Reactor* reactor);
+void reactor_stop(Reactor* reactor);
+
+/* Queue bytes for a client owned by this reactor, callable from any thread */
+bool reactor_send(Reactor* reactor, int client_id, const void* data, size_t length);
+
+/* Queue a reference to an encoded frame, for one client or all of the reactor's */
+bool reactor_send_shared(Reactor* reactor, int client_id, SharedFrame* frame);
+bool reactor_broadcast(Reactor* reactor, SharedFrame* frame, unsigned flags);
+
+/* Broadcast with a compact-body variant for clients that negotiated it */
+bool reactor_broadcast_encoded(Reactor* reactor, SharedFrame* frame, SharedFrame* compact, unsigned flags);
+
+/* Clients on compact bodies, callable from any thread */
+int reactor_compact_clients(Reactor* reactor);
+
+/* Backend in use */
+bool reactor_is_uring(Reactor* reactor);
+
+/* Reactor owning a client id */
+int reactor_index_for_client(int client_id, int count);
+
+#endif /* REACTOR_H */
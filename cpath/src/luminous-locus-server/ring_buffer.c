@@ -0,0 +1,202 @@
+/*
+ * Luminous Locus Ring Buffer Module
+ * Growable power-of-two byte ring for connection input
+ *
+ * Consuming only moves the head, so draining many small pipelined frames
+ * costs nothing per frame. The ring doubles when a large message does not
+ * fit and drops back to its minimum size as soon as it is empty.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "ring_buffer.h"
+
+/* Round up to a power of two */
+static size_t round_pow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+/* Reverse bytes in place */
+static void reverse_bytes(char* data, size_t length) {
+    if (length < 2) {
+        return;
+    }
+    size_t i = 0;
+    size_t j = length - 1;
+    while (i < j) {
+        char tmp = data[i];
+        data[i++] = data[j];
+        data[j--] = tmp;
+    }
+}
+
+/* Move wrapped readable bytes to offset 0 */
+static void linearize(RingBuffer* ring) {
+    size_t first = ring->Capacity - ring->Head;
+    size_t second = ring->Used - first;
+    if (first <= ring->Head - second) {
+        /* Room to shift the wrapped part right, then copy the tail in front */
+        memmove(ring->Data + first, ring->Data, second);
+        memcpy(ring->Data, ring->Data + ring->Head, first);
+    } else {
+        /* Rotate left by Head without extra storage */
+        reverse_bytes(ring->Data, ring->Head);
+        reverse_bytes(ring->Data + ring->Head, ring->Capacity - ring->Head);
+        reverse_bytes(ring->Data, ring->Capacity);
+    }
+    ring->Head = 0;
+}
+
+/* Swap storage for a buffer of the given size, contents are kept */
+static bool resize(RingBuffer* ring, size_t capacity) {
+    char* data = (char*)malloc(capacity);
+    if (data == NULL) {
+        return false;
+    }
+    size_t first = ring->Capacity - ring->Head;
+    if (ring->Used <= first) {
+        memcpy(data, ring->Data + ring->Head, ring->Used);
+    } else {
+        memcpy(data, ring->Data + ring->Head, first);
+        memcpy(data + first, ring->Data, ring->Used - first);
+    }
+    free(ring->Data);
+    ring->Data = data;
+    ring->Capacity = capacity;
+    ring->Head = 0;
+    return true;
+}
+
+/* Init ring */
+bool ring_buffer_init(RingBuffer* ring, size_t min_capacity, size_t max_capacity) {
+    if (ring == NULL || min_capacity == 0) {
+        return false;
+    }
+    ring->MinCapacity = round_pow2(min_capacity);
+    ring->MaxCapacity = round_pow2(max_capacity > min_capacity ? max_capacity : min_capacity);
+    ring->Capacity = ring->MinCapacity;
+    ring->Head = 0;
+    ring->Used = 0;
+    ring->Data = (char*)malloc(ring->Capacity);
+    return ring->Data != NULL;
+}
+
+/* Destroy ring */
+void ring_buffer_destroy(RingBuffer* ring) {
+    if (ring != NULL) {
+        free(ring->Data);
+        ring->Data = NULL;
+        ring->Capacity = 0;
+        ring->Head = 0;
+        ring->Used = 0;
+    }
+}
+
+/* Get used bytes */
+size_t ring_buffer_used(const RingBuffer* ring) {
+    return ring != NULL ? ring->Used : 0;
+}
+
+/* Get current capacity */
+size_t ring_buffer_capacity(const RingBuffer* ring) {
+    return ring != NULL ? ring->Capacity : 0;
+}
+
+/* Get capacity limit */
+size_t ring_buffer_max_capacity(const RingBuffer* ring) {
+    return ring != NULL ? ring->MaxCapacity : 0;
+}
+
+/* Get contiguous free region */
+char* ring_buffer_write_space(RingBuffer* ring, size_t* length) {
+    if (ring == NULL || ring->Used == ring->Capacity) {
+        *length = 0;
+        return NULL;
+    }
+    size_t mask = ring->Capacity - 1;
+    size_t tail = (ring->Head + ring->Used) & mask;
+    if (ring->Head + ring->Used < ring->Capacity) {
+        *length = ring->Capacity - tail;
+    } else {
+        *length = ring->Head - tail;
+    }
+    return ring->Data + tail;
+}
+
+/* Commit written bytes */
+void ring_buffer_commit(RingBuffer* ring, size_t length) {
+    if (ring != NULL && length <= ring->Capacity - ring->Used) {
+        ring->Used += length;
+    }
+}
+
+/* Grow ring */
+bool ring_buffer_grow(RingBuffer* ring) {
+    if (ring == NULL || ring->Capacity >= ring->MaxCapacity) {
+        return false;
+    }
+    return resize(ring, ring->Capacity * 2);
+}
+
+/* Append data */
+bool ring_buffer_append(RingBuffer* ring, const char* data, size_t length) {
+    if (ring == NULL) {
+        return false;
+    }
+    while (ring->Capacity - ring->Used < length) {
+        if (!ring_buffer_grow(ring)) {
+            return false;
+        }
+    }
+    while (length > 0) {
+        size_t space = 0;
+        char* out = ring_buffer_write_space(ring, &space);
+        size_t chunk = length < space ? length : space;
+        memcpy(out, data, chunk);
+        ring->Used += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+    return true;
+}
+
+/* Get readable bytes */
+const char* ring_buffer_peek(RingBuffer* ring) {
+    if (ring == NULL) {
+        return NULL;
+    }
+    if (ring->Head + ring->Used > ring->Capacity) {
+        linearize(ring);
+    }
+    return ring->Data + ring->Head;
+}
+
+/* Consume bytes */
+size_t ring_buffer_consume(RingBuffer* ring, size_t length) {
+    if (ring == NULL || length > ring->Used) {
+        return 0;
+    }
+    ring->Head = (ring->Head + length) & (ring->Capacity - 1);
+    ring->Used -= length;
+    if (ring->Used == 0) {
+        ring->Head = 0;
+        if (ring->Capacity > ring->MinCapacity) {
+            /* Idle again, give back what a large message needed */
+            resize(ring, ring->MinCapacity);
+        }
+    }
+    return length;
+}
+
+/* Clear ring */
+void ring_buffer_clear(RingBuffer* ring) {
+    if (ring != NULL) {
+        ring_buffer_consume(ring, ring->Used);
+    }
+}
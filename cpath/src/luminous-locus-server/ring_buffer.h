@@ -0,0 +1,51 @@
+/*
+ * Luminous Locus Ring Buffer Header
+ */
+
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Byte ring, capacity is always a power of two between MinCapacity and MaxCapacity */
+typedef struct RingBuffer {
+    char* Data;
+    size_t Capacity;
+    size_t Head;          /* offset of the first readable byte */
+    size_t Used;
+    size_t MinCapacity;
+    size_t MaxCapacity;
+} RingBuffer;
+
+/* Init ring, sizes are rounded up to powers of two */
+bool ring_buffer_init(RingBuffer* ring, size_t min_capacity, size_t max_capacity);
+
+/* Release storage */
+void ring_buffer_destroy(RingBuffer* ring);
+
+/* Sizes */
+size_t ring_buffer_used(const RingBuffer* ring);
+size_t ring_buffer_capacity(const RingBuffer* ring);
+size_t ring_buffer_max_capacity(const RingBuffer* ring);
+
+/* Contiguous free region after the readable bytes, commit what was written */
+char* ring_buffer_write_space(RingBuffer* ring, size_t* length);
+void ring_buffer_commit(RingBuffer* ring, size_t length);
+
+/* Copy bytes in, growing if needed, false past the maximum */
+bool ring_buffer_append(RingBuffer* ring, const char* data, size_t length);
+
+/* Double the capacity, false at the maximum */
+bool ring_buffer_grow(RingBuffer* ring);
+
+/* Readable bytes as one contiguous block, rotates only when they wrap */
+const char* ring_buffer_peek(RingBuffer* ring);
+
+/* Drop bytes from the front, shrinks back to the minimum once empty */
+size_t ring_buffer_consume(RingBuffer* ring, size_t length);
+
+/* Drop everything */
+void ring_buffer_clear(RingBuffer* ring);
+
+#endif /* RING_BUFFER_H */
@@ -9,6 +9,7 @@
  * - Tick-based game loop
  */
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,15 +24,22 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <arpa/inet.h>
-#include <sys/select.h>
 #include <signal.h>
+#include "event_loop.h"
+#include "frame.h"
+#include "write_queue.h"
+#include "shared_frame.h"
+#include "tick_clock.h"
+#include "model.h"
 
 /* Server configuration */
 #define DEFAULT_PORT 1111
 #define DEFAULT_METRICS_PORT 9095
 #define DEFAULT_SERVER_URL "http://localhost:8011/"
 #define DEFAULT_TICK_INTERVAL 100
-#define DEFAULT_MAX_CLIENTS 64
+#define DEFAULT_MAX_CLIENTS 4096
+#define POLL_TIMEOUT_MS 50
+#define CLIENT_BUFFER_SIZE 8192
 #define DEFAULT_DUMPS_ROOT "./dumps"
 #define DEFAULT_DB_ROOT "./db"
 
@@ -56,6 +64,7 @@ typedef struct {
     int metrics_fd;
     char server_url[256];
     int tick_interval;
+    size_t write_high_water;
     char dumps_root[256];
     char db_root[256];
     bool running;
@@ -65,6 +74,8 @@ typedef struct {
 
 /* Client structure */
 typedef struct {
+    EventSource source;  /* must stay first, the event loop hands it back */
+    int slot;
     int fd;
     char address[64];
     int port;
@@ -74,12 +85,17 @@ typedef struct {
     uint64_t bytes_received;
     uint64_t bytes_sent;
     float pos_x, pos_y, pos_z;
+    bool handshaken;
+    char inbuf[CLIENT_BUFFER_SIZE];
+    size_t inbuf_used;
+    WriteQueue outq;
+    bool want_write;
     pthread_mutex_t client_mutex;
 } client_t;
 
-/* Message structure */
+/* Message structure, data points into the client buffer */
 typedef struct {
-    uint8_t type;
+    uint32_t type;
     uint32_t length;
     char* data;
 } message_t;
@@ -89,6 +105,11 @@ static server_state_t g_server;
 static client_t* g_clients[DEFAULT_MAX_CLIENTS];
 static int g_num_clients = 0;
 static pthread_mutex_t g_clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+static EventLoop* g_loop = NULL;
+static EventSource g_listener;
+static EventSource g_tick_source;
+static TickClock* g_tick_clock = NULL;
+static SharedFrame* g_newtick_frame = NULL;
 
 /* Initialize server state */
 void server_init(void) {
@@ -96,6 +117,7 @@ void server_init(void) {
     g_server.listen_fd = -1;
     g_server.metrics_fd = -1;
     g_server.tick_interval = DEFAULT_TICK_INTERVAL;
+    g_server.write_high_water = WRITE_QUEUE_DEFAULT_HIGH_WATER;
     g_server.running = false;
     g_server.start_time = time(NULL);
     strcpy(g_server.server_url, DEFAULT_SERVER_URL);
@@ -131,7 +153,8 @@ int create_server_socket(int port) {
         return -1;
     }
     
-    listen(fd, 10);
+    listen(fd, SOMAXCONN);
+    set_nonblocking(fd);
     return fd;
 }
 
@@ -140,9 +163,11 @@ client_t* server_accept_client(int server_fd) {
     struct sockaddr_in addr;
     socklen_t addrlen = sizeof(addr);
     
-    int client_fd = accept(server_fd, (struct sockaddr*)&addr, &addrlen);
+    int client_fd = accept4(server_fd, (struct sockaddr*)&addr, &addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (client_fd < 0) {
-        perror("accept");
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            perror("accept");
+        }
         return NULL;
     }
     
@@ -155,11 +180,13 @@ client_t* server_accept_client(int server_fd) {
             client = malloc(sizeof(client_t));
             if (client) {
                 memset(client, 0, sizeof(client_t));
+                client->slot = i;
                 client->fd = client_fd;
                 strcpy(client->address, inet_ntoa(addr.sin_addr));
                 client->port = ntohs(addr.sin_port);
                 client->state = CLIENT_STATE_CONNECTING;
                 client->last_activity = time(NULL);
+                write_queue_init(&client->outq, g_server.write_high_water);
                 pthread_mutex_init(&client->client_mutex, NULL);
                 g_clients[i] = client;
                 g_num_clients++;
@@ -169,9 +196,84 @@ client_t* server_accept_client(int server_fd) {
     }
     
     pthread_mutex_unlock(&g_clients_mutex);
+    
+    if (client == NULL) {
+        close(client_fd);
+    }
     return client;
 }
 
+/* Drop client connection */
+static void server_remove_client(client_t* client) {
+    event_loop_remove(g_loop, &client->source);
+    
+    pthread_mutex_lock(&g_clients_mutex);
+    g_clients[client->slot] = NULL;
+    g_num_clients--;
+    pthread_mutex_unlock(&g_clients_mutex);
+    
+    close(client->fd);
+    write_queue_destroy(&client->outq);
+    pthread_mutex_destroy(&client->client_mutex);
+    free(client);
+}
+
+/* Drop a client that cannot keep up, the hangup event removes it */
+static void server_drop_slow_client(client_t* client) {
+    client->state = CLIENT_STATE_DISCONNECTED;
+    shutdown(client->fd, SHUT_RDWR);
+}
+
+/* Watch for writability while output is queued */
+static void server_arm_write(client_t* client) {
+    if (!client->want_write && event_loop_modify(g_loop, &client->source, EVENT_READ | EVENT_WRITE)) {
+        client->want_write = true;
+    }
+}
+
+/* Write queued output, never blocks */
+static void server_flush_client(client_t* client) {
+    size_t written = 0;
+    enum WriteQueueResult result = write_queue_flush(&client->outq, client->fd, &written);
+    client->bytes_sent += written;
+    
+    if (result == WRITE_QUEUE_ERROR) {
+        client->state = CLIENT_STATE_DISCONNECTED;
+    } else if (result == WRITE_QUEUE_DONE && client->want_write) {
+        if (event_loop_modify(g_loop, &client->source, EVENT_READ)) {
+            client->want_write = false;
+        }
+    }
+}
+
+/* Queue one framed message */
+static void send_frame(client_t* client, uint32_t type, const char* data, uint32_t length) {
+    if (client->state == CLIENT_STATE_DISCONNECTED) {
+        return;
+    }
+    if (!write_queue_push_frame(&client->outq, type, data, length)) {
+        server_drop_slow_client(client);
+        return;
+    }
+    server_arm_write(client);
+}
+
+/* Queue one shared frame on every authenticated client */
+static void server_broadcast_frame(SharedFrame* frame) {
+    pthread_mutex_lock(&g_clients_mutex);
+    for (int i = 0; i < DEFAULT_MAX_CLIENTS; i++) {
+        client_t* client = g_clients[i];
+        if (client && client->state == CLIENT_STATE_AUTHENTICATED) {
+            if (write_queue_push_shared(&client->outq, frame)) {
+                server_arm_write(client);
+            } else {
+                server_drop_slow_client(client);
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_clients_mutex);
+}
+
 /* Handle client message */
 void handle_client_message(client_t* client, message_t* msg) {
     client->last_activity = time(NULL);
@@ -179,23 +281,24 @@ void handle_client_message(client_t* client, message_t* msg) {
     switch (msg->type) {
         case MSG_TYPE_PING:
             /* Send pong response */
-            message_t pong = { MSG_TYPE_PONG, 0, NULL };
-            send(client->fd, &pong, sizeof(pong), 0);
+            send_frame(client, MSG_TYPE_PONG, NULL, 0);
             break;
             
-        case MSG_TYPE_CHAT:
-            /* Broadcast chat message */
-            pthread_mutex_lock(&g_clients_mutex);
-            for (int i = 0; i < DEFAULT_MAX_CLIENTS; i++) {
-                if (g_clients[i] && g_clients[i]->state == CLIENT_STATE_AUTHENTICATED) {
-                    send(g_clients[i]->fd, msg, sizeof(message_t) + msg->length, 0);
-                }
+        case MSG_TYPE_CHAT: {
+            /* Broadcast chat message, encoded once and enqueued by reference */
+            SharedFrame* chat = shared_frame_create(msg->type, msg->data, msg->length);
+            if (chat != NULL) {
+                server_broadcast_frame(chat);
+                shared_frame_release(chat);
             }
-            pthread_mutex_unlock(&g_clients_mutex);
             break;
+        }
             
         case MSG_TYPE_POSITION:
             /* Update client position */
+            if (msg->length < 3 * sizeof(float)) {
+                break;
+            }
             memcpy(&client->pos_x, msg->data, sizeof(float));
             memcpy(&client->pos_y, msg->data + sizeof(float), sizeof(float));
             memcpy(&client->pos_z, msg->data + 2 * sizeof(float), sizeof(float));
@@ -203,33 +306,154 @@ void handle_client_message(client_t* client, message_t* msg) {
     }
 }
 
-/* Process client */
-void server_process_client(client_t* client) {
-    char buffer[1024];
-    ssize_t bytes = recv(client->fd, buffer, sizeof(buffer), 0);
+/* Extract complete frames from the client buffer */
+static void server_parse_frames(client_t* client) {
+    size_t start = 0;
     
-    if (bytes <= 0) {
-        /* Client disconnected */
-        return;
+    /* Protocol version comes first */
+    if (!client->handshaken) {
+        if (client->inbuf_used < FRAME_PROTOCOL_VERSION_SIZE) {
+            return;
+        }
+        if (memcmp(client->inbuf, FRAME_PROTOCOL_VERSION, FRAME_PROTOCOL_VERSION_SIZE) != 0) {
+            client->state = CLIENT_STATE_DISCONNECTED;
+            return;
+        }
+        client->handshaken = true;
+        start = FRAME_PROTOCOL_VERSION_SIZE;
     }
     
-    client->bytes_received += bytes;
-    client->last_activity = time(NULL);
+    FrameReader reader;
+    FrameView frame;
+    enum FrameResult result;
+    frame_reader_init(&reader, client->inbuf + start, client->inbuf_used - start, sizeof(client->inbuf) - start);
+    while ((result = frame_reader_next(&reader, &frame)) == FRAME_OK) {
+        message_t msg = { frame.Kind, frame.Length, (char*)frame.Body };
+        handle_client_message(client, &msg);
+    }
     
-    /* Parse message */
-    message_t* msg = (message_t*)buffer;
-    handle_client_message(client, msg);
+    if (result != FRAME_INCOMPLETE) {
+        /* Oversized or malformed frame */
+        client->state = CLIENT_STATE_DISCONNECTED;
+        return;
+    }
+    
+    /* Keep the partial tail for the next read */
+    size_t consumed = start + frame_reader_consumed(&reader);
+    memmove(client->inbuf, client->inbuf + consumed, client->inbuf_used - consumed);
+    client->inbuf_used -= consumed;
+}
+
+/* Process client */
+void server_process_client(client_t* client) {
+    /* Edge-triggered: drain the socket until EAGAIN */
+    while (client->state != CLIENT_STATE_DISCONNECTED) {
+        ssize_t bytes = recv(client->fd, client->inbuf + client->inbuf_used,
+                             sizeof(client->inbuf) - client->inbuf_used, 0);
+        
+        if (bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (bytes <= 0) {
+            /* Client disconnected */
+            client->state = CLIENT_STATE_DISCONNECTED;
+            return;
+        }
+        
+        client->bytes_received += bytes;
+        client->last_activity = time(NULL);
+        client->inbuf_used += (size_t)bytes;
+        
+        /* A frame may span reads, a read may carry many frames */
+        server_parse_frames(client);
+    }
 }
 
-/* Broadcast to all clients */
+/* Broadcast to all clients, data is already framed */
 void server_broadcast(void* data, size_t length) {
-    pthread_mutex_lock(&g_clients_mutex);
-    for (int i = 0; i < DEFAULT_MAX_CLIENTS; i++) {
-        if (g_clients[i] && g_clients[i]->state == CLIENT_STATE_AUTHENTICATED) {
-            send(g_clients[i]->fd, data, length, 0);
+    SharedFrame* frame = shared_frame_copy(data, length);
+    if (frame != NULL) {
+        server_broadcast_frame(frame);
+        shared_frame_release(frame);
+    }
+}
+
+/* Client socket became ready */
+static void on_client_event(EventLoop* loop, EventSource* source, uint32_t events) {
+    (void)loop;
+    client_t* client = (client_t*)source;
+    
+    if ((events & EVENT_WRITE) && client->state != CLIENT_STATE_DISCONNECTED) {
+        server_flush_client(client);
+    }
+    if (events & (EVENT_READ | EVENT_HANGUP | EVENT_ERROR)) {
+        server_process_client(client);
+    }
+    if (client->state == CLIENT_STATE_DISCONNECTED) {
+        printf("Client left: %s:%d\n", client->address, client->port);
+        server_remove_client(client);
+    }
+}
+
+/* Listening socket became ready */
+static void on_listener_event(EventLoop* loop, EventSource* source, uint32_t events) {
+    (void)events;
+    
+    /* Edge-triggered: accept until the backlog is empty */
+    for (;;) {
+        client_t* client = server_accept_client(source->FD);
+        if (client == NULL) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            continue;
         }
+        
+        event_source_init(&client->source, client->fd, on_client_event);
+        if (!event_loop_add(loop, &client->source, EVENT_READ)) {
+            server_remove_client(client);
+            continue;
+        }
+        printf("New client: %s:%d\n", client->address, client->port);
+    }
+}
+
+/* Run one game tick */
+static void server_tick(int64_t now) {
+    tick_clock_begin(g_tick_clock, now);
+    server_broadcast_frame(g_newtick_frame);
+    tick_clock_end(g_tick_clock, tick_clock_now());
+    
+    TickStats stats;
+    tick_clock_get_stats(g_tick_clock, &stats);
+    if (stats.LastDuration > tick_clock_interval(g_tick_clock)) {
+        printf("Tick %llu overran: %lld us\n", (unsigned long long)stats.Ticks,
+               (long long)(stats.LastDuration / 1000));
     }
-    pthread_mutex_unlock(&g_clients_mutex);
+}
+
+/* Tick timer fired, the tick itself runs after dispatch */
+static void on_tick_event(EventLoop* loop, EventSource* source, uint32_t events) {
+    (void)loop;
+    (void)source;
+    (void)events;
+    tick_clock_drain_timer(g_tick_clock);
+}
+
+/* Poll timeout that wakes up for the next tick when there is no timer fd */
+static int server_poll_timeout(void) {
+    if (g_tick_source.FD >= 0) {
+        return POLL_TIMEOUT_MS;
+    }
+    int64_t wait = tick_clock_deadline(g_tick_clock) - tick_clock_now();
+    if (wait <= 0) {
+        return 0;
+    }
+    int64_t wait_ms = (wait + 999999) / 1000000;
+    return wait_ms < POLL_TIMEOUT_MS ? (int)wait_ms : POLL_TIMEOUT_MS;
 }
 
 /* Main server loop */
@@ -242,51 +466,40 @@ void server_run(const char* listen_addr, int port) {
         return;
     }
     
-    g_server.running = true;
+    g_loop = event_loop_create(EVENT_LOOP_DEFAULT_BATCH);
+    if (g_loop == NULL) {
+        fprintf(stderr, "Failed to create event loop\n");
+        return;
+    }
+    
+    event_source_init(&g_listener, g_server.listen_fd, on_listener_event);
+    event_loop_add(g_loop, &g_listener, EVENT_READ);
+    
+    /* Fixed-rate ticks on absolute deadlines */
+    g_tick_clock = tick_clock_create(g_server.tick_interval);
+    g_newtick_frame = shared_frame_create(MSGID_NEWTICK, "{}", 2);
+    if (g_tick_clock == NULL || g_newtick_frame == NULL) {
+        fprintf(stderr, "Failed to create tick clock\n");
+        return;
+    }
+    event_source_init(&g_tick_source, tick_clock_timer_fd(g_tick_clock), on_tick_event);
+    if (g_tick_source.FD >= 0 && !event_loop_add(g_loop, &g_tick_source, EVENT_READ)) {
+        g_tick_source.FD = -1;
+    }
     
-    fd_set read_fds;
-    int max_fd = g_server.listen_fd;
+    g_server.running = true;
     
     while (g_server.running) {
-        FD_ZERO(&read_fds);
-        FD_SET(g_server.listen_fd, &read_fds);
-        
-        pthread_mutex_lock(&g_clients_mutex);
-        for (int i = 0; i < DEFAULT_MAX_CLIENTS; i++) {
-            if (g_clients[i]) {
-                FD_SET(g_clients[i]->fd, &read_fds);
-                if (g_clients[i]->fd > max_fd) {
-                    max_fd = g_clients[i]->fd;
-                }
-            }
-        }
-        pthread_mutex_unlock(&g_clients_mutex);
-        
-        struct timeval tv;
-        tv.tv_sec = 0;
-        tv.tv_usec = 50000; /* 50ms timeout */
-        
-        int ret = select(max_fd + 1, &read_fds, NULL, NULL, &tv);
-        if (ret < 0) {
-            if (errno == EINTR) continue;
-            perror("select");
+        /* O(ready) dispatch, no per-iteration walk over the client table */
+        if (event_loop_poll(g_loop, server_poll_timeout()) < 0) {
+            perror("epoll_wait");
             break;
         }
         
-        if (FD_ISSET(g_server.listen_fd, &read_fds)) {
-            client_t* client = server_accept_client(g_server.listen_fd);
-            if (client) {
-                printf("New client: %s:%d\n", client->address, client->port);
-            }
-        }
-        
-        pthread_mutex_lock(&g_clients_mutex);
-        for (int i = 0; i < DEFAULT_MAX_CLIENTS; i++) {
-            if (g_clients[i] && FD_ISSET(g_clients[i]->fd, &read_fds)) {
-                server_process_client(g_clients[i]);
-            }
+        int64_t now = tick_clock_now();
+        if (tick_clock_due(g_tick_clock, now)) {
+            server_tick(now);
         }
-        pthread_mutex_unlock(&g_clients_mutex);
     }
 }
 
@@ -318,6 +531,7 @@ void server_stop(void) {
     for (int i = 0; i < DEFAULT_MAX_CLIENTS; i++) {
         if (g_clients[i]) {
             close(g_clients[i]->fd);
+            write_queue_destroy(&g_clients[i]->outq);
             pthread_mutex_destroy(&g_clients[i]->client_mutex);
             free(g_clients[i]);
             g_clients[i] = NULL;
@@ -325,6 +539,24 @@ void server_stop(void) {
     }
     pthread_mutex_unlock(&g_clients_mutex);
     
+    event_loop_free(g_loop);
+    g_loop = NULL;
+    
+    if (g_tick_clock != NULL) {
+        TickStats stats;
+        tick_clock_get_stats(g_tick_clock, &stats);
+        if (stats.Ticks > 0) {
+            printf("Ticks: %llu (missed %llu), lateness avg %lld us max %lld us, duration max %lld us\n",
+                   (unsigned long long)stats.Ticks, (unsigned long long)stats.Missed,
+                   (long long)(stats.TotalLateness / (int64_t)stats.Ticks / 1000),
+                   (long long)(stats.MaxLateness / 1000), (long long)(stats.MaxDuration / 1000));
+        }
+        tick_clock_free(g_tick_clock);
+        g_tick_clock = NULL;
+    }
+    shared_frame_release(g_newtick_frame);
+    g_newtick_frame = NULL;
+    
     pthread_mutex_destroy(&g_server.state_mutex);
 }
 
@@ -343,6 +575,9 @@ int main(int argc, char* argv[]) {
     printf("Luminous Locus C Server\n");
     printf("========================\n\n");
     
+    /* Initialize server, options below override the defaults */
+    server_init();
+    
     /* Parse arguments */
     int port = DEFAULT_PORT;
     const char* listen_addr = "0.0.0.0";
@@ -354,12 +589,15 @@ int main(int argc, char* argv[]) {
             port = atoi(argv[++i]);
         } else if (strcmp(argv[i], "--tick-interval") == 0 && i + 1 < argc) {
             g_server.tick_interval = atoi(argv[++i]);
+            if (g_server.tick_interval <= 0) {
+                g_server.tick_interval = DEFAULT_TICK_INTERVAL;
+            }
+        } else if (strcmp(argv[i], "--high-water") == 0 && i + 1 < argc) {
+            long value = atol(argv[++i]);
+            g_server.write_high_water = value > 0 ? (size_t)value : WRITE_QUEUE_DEFAULT_HIGH_WATER;
         }
     }
     
-    /* Initialize server */
-    server_init();
-    
     /* Start metrics server thread */
     pthread_t metrics_thread;
     int metrics_port = DEFAULT_METRICS_PORT;
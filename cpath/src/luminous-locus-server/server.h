@@ -61,7 +61,7 @@ struct client {
 
 /* Message structure */
 struct message {
-    uint8_t type;
+    uint32_t type;
     uint32_t length;
     char* data;
 };
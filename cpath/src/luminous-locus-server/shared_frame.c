@@ -0,0 +1,86 @@
+/*
+ * Luminous Locus Shared Frame Module
+ * Encode-once, reference-counted frames for fan-out
+ *
+ * A broadcast is serialized into one SharedFrame and every recipient's
+ * write queue holds a reference instead of a copy. The last queue to
+ * finish writing it frees the frame. Frames are never modified once a
+ * second reference exists.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "frame.h"
+#include "shared_frame.h"
+
+struct SharedFrame {
+    int RefCount;
+    size_t Length;
+    char Data[];
+};
+
+/* Allocate frame */
+SharedFrame* shared_frame_alloc(size_t length) {
+    SharedFrame* frame = (SharedFrame*)malloc(sizeof(SharedFrame) + length);
+    if (frame == NULL) {
+        return NULL;
+    }
+    frame->RefCount = 1;
+    frame->Length = length;
+    return frame;
+}
+
+/* Get writable data, only valid before the frame is shared */
+char* shared_frame_mutable_data(SharedFrame* frame) {
+    return frame != NULL ? frame->Data : NULL;
+}
+
+/* Create frame */
+SharedFrame* shared_frame_create(uint32_t kind, const void* body, uint32_t length) {
+    SharedFrame* frame = shared_frame_alloc(FRAME_HEADER_SIZE + (size_t)length);
+    if (frame == NULL) {
+        return NULL;
+    }
+    frame_write_header(frame->Data, kind, length);
+    if (length > 0) {
+        memcpy(frame->Data + FRAME_HEADER_SIZE, body, length);
+    }
+    return frame;
+}
+
+/* Copy encoded bytes */
+SharedFrame* shared_frame_copy(const void* data, size_t length) {
+    SharedFrame* frame = shared_frame_alloc(length);
+    if (frame != NULL && length > 0) {
+        memcpy(frame->Data, data, length);
+    }
+    return frame;
+}
+
+/* Add reference */
+SharedFrame* shared_frame_retain(SharedFrame* frame) {
+    if (frame != NULL) {
+        __atomic_add_fetch(&frame->RefCount, 1, __ATOMIC_RELAXED);
+    }
+    return frame;
+}
+
+/* Drop reference */
+void shared_frame_release(SharedFrame* frame) {
+    if (frame != NULL && __atomic_sub_fetch(&frame->RefCount, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(frame);
+    }
+}
+
+/* Get data */
+const char* shared_frame_data(const SharedFrame* frame) {
+    return frame != NULL ? frame->Data : NULL;
+}
+
+/* Get length */
+size_t shared_frame_length(const SharedFrame* frame) {
+    return frame != NULL ? frame->Length : 0;
+}
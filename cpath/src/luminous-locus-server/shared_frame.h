@@ -0,0 +1,33 @@
+/*
+ * Luminous Locus Shared Frame Header
+ */
+
+#ifndef SHARED_FRAME_H
+#define SHARED_FRAME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Immutable encoded frame shared by every queue it is sent to */
+typedef struct SharedFrame SharedFrame;
+
+/* Encode a protocol v2 frame once, the caller holds the first reference */
+SharedFrame* shared_frame_create(uint32_t kind, const void* body, uint32_t length);
+
+/* Wrap already encoded bytes */
+SharedFrame* shared_frame_copy(const void* data, size_t length);
+
+/* Allocate an empty frame of length bytes to be filled before it is shared */
+SharedFrame* shared_frame_alloc(size_t length);
+char* shared_frame_mutable_data(SharedFrame* frame);
+
+/* Reference counting, safe across threads */
+SharedFrame* shared_frame_retain(SharedFrame* frame);
+void shared_frame_release(SharedFrame* frame);
+
+/* Encoded bytes */
+const char* shared_frame_data(const SharedFrame* frame);
+size_t shared_frame_length(const SharedFrame* frame);
+
+#endif /* SHARED_FRAME_H */
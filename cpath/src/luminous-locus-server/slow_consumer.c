@@ -0,0 +1,187 @@
+/*
+ * Luminous Locus Slow Consumer Module
+ * Detection and escalation policy for clients that cannot keep up
+ *
+ * A connection is measured on four metrics every tick; the worst one
+ * decides its level. Levels escalate from a log line, to shedding
+ * nonessential traffic such as OOC chat, to eviction with MSGID_TOOSLOW.
+ * Tick frames are never shed, a lockstep client cannot skip them. An
+ * evicted client gets a short linger to read TOOSLOW before it is cut.
+ * Input held back because the game thread's queue was full counts as
+ * waiting traffic too, so a stalled client escalates the same way.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "slow_consumer.h"
+
+/* Defaults at a 100 ms tick */
+#define DEFAULT_EVICT_BYTES (1024 * 1024)
+#define DEFAULT_EVICT_TICKS 50
+#define DEFAULT_EVICT_STALL_MS 10000
+#define DEFAULT_EVICT_HASH_TICKS 300
+#define DEFAULT_EVICT_LINGER_MS 2000
+
+/* Set thresholds */
+void slow_thresholds_scale(SlowThresholds* thresholds, int64_t evict) {
+    if (thresholds != NULL) {
+        thresholds->Evict = evict > 0 ? evict : 0;
+        thresholds->Drop = thresholds->Evict / 2;
+        thresholds->Warn = thresholds->Evict / 4;
+    }
+}
+
+/* Default policy */
+void slow_policy_defaults(SlowPolicy* policy) {
+    if (policy != NULL) {
+        slow_thresholds_scale(&policy->QueueBytes, DEFAULT_EVICT_BYTES);
+        slow_thresholds_scale(&policy->QueueTicks, DEFAULT_EVICT_TICKS);
+        slow_thresholds_scale(&policy->StallMs, DEFAULT_EVICT_STALL_MS);
+        slow_thresholds_scale(&policy->HashTicks, DEFAULT_EVICT_HASH_TICKS);
+        policy->EvictLingerMs = DEFAULT_EVICT_LINGER_MS;
+    }
+}
+
+/* Level for one metric */
+static enum SlowLevel assess_metric(const SlowThresholds* thresholds, int64_t value) {
+    if (thresholds->Evict > 0 && value >= thresholds->Evict) {
+        return SLOW_EVICT;
+    }
+    if (thresholds->Drop > 0 && value >= thresholds->Drop) {
+        return SLOW_DROP;
+    }
+    if (thresholds->Warn > 0 && value >= thresholds->Warn) {
+        return SLOW_WARN;
+    }
+    return SLOW_OK;
+}
+
+/* Assess sample */
+enum SlowLevel slow_policy_assess(const SlowPolicy* policy, const SlowSample* sample) {
+    if (policy == NULL || sample == NULL) {
+        return SLOW_OK;
+    }
+    enum SlowLevel levels[4] = {
+        assess_metric(&policy->QueueBytes, sample->QueueBytes),
+        assess_metric(&policy->QueueTicks, sample->QueueTicks),
+        assess_metric(&policy->HashTicks, sample->HashTicks),
+        assess_metric(&policy->StallMs, sample->StallMs),
+    };
+    enum SlowLevel worst = SLOW_OK;
+    for (int i = 0; i < 4; i++) {
+        if (levels[i] > worst) {
+            worst = levels[i];
+        }
+    }
+    return worst;
+}
+
+/* Init tracker */
+void slow_tracker_init(SlowTracker* tracker, uint64_t tick, int64_t now) {
+    if (tracker != NULL) {
+        tracker->Backlogged = false;
+        tracker->BacklogSinceTick = tick;
+        tracker->LastProgress = now;
+        tracker->LastHashTick = tick;
+        tracker->Level = SLOW_OK;
+        tracker->EvictDeadline = 0;
+        tracker->NoticePending = false;
+        tracker->InputPaused = false;
+        tracker->InputPausedSinceTick = tick;
+    }
+}
+
+/* Output queue went from empty to non-empty */
+void slow_tracker_backlog_started(SlowTracker* tracker, uint64_t tick, int64_t now) {
+    if (tracker != NULL && !tracker->Backlogged) {
+        tracker->Backlogged = true;
+        tracker->BacklogSinceTick = tick;
+        tracker->LastProgress = now;
+    }
+}
+
+/* Bytes were written */
+void slow_tracker_progress(SlowTracker* tracker, bool drained, int64_t now) {
+    if (tracker != NULL) {
+        tracker->LastProgress = now;
+        if (drained) {
+            tracker->Backlogged = false;
+        }
+    }
+}
+
+/* Client sent MSGID_HASH */
+void slow_tracker_hash(SlowTracker* tracker, uint64_t tick) {
+    if (tracker != NULL) {
+        tracker->LastHashTick = tick;
+    }
+}
+
+/* Start eviction */
+void slow_tracker_evict(SlowTracker* tracker, const SlowPolicy* policy, int64_t now) {
+    if (tracker != NULL && tracker->Level != SLOW_EVICT) {
+        int64_t linger = policy != NULL ? policy->EvictLingerMs : DEFAULT_EVICT_LINGER_MS;
+        tracker->Level = SLOW_EVICT;
+        tracker->EvictDeadline = now + linger * 1000000;
+    }
+}
+
+/* Check if evicted */
+bool slow_tracker_evicting(const SlowTracker* tracker) {
+    return tracker != NULL && tracker->Level == SLOW_EVICT;
+}
+
+/* Build sample */
+void slow_tracker_sample(const SlowTracker* tracker, size_t queued_bytes, uint64_t tick, int64_t now,
+                         SlowSample* sample) {
+    if (tracker == NULL || sample == NULL) {
+        return;
+    }
+    bool backlogged = tracker->Backlogged && queued_bytes > 0;
+    sample->QueueBytes = (int64_t)queued_bytes;
+    sample->QueueTicks = backlogged ? (int64_t)(tick - tracker->BacklogSinceTick) : 0;
+    if (tracker->InputPaused && (int64_t)(tick - tracker->InputPausedSinceTick) > sample->QueueTicks) {
+        sample->QueueTicks = (int64_t)(tick - tracker->InputPausedSinceTick);
+    }
+    sample->HashTicks = (int64_t)(tick - tracker->LastHashTick);
+    sample->StallMs = backlogged ? (now - tracker->LastProgress) / 1000000 : 0;
+}
+
+/* Input held back */
+void slow_tracker_pause_input(SlowTracker* tracker, uint64_t tick) {
+    if (tracker != NULL && !tracker->InputPaused) {
+        tracker->InputPaused = true;
+        tracker->InputPausedSinceTick = tick;
+    }
+}
+
+/* Input flowing again */
+void slow_tracker_resume_input(SlowTracker* tracker) {
+    if (tracker != NULL) {
+        tracker->InputPaused = false;
+    }
+}
+
+/* Check for held back input */
+bool slow_tracker_input_paused(const SlowTracker* tracker) {
+    return tracker != NULL && tracker->InputPaused;
+}
+
+/* Get level name */
+const char* slow_level_name(enum SlowLevel level) {
+    switch (level) {
+        case SLOW_OK:
+            return "ok";
+        case SLOW_WARN:
+            return "warn";
+        case SLOW_DROP:
+            return "drop";
+        case SLOW_EVICT:
+            return "evict";
+        default:
+            return "unknown";
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * Luminous Locus Slow Consumer Header
+ */
+
+#ifndef SLOW_CONSUMER_H
+#define SLOW_CONSUMER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Escalation, each level includes the ones below */
+enum SlowLevel {
+    SLOW_OK,
+    SLOW_WARN,        /* logged */
+    SLOW_DROP,        /* nonessential frames are no longer queued */
+    SLOW_EVICT        /* TOOSLOW is sent and the connection closed */
+};
+
+/* Thresholds for one metric, 0 disables a level */
+typedef struct SlowThresholds {
+    int64_t Warn;
+    int64_t Drop;
+    int64_t Evict;
+} SlowThresholds;
+
+/* Policy applied to every connection */
+typedef struct SlowPolicy {
+    SlowThresholds QueueBytes;   /* unwritten output */
+    SlowThresholds QueueTicks;   /* ticks the oldest unwritten output has waited */
+    SlowThresholds HashTicks;    /* ticks since the last MSGID_HASH */
+    SlowThresholds StallMs;      /* time with output queued and no write progress */
+    int64_t EvictLingerMs;       /* time an evicted client gets to read TOOSLOW */
+} SlowPolicy;
+
+/* Per-connection bookkeeping, embedded in Conn */
+typedef struct SlowTracker {
+    bool Backlogged;
+    uint64_t BacklogSinceTick;
+    int64_t LastProgress;        /* monotonic ns of the last write progress */
+    uint64_t LastHashTick;
+    enum SlowLevel Level;
+    int64_t EvictDeadline;       /* monotonic ns, set once evicted */
+    bool NoticePending;          /* TOOSLOW waits for the send in flight */
+    bool InputPaused;            /* input held back, the game thread's queue was full */
+    uint64_t InputPausedSinceTick;
+} SlowTracker;
+
+/* One measurement of a connection */
+typedef struct SlowSample {
+    int64_t QueueBytes;
+    int64_t QueueTicks;          /* output or held-back input, whichever waited longer */
+    int64_t HashTicks;
+    int64_t StallMs;
+} SlowSample;
+
+/* Default policy */
+void slow_policy_defaults(SlowPolicy* policy);
+
+/* Set a metric from its eviction threshold, warn at a quarter and drop at half */
+void slow_thresholds_scale(SlowThresholds* thresholds, int64_t evict);
+
+/* Level for a sample */
+enum SlowLevel slow_policy_assess(const SlowPolicy* policy, const SlowSample* sample);
+
+/* Tracker updates */
+void slow_tracker_init(SlowTracker* tracker, uint64_t tick, int64_t now);
+void slow_tracker_backlog_started(SlowTracker* tracker, uint64_t tick, int64_t now);
+void slow_tracker_progress(SlowTracker* tracker, bool drained, int64_t now);
+void slow_tracker_hash(SlowTracker* tracker, uint64_t tick);
+
+/* Input could not be handed to the game thread, and later could again */
+void slow_tracker_pause_input(SlowTracker* tracker, uint64_t tick);
+void slow_tracker_resume_input(SlowTracker* tracker);
+bool slow_tracker_input_paused(const SlowTracker* tracker);
+
+/* Start eviction, the connection is closed by the deadline at the latest */
+void slow_tracker_evict(SlowTracker* tracker, const SlowPolicy* policy, int64_t now);
+bool slow_tracker_evicting(const SlowTracker* tracker);
+
+/* Build a sample from a tracker */
+void slow_tracker_sample(const SlowTracker* tracker, size_t queued_bytes, uint64_t tick, int64_t now,
+                         SlowSample* sample);
+
+/* Level name for logs */
+const char* slow_level_name(enum SlowLevel level);
+
+#endif /* SLOW_CONSUMER_H */
@@ -0,0 +1,323 @@
+/*
+ * Luminous Locus Stream Codec Module
+ * LZ77 compression with history kept across frames
+ *
+ * Output is a run of sequences. A token byte holds the literal count in
+ * its high nibble and the match length minus three in its low nibble,
+ * 15 in either meaning more length follows as bytes of 255 ending with
+ * a smaller one. The literals come next, then, when the match length is
+ * not zero, a little-endian 16-bit distance back into the output. Both
+ * sides keep the last STREAM_CODEC_WINDOW bytes of the stream, so a
+ * frame can match against frames sent before it: the tick that repeats
+ * most of the last one, the map chunk that repeats its neighbour. The
+ * encoder finds matches with one hash probe per position and skips ahead
+ * faster the longer it goes without one, which keeps incompressible data
+ * cheap.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "stream_codec.h"
+
+/* Window buffer holds the history plus one chunk */
+#define BUFFER_SIZE (2 * STREAM_CODEC_WINDOW)
+
+/* Input is compressed in chunks no larger than the history */
+#define CHUNK_MAX STREAM_CODEC_WINDOW
+
+/* Farthest match distance */
+#define MAX_DISTANCE (STREAM_CODEC_WINDOW - 1)
+
+/* Shortest match worth a sequence */
+#define MIN_MATCH 4
+
+/* Nibble value announcing more length */
+#define LENGTH_MORE 15
+
+/* Match position table */
+#define HASH_BITS 14
+#define HASH_SIZE (1 << HASH_BITS)
+
+/* Misses before the encoder starts skipping */
+#define SKIP_SHIFT 5
+
+/* Worst case overhead of one chunk beyond its extended literal length */
+#define CHUNK_OVERHEAD 16
+
+struct StreamEncoder {
+    int32_t Table[HASH_SIZE];   /* last window position of each hashed 4-byte sequence, -1 when empty */
+    size_t Used;
+    unsigned char Window[BUFFER_SIZE];
+};
+
+struct StreamDecoder {
+    size_t Used;
+    unsigned char Window[BUFFER_SIZE];
+};
+
+/* Unaligned 32-bit load */
+static uint32_t read32(const unsigned char* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/* Hash a 4-byte sequence */
+static uint32_t hash32(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Write the bytes of a length above its nibble */
+static char* put_length(char* p, size_t length) {
+    while (length >= 255) {
+        *p++ = (char)255;
+        length -= 255;
+    }
+    *p++ = (char)length;
+    return p;
+}
+
+/* Read the bytes of a length above its nibble, false when truncated */
+static bool get_length(const unsigned char** p, const unsigned char* end, size_t* length) {
+    unsigned char byte;
+    do {
+        if (*p == end || *length > STREAM_CODEC_INFLATE_MAX) {
+            return false;
+        }
+        byte = *(*p)++;
+        *length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/* Write one sequence, a match length of 0 writes literals only */
+static char* put_sequence(char* p, const unsigned char* literals, size_t literal_length, size_t distance,
+                          size_t match_length) {
+    size_t literal_nibble = literal_length < LENGTH_MORE ? literal_length : LENGTH_MORE;
+    size_t match_code = match_length > 0 ? match_length - (MIN_MATCH - 1) : 0;
+    size_t match_nibble = match_code < LENGTH_MORE ? match_code : LENGTH_MORE;
+
+    *p++ = (char)((literal_nibble << 4) | match_nibble);
+    if (literal_nibble == LENGTH_MORE) {
+        p = put_length(p, literal_length - LENGTH_MORE);
+    }
+    memcpy(p, literals, literal_length);
+    p += literal_length;
+    if (match_length > 0) {
+        *p++ = (char)(distance & 0xff);
+        *p++ = (char)(distance >> 8);
+        if (match_nibble == LENGTH_MORE) {
+            p = put_length(p, match_code - LENGTH_MORE);
+        }
+    }
+    return p;
+}
+
+/* Length of the match at ip against ref, stops at end */
+static size_t match_length(const unsigned char* w, size_t ref, size_t ip, size_t end) {
+    size_t length = MIN_MATCH;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (ip + length + sizeof(uint64_t) <= end) {
+        uint64_t a, b;
+        memcpy(&a, w + ip + length, sizeof(a));
+        memcpy(&b, w + ref + length, sizeof(b));
+        if (a != b) {
+            return length + (size_t)(__builtin_ctzll(a ^ b) >> 3);
+        }
+        length += sizeof(uint64_t);
+    }
+#endif
+    while (ip + length < end && w[ref + length] == w[ip + length]) {
+        length++;
+    }
+    return length;
+}
+
+/* Drop all but the last window of history, table positions move with it */
+static void encoder_slide(StreamEncoder* encoder) {
+    size_t drop = encoder->Used - STREAM_CODEC_WINDOW;
+    memmove(encoder->Window, encoder->Window + drop, STREAM_CODEC_WINDOW);
+    for (int i = 0; i < HASH_SIZE; i++) {
+        int32_t position = encoder->Table[i];
+        encoder->Table[i] = position >= (int32_t)drop ? position - (int32_t)drop : -1;
+    }
+    encoder->Used = STREAM_CODEC_WINDOW;
+}
+
+/* Compress window bytes start..end, which are already in place */
+static char* encode_chunk(StreamEncoder* encoder, size_t start, size_t end, char* p) {
+    const unsigned char* w = encoder->Window;
+    size_t ip = start;
+    size_t anchor = start;
+    unsigned misses = 0;
+
+    while (ip + MIN_MATCH <= end) {
+        uint32_t sequence = read32(w + ip);
+        uint32_t hash = hash32(sequence);
+        int32_t ref = encoder->Table[hash];
+        encoder->Table[hash] = (int32_t)ip;
+        if (ref < 0 || ip - (size_t)ref > MAX_DISTANCE || read32(w + ref) != sequence) {
+            ip += 1 + (misses++ >> SKIP_SHIFT);
+            continue;
+        }
+        misses = 0;
+
+        size_t from = (size_t)ref;
+        size_t length = match_length(w, from, ip, end);
+        /* Grow backwards into literals the hash probe skipped over */
+        while (ip > anchor && from > 0 && w[ip - 1] == w[from - 1]) {
+            ip--;
+            from--;
+            length++;
+        }
+        p = put_sequence(p, w + anchor, ip - anchor, ip - from, length);
+        ip += length;
+        anchor = ip;
+        if (ip + 2 <= end) {
+            /* Seed the table from inside the match so runs of repeats chain */
+            encoder->Table[hash32(read32(w + ip - 2))] = (int32_t)(ip - 2);
+        }
+    }
+
+    if (anchor < end) {
+        p = put_sequence(p, w + anchor, end - anchor, 0, 0);
+    }
+    return p;
+}
+
+/* Create encoder */
+StreamEncoder* stream_encoder_create(void) {
+    StreamEncoder* encoder = (StreamEncoder*)malloc(sizeof(StreamEncoder));
+    if (encoder == NULL) {
+        return NULL;
+    }
+    memset(encoder->Table, 0xff, sizeof(encoder->Table));
+    encoder->Used = 0;
+    return encoder;
+}
+
+/* Free encoder */
+void stream_encoder_free(StreamEncoder* encoder) {
+    free(encoder);
+}
+
+/* Worst case output */
+size_t stream_encode_bound(size_t length) {
+    return length + length / 255 + CHUNK_OVERHEAD * (length / CHUNK_MAX + 1);
+}
+
+/* Compress against the history */
+size_t stream_encode(StreamEncoder* encoder, const char* data, size_t length, char* out, size_t capacity) {
+    if (encoder == NULL || out == NULL || (data == NULL && length > 0) || capacity < stream_encode_bound(length)) {
+        return 0;
+    }
+    char* p = out;
+    while (length > 0) {
+        size_t chunk = length < CHUNK_MAX ? length : CHUNK_MAX;
+        if (encoder->Used + chunk > BUFFER_SIZE) {
+            encoder_slide(encoder);
+        }
+        size_t start = encoder->Used;
+        memcpy(encoder->Window + start, data, chunk);
+        encoder->Used += chunk;
+        p = encode_chunk(encoder, start, encoder->Used, p);
+        data += chunk;
+        length -= chunk;
+    }
+    return (size_t)(p - out);
+}
+
+/* Create decoder */
+StreamDecoder* stream_decoder_create(void) {
+    StreamDecoder* decoder = (StreamDecoder*)malloc(sizeof(StreamDecoder));
+    if (decoder != NULL) {
+        decoder->Used = 0;
+    }
+    return decoder;
+}
+
+/* Free decoder */
+void stream_decoder_free(StreamDecoder* decoder) {
+    free(decoder);
+}
+
+/* Make room for up to a window of output, keeping a window of history */
+static unsigned char* decoder_reserve(StreamDecoder* decoder, size_t length) {
+    if (decoder->Used + length > BUFFER_SIZE) {
+        memmove(decoder->Window, decoder->Window + decoder->Used - STREAM_CODEC_WINDOW, STREAM_CODEC_WINDOW);
+        decoder->Used = STREAM_CODEC_WINDOW;
+    }
+    return decoder->Window + decoder->Used;
+}
+
+/* Decompress in stream order */
+bool stream_decode(StreamDecoder* decoder, const char* data, size_t length, char* out, size_t capacity,
+                   size_t* written) {
+    if (decoder == NULL || out == NULL || written == NULL || (data == NULL && length > 0)) {
+        return false;
+    }
+    const unsigned char* p = (const unsigned char*)data;
+    const unsigned char* end = p + length;
+    size_t produced = 0;
+
+    while (p < end) {
+        unsigned token = *p++;
+        size_t literal_length = token >> 4;
+        if (literal_length == LENGTH_MORE && !get_length(&p, end, &literal_length)) {
+            return false;
+        }
+        if (literal_length > (size_t)(end - p) || literal_length > capacity - produced) {
+            return false;
+        }
+        while (literal_length > 0) {
+            size_t piece = literal_length < CHUNK_MAX ? literal_length : CHUNK_MAX;
+            unsigned char* target = decoder_reserve(decoder, piece);
+            memcpy(target, p, piece);
+            memcpy(out + produced, p, piece);
+            decoder->Used += piece;
+            produced += piece;
+            p += piece;
+            literal_length -= piece;
+        }
+
+        size_t match_code = token & 0x0f;
+        if (match_code == 0) {
+            continue;
+        }
+        if (end - p < 2) {
+            return false;
+        }
+        size_t distance = (size_t)p[0] | ((size_t)p[1] << 8);
+        p += 2;
+        if (match_code == LENGTH_MORE && !get_length(&p, end, &match_code)) {
+            return false;
+        }
+        size_t length_left = match_code + (MIN_MATCH - 1);
+        if (distance == 0 || distance > decoder->Used || length_left > capacity - produced) {
+            return false;
+        }
+        while (length_left > 0) {
+            size_t piece = length_left < CHUNK_MAX ? length_left : CHUNK_MAX;
+            unsigned char* target = decoder_reserve(decoder, piece);
+            const unsigned char* source = target - distance;
+            if (distance >= piece) {
+                memcpy(target, source, piece);
+            } else {
+                /* Overlapping match repeats the last distance bytes */
+                for (size_t i = 0; i < piece; i++) {
+                    target[i] = source[i];
+                }
+            }
+            memcpy(out + produced, target, piece);
+            decoder->Used += piece;
+            produced += piece;
+            length_left -= piece;
+        }
+    }
+
+    *written = produced;
+    return true;
+}
@@ -0,0 +1,67 @@
+/*
+ * Luminous Locus Stream Codec Header
+ */
+
+#ifndef STREAM_CODEC_H
+#define STREAM_CODEC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* MessageLogin.Compression asking for compressed frames */
+#define STREAM_CODEC_VERSION 1
+
+/* History shared across frames, the farthest a match may reach back */
+#define STREAM_CODEC_WINDOW (64 * 1024)
+
+/* Frames smaller than this are sent as they are */
+#define STREAM_CODEC_DEFAULT_THRESHOLD 256
+
+/* Largest run of frames one compressed frame may unpack to */
+#define STREAM_CODEC_INFLATE_MAX (2 * 1024 * 1024)
+
+/* Compressing side of a stream */
+typedef struct StreamEncoder StreamEncoder;
+
+/* Decompressing side of a stream */
+typedef struct StreamDecoder StreamDecoder;
+
+/* Per-connection counters, raw is before the codec and wire after it */
+typedef struct StreamStats {
+    int64_t RawOut;
+    int64_t WireOut;
+    int64_t BypassedOut;    /* bytes under the threshold, sent as they are */
+    int64_t EncodeNs;
+    int64_t RawIn;
+    int64_t WireIn;
+    int64_t DecodeNs;
+} StreamStats;
+
+/* Create/free encoder */
+StreamEncoder* stream_encoder_create(void);
+void stream_encoder_free(StreamEncoder* encoder);
+
+/* Output size that always fits length input bytes */
+size_t stream_encode_bound(size_t length);
+
+/*
+ * Compress data against everything encoded before it. Returns the
+ * compressed size, or 0 when capacity is below stream_encode_bound, in
+ * which case the stream is left untouched.
+ */
+size_t stream_encode(StreamEncoder* encoder, const char* data, size_t length, char* out, size_t capacity);
+
+/* Create/free decoder */
+StreamDecoder* stream_decoder_create(void);
+void stream_decoder_free(StreamDecoder* decoder);
+
+/*
+ * Decompress one encoder output, in the order it was produced. False
+ * when the input is corrupt or unpacks to more than capacity bytes;
+ * the stream cannot be continued after that.
+ */
+bool stream_decode(StreamDecoder* decoder, const char* data, size_t length, char* out, size_t capacity,
+                   size_t* written);
+
+#endif /* STREAM_CODEC_H */
@@ -11,6 +11,22 @@
 #include <time.h>
 #include <sys/time.h>
 #include "model.h"
+#include "telemetry.h"
+
+/*
+ * Counters are updated from every reactor thread, so all access goes
+ * through relaxed atomics.
+ */
+#define STAT_ADD(field, value) __atomic_fetch_add(&(field), (value), __ATOMIC_RELAXED)
+#define STAT_GET(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+/*
+ * Login latency histogram in microseconds: exact below 8, then four
+ * buckets per power of two, so a percentile is within 25% of the truth.
+ */
+#define LOGIN_LINEAR_BUCKETS 8
+#define LOGIN_SUB_BUCKETS 4
+#define LOGIN_BUCKETS (LOGIN_LINEAR_BUCKETS + (64 - 3) * LOGIN_SUB_BUCKETS)
 
 /* Stats collector structure */
 struct StatsCollector {
@@ -20,6 +36,28 @@ struct StatsCollector {
     int total_messages_out;
     int64_t bytes_received;
     int64_t bytes_sent;
+    int64_t ticks;
+    int64_t ticks_missed;
+    int64_t tick_lateness_total;  /* nanoseconds */
+    int64_t tick_lateness_max;
+    int64_t tick_duration_total;
+    int64_t tick_duration_max;
+    int64_t slow_warnings;
+    int64_t slow_frames_dropped;
+    int64_t slow_evictions;
+    int64_t compress_raw;
+    int64_t compress_wire;
+    int64_t compress_bypassed;
+    int64_t compress_ns;          /* codec time on reactor threads */
+    int64_t compressed_conns;     /* closed connections that used the codec */
+    int64_t conn_ratio_best;      /* wire bytes per 10000 raw, lowest and highest of one connection */
+    int64_t conn_ratio_worst;
+    int64_t conn_codec_max;       /* nanoseconds, most codec time of one connection */
+    int64_t logins;
+    int64_t logins_failed;
+    int64_t logins_cached;
+    int64_t login_latency_max;    /* nanoseconds */
+    int64_t login_latency[LOGIN_BUCKETS];
     time_t start_time;
 };
 
@@ -30,6 +68,7 @@ StatsCollector* stats_collector_create(void) {
         return NULL;
     }
     memset(sc, 0, sizeof(StatsCollector));
+    sc->conn_ratio_best = INT64_MAX;
     sc->start_time = time(NULL);
     return sc;
 }
@@ -51,54 +90,248 @@ static int64_t get_time_ms(void) {
 /* Record incoming message */
 void stats_collector_record_incoming(StatsCollector* sc) {
     if (sc != NULL) {
-        sc->total_messages_in++;
+        STAT_ADD(sc->total_messages_in, 1);
     }
 }
 
 /* Record outgoing message */
 void stats_collector_record_outgoing(StatsCollector* sc) {
     if (sc != NULL) {
-        sc->total_messages_out++;
+        STAT_ADD(sc->total_messages_out, 1);
     }
 }
 
 /* Record bytes received */
 void stats_collector_bytes_received(StatsCollector* sc, int64_t bytes) {
     if (sc != NULL) {
-        sc->bytes_received += bytes;
+        STAT_ADD(sc->bytes_received, bytes);
     }
 }
 
 /* Record bytes sent */
 void stats_collector_bytes_sent(StatsCollector* sc, int64_t bytes) {
     if (sc != NULL) {
-        sc->bytes_sent += bytes;
+        STAT_ADD(sc->bytes_sent, bytes);
+    }
+}
+
+/* Record one game tick, only the game thread writes these */
+void stats_collector_record_tick(StatsCollector* sc, int64_t lateness_ns, int64_t duration_ns, int64_t missed) {
+    if (sc != NULL) {
+        STAT_ADD(sc->ticks, 1);
+        STAT_ADD(sc->ticks_missed, missed);
+        STAT_ADD(sc->tick_lateness_total, lateness_ns);
+        STAT_ADD(sc->tick_duration_total, duration_ns);
+        if (lateness_ns > STAT_GET(sc->tick_lateness_max)) {
+            __atomic_store_n(&sc->tick_lateness_max, lateness_ns, __ATOMIC_RELAXED);
+        }
+        if (duration_ns > STAT_GET(sc->tick_duration_max)) {
+            __atomic_store_n(&sc->tick_duration_max, duration_ns, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* Get tick count */
+int64_t stats_collector_get_ticks(StatsCollector* sc) {
+    return sc != NULL ? STAT_GET(sc->ticks) : 0;
+}
+
+/* Get tick timing in microseconds */
+void stats_collector_get_tick_timing(StatsCollector* sc, int64_t* avg_lateness_us, int64_t* max_lateness_us,
+                                     int64_t* avg_duration_us, int64_t* max_duration_us) {
+    int64_t ticks = stats_collector_get_ticks(sc);
+    int64_t divisor = ticks > 0 ? ticks * 1000 : 1;
+    *avg_lateness_us = sc != NULL ? STAT_GET(sc->tick_lateness_total) / divisor : 0;
+    *max_lateness_us = sc != NULL ? STAT_GET(sc->tick_lateness_max) / 1000 : 0;
+    *avg_duration_us = sc != NULL ? STAT_GET(sc->tick_duration_total) / divisor : 0;
+    *max_duration_us = sc != NULL ? STAT_GET(sc->tick_duration_max) / 1000 : 0;
+}
+
+/* Get missed tick deadlines */
+int64_t stats_collector_get_ticks_missed(StatsCollector* sc) {
+    return sc != NULL ? STAT_GET(sc->ticks_missed) : 0;
+}
+
+/* Record slow consumer events */
+void stats_collector_record_slow(StatsCollector* sc, int64_t warnings, int64_t frames_dropped, int64_t evictions) {
+    if (sc != NULL) {
+        STAT_ADD(sc->slow_warnings, warnings);
+        STAT_ADD(sc->slow_frames_dropped, frames_dropped);
+        STAT_ADD(sc->slow_evictions, evictions);
+    }
+}
+
+/* Get slow consumer counters */
+void stats_collector_get_slow(StatsCollector* sc, int64_t* warnings, int64_t* frames_dropped, int64_t* evictions) {
+    *warnings = sc != NULL ? STAT_GET(sc->slow_warnings) : 0;
+    *frames_dropped = sc != NULL ? STAT_GET(sc->slow_frames_dropped) : 0;
+    *evictions = sc != NULL ? STAT_GET(sc->slow_evictions) : 0;
+}
+
+/* Record a frame through the stream codec, either direction */
+void stats_collector_record_compression(StatsCollector* sc, int64_t raw_bytes, int64_t wire_bytes, int64_t cpu_ns) {
+    if (sc != NULL) {
+        STAT_ADD(sc->compress_raw, raw_bytes);
+        STAT_ADD(sc->compress_wire, wire_bytes);
+        STAT_ADD(sc->compress_ns, cpu_ns);
     }
 }
 
+/* Record a frame under the compression threshold */
+void stats_collector_record_bypass(StatsCollector* sc, int64_t bytes) {
+    if (sc != NULL) {
+        STAT_ADD(sc->compress_bypassed, bytes);
+    }
+}
+
+/* Get compression counters */
+void stats_collector_get_compression(StatsCollector* sc, int64_t* raw_bytes, int64_t* wire_bytes,
+                                     int64_t* bypassed_bytes, int64_t* cpu_us) {
+    *raw_bytes = sc != NULL ? STAT_GET(sc->compress_raw) : 0;
+    *wire_bytes = sc != NULL ? STAT_GET(sc->compress_wire) : 0;
+    *bypassed_bytes = sc != NULL ? STAT_GET(sc->compress_bypassed) : 0;
+    *cpu_us = sc != NULL ? STAT_GET(sc->compress_ns) / 1000 : 0;
+}
+
+/* Raise a maximum shared between threads */
+static void stat_raise(int64_t* field, int64_t value) {
+    int64_t current = STAT_GET(*field);
+    while (value > current &&
+           !__atomic_compare_exchange_n(field, &current, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/* Lower a minimum shared between threads */
+static void stat_lower(int64_t* field, int64_t value) {
+    int64_t current = STAT_GET(*field);
+    while (value < current &&
+           !__atomic_compare_exchange_n(field, &current, value, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/* Record a compressed connection's totals when it closes */
+void stats_collector_record_connection_compression(StatsCollector* sc, int64_t raw_bytes, int64_t wire_bytes,
+                                                   int64_t cpu_ns) {
+    if (sc != NULL && raw_bytes > 0) {
+        int64_t ratio = wire_bytes * 10000 / raw_bytes;
+        STAT_ADD(sc->compressed_conns, 1);
+        stat_lower(&sc->conn_ratio_best, ratio);
+        stat_raise(&sc->conn_ratio_worst, ratio);
+        stat_raise(&sc->conn_codec_max, cpu_ns);
+    }
+}
+
+/* Get per-connection compression extremes */
+void stats_collector_get_connection_compression(StatsCollector* sc, int64_t* connections, double* best_ratio,
+                                                double* worst_ratio, int64_t* max_cpu_us) {
+    *connections = sc != NULL ? STAT_GET(sc->compressed_conns) : 0;
+    *best_ratio = *connections > 0 ? (double)STAT_GET(sc->conn_ratio_best) / 100.0 : 100.0;
+    *worst_ratio = *connections > 0 ? (double)STAT_GET(sc->conn_ratio_worst) / 100.0 : 100.0;
+    *max_cpu_us = sc != NULL ? STAT_GET(sc->conn_codec_max) / 1000 : 0;
+}
+
+/* Histogram bucket of a latency in microseconds */
+static int login_bucket(uint64_t us) {
+    if (us < LOGIN_LINEAR_BUCKETS) {
+        return (int)us;
+    }
+    int exponent = 63 - __builtin_clzll(us);
+    int sub = (int)(us >> (exponent - 2)) & (LOGIN_SUB_BUCKETS - 1);
+    return LOGIN_LINEAR_BUCKETS + (exponent - 3) * LOGIN_SUB_BUCKETS + sub;
+}
+
+/* Largest latency in microseconds that falls in a bucket */
+static int64_t login_bucket_limit(int bucket) {
+    if (bucket < LOGIN_LINEAR_BUCKETS) {
+        return bucket;
+    }
+    int exponent = (bucket - LOGIN_LINEAR_BUCKETS) / LOGIN_SUB_BUCKETS + 3;
+    int sub = (bucket - LOGIN_LINEAR_BUCKETS) % LOGIN_SUB_BUCKETS;
+    return (int64_t)(((uint64_t)(LOGIN_SUB_BUCKETS + sub + 1) << (exponent - 2)) - 1);
+}
+
+/* Record a checked login, latency from the login frame to its result */
+void stats_collector_record_login(StatsCollector* sc, int64_t latency_ns, bool ok, bool cached) {
+    if (sc != NULL) {
+        int64_t latency = latency_ns > 0 ? latency_ns : 0;
+        STAT_ADD(sc->logins, 1);
+        STAT_ADD(sc->logins_failed, ok ? 0 : 1);
+        STAT_ADD(sc->logins_cached, cached ? 1 : 0);
+        STAT_ADD(sc->login_latency[login_bucket((uint64_t)latency / 1000)], 1);
+        int64_t max = STAT_GET(sc->login_latency_max);
+        while (latency > max && !__atomic_compare_exchange_n(&sc->login_latency_max, &max, latency, false,
+                                                             __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+}
+
+/* Get login counters */
+void stats_collector_get_logins(StatsCollector* sc, int64_t* logins, int64_t* failed, int64_t* cached,
+                                int64_t* max_latency_us) {
+    *logins = sc != NULL ? STAT_GET(sc->logins) : 0;
+    *failed = sc != NULL ? STAT_GET(sc->logins_failed) : 0;
+    *cached = sc != NULL ? STAT_GET(sc->logins_cached) : 0;
+    *max_latency_us = sc != NULL ? STAT_GET(sc->login_latency_max) / 1000 : 0;
+}
+
+/* Get a login latency percentile in microseconds */
+int64_t stats_collector_get_login_percentile(StatsCollector* sc, double percentile) {
+    if (sc == NULL) {
+        return 0;
+    }
+    int64_t counts[LOGIN_BUCKETS];
+    int64_t total = 0;
+    for (int i = 0; i < LOGIN_BUCKETS; i++) {
+        counts[i] = STAT_GET(sc->login_latency[i]);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    /* Rank of the sample at that percentile, 1-based */
+    int64_t rank = (int64_t)(percentile / 100.0 * (double)total + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    int64_t seen = 0;
+    for (int i = 0; i < LOGIN_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            int64_t max = STAT_GET(sc->login_latency_max) / 1000;
+            int64_t limit = login_bucket_limit(i);
+            return limit < max ? limit : max;
+        }
+    }
+    return STAT_GET(sc->login_latency_max) / 1000;
+}
+
 /* Increment client count */
 void stats_collector_add_client(StatsCollector* sc) {
     if (sc != NULL) {
-        sc->current_clients++;
-        sc->total_session_clients++;
+        STAT_ADD(sc->current_clients, 1);
+        STAT_ADD(sc->total_session_clients, 1);
     }
 }
 
 /* Decrement client count */
 void stats_collector_remove_client(StatsCollector* sc) {
-    if (sc != NULL && sc->current_clients > 0) {
-        sc->current_clients--;
+    if (sc != NULL) {
+        int current = STAT_GET(sc->current_clients);
+        while (current > 0 && !__atomic_compare_exchange_n(&sc->current_clients, &current, current - 1,
+                                                           false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
     }
 }
 
 /* Get current client count */
 int stats_collector_get_clients(StatsCollector* sc) {
-    return sc != NULL ? sc->current_clients : 0;
+    return sc != NULL ? STAT_GET(sc->current_clients) : 0;
 }
 
 /* Get total session clients */
 int stats_collector_get_total_clients(StatsCollector* sc) {
-    return sc != NULL ? sc->total_session_clients : 0;
+    return sc != NULL ? STAT_GET(sc->total_session_clients) : 0;
 }
 
 /* Get uptime in seconds */
@@ -114,12 +347,12 @@ int stats_collector_get_total_messages(StatsCollector* sc) {
     if (sc == NULL) {
         return 0;
     }
-    return sc->total_messages_in + sc->total_messages_out;
+    return STAT_GET(sc->total_messages_in) + STAT_GET(sc->total_messages_out);
 }
 
 /* Reset client stats */
 void stats_collector_reset_clients(StatsCollector* sc) {
     if (sc != NULL) {
-        sc->current_clients = 0;
+        __atomic_store_n(&sc->current_clients, 0, __ATOMIC_RELAXED);
     }
 }
\ No newline at end of file
@@ -23,6 +23,37 @@ void stats_collector_record_outgoing(StatsCollector* sc);
 void stats_collector_bytes_received(StatsCollector* sc, int64_t bytes);
 void stats_collector_bytes_sent(StatsCollector* sc, int64_t bytes);
 
+/* Tick timing */
+void stats_collector_record_tick(StatsCollector* sc, int64_t lateness_ns, int64_t duration_ns, int64_t missed);
+int64_t stats_collector_get_ticks(StatsCollector* sc);
+int64_t stats_collector_get_ticks_missed(StatsCollector* sc);
+void stats_collector_get_tick_timing(StatsCollector* sc, int64_t* avg_lateness_us, int64_t* max_lateness_us,
+                                     int64_t* avg_duration_us, int64_t* max_duration_us);
+
+/* Slow consumer escalations */
+void stats_collector_record_slow(StatsCollector* sc, int64_t warnings, int64_t frames_dropped, int64_t evictions);
+void stats_collector_get_slow(StatsCollector* sc, int64_t* warnings, int64_t* frames_dropped, int64_t* evictions);
+
+/* Stream compression, raw bytes on the game side of the codec and wire bytes on the socket side */
+void stats_collector_record_compression(StatsCollector* sc, int64_t raw_bytes, int64_t wire_bytes, int64_t cpu_ns);
+void stats_collector_record_bypass(StatsCollector* sc, int64_t bytes);
+void stats_collector_get_compression(StatsCollector* sc, int64_t* raw_bytes, int64_t* wire_bytes,
+                                     int64_t* bypassed_bytes, int64_t* cpu_us);
+
+/* One compressed connection's totals over both directions, recorded as it closes; ratios in percent */
+void stats_collector_record_connection_compression(StatsCollector* sc, int64_t raw_bytes, int64_t wire_bytes,
+                                                   int64_t cpu_ns);
+void stats_collector_get_connection_compression(StatsCollector* sc, int64_t* connections, double* best_ratio,
+                                                double* worst_ratio, int64_t* max_cpu_us);
+
+/* Logins checked by the auth workers, latency from the login frame to its result */
+void stats_collector_record_login(StatsCollector* sc, int64_t latency_ns, bool ok, bool cached);
+void stats_collector_get_logins(StatsCollector* sc, int64_t* logins, int64_t* failed, int64_t* cached,
+                                int64_t* max_latency_us);
+
+/* Login latency at a percentile (50, 99, ...) in microseconds, rounded up to its histogram bucket */
+int64_t stats_collector_get_login_percentile(StatsCollector* sc, double percentile);
+
 /* Client tracking */
 void stats_collector_add_client(StatsCollector* sc);
 void stats_collector_remove_client(StatsCollector* sc);
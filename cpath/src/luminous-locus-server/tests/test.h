@@ -0,0 +1,46 @@
+/*
+ * Luminous Locus Test Header
+ * Assertions shared by the C unit tests
+ */
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+#include <string.h>
+
+/* Failed checks in this program */
+static int test_failures = 0;
+
+/* Record a failed condition and keep going */
+#define CHECK(cond)                                                                         \
+    do {                                                                                    \
+        if (!(cond)) {                                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);        \
+            test_failures++;                                                                \
+        }                                                                                   \
+    } while (0)
+
+/* Compare two byte ranges */
+#define CHECK_BYTES(actual, expected, length) CHECK(memcmp((actual), (expected), (length)) == 0)
+
+/* Run one test function */
+#define RUN(test)                                                                           \
+    do {                                                                                    \
+        int before = test_failures;                                                         \
+        test();                                                                             \
+        printf("%s %s\n", test_failures == before ? "ok  " : "FAIL", #test);                \
+    } while (0)
+
+/* Exit status of the program */
+#define TEST_RESULT() (test_failures == 0 ? 0 : 1)
+
+/* Deterministic generator, so a failure reproduces */
+static unsigned test_rand_state = 12345;
+
+static inline unsigned test_rand(void) {
+    test_rand_state = test_rand_state * 1103515245u + 12345u;
+    return (test_rand_state >> 16) & 0x7fff;
+}
+
+#endif /* TEST_H */
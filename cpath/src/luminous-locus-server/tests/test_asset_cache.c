@@ -0,0 +1,172 @@
+/*
+ * Luminous Locus Asset Cache Test
+ * Lookup, encoding choice and validators of cached asset files
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "../asset_cache.h"
+#include "test.h"
+
+/* Compressible text the cache should keep a gzip copy of */
+#define TEXT_SIZE 8192
+
+/* Write a file below dir */
+static void put_file(const char* dir, const char* path, const void* data, size_t length) {
+    char full[512];
+    snprintf(full, sizeof(full), "%s/%s", dir, path);
+    FILE* file = fopen(full, "wb");
+    CHECK(file != NULL);
+    if (file != NULL) {
+        CHECK(fwrite(data, 1, length, file) == length);
+        fclose(file);
+    }
+}
+
+/* Remove the test tree */
+static void remove_tree(const char* dir) {
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    CHECK(system(command) == 0);
+}
+
+/* Build a small tree: text, an icon, a file with a shipped .gz, a dotfile and a subdirectory */
+static void make_tree(char* dir) {
+    CHECK(mkdtemp(dir) != NULL);
+    char text[TEXT_SIZE];
+    for (size_t i = 0; i < sizeof(text); i++) {
+        text[i] = "the quick brown fox "[i % 20];
+    }
+    put_file(dir, "map.json", text, sizeof(text));
+    put_file(dir, "icon.png", text, sizeof(text));
+    put_file(dir, "big.txt", text, sizeof(text));
+    put_file(dir, "big.txt.gz", "tiny", 4);
+    put_file(dir, ".hidden", "secret", 6);
+    char sub[512];
+    snprintf(sub, sizeof(sub), "%s/sounds", dir);
+    CHECK(mkdir(sub, 0700) == 0);
+    put_file(dir, "sounds/step.ogg", "OggS", 4);
+}
+
+/* Files are found by path relative to the root, dotfiles are not */
+static void test_find(void) {
+    char dir[] = "/tmp/ll_asset_cache_XXXXXX";
+    make_tree(dir);
+    int root = open(dir, O_RDONLY | O_DIRECTORY);
+    AssetCache* cache = asset_cache_create(root);
+    CHECK(cache != NULL);
+
+    const AssetEntry* entry = asset_cache_find(cache, "sounds/step.ogg");
+    CHECK(entry != NULL && strcmp(asset_entry_type(entry), "audio/ogg") == 0);
+    CHECK(asset_cache_find(cache, "map.json") != NULL);
+    CHECK(asset_cache_find(cache, ".hidden") == NULL);
+    CHECK(asset_cache_find(cache, "missing.png") == NULL);
+    CHECK(asset_cache_find(cache, "/map.json") == NULL);
+
+    AssetBody body;
+    asset_entry_select(entry, NULL, &body);
+    CHECK(body.Length == 4 && memcmp(body.Data, "OggS", 4) == 0 && body.Encoding == NULL);
+
+    AssetCacheStats stats;
+    asset_cache_get_stats(cache, &stats);
+    CHECK(stats.Files == 5);
+    asset_cache_free(cache);
+    close(root);
+    remove_tree(dir);
+}
+
+/* Text gets a gzip copy for clients that take it, compressed formats do not */
+static void test_gzip_variant(void) {
+    char dir[] = "/tmp/ll_asset_cache_XXXXXX";
+    make_tree(dir);
+    int root = open(dir, O_RDONLY | O_DIRECTORY);
+    AssetCache* cache = asset_cache_create(root);
+
+    const AssetEntry* map = asset_cache_find(cache, "map.json");
+    CHECK(asset_entry_has_variants(map));
+    AssetBody identity;
+    AssetBody gzip;
+    asset_entry_select(map, NULL, &identity);
+    asset_entry_select(map, "br;q=0.5, gzip", &gzip);
+    CHECK(identity.Length == TEXT_SIZE && gzip.Length < TEXT_SIZE / 4);
+    CHECK(gzip.Encoding != NULL && strcmp(gzip.Encoding, "gzip") == 0);
+    CHECK((unsigned char)gzip.Data[0] == 0x1f && (unsigned char)gzip.Data[1] == 0x8b);
+
+    /* Refused or unknown codings fall back to identity */
+    AssetBody body;
+    asset_entry_select(map, "gzip;q=0, deflate", &body);
+    CHECK(body.Encoding == NULL);
+    asset_entry_select(map, "*", &body);
+    CHECK(body.Encoding != NULL);
+
+    const AssetEntry* icon = asset_cache_find(cache, "icon.png");
+    CHECK(!asset_entry_has_variants(icon));
+    asset_entry_select(icon, "gzip", &body);
+    CHECK(body.Encoding == NULL && body.Length == TEXT_SIZE);
+
+    /* A shipped .gz is used instead of building one */
+    asset_entry_select(asset_cache_find(cache, "big.txt"), "gzip", &body);
+    CHECK(body.Length == 4 && memcmp(body.Data, "tiny", 4) == 0);
+
+    AssetCacheStats stats;
+    asset_cache_get_stats(cache, &stats);
+    CHECK(stats.VariantBytes > 0 && stats.VariantSaved > 0);
+    asset_cache_free(cache);
+    close(root);
+    remove_tree(dir);
+}
+
+/* Every representation has its own ETag, and If-None-Match lists are matched */
+static void test_etags(void) {
+    char dir[] = "/tmp/ll_asset_cache_XXXXXX";
+    make_tree(dir);
+    int root = open(dir, O_RDONLY | O_DIRECTORY);
+    AssetCache* cache = asset_cache_create(root);
+
+    const AssetEntry* map = asset_cache_find(cache, "map.json");
+    AssetBody identity;
+    AssetBody gzip;
+    asset_entry_select(map, NULL, &identity);
+    asset_entry_select(map, "gzip", &gzip);
+    CHECK(identity.ETag[0] == '"' && strcmp(identity.ETag, gzip.ETag) != 0);
+    CHECK(asset_entry_matches(map, identity.ETag));
+    CHECK(asset_entry_matches(map, gzip.ETag));
+
+    char list[128];
+    snprintf(list, sizeof(list), "\"nope\", W/%s", gzip.ETag);
+    CHECK(asset_entry_matches(map, list));
+    CHECK(asset_entry_matches(map, "*"));
+    CHECK(!asset_entry_matches(map, "\"nope\""));
+    CHECK(!asset_entry_matches(map, NULL));
+
+    /* Same bytes, same validator */
+    AssetBody other;
+    asset_entry_select(asset_cache_find(cache, "icon.png"), NULL, &other);
+    CHECK(strcmp(other.ETag, identity.ETag) == 0);
+    asset_cache_free(cache);
+    close(root);
+    remove_tree(dir);
+}
+
+/* Types by extension, and a hash that does not depend on the platform */
+static void test_helpers(void) {
+    CHECK(strcmp(asset_content_type("a/b.png"), "image/png") == 0);
+    CHECK(strcmp(asset_content_type("x.json"), "application/json") == 0);
+    CHECK(strcmp(asset_content_type("noext"), "application/octet-stream") == 0);
+    CHECK(asset_hash64("abc", 3) == asset_hash64("abc", 3));
+    CHECK(asset_hash64("abc", 3) != asset_hash64("abd", 3));
+    CHECK(asset_hash64("", 0) != asset_hash64("a", 1));
+}
+
+int main(void) {
+    RUN(test_find);
+    RUN(test_gzip_variant);
+    RUN(test_etags);
+    RUN(test_helpers);
+    return TEST_RESULT();
+}
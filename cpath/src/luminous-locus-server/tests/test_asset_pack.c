@@ -0,0 +1,171 @@
+/*
+ * Luminous Locus Asset Pack Test
+ * Building, checking and serving from a packed asset tree
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../asset_pack.h"
+#include "../asset_cache.h"
+#include "../dmi_meta.h"
+#include "test.h"
+
+/* Compressible text the builder should store a gzip copy of */
+#define TEXT_SIZE 8192
+
+/* Sidecar of the icon in the tree */
+static const char sidecar[] =
+    "{\"info\":{\"width\":32,\"height\":32},\"states\":[{\"state\":\"idle\"},{\"state\":\"walk\",\"dirs\":4}]}";
+
+/* Start of a PNG whose IHDR says it is 64 pixels wide */
+static const char sheet[] =
+    "\x89PNG\r\n\x1a\n\x00\x00\x00\x0dIHDR\x00\x00\x00\x40\x00\x00\x00\x60\x08\x06\x00\x00\x00";
+
+/* Write a file below dir */
+static void put_file(const char* dir, const char* path, const void* data, size_t length) {
+    char full[512];
+    snprintf(full, sizeof(full), "%s/%s", dir, path);
+    FILE* file = fopen(full, "wb");
+    CHECK(file != NULL);
+    if (file != NULL) {
+        CHECK(fwrite(data, 1, length, file) == length);
+        fclose(file);
+    }
+}
+
+/* Remove the test tree */
+static void remove_tree(const char* dir) {
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    CHECK(system(command) == 0);
+}
+
+/* Build a tree with text, a shipped .gz, an icon with its sidecar and a broken sidecar, and pack it */
+static AssetPack* make_pack(char* dir, char* pack_path, size_t pack_path_size, AssetPackBuildStats* stats) {
+    CHECK(mkdtemp(dir) != NULL);
+    char text[TEXT_SIZE];
+    for (size_t i = 0; i < sizeof(text); i++) {
+        text[i] = "the quick brown fox "[i % 20];
+    }
+    put_file(dir, "map.json", text, sizeof(text));
+    put_file(dir, "big.txt", text, sizeof(text));
+    put_file(dir, "big.txt.gz", "tiny", 4);
+    char icons[512];
+    snprintf(icons, sizeof(icons), "%s/icons", dir);
+    CHECK(mkdir(icons, 0700) == 0);
+    put_file(dir, "icons/mob.dmi", sheet, sizeof(sheet) - 1);
+    put_file(dir, "icons/mob.dmi.json", sidecar, sizeof(sidecar) - 1);
+    put_file(dir, "icons/bad.dmi.json", "{\"states\":", 10);
+
+    /* Written inside the root, which the walk must leave out */
+    snprintf(pack_path, pack_path_size, "%s/assets.pack", dir);
+    CHECK(asset_pack_build(dir, pack_path, stats));
+    return asset_pack_open(pack_path);
+}
+
+/* Every file is packed as it is, aligned, and found by path */
+static void test_build_and_find(void) {
+    char dir[] = "/tmp/ll_asset_pack_XXXXXX";
+    char pack_path[512];
+    AssetPackBuildStats stats;
+    AssetPack* pack = make_pack(dir, pack_path, sizeof(pack_path), &stats);
+    CHECK(pack != NULL);
+    CHECK(stats.Files == 6 && stats.Variants >= 1 && stats.StateTables == 1);
+
+    const AssetPackEntry* map = asset_pack_find(pack, "map.json");
+    CHECK(map != NULL && map->Kind == ASSET_PACK_FILE && map->Length == TEXT_SIZE);
+    CHECK(map->Offset % ASSET_PACK_ALIGN == 0);
+    CHECK(memcmp(asset_pack_entry_data(pack, map), "the quick brown fox ", 20) == 0);
+    CHECK(strcmp(asset_pack_entry_path(pack, map), "map.json") == 0);
+
+    /* A gzip copy is made unless one was shipped */
+    const AssetPackEntry* gzip = asset_pack_find(pack, "map.json.gz");
+    CHECK(gzip != NULL && gzip->Kind == ASSET_PACK_GZIP && gzip->Length < TEXT_SIZE / 4);
+    const AssetPackEntry* shipped = asset_pack_find(pack, "big.txt.gz");
+    CHECK(shipped != NULL && shipped->Kind == ASSET_PACK_FILE && shipped->Length == 4);
+
+    CHECK(asset_pack_find(pack, "assets.pack") == NULL);
+    CHECK(asset_pack_find(pack, "icons/bad.dmi.states") == NULL);
+    CHECK(asset_pack_find(pack, "missing") == NULL);
+
+    size_t length = 0;
+    asset_pack_bytes(pack, &length);
+    CHECK((int64_t)length == stats.Bytes);
+    asset_pack_close(pack);
+    remove_tree(dir);
+}
+
+/* The sidecar is compiled into a state table that reads in place */
+static void test_state_table(void) {
+    char dir[] = "/tmp/ll_asset_pack_XXXXXX";
+    char pack_path[512];
+    AssetPack* pack = make_pack(dir, pack_path, sizeof(pack_path), NULL);
+    const AssetPackEntry* entry = asset_pack_find(pack, "icons/mob.dmi" ASSET_PACK_STATES_SUFFIX);
+    CHECK(entry != NULL && entry->Kind == ASSET_PACK_DMI_STATES);
+
+    DmiMeta meta;
+    CHECK(entry != NULL && dmi_meta_view(asset_pack_entry_data(pack, entry), (size_t)entry->Length, &meta));
+    CHECK(meta.Header->Columns == 2 && meta.Header->IconCount == 5);
+    const DmiStateRecord* walk = dmi_meta_find(&meta, "walk");
+    CHECK(walk != NULL && walk->FirstIcon == 1 && walk->Dirs == 4);
+    asset_pack_close(pack);
+    remove_tree(dir);
+}
+
+/* A cache over a pack serves its entries and the pack itself */
+static void test_cache_from_pack(void) {
+    char dir[] = "/tmp/ll_asset_pack_XXXXXX";
+    char pack_path[512];
+    AssetPack* pack = make_pack(dir, pack_path, sizeof(pack_path), NULL);
+    AssetCache* cache = asset_cache_create_from_pack(pack);
+    CHECK(cache != NULL);
+
+    AssetBody body;
+    const AssetEntry* map = asset_cache_find(cache, "map.json");
+    CHECK(map != NULL && asset_entry_has_variants(map));
+    asset_entry_select(map, "gzip", &body);
+    CHECK(body.Encoding != NULL && body.Length < TEXT_SIZE / 4);
+
+    size_t length = 0;
+    const char* bytes = asset_pack_bytes(pack, &length);
+    asset_entry_select(asset_cache_find(cache, ASSET_PACK_URL_PATH), NULL, &body);
+    CHECK(body.Data == bytes && body.Length == length);
+    asset_cache_free(cache);
+    asset_pack_close(pack);
+    remove_tree(dir);
+}
+
+/* A damaged or truncated pack does not open */
+static void test_damaged(void) {
+    char dir[] = "/tmp/ll_asset_pack_XXXXXX";
+    char pack_path[512];
+    AssetPack* pack = make_pack(dir, pack_path, sizeof(pack_path), NULL);
+    size_t length = 0;
+    asset_pack_bytes(pack, &length);
+    const AssetPackEntry* last = asset_pack_entry_at(pack, asset_pack_count(pack) - 1);
+    long index_byte = (long)((const char*)last - asset_pack_bytes(pack, NULL)) + 3;
+    asset_pack_close(pack);
+
+    FILE* file = fopen(pack_path, "r+b");
+    CHECK(file != NULL && fseek(file, index_byte, SEEK_SET) == 0 && fputc(0x5a, file) != EOF);
+    fclose(file);
+    CHECK(asset_pack_open(pack_path) == NULL);
+
+    CHECK(truncate(pack_path, (off_t)length - 1) == 0);
+    CHECK(asset_pack_open(pack_path) == NULL);
+    CHECK(asset_pack_open("/nonexistent/assets.pack") == NULL);
+    remove_tree(dir);
+}
+
+int main(void) {
+    RUN(test_build_and_find);
+    RUN(test_state_table);
+    RUN(test_cache_from_pack);
+    RUN(test_damaged);
+    return TEST_RESULT();
+}
@@ -0,0 +1,310 @@
+/*
+ * Luminous Locus Asset Server Test
+ * HTTP requests against a running server over loopback
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "../assetserver.h"
+#include "../asset_pack.h"
+#include "test.h"
+
+/* Compressible text served with a gzip copy */
+#define TEXT_SIZE 8192
+
+/* Ports tried for the server, from a pid-dependent start */
+#define PORT_BASE 41000
+#define PORT_TRIES 20
+
+/* One parsed response */
+typedef struct Response {
+    int Status;
+    char Head[2048];
+    char* Body;
+    size_t BodyLength;
+} Response;
+
+/* Write a file below dir */
+static void put_file(const char* dir, const char* path, const void* data, size_t length) {
+    char full[512];
+    snprintf(full, sizeof(full), "%s/%s", dir, path);
+    FILE* file = fopen(full, "wb");
+    CHECK(file != NULL);
+    if (file != NULL) {
+        CHECK(fwrite(data, 1, length, file) == length);
+        fclose(file);
+    }
+}
+
+/* Remove the test tree */
+static void remove_tree(const char* dir) {
+    char command[600];
+    snprintf(command, sizeof(command), "rm -rf '%s'", dir);
+    CHECK(system(command) == 0);
+}
+
+/* A root with a small file, compressible text and a subdirectory */
+static void make_tree(char* dir) {
+    CHECK(mkdtemp(dir) != NULL);
+    char text[TEXT_SIZE];
+    for (size_t i = 0; i < sizeof(text); i++) {
+        text[i] = "the quick brown fox "[i % 20];
+    }
+    put_file(dir, "hello.txt", "hello world", 11);
+    put_file(dir, "map.json", text, sizeof(text));
+    char sub[512];
+    snprintf(sub, sizeof(sub), "%s/icons", dir);
+    CHECK(mkdir(sub, 0700) == 0);
+    put_file(dir, "icons/a b.png", "PNGDATA", 7);
+}
+
+/* Start a server on the first free port */
+static AssetServer* start_server(const char* root, const char* pack, int* port) {
+    for (int i = 0; i < PORT_TRIES; i++) {
+        *port = PORT_BASE + (int)(getpid() * 7 + i) % 2000;
+        AssetServer* server = asset_server_create(*port, root, pack);
+        if (server != NULL && asset_server_start(server)) {
+            return server;
+        }
+        asset_server_free(server);
+    }
+    CHECK(false);
+    return NULL;
+}
+
+/* Connected client socket with a receive timeout */
+static int connect_to(int port) {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    struct timeval timeout = {5, 0};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    CHECK(connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+    return sock;
+}
+
+/* Send all of text */
+static void send_text(int sock, const char* text) {
+    size_t length = strlen(text);
+    CHECK(send(sock, text, length, MSG_NOSIGNAL) == (ssize_t)length);
+}
+
+/* Value of a header in a response head, "" when absent */
+static const char* header(const Response* response, const char* name, char* out, size_t capacity) {
+    out[0] = '\0';
+    size_t name_length = strlen(name);
+    for (const char* line = strstr(response->Head, "\r\n"); line != NULL; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, name, name_length) == 0 && line[2 + name_length] == ':') {
+            const char* value = line + 3 + name_length;
+            while (*value == ' ') {
+                value++;
+            }
+            size_t length = strcspn(value, "\r");
+            if (length < capacity) {
+                memcpy(out, value, length);
+                out[length] = '\0';
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+/* Read one response; HEAD responses have no body whatever their Content-Length says */
+static bool read_response(int sock, bool head_only, Response* response) {
+    memset(response, 0, sizeof(Response));
+    size_t used = 0;
+    char* end = NULL;
+    while (end == NULL) {
+        if (used + 1 >= sizeof(response->Head) || recv(sock, response->Head + used, 1, 0) != 1) {
+            return false;
+        }
+        used++;
+        response->Head[used] = '\0';
+        end = strstr(response->Head, "\r\n\r\n");
+    }
+    response->Status = atoi(response->Head + 9);
+
+    char value[64];
+    size_t length = head_only ? 0 : (size_t)atol(header(response, "Content-Length", value, sizeof(value)));
+    response->Body = (char*)malloc(length + 1);
+    response->BodyLength = length;
+    for (size_t got = 0; got < length;) {
+        ssize_t n = recv(sock, response->Body + got, length - got, 0);
+        if (n <= 0) {
+            return false;
+        }
+        got += (size_t)n;
+    }
+    response->Body[length] = '\0';
+    return true;
+}
+
+/* One request on a fresh connection */
+static void fetch(int port, const char* request, bool head_only, Response* response) {
+    int sock = connect_to(port);
+    send_text(sock, request);
+    CHECK(read_response(sock, head_only, response));
+    close(sock);
+}
+
+/* Files are served whole, in part or not at all */
+static void test_get(void) {
+    char dir[] = "/tmp/ll_assetserver_XXXXXX";
+    make_tree(dir);
+    int port = 0;
+    AssetServer* server = start_server(dir, NULL, &port);
+    char value[64];
+
+    Response response;
+    fetch(port, "GET /hello.txt HTTP/1.1\r\nHost: x\r\n\r\n", false, &response);
+    CHECK(response.Status == 200 && response.BodyLength == 11 && strcmp(response.Body, "hello world") == 0);
+    CHECK(strcmp(header(&response, "Content-Type", value, sizeof(value)), "text/plain; charset=utf-8") == 0);
+    free(response.Body);
+
+    fetch(port, "GET /icons/a%20b.png?v=3 HTTP/1.1\r\n\r\n", false, &response);
+    CHECK(response.Status == 200 && strcmp(response.Body, "PNGDATA") == 0);
+    free(response.Body);
+
+    fetch(port, "HEAD /hello.txt HTTP/1.1\r\n\r\n", true, &response);
+    CHECK(response.Status == 200 && strcmp(header(&response, "Content-Length", value, sizeof(value)), "11") == 0);
+    free(response.Body);
+
+    fetch(port, "GET /hello.txt HTTP/1.1\r\nRange: bytes=6-\r\n\r\n", false, &response);
+    CHECK(response.Status == 206 && strcmp(response.Body, "world") == 0);
+    CHECK(strcmp(header(&response, "Content-Range", value, sizeof(value)), "bytes 6-10/11") == 0);
+    free(response.Body);
+
+    fetch(port, "GET /hello.txt HTTP/1.1\r\nRange: bytes=50-60\r\n\r\n", false, &response);
+    CHECK(response.Status == 416);
+    free(response.Body);
+
+    /* Missing, outside the root, a directory, or not a method served */
+    fetch(port, "GET /missing.txt HTTP/1.1\r\n\r\n", false, &response);
+    CHECK(response.Status == 404);
+    free(response.Body);
+    fetch(port, "GET /icons/../../etc/passwd HTTP/1.1\r\n\r\n", false, &response);
+    CHECK(response.Status == 404);
+    free(response.Body);
+    fetch(port, "GET /icons HTTP/1.1\r\n\r\n", false, &response);
+    CHECK(response.Status == 404);
+    free(response.Body);
+    fetch(port, "POST /hello.txt HTTP/1.1\r\nContent-Length: 0\r\n\r\n", false, &response);
+    CHECK(response.Status == 405);
+    free(response.Body);
+
+    int64_t requests = 0;
+    int64_t bytes = 0;
+    asset_server_get_stats(server, &requests, &bytes);
+    CHECK(requests >= 9 && bytes > 0);
+    asset_server_free(server);
+    remove_tree(dir);
+}
+
+/* Pipelined requests are answered in order on one connection, until it asks to close */
+static void test_keep_alive(void) {
+    char dir[] = "/tmp/ll_assetserver_XXXXXX";
+    make_tree(dir);
+    int port = 0;
+    AssetServer* server = start_server(dir, NULL, &port);
+
+    int sock = connect_to(port);
+    send_text(sock, "GET /hello.txt HTTP/1.1\r\n\r\nHEAD /map.json HTTP/1.1\r\n\r\n"
+                    "GET /icons/a%20b.png HTTP/1.1\r\nConnection: close\r\n\r\n");
+    Response response;
+    CHECK(read_response(sock, false, &response) && strcmp(response.Body, "hello world") == 0);
+    free(response.Body);
+    CHECK(read_response(sock, true, &response) && response.Status == 200);
+    free(response.Body);
+    CHECK(read_response(sock, false, &response) && strcmp(response.Body, "PNGDATA") == 0);
+    free(response.Body);
+    char byte;
+    CHECK(recv(sock, &byte, 1, 0) == 0);
+    close(sock);
+    asset_server_free(server);
+    remove_tree(dir);
+}
+
+/* Cached files carry an ETag that revalidates, and text goes out gzipped when asked */
+static void test_validators_and_gzip(void) {
+    char dir[] = "/tmp/ll_assetserver_XXXXXX";
+    make_tree(dir);
+    int port = 0;
+    AssetServer* server = start_server(dir, NULL, &port);
+    char etag[64];
+    char value[64];
+    char request[256];
+
+    Response response;
+    fetch(port, "GET /map.json HTTP/1.1\r\n\r\n", false, &response);
+    CHECK(response.Status == 200 && response.BodyLength == TEXT_SIZE);
+    header(&response, "ETag", etag, sizeof(etag));
+    CHECK(etag[0] == '"');
+    CHECK(strcmp(header(&response, "Vary", value, sizeof(value)), "Accept-Encoding") == 0);
+    free(response.Body);
+
+    snprintf(request, sizeof(request), "GET /map.json HTTP/1.1\r\nIf-None-Match: %s\r\n\r\n", etag);
+    fetch(port, request, true, &response);
+    CHECK(response.Status == 304);
+    free(response.Body);
+
+    fetch(port, "GET /map.json HTTP/1.1\r\nAccept-Encoding: gzip, deflate\r\n\r\n", false, &response);
+    CHECK(response.Status == 200 && response.BodyLength < TEXT_SIZE / 4);
+    CHECK(strcmp(header(&response, "Content-Encoding", value, sizeof(value)), "gzip") == 0);
+    CHECK((unsigned char)response.Body[0] == 0x1f && (unsigned char)response.Body[1] == 0x8b);
+    CHECK(strcmp(header(&response, "ETag", value, sizeof(value)), etag) != 0);
+    free(response.Body);
+
+    /* A range is always of the file itself */
+    fetch(port, "GET /map.json HTTP/1.1\r\nAccept-Encoding: gzip\r\nRange: bytes=0-8\r\n\r\n", false, &response);
+    CHECK(response.Status == 206 && strcmp(response.Body, "the quick") == 0);
+    free(response.Body);
+    asset_server_free(server);
+    remove_tree(dir);
+}
+
+/* A pack is served from its mapping, whole or by entry, with the root as fallback */
+static void test_pack(void) {
+    char dir[] = "/tmp/ll_assetserver_XXXXXX";
+    make_tree(dir);
+    char pack_path[512];
+    snprintf(pack_path, sizeof(pack_path), "%s.pack", dir);
+    CHECK(asset_pack_build(dir, pack_path, NULL));
+    put_file(dir, "late.txt", "added later", 11);
+    int port = 0;
+    AssetServer* server = start_server(dir, pack_path, &port);
+
+    Response response;
+    fetch(port, "GET /hello.txt HTTP/1.1\r\n\r\n", false, &response);
+    CHECK(response.Status == 200 && strcmp(response.Body, "hello world") == 0);
+    free(response.Body);
+    fetch(port, "GET /late.txt HTTP/1.1\r\n\r\n", false, &response);
+    CHECK(response.Status == 200 && strcmp(response.Body, "added later") == 0);
+    free(response.Body);
+    fetch(port, "GET /" ASSET_PACK_URL_PATH " HTTP/1.1\r\nRange: bytes=0-7\r\n\r\n", false, &response);
+    CHECK(response.Status == 206 && memcmp(response.Body, ASSET_PACK_MAGIC, 8) == 0);
+    free(response.Body);
+    asset_server_free(server);
+    unlink(pack_path);
+    remove_tree(dir);
+}
+
+int main(void) {
+    RUN(test_get);
+    RUN(test_keep_alive);
+    RUN(test_validators_and_gzip);
+    RUN(test_pack);
+    return TEST_RESULT();
+}
@@ -0,0 +1,207 @@
+/*
+ * Luminous Locus Auth Test
+ * Secret comparison, direct checks and the login worker pool
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../model.h"
+#include "../json_db.h"
+#include "../auth.h"
+#include "test.h"
+
+/* Logins submitted at once to the pool */
+#define BURST 200
+
+/* Longest wait for jobs or a reload */
+#define WAIT_MS 3000
+
+/* Users the tests log in as */
+static const char users[] =
+    "{\"admin\":{\"passhash\":\"aa11\",\"is-admin\":true},\"bob\":{\"passhash\":\"bb22\",\"is-admin\":false}}";
+
+/* Database file shared by the tests */
+static char db_path[512];
+
+/* Jobs handed back by the workers */
+static pthread_mutex_t done_mutex = PTHREAD_MUTEX_INITIALIZER;
+static AuthJob* done_jobs;
+static int done_count;
+static int unwiped;
+
+/* Collect a checked job, noting whether its password was wiped first */
+static void on_done(AuthJob* job) {
+    bool wiped = true;
+    for (size_t i = 0; i < sizeof(job->Password); i++) {
+        wiped = wiped && job->Password[i] == '\0';
+    }
+    pthread_mutex_lock(&done_mutex);
+    unwiped += !wiped;
+    job->Next = done_jobs;
+    done_jobs = job;
+    done_count++;
+    pthread_mutex_unlock(&done_mutex);
+}
+
+/* Wait for count jobs in all */
+static bool wait_done(int count) {
+    for (int waited = 0; waited < WAIT_MS; waited++) {
+        pthread_mutex_lock(&done_mutex);
+        bool done = done_count >= count;
+        pthread_mutex_unlock(&done_mutex);
+        if (done) {
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+/* Free collected jobs */
+static void free_done(void) {
+    while (done_jobs != NULL) {
+        AuthJob* next = done_jobs->Next;
+        free(done_jobs);
+        done_jobs = next;
+    }
+    done_count = 0;
+}
+
+/* Create a job for one login */
+static AuthJob* make_job(int client_id, const char* login, const char* password, bool guest) {
+    AuthJob* job = (AuthJob*)calloc(1, sizeof(AuthJob));
+    job->Done = on_done;
+    job->ClientID = client_id;
+    job->IsGuest = guest;
+    snprintf(job->Login, sizeof(job->Login), "%s", login);
+    snprintf(job->Password, sizeof(job->Password), "%s", password);
+    return job;
+}
+
+/* Submit one job and wait for it, returning it */
+static AuthJob* check_one(AuthPool* pool, const char* login, const char* password) {
+    int before = done_count;
+    CHECK(auth_pool_submit(pool, make_job(1, login, password, false)));
+    CHECK(wait_done(before + 1));
+    return done_jobs;
+}
+
+/* Write the database file, renamed into place */
+static void write_db(const char* path, const char* text) {
+    char temp[520];
+    snprintf(temp, sizeof(temp), "%s.new", path);
+    FILE* file = fopen(temp, "w");
+    CHECK(file != NULL);
+    if (file != NULL) {
+        fputs(text, file);
+        fclose(file);
+    }
+    CHECK(rename(temp, path) == 0);
+}
+
+/* Equal only when both secrets are the same, whatever their lengths */
+static void test_equal(void) {
+    CHECK(auth_equal("bb22", "bb22"));
+    CHECK(auth_equal("", ""));
+    CHECK(!auth_equal("bb22", "bb2"));
+    CHECK(!auth_equal("bb2", "bb22"));
+    CHECK(!auth_equal("bb22", "bb23"));
+    CHECK(!auth_equal("", "x"));
+
+    char long_secret[AUTH_SECRET_WIDTH + 8];
+    memset(long_secret, 'k', sizeof(long_secret) - 1);
+    long_secret[sizeof(long_secret) - 1] = '\0';
+    CHECK(!auth_equal(long_secret, long_secret));
+    long_secret[AUTH_SECRET_WIDTH - 1] = '\0';
+    CHECK(auth_equal(long_secret, long_secret));
+}
+
+/* Direct checks against the database */
+static void test_authenticate(void) {
+    json_db_t* db = json_db_create(db_path);
+    UserInfo info;
+    CHECK(authenticate(db, "bob", "bb22", false, &info) == 0);
+    CHECK(strcmp(info.Login, "bob") == 0 && !info.IsAdmin);
+    CHECK(authenticate(db, "admin", "aa11", false, &info) == 0 && info.IsAdmin);
+    CHECK(authenticate(db, "bob", "aa11", false, &info) == ErrNotAuthenticated);
+    CHECK(authenticate(db, "carol", "", false, &info) == ErrNotAuthenticated);
+    CHECK(authenticate(db, "anyone", "", true, &info) == 0 && info.Login[0] == '\0' && !info.IsAdmin);
+    json_db_free(db);
+}
+
+/* A burst of logins is checked off the submitting thread, each exactly once */
+static void test_pool_burst(void) {
+    json_db_t* db = json_db_create(db_path);
+    AuthPool* pool = auth_pool_create(db, 4);
+    CHECK(pool != NULL);
+    for (int i = 0; i < BURST; i++) {
+        const char* password = i % 3 == 0 ? "wrong" : "bb22";
+        CHECK(auth_pool_submit(pool, make_job(i, i % 5 == 0 ? "guest" : "bob", password, i % 5 == 0)));
+    }
+    CHECK(wait_done(BURST));
+
+    int seen[BURST] = {0};
+    for (AuthJob* job = done_jobs; job != NULL; job = job->Next) {
+        seen[job->ClientID]++;
+        bool should_pass = job->IsGuest || job->ClientID % 3 != 0;
+        CHECK((job->Result == 0) == should_pass);
+    }
+    for (int i = 0; i < BURST; i++) {
+        CHECK(seen[i] == 1);
+    }
+    CHECK(unwiped == 0);
+    free_done();
+    auth_pool_free(pool);
+    json_db_free(db);
+}
+
+/* A repeated login is taken from the cache until the stored hash changes */
+static void test_pool_cache(void) {
+    json_db_t* db = json_db_create(db_path);
+    AuthPool* pool = auth_pool_create(db, 1);
+
+    AuthJob* job = check_one(pool, "bob", "bb22");
+    CHECK(job->Result == 0 && !job->Cached);
+    job = check_one(pool, "bob", "bb22");
+    CHECK(job->Result == 0 && job->Cached);
+    job = check_one(pool, "bob", "wrong");
+    CHECK(job->Result == ErrNotAuthenticated && !job->Cached);
+
+    /* A reload with a new hash turns the old password away */
+    int64_t reloads = 0;
+    write_db(db_path, "{\"bob\":{\"passhash\":\"cc33\"}}");
+    for (int waited = 0; waited < WAIT_MS && reloads == 0; waited++) {
+        json_db_get_stats(db, NULL, &reloads);
+        usleep(1000);
+    }
+    CHECK(reloads > 0);
+    job = check_one(pool, "bob", "bb22");
+    CHECK(job->Result == ErrNotAuthenticated && !job->Cached);
+    job = check_one(pool, "bob", "cc33");
+    CHECK(job->Result == 0 && !job->Cached);
+    write_db(db_path, users);
+    free_done();
+
+    auth_pool_free(pool);
+    json_db_free(db);
+}
+
+int main(void) {
+    char dir[] = "/tmp/ll_auth_XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    snprintf(db_path, sizeof(db_path), "%s/auth.json", dir);
+    write_db(db_path, users);
+
+    RUN(test_equal);
+    RUN(test_authenticate);
+    RUN(test_pool_burst);
+    RUN(test_pool_cache);
+    unlink(db_path);
+    rmdir(dir);
+    return TEST_RESULT();
+}
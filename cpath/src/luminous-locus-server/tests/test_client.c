@@ -0,0 +1,128 @@
+/*
+ * Luminous Locus Client Test
+ * IDs, stale lookups and packing of the client slot map
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../client.h"
+#include "test.h"
+
+/* Clients registered by the churn test */
+#define CHURN_CLIENTS 300
+
+/* Registered clients resolve to their details */
+static void test_register_and_get(void) {
+    ClientRegistry* reg = client_registry_create();
+    int a = client_registry_register(reg, "10.0.0.1", 4000, "alice", false);
+    int b = client_registry_register(reg, "10.0.0.2", 4001, "bob", true);
+    CHECK(a >= 0 && b >= 0 && a != b);
+    CHECK(client_registry_count(reg) == 2);
+
+    struct Client* client = client_registry_get(reg, b);
+    CHECK(client != NULL && client->ID == b && client->IsAdmin && client->State == CLIENT_CONNECTING);
+    struct ClientInfo* info = client_registry_get_info(reg, a);
+    CHECK(info != NULL && strcmp(info->Login, "alice") == 0 && info->Port == 4000);
+    CHECK(strcmp(info->Address, "10.0.0.1") == 0);
+    CHECK(client_registry_get(reg, -1) == NULL && client_registry_get(reg, a + b + 1) == NULL);
+    client_registry_free(reg);
+}
+
+/* An ID kept after its client left does not resolve to the slot's next owner */
+static void test_stale_id(void) {
+    ClientRegistry* reg = client_registry_create();
+    int first = client_registry_register(reg, "a", 1, "first", false);
+    CHECK(client_registry_remove(reg, first));
+    CHECK(!client_registry_remove(reg, first));
+
+    int second = client_registry_register(reg, "b", 2, "second", false);
+    CHECK(second != first);
+    CHECK(client_registry_get(reg, first) == NULL);
+    CHECK(client_registry_get_info(reg, first) == NULL);
+    CHECK(strcmp(client_registry_get_info(reg, second)->Login, "second") == 0);
+    client_registry_free(reg);
+}
+
+/* Partitions hand out striped IDs and refuse the others' */
+static void test_partition(void) {
+    ClientRegistry* reg = client_registry_create_partition(2, 4);
+    for (int i = 0; i < 10; i++) {
+        int id = client_registry_register(reg, "x", i, "p", false);
+        CHECK(id >= 2 && id % 4 == 2);
+    }
+    int id = client_registry_register(reg, "x", 0, "p", false);
+    CHECK(client_registry_get(reg, id) != NULL);
+    CHECK(client_registry_get(reg, id + 1) == NULL);
+    CHECK(client_registry_get(reg, id - 2) == NULL);
+    client_registry_free(reg);
+}
+
+/* Removal keeps live clients packed, every survivor stays reachable */
+static void test_churn(void) {
+    ClientRegistry* reg = client_registry_create();
+    int ids[CHURN_CLIENTS];
+    bool live[CHURN_CLIENTS];
+    for (int i = 0; i < CHURN_CLIENTS; i++) {
+        char login[16];
+        snprintf(login, sizeof(login), "user%d", i);
+        ids[i] = client_registry_register(reg, "x", i, login, false);
+        live[i] = ids[i] >= 0;
+        CHECK(live[i]);
+    }
+    int count = CHURN_CLIENTS;
+    for (int round = 0; round < 2000; round++) {
+        int i = (int)(test_rand() % CHURN_CLIENTS);
+        if (live[i]) {
+            CHECK(client_registry_remove(reg, ids[i]));
+            live[i] = false;
+            count--;
+        } else {
+            int old = ids[i];
+            ids[i] = client_registry_register(reg, "x", i, "again", false);
+            CHECK(ids[i] >= 0 && client_registry_get(reg, old) == NULL);
+            live[i] = true;
+            count++;
+        }
+    }
+    CHECK(client_registry_count(reg) == count);
+    for (int i = 0; i < CHURN_CLIENTS; i++) {
+        struct Client* client = client_registry_get(reg, ids[i]);
+        CHECK(live[i] ? client != NULL && client->ID == ids[i] : client == NULL);
+        if (live[i]) {
+            CHECK(client_registry_get_info(reg, ids[i])->Port == i);
+        }
+    }
+    int seen = 0;
+    for (int index = 0; client_registry_at(reg, index) != NULL; index++) {
+        struct Client* client = client_registry_at(reg, index);
+        CHECK(client_registry_get(reg, client->ID) == client);
+        seen++;
+    }
+    CHECK(seen == count);
+    client_registry_free(reg);
+}
+
+/* Only clients past their login count as logged in */
+static void test_logged_in(void) {
+    ClientRegistry* reg = client_registry_create();
+    struct Client* client = client_registry_get(reg, client_registry_register(reg, "x", 1, "l", false));
+    CHECK(!client_is_logged_in(client));
+    client->State = CLIENT_AUTHENTICATING;
+    CHECK(!client_is_logged_in(client));
+    client->State = CLIENT_LOGGED_IN;
+    CHECK(client_is_logged_in(client));
+    client_mark_active(client);
+    CHECK(client->State == CLIENT_ACTIVE && client_is_logged_in(client));
+    CHECK(!client_is_logged_in(NULL));
+    client_registry_free(reg);
+}
+
+int main(void) {
+    RUN(test_register_and_get);
+    RUN(test_stale_id);
+    RUN(test_partition);
+    RUN(test_churn);
+    RUN(test_logged_in);
+    return TEST_RESULT();
+}
@@ -0,0 +1,136 @@
+/*
+ * Luminous Locus Compact Codec Test
+ * Protocol v3 bodies and their JSON fallback
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "../model.h"
+#include "../json_decode.h"
+#include "../compact_codec.h"
+#include "test.h"
+
+/* Every supported struct survives both encodings */
+static void test_round_trips(void) {
+    char body[COMPACT_BODY_MAX];
+    char json[COMPACT_JSON_MAX];
+
+    MessageMouseClick click = { .ID = -5, .Object = INT_MAX, .Action = "drag \"this\"\n" };
+    MessageMouseClick click_out;
+    size_t length = compact_encode(MSGID_MOUSECLICK, &click, body, sizeof(body));
+    CHECK(length > 0 && compact_is_body(body, length));
+    CHECK(compact_decode(MSGID_MOUSECLICK, body, length, &click_out));
+    CHECK(memcmp(&click, &click_out, sizeof(click)) == 0);
+
+    length = compact_encode_json(MSGID_MOUSECLICK, &click, json, sizeof(json));
+    CHECK(length > 0 && !compact_is_body(json, length));
+    memset(&click_out, 0xff, sizeof(click_out));
+    CHECK(json_decode_message(MSGID_MOUSECLICK, json, length, &click_out) == JSON_DECODE_OK);
+    CHECK(click_out.ID == click.ID && click_out.Object == click.Object);
+    CHECK(strcmp(click_out.Action, click.Action) == 0);
+
+    MessageHash hash = { .Hash = INT_MIN, .Tick = 123456 };
+    MessageHash hash_out;
+    length = compact_encode(MSGID_HASH, &hash, body, sizeof(body));
+    CHECK(compact_decode(MSGID_HASH, body, length, &hash_out));
+    CHECK(hash_out.Hash == INT_MIN && hash_out.Tick == 123456);
+    length = compact_encode_json(MSGID_HASH, &hash, json, sizeof(json));
+    CHECK(json_decode_message(MSGID_HASH, json, length, &hash_out) == JSON_DECODE_OK);
+    CHECK(hash_out.Hash == INT_MIN && hash_out.Tick == 123456);
+
+    MessageInput input = { .ID = 0, .Key = "" };
+    MessageInput input_out;
+    length = compact_encode(MSGID_INPUT, &input, body, sizeof(body));
+    CHECK(length == 1);
+    CHECK(compact_decode(MSGID_INPUT, body, length, &input_out));
+    CHECK(input_out.ID == 0 && input_out.Key[0] == '\0');
+
+    CHECK(compact_encode(MSGID_NEWTICK, NULL, body, sizeof(body)) == 1);
+    CHECK(compact_encode_json(MSGID_NEWTICK, NULL, json, sizeof(json)) == 2 && memcmp(json, "{}", 2) == 0);
+}
+
+/* Only the per-tick kinds have a compact form */
+static void test_supported_kinds(void) {
+    CHECK(compact_supports(MSGID_INPUT) && compact_supports(MSGID_HASH) && compact_supports(MSGID_NEWTICK));
+    CHECK(!compact_supports(MSGID_LOGIN) && !compact_supports(MSGID_OOCMESSAGE));
+
+    MessageLogin login;
+    char body[COMPACT_BODY_MAX];
+    memset(&login, 0, sizeof(login));
+    CHECK(compact_encode(MSGID_LOGIN, &login, body, sizeof(body)) == 0);
+    CHECK(!compact_is_body("{}", 2) && !compact_is_body("", 0));
+}
+
+/* A body that does not fit is refused, not cut */
+static void test_small_buffers(void) {
+    MessageInput input = { .ID = 1 };
+    memset(input.Key, 'k', sizeof(input.Key) - 1);
+    input.Key[sizeof(input.Key) - 1] = '\0';
+    char out[64];
+    CHECK(compact_encode(MSGID_INPUT, &input, out, sizeof(out)) == 0);
+    CHECK(compact_encode_json(MSGID_INPUT, &input, out, sizeof(out)) == 0);
+
+    /* A key filling its whole buffer has no terminator to trust */
+    char big[COMPACT_JSON_MAX];
+    memset(input.Key, 'k', sizeof(input.Key));
+    CHECK(compact_encode_json(MSGID_INPUT, &input, big, sizeof(big)) == 0);
+}
+
+/* Unknown keys are skipped by wire type */
+static void test_skips_unknown_keys(void) {
+    /* id 2, key 9 as a varint, key 10 as bytes "zz", key "q" */
+    const char body[] = "\xb3\x02\x04\x12\x7f\x15\x02zz\x05\x01q";
+    MessageInput input;
+    CHECK(compact_decode(MSGID_INPUT, body, sizeof(body) - 1, &input));
+    CHECK(input.ID == 2 && strcmp(input.Key, "q") == 0);
+}
+
+/* Truncated and malformed bodies are rejected */
+static void test_rejects_corrupt(void) {
+    MessageInput input;
+    MessageHash hash;
+    CHECK(!compact_decode(MSGID_INPUT, "\xb3\x02", 2, &input));                 /* tag without value */
+    CHECK(!compact_decode(MSGID_INPUT, "\xb3\x05\x05q", 4, &input));            /* string runs off the end */
+    CHECK(!compact_decode(MSGID_INPUT, "\xb3\x04\x01", 3, &input));             /* string sent as varint */
+    CHECK(!compact_decode(MSGID_INPUT, "\xb3\x03\x01q", 4, &input));            /* integer sent as bytes */
+    CHECK(!compact_decode(MSGID_INPUT, "\xb3\x02\xff\xff\xff\xff\x7f", 7, &input)); /* past INT_MAX */
+    CHECK(!compact_decode(MSGID_HASH, "\xb3\x0a\x80\x80\x80\x80\x10", 7, &hash)); /* past 32 bits */
+    CHECK(!compact_decode(MSGID_INPUT, "\xb3\x02\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01", 13, &input));
+    CHECK(!compact_decode(MSGID_INPUT, "{}", 2, &input));
+
+    char body[200];
+    body[0] = (char)COMPACT_MARKER;
+    body[1] = 0x05;
+    body[2] = (char)(0x80 | 128);
+    body[3] = 0x01;
+    memset(body + 4, 'k', 160);
+    CHECK(!compact_decode(MSGID_INPUT, body, 164, &input));
+}
+
+/* Every cut of a valid body is rejected or decodes without overrun */
+static void test_every_truncation(void) {
+    MessageMouseClick click = { .ID = 300, .Object = -70000, .Action = "use" };
+    MessageMouseClick out;
+    char body[COMPACT_BODY_MAX];
+    size_t length = compact_encode(MSGID_MOUSECLICK, &click, body, sizeof(body));
+    for (size_t cut = 1; cut < length; cut++) {
+        char* copy = (char*)malloc(cut);
+        memcpy(copy, body, cut);
+        if (compact_decode(MSGID_MOUSECLICK, copy, cut, &out)) {
+            CHECK(memcmp(&out, &click, sizeof(out)) != 0);
+        }
+        free(copy);
+    }
+}
+
+int main(void) {
+    RUN(test_round_trips);
+    RUN(test_supported_kinds);
+    RUN(test_small_buffers);
+    RUN(test_skips_unknown_keys);
+    RUN(test_rejects_corrupt);
+    RUN(test_every_truncation);
+    return TEST_RESULT();
+}
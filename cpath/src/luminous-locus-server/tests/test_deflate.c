@@ -0,0 +1,160 @@
+/*
+ * Luminous Locus Deflate Test
+ * Checksums, gzip framing and deflate round trips
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../deflate.h"
+#include "test.h"
+
+/* Round trip sizes, around the window and the stored block limit */
+static const size_t round_trip_sizes[] = { 0, 1, 3, 4, 100, 32768, 32769, 70000, 200000 };
+
+/* Little-endian 32-bit read */
+static uint32_t load32(const char* p) {
+    const unsigned char* u = (const unsigned char*)p;
+    return (uint32_t)u[0] | (uint32_t)u[1] << 8 | (uint32_t)u[2] << 16 | (uint32_t)u[3] << 24;
+}
+
+/* Text with plenty of repeats */
+static void fill_text(char* out, size_t length) {
+    static const char words[] = "lockstep input tick hash client reactor frame ";
+    for (size_t i = 0; i < length; i++) {
+        out[i] = words[(i * 7 + i / 13) % (sizeof(words) - 1)];
+    }
+}
+
+/* Noise that does not compress */
+static void fill_noise(char* out, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        out[i] = (char)(test_rand() >> 3);
+    }
+}
+
+/* Standard check value, in one call or many */
+static void test_crc32(void) {
+    CHECK(crc32_update(0, "123456789", 9) == 0xcbf43926u);
+    CHECK(crc32_update(crc32_update(0, "1234", 4), "56789", 5) == 0xcbf43926u);
+    CHECK(crc32_update(0, "", 0) == 0);
+}
+
+/* A gzip member has its header, and the CRC and size of the input at the end */
+static void test_gzip_framing(void) {
+    char data[5000];
+    fill_text(data, sizeof(data));
+    size_t capacity = gzip_bound(sizeof(data));
+    char* out = (char*)malloc(capacity);
+    size_t length = gzip_compress(data, sizeof(data), out, capacity);
+    CHECK(length > 18 && length < sizeof(data) / 4);
+    CHECK((unsigned char)out[0] == 0x1f && (unsigned char)out[1] == 0x8b && out[2] == 8);
+    CHECK(load32(out + length - 8) == crc32_update(0, data, sizeof(data)));
+    CHECK(load32(out + length - 4) == sizeof(data));
+    CHECK(gzip_compress(data, sizeof(data), out, capacity - 1) == 0);
+    free(out);
+}
+
+/* Incompressible input stays within the bound */
+static void test_bound(void) {
+    char data[10000];
+    fill_noise(data, sizeof(data));
+    char* out = (char*)malloc(deflate_bound(sizeof(data)));
+    size_t length = deflate_compress(data, sizeof(data), out, deflate_bound(sizeof(data)));
+    CHECK(length > 0 && length <= deflate_bound(sizeof(data)));
+    CHECK(deflate_compress(data, sizeof(data), out, 100) == 0);
+    free(out);
+}
+
+/* Standard check value of the zlib checksum */
+static void test_adler32(void) {
+    CHECK(adler32_update(1, "Wikipedia", 9) == 0x11e60398u);
+    CHECK(adler32_update(adler32_update(1, "Wiki", 4), "pedia", 5) == 0x11e60398u);
+    CHECK(adler32_update(1, "", 0) == 1);
+}
+
+/* Whatever is compressed inflates back to the same bytes */
+static void test_round_trip(void) {
+    for (size_t i = 0; i < sizeof(round_trip_sizes) / sizeof(round_trip_sizes[0]); i++) {
+        for (int noise = 0; noise < 2; noise++) {
+            size_t size = round_trip_sizes[i];
+            char* data = (char*)malloc(size + 1);
+            char* packed = (char*)malloc(zlib_bound(size));
+            char* unpacked = (char*)malloc(size + 1);
+            if (noise) {
+                fill_noise(data, size);
+            } else {
+                fill_text(data, size);
+            }
+
+            size_t packed_length = deflate_compress(data, size, packed, deflate_bound(size));
+            size_t unpacked_length = 0;
+            CHECK(packed_length > 0);
+            CHECK(deflate_decompress(packed, packed_length, unpacked, size + 1, &unpacked_length));
+            CHECK(unpacked_length == size && memcmp(unpacked, data, size) == 0);
+
+            packed_length = zlib_compress(data, size, packed, zlib_bound(size));
+            CHECK(packed_length > 0 && (packed[0] & 0x0f) == 8);
+            CHECK(zlib_decompress(packed, packed_length, unpacked, size + 1, &unpacked_length));
+            CHECK(unpacked_length == size && memcmp(unpacked, data, size) == 0);
+            free(data);
+            free(packed);
+            free(unpacked);
+        }
+    }
+}
+
+/* Stored and dynamic Huffman blocks, which the compressor never writes */
+static void test_other_blocks(void) {
+    static const char stored[] = "\x01\x05\x00\xfa\xff" "hello";
+    char out[256];
+    size_t length = 0;
+    CHECK(deflate_decompress(stored, sizeof(stored) - 1, out, sizeof(out), &length));
+    CHECK(length == 5 && memcmp(out, "hello", 5) == 0);
+
+    /* zlib level 9 with Huffman only, one dynamic block */
+    static const char text[] =
+        "attaetestataqeataahetqteesaasateras aa taa aqaetrehneernteaeaaaeaase saetqetettetaesaatshahetttahsasq"
+        "taaaaeseaenaeaaae eaatt aehtetataaaaaattaaeataahaeeeaeeeteststatntaesrhaaeatateaneteaettsaasseeeset";
+    static const char dynamic[] =
+        "\x05\xc1\xb1\x09\xc0\x30\x10\xc0\xc0\x55\xbc\x9a\x0a\xc1\x57\x06\xe7\xb5\x3f\xb9\xa3\x30\x37\xe2\x49"
+        "\x30\xf6\xd2\x85\x25\x3f\xf6\xc0\x09\x0e\x0f\xfb\x9c\xab\xdf\x4d\x04\x84\xf5\x2c\xf6\xcc\x32\x5c\x68"
+        "\x87\xb1\x62\x96\x7d\x01\xb8\xe2\x45\xc0\x23\xd4\xc1\xc9\x08\x00\x0a\x24\x18\x54\xd4\xdc\x36\xba\xe1"
+        "\x7e\x03\x12\xc9\x35\xb1\x16\x76\xd5\xb5\x1f";
+    CHECK(deflate_decompress(dynamic, sizeof(dynamic) - 1, out, sizeof(out), &length));
+    CHECK(length == sizeof(text) - 1 && memcmp(out, text, length) == 0);
+}
+
+/* Truncated, corrupted or oversized streams are refused */
+static void test_corrupt(void) {
+    char data[4000];
+    fill_text(data, sizeof(data));
+    char packed[8000];
+    char out[4000];
+    size_t length = 0;
+    size_t packed_length = zlib_compress(data, sizeof(data), packed, sizeof(packed));
+
+    CHECK(!zlib_decompress(packed, packed_length - 5, out, sizeof(out), &length));
+    CHECK(!zlib_decompress(packed, packed_length, out, sizeof(out) - 1, &length));
+    packed[packed_length - 1] ^= 1;
+    CHECK(!zlib_decompress(packed, packed_length, out, sizeof(out), &length));
+    packed[packed_length - 1] ^= 1;
+    packed[0] = 0x79;
+    CHECK(!zlib_decompress(packed, packed_length, out, sizeof(out), &length));
+
+    /* Reserved block type, and a stored length that disagrees with its complement */
+    CHECK(!deflate_decompress("\x07\x00", 2, out, sizeof(out), &length));
+    CHECK(!deflate_decompress("\x01\x05\x00\xfb\xff" "hello", 10, out, sizeof(out), &length));
+}
+
+int main(void) {
+    RUN(test_crc32);
+    RUN(test_gzip_framing);
+    RUN(test_bound);
+    RUN(test_adler32);
+    RUN(test_round_trip);
+    RUN(test_other_blocks);
+    RUN(test_corrupt);
+    return TEST_RESULT();
+}
@@ -0,0 +1,164 @@
+/*
+ * Luminous Locus DMI Atlas Test
+ * Cutting sheets into frames, dropping duplicates and finding them again
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../png_codec.h"
+#include "../dmi_meta.h"
+#include "../dmi_atlas.h"
+#include "test.h"
+
+/* Icon size and sheet layout: 3 columns, 2 rows */
+#define ICON 8
+#define COLUMNS 3
+#define ROWS 2
+
+/* Three states over seven icons, the last of which is past the end of the sheet */
+static const char sidecar[] =
+    "{\"info\":{\"width\":8,\"height\":8},\"states\":["
+    "{\"state\":\"idle\"},{\"state\":\"walk\",\"dirs\":2,\"frames\":2},{\"state\":\"gone\",\"frames\":2}]}";
+
+/* One state whose only frame is the same as idle's */
+static const char other_sidecar[] = "{\"info\":{\"width\":8,\"height\":8},\"states\":[{\"state\":\"still\"}]}";
+
+/* Color of sheet icon k, walk's second frame facing south repeats its first */
+static void icon_color(int k, uint8_t* rgba) {
+    if (k == 3) {
+        k = 1;
+    }
+    rgba[0] = (uint8_t)(k * 40);
+    rgba[1] = (uint8_t)(255 - k * 30);
+    rgba[2] = (uint8_t)k;
+    rgba[3] = 255;
+}
+
+/* Encode the sheet, a solid color per icon */
+static char* make_sheet(size_t* length) {
+    uint32_t width = ICON * COLUMNS;
+    uint32_t height = ICON * ROWS;
+    uint8_t pixels[ICON * COLUMNS * ICON * ROWS * 4];
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            icon_color((int)(y / ICON * COLUMNS + x / ICON), &pixels[(y * width + x) * 4]);
+        }
+    }
+    return png_encode(pixels, width, height, length);
+}
+
+/* Add a sheet with its sidecar compiled */
+static bool add_sheet(DmiAtlasBuilder* builder, const char* path, const char* json, const char* sheet,
+                      size_t sheet_length) {
+    size_t table_length = 0;
+    void* table = dmi_meta_compile(json, strlen(json), sheet, sheet_length, &table_length);
+    CHECK(table != NULL);
+    bool added = dmi_atlas_builder_add(builder, path, sheet, sheet_length, table, table_length);
+    free(table);
+    return added;
+}
+
+/* Build the atlas of both icons */
+static DmiAtlasBuilder* build(void) {
+    size_t sheet_length = 0;
+    char* sheet = make_sheet(&sheet_length);
+    DmiAtlasBuilder* builder = dmi_atlas_builder_create();
+    CHECK(add_sheet(builder, "icons/mob.dmi", sidecar, sheet, sheet_length));
+    CHECK(add_sheet(builder, "icons/a/other.dmi", other_sidecar, sheet, sheet_length));
+    CHECK(dmi_atlas_builder_finish(builder));
+    free(sheet);
+    return builder;
+}
+
+/* Check the pixels of a rect on its decoded page against sheet icon k */
+static void check_rect(const PngImage* page, const DmiAtlasRect* rect, int k) {
+    uint8_t expected[4];
+    icon_color(k, expected);
+    CHECK(rect != NULL);
+    if (rect == NULL) {
+        return;
+    }
+    CHECK(rect->Width == ICON && rect->Height == ICON);
+    CHECK((uint32_t)rect->X + ICON <= page->Width && (uint32_t)rect->Y + ICON <= page->Height);
+    for (int y = 0; y < ICON; y++) {
+        for (int x = 0; x < ICON; x++) {
+            CHECK_BYTES(&page->Pixels[((size_t)(rect->Y + y) * page->Width + rect->X + x) * 4], expected, 4);
+        }
+    }
+}
+
+/* Every frame is found where its pixels were drawn, repeats share a rect */
+static void test_find(void) {
+    DmiAtlasBuilder* builder = build();
+    DmiAtlasStats stats;
+    dmi_atlas_builder_get_stats(builder, &stats);
+    CHECK(stats.Sheets == 2 && stats.Frames == 8 && stats.UniqueFrames == 5 && stats.Pages == 1);
+    CHECK(dmi_atlas_builder_page_count(builder) == 1);
+
+    size_t length = 0;
+    const char* index = dmi_atlas_builder_index(builder, &length);
+    DmiAtlas atlas;
+    CHECK(dmi_atlas_view(index, length, &atlas));
+    CHECK(atlas.Header->IconCount == 2 && atlas.Header->RectCount == 5);
+
+    const char* page_png = dmi_atlas_builder_page(builder, 0, &length);
+    PngImage page;
+    CHECK(png_decode(page_png, length, &page));
+
+    check_rect(&page, dmi_atlas_find(&atlas, "icons/mob.dmi", "idle", 0, 0), 0);
+    check_rect(&page, dmi_atlas_find(&atlas, "icons/mob.dmi", "walk", 1, 0), 2);
+    check_rect(&page, dmi_atlas_find(&atlas, "icons/mob.dmi", "walk", 1, 1), 4);
+    check_rect(&page, dmi_atlas_find(&atlas, "icons/mob.dmi", "gone", 0, 0), 5);
+    CHECK(dmi_atlas_find(&atlas, "icons/mob.dmi", "walk", 0, 1) ==
+          dmi_atlas_find(&atlas, "icons/mob.dmi", "walk", 0, 0));
+    CHECK(dmi_atlas_find(&atlas, "icons/a/other.dmi", "still", 0, 0) ==
+          dmi_atlas_find(&atlas, "icons/mob.dmi", "idle", 0, 0));
+
+    /* Past the sheet, past the state, or not there at all */
+    CHECK(dmi_atlas_find(&atlas, "icons/mob.dmi", "gone", 0, 1) == NULL);
+    CHECK(dmi_atlas_find(&atlas, "icons/mob.dmi", "walk", 2, 0) == NULL);
+    CHECK(dmi_atlas_find(&atlas, "icons/mob.dmi", "run", 0, 0) == NULL);
+    CHECK(dmi_atlas_find(&atlas, "icons/none.dmi", "idle", 0, 0) == NULL);
+    png_image_free(&page);
+    dmi_atlas_builder_free(builder);
+}
+
+/* The same sheets in the same order give the same bytes */
+static void test_deterministic(void) {
+    DmiAtlasBuilder* first = build();
+    DmiAtlasBuilder* second = build();
+    size_t first_length = 0;
+    size_t second_length = 0;
+    const char* a = dmi_atlas_builder_index(first, &first_length);
+    const char* b = dmi_atlas_builder_index(second, &second_length);
+    CHECK(first_length == second_length && memcmp(a, b, first_length) == 0);
+    a = dmi_atlas_builder_page(first, 0, &first_length);
+    b = dmi_atlas_builder_page(second, 0, &second_length);
+    CHECK(first_length == second_length && memcmp(a, b, first_length) == 0);
+    dmi_atlas_builder_free(first);
+    dmi_atlas_builder_free(second);
+}
+
+/* A sheet that does not decode is refused and leaves the builder as it was */
+static void test_bad_sheet(void) {
+    DmiAtlasBuilder* builder = dmi_atlas_builder_create();
+    CHECK(!add_sheet(builder, "icons/bad.dmi", sidecar, "not a png", 9));
+    CHECK(!dmi_atlas_builder_add(builder, "icons/bad.dmi", "x", 1, "DMI1", 4));
+    DmiAtlasStats stats;
+    dmi_atlas_builder_get_stats(builder, &stats);
+    CHECK(stats.Sheets == 0 && stats.Frames == 0);
+    dmi_atlas_builder_free(builder);
+
+    DmiAtlas atlas;
+    CHECK(!dmi_atlas_view("ATL0", 4, &atlas));
+    CHECK(!dmi_atlas_view(NULL, 0, &atlas));
+}
+
+int main(void) {
+    RUN(test_find);
+    RUN(test_deterministic);
+    RUN(test_bad_sheet);
+    return TEST_RESULT();
+}
@@ -0,0 +1,112 @@
+/*
+ * Luminous Locus DMI Metadata Test
+ * Compiling sidecars into state tables and reading them back
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../dmi_meta.h"
+#include "test.h"
+
+/* Sidecar in the layout the icon tools write */
+static const char sidecar[] =
+    "{\"info\": {\"width\": 32, \"version\": 4.0, \"height\": 32},\n"
+    " \"states\": [\n"
+    "  {\"dirs\": 1, \"frames\": 1, \"state\": \"state1\"},\n"
+    "  {\"dirs\": 4, \"frames\": 1, \"state\": \"state2\", \"unknown\": [1, {\"x\": null}]},\n"
+    "  {\"dirs\": 1, \"frames\": 1, \"state\": \"state with spaces\", \"hotspot\": [13.0, 9.0, 1.0]},\n"
+    "  {\"dirs\": 2, \"delay\": [1.0, 3.0, 2.0], \"state\": \"animated\", \"rewind\": 1, \"frames\": 4, \"loop\": 4},\n"
+    "  {\"dirs\": 1, \"frames\": 1, \"state\": \"state1\"},\n"
+    "  {\"dirs\": 1, \"frames\": 1}\n"
+    " ]}";
+
+/* Start of a PNG whose IHDR says it is 128 pixels wide */
+static const char sheet[] =
+    "\x89PNG\r\n\x1a\n\x00\x00\x00\x0dIHDR\x00\x00\x00\x80\x00\x00\x00\x40\x08\x06\x00\x00\x00";
+
+/* Compile the sidecar and view it, the table is returned for freeing */
+static void* compile(DmiMeta* meta, size_t* length) {
+    void* table = dmi_meta_compile(sidecar, sizeof(sidecar) - 1, sheet, sizeof(sheet) - 1, length);
+    CHECK(table != NULL);
+    CHECK(dmi_meta_view(table, *length, meta));
+    return table;
+}
+
+/* States are laid out in sheet order with their icon sizes */
+static void test_layout(void) {
+    DmiMeta meta;
+    size_t length = 0;
+    void* table = compile(&meta, &length);
+    CHECK(meta.Header->Width == 32 && meta.Header->Height == 32 && meta.Header->Columns == 4);
+    CHECK(meta.Header->StateCount == 6 && meta.Header->IconCount == 16);
+
+    const DmiStateRecord* state2 = dmi_meta_find(&meta, "state2");
+    CHECK(state2 != NULL && state2->Dirs == 4 && state2->FirstIcon == 1);
+    CHECK(dmi_meta_icon_index(state2, 3, 0) == 4);
+
+    const DmiStateRecord* animated = dmi_meta_find(&meta, "animated");
+    CHECK(animated != NULL && animated->Frames == 4 && animated->Loop == 4);
+    CHECK(animated->Flags == DMI_STATE_REWIND);
+    CHECK(dmi_meta_icon_index(animated, 1, 2) == 6 + 2 * 2 + 1);
+
+    /* Missing delays are padded to a tick */
+    CHECK(animated->DelayOffset != DMI_META_NO_DELAY);
+    const float* delays = meta.Delays + animated->DelayOffset;
+    CHECK(delays[0] == 1.0f && delays[1] == 3.0f && delays[2] == 2.0f && delays[3] == 1.0f);
+    CHECK(state2->DelayOffset == DMI_META_NO_DELAY);
+
+    const DmiStateRecord* spaces = dmi_meta_find(&meta, "state with spaces");
+    CHECK(spaces != NULL && (spaces->Flags & DMI_STATE_HOTSPOT) && spaces->HotspotX == 13 && spaces->HotspotY == 9);
+    CHECK(strcmp(dmi_meta_state_name(&meta, spaces), "state with spaces") == 0);
+    free(table);
+}
+
+/* Repeated names find the first, the unnamed state is the empty name */
+static void test_find(void) {
+    DmiMeta meta;
+    size_t length = 0;
+    void* table = compile(&meta, &length);
+    CHECK(dmi_meta_find(&meta, "state1") == &meta.States[0]);
+    CHECK(dmi_meta_find(&meta, "") == &meta.States[5]);
+    CHECK(dmi_meta_find(&meta, "state") == NULL);
+    CHECK(dmi_meta_find(&meta, "zzz") == NULL);
+    CHECK(dmi_meta_find(&meta, NULL) == NULL);
+    free(table);
+}
+
+/* Without a sheet the column count is unknown */
+static void test_no_sheet(void) {
+    size_t length = 0;
+    void* table = dmi_meta_compile(sidecar, sizeof(sidecar) - 1, NULL, 0, &length);
+    DmiMeta meta;
+    CHECK(table != NULL && dmi_meta_view(table, length, &meta));
+    CHECK(meta.Header->Columns == 0 && meta.Header->StateCount == 6);
+    free(table);
+}
+
+/* Broken sidecars and tables are refused */
+static void test_refused(void) {
+    size_t length = 0;
+    CHECK(dmi_meta_compile("{\"info\":{\"width\":32}", 20, NULL, 0, &length) == NULL);
+    CHECK(dmi_meta_compile("{\"states\":[]}", 13, NULL, 0, &length) == NULL);
+    const char* no_dirs = "{\"info\":{\"width\":32,\"height\":32},\"states\":[{\"dirs\":0}]}";
+    CHECK(dmi_meta_compile(no_dirs, strlen(no_dirs), NULL, 0, &length) == NULL);
+
+    DmiMeta meta;
+    void* table = dmi_meta_compile(sidecar, sizeof(sidecar) - 1, NULL, 0, &length);
+    CHECK(!dmi_meta_view(table, length - 8, &meta));
+    memcpy(table, "DMI0", 4);
+    CHECK(!dmi_meta_view(table, length, &meta));
+    CHECK(!dmi_meta_view(NULL, 0, &meta));
+    free(table);
+}
+
+int main(void) {
+    RUN(test_layout);
+    RUN(test_find);
+    RUN(test_no_sheet);
+    RUN(test_refused);
+    return TEST_RESULT();
+}
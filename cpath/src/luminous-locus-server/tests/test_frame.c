@@ -0,0 +1,83 @@
+/*
+ * Luminous Locus Frame Test
+ * Incremental protocol v2 frame reading
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../model.h"
+#include "../frame.h"
+#include "test.h"
+
+/* Append one frame to buffer, returns its size */
+static size_t put_frame(char* out, uint32_t kind, const char* body, uint32_t length) {
+    frame_write_header(out, kind, length);
+    memcpy(out + FRAME_HEADER_SIZE, body, length);
+    return FRAME_HEADER_SIZE + length;
+}
+
+/* The header is big-endian length then kind */
+static void test_header_layout(void) {
+    char header[FRAME_HEADER_SIZE];
+    frame_write_header(header, 0x01020304, 0x0a0b0c0d);
+    CHECK_BYTES(header, "\x0a\x0b\x0c\x0d\x01\x02\x03\x04", FRAME_HEADER_SIZE);
+}
+
+/* Several frames in one buffer are walked in order */
+static void test_reads_frames(void) {
+    char buffer[128];
+    size_t length = put_frame(buffer, MSGID_HASH, "{\"hash\":1}", 10);
+    length += put_frame(buffer + length, MSGID_NEXTTICK, "", 0);
+
+    FrameReader reader;
+    FrameView frame;
+    frame_reader_init(&reader, buffer, length, sizeof(buffer));
+    CHECK(frame_reader_next(&reader, &frame) == FRAME_OK);
+    CHECK(frame.Kind == MSGID_HASH && frame.Length == 10);
+    CHECK_BYTES(frame.Body, "{\"hash\":1}", 10);
+    CHECK(frame_reader_next(&reader, &frame) == FRAME_OK);
+    CHECK(frame.Kind == MSGID_NEXTTICK && frame.Length == 0);
+    CHECK(frame_reader_next(&reader, &frame) == FRAME_INCOMPLETE);
+    CHECK(frame_reader_consumed(&reader) == length);
+}
+
+/* Every split point of a frame waits for the rest */
+static void test_incomplete_at_every_split(void) {
+    char buffer[64];
+    size_t length = put_frame(buffer, MSGID_INPUT, "{\"key\":\"w\"}", 11);
+    for (size_t split = 0; split < length; split++) {
+        FrameReader reader;
+        FrameView frame;
+        frame_reader_init(&reader, buffer, split, sizeof(buffer));
+        CHECK(frame_reader_next(&reader, &frame) == FRAME_INCOMPLETE);
+        CHECK(frame_reader_consumed(&reader) == 0);
+    }
+}
+
+/* Oversized and malformed headers are refused before the body arrives */
+static void test_rejects_bad_headers(void) {
+    char buffer[FRAME_HEADER_SIZE];
+    FrameReader reader;
+    FrameView frame;
+
+    frame_write_header(buffer, MSGID_LOGIN, 257);
+    frame_reader_init(&reader, buffer, sizeof(buffer), 4096);
+    CHECK(frame_reader_next(&reader, &frame) == FRAME_TOO_LARGE);
+
+    frame_write_header(buffer, MSGID_INPUT, 4096);
+    frame_reader_init(&reader, buffer, sizeof(buffer), 1024);
+    CHECK(frame_reader_next(&reader, &frame) == FRAME_TOO_LARGE);
+
+    frame_write_header(buffer, 0, 4);
+    frame_reader_init(&reader, buffer, sizeof(buffer), 4096);
+    CHECK(frame_reader_next(&reader, &frame) == FRAME_INVALID);
+}
+
+int main(void) {
+    RUN(test_header_layout);
+    RUN(test_reads_frames);
+    RUN(test_incomplete_at_every_split);
+    RUN(test_rejects_bad_headers);
+    return TEST_RESULT();
+}
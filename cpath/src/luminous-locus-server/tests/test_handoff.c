@@ -0,0 +1,122 @@
+/*
+ * Luminous Locus Handoff Queue Test
+ * Ordering, capacity and concurrent producers of the MPSC ring
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../message.h"
+#include "../handoff.h"
+#include "test.h"
+
+#define PRODUCERS 4
+#define PER_PRODUCER 100000
+
+/* One producer's share of the stress test */
+typedef struct Producer {
+    HandoffQueue* Queue;
+    int ID;
+    int64_t Retries;
+} Producer;
+
+/* Envelopes come out in push order, capacity rounds up to a power of two */
+static void test_order_and_capacity(void) {
+    HandoffQueue* queue = handoff_queue_create(5);
+    CHECK(queue != NULL);
+    for (int i = 0; i < 8; i++) {
+        CHECK(handoff_queue_push(queue, envelope_create(NULL, i, 1)));
+    }
+    Envelope* extra = envelope_create(NULL, 8, 1);
+    CHECK(!handoff_queue_push(queue, extra));
+
+    Envelope* out[16];
+    CHECK(handoff_queue_drain(queue, out, 3, 0) == 3);
+    for (int i = 0; i < 3; i++) {
+        CHECK(envelope_get_kind(out[i]) == i);
+        envelope_free(out[i]);
+    }
+    CHECK(handoff_queue_push(queue, extra));
+    CHECK(handoff_queue_drain(queue, out, 16, 0) == 6);
+    for (int i = 0; i < 6; i++) {
+        CHECK(envelope_get_kind(out[i]) == i + 3);
+        envelope_free(out[i]);
+    }
+    CHECK(handoff_queue_drain(queue, out, 16, 0) == 0);
+
+    /* Whatever is still queued is freed with the queue */
+    handoff_queue_push(queue, envelope_create(NULL, 0, 1));
+    handoff_queue_free(queue);
+}
+
+/* An empty drain waits for its timeout, a wake ends it early */
+static void test_drain_waits(void) {
+    HandoffQueue* queue = handoff_queue_create(16);
+    Envelope* out[4];
+    CHECK(handoff_queue_drain(queue, out, 4, 20) == 0);
+    handoff_queue_wake(queue);
+    CHECK(handoff_queue_drain(queue, out, 4, 60000) == 0);
+    handoff_queue_free(queue);
+}
+
+/* Push a numbered run, spinning while the queue is full */
+static void* produce(void* arg) {
+    Producer* producer = (Producer*)arg;
+    for (int i = 0; i < PER_PRODUCER; i++) {
+        Envelope* env = envelope_create(NULL, i, producer->ID);
+        while (!handoff_queue_push(producer->Queue, env)) {
+            producer->Retries++;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+/* Concurrent producers lose nothing and keep their own order */
+static void test_concurrent_producers(void) {
+    HandoffQueue* queue = handoff_queue_create(1024);
+    Producer producers[PRODUCERS];
+    pthread_t threads[PRODUCERS];
+    for (int i = 0; i < PRODUCERS; i++) {
+        producers[i].Queue = queue;
+        producers[i].ID = i;
+        producers[i].Retries = 0;
+        pthread_create(&threads[i], NULL, produce, &producers[i]);
+    }
+
+    int next[PRODUCERS] = {0};
+    int total = 0;
+    bool ordered = true;
+    Envelope* out[256];
+    while (total < PRODUCERS * PER_PRODUCER) {
+        size_t count = handoff_queue_drain(queue, out, 256, 100);
+        for (size_t i = 0; i < count; i++) {
+            int from = envelope_get_from(out[i]);
+            if (from < 0 || from >= PRODUCERS || envelope_get_kind(out[i]) != next[from]) {
+                ordered = false;
+            } else {
+                next[from]++;
+            }
+            envelope_free(out[i]);
+        }
+        total += (int)count;
+    }
+    for (int i = 0; i < PRODUCERS; i++) {
+        pthread_join(threads[i], NULL);
+        CHECK(next[i] == PER_PRODUCER);
+    }
+    CHECK(ordered);
+    CHECK(handoff_queue_drain(queue, out, 256, 0) == 0);
+    handoff_queue_free(queue);
+}
+
+int main(void) {
+    RUN(test_order_and_capacity);
+    RUN(test_drain_waits);
+    RUN(test_concurrent_producers);
+    return TEST_RESULT();
+}
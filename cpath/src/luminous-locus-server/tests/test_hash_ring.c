@@ -0,0 +1,125 @@
+/*
+ * Luminous Locus Hash Ring Test
+ * Majority voting on per-tick client hashes
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../hash_ring.h"
+#include "test.h"
+
+/* Mismatches reported through the callback */
+typedef struct Flags {
+    int Count;
+    int Client[16];
+    int64_t Tick[16];
+} Flags;
+
+/* Remember a flagged client */
+static void on_mismatch(void* data, int client_id, int64_t tick) {
+    Flags* flags = (Flags*)data;
+    if (flags->Count < 16) {
+        flags->Client[flags->Count] = client_id;
+        flags->Tick[flags->Count] = tick;
+    }
+    flags->Count++;
+}
+
+/* Agreeing clients flag nobody */
+static void test_all_agree(void) {
+    Flags flags = {0};
+    HashRing* ring = hash_ring_create(on_mismatch, &flags);
+    CHECK(hash_ring_open(ring, 10, 3));
+    for (int client = 1; client <= 3; client++) {
+        CHECK(hash_ring_report(ring, 10, client, 42) == HASH_REPORT_OK);
+    }
+    CHECK(flags.Count == 0);
+    CHECK(hash_ring_get_resolved(ring) == 1);
+    CHECK(hash_ring_get_mismatches(ring) == 0);
+    hash_ring_free(ring);
+}
+
+/* A dissenter before the majority is flagged once the majority forms */
+static void test_flags_minority(void) {
+    Flags flags = {0};
+    HashRing* ring = hash_ring_create(on_mismatch, &flags);
+    hash_ring_open(ring, 5, 5);
+    hash_ring_report(ring, 5, 1, 7);
+    hash_ring_report(ring, 5, 2, 9);
+    hash_ring_report(ring, 5, 3, 7);
+    CHECK(flags.Count == 0);
+    hash_ring_report(ring, 5, 4, 7);
+    CHECK(flags.Count == 1 && flags.Client[0] == 2 && flags.Tick[0] == 5);
+
+    /* A late dissenter is flagged on arrival */
+    hash_ring_report(ring, 5, 5, -1);
+    CHECK(flags.Count == 2 && flags.Client[1] == 5);
+    CHECK(hash_ring_get_mismatches(ring) == 2);
+    CHECK(hash_ring_get_resolved(ring) == 1);
+    hash_ring_free(ring);
+}
+
+/* Duplicates and unknown ticks are refused */
+static void test_rejects_bad_reports(void) {
+    HashRing* ring = hash_ring_create(NULL, NULL);
+    hash_ring_open(ring, 3, 2);
+    CHECK(hash_ring_report(ring, 3, 1, 1) == HASH_REPORT_OK);
+    CHECK(hash_ring_report(ring, 3, 1, 1) == HASH_REPORT_DUPLICATE);
+    CHECK(hash_ring_report(ring, 4, 1, 1) == HASH_REPORT_UNKNOWN);
+    CHECK(hash_ring_report(ring, -1, 1, 1) == HASH_REPORT_UNKNOWN);
+
+    /* Reopening the slot a ring later recycles the old tick */
+    CHECK(hash_ring_open(ring, 3 + HASH_RING_SIZE, 2));
+    CHECK(hash_ring_report(ring, 3, 2, 1) == HASH_REPORT_UNKNOWN);
+    CHECK(!hash_ring_open(ring, 9, 0));
+    hash_ring_free(ring);
+}
+
+/* A tick short of replies is settled on timeout by what arrived */
+static void test_expire(void) {
+    Flags flags = {0};
+    HashRing* ring = hash_ring_create(on_mismatch, &flags);
+    hash_ring_open(ring, 20, 6);
+    hash_ring_report(ring, 20, 1, 1);
+    hash_ring_report(ring, 20, 2, 1);
+    hash_ring_report(ring, 20, 3, 2);
+
+    hash_ring_expire(ring, 22, 5);
+    CHECK(hash_ring_get_resolved(ring) == 0);
+    hash_ring_expire(ring, 25, 5);
+    CHECK(hash_ring_get_resolved(ring) == 1);
+    CHECK(flags.Count == 1 && flags.Client[0] == 3);
+
+    /* An even split has no majority to trust */
+    hash_ring_open(ring, 30, 4);
+    hash_ring_report(ring, 30, 1, 1);
+    hash_ring_report(ring, 30, 2, 2);
+    hash_ring_expire(ring, 40, 5);
+    CHECK(hash_ring_get_undecided(ring) == 1);
+    CHECK(flags.Count == 1);
+    hash_ring_free(ring);
+}
+
+/* More clients than the first slot capacity */
+static void test_many_clients(void) {
+    Flags flags = {0};
+    HashRing* ring = hash_ring_create(on_mismatch, &flags);
+    CHECK(hash_ring_open(ring, 1, 100));
+    for (int client = 0; client < 100; client++) {
+        CHECK(hash_ring_report(ring, 1, client, client == 77 ? 5 : 6) == HASH_REPORT_OK);
+    }
+    /* One joined after the request went out */
+    CHECK(hash_ring_report(ring, 1, 100, 6) == HASH_REPORT_OK);
+    CHECK(flags.Count == 1 && flags.Client[0] == 77);
+    hash_ring_free(ring);
+}
+
+int main(void) {
+    RUN(test_all_agree);
+    RUN(test_flags_minority);
+    RUN(test_rejects_bad_reports);
+    RUN(test_expire);
+    RUN(test_many_clients);
+    return TEST_RESULT();
+}
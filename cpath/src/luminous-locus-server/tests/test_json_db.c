@@ -0,0 +1,165 @@
+/*
+ * Luminous Locus JSON Database Test
+ * Lookups, and reloads of the file while readers keep going
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "../model.h"
+#include "../json_db.h"
+#include "test.h"
+
+/* Longest wait for the watcher to pick up a change */
+#define RELOAD_WAIT_MS 3000
+
+/* Users in the file at start */
+static const char first_users[] =
+    "{\"admin\":{\"passhash\":\"aa11\",\"is-admin\":true},\"bob\":{\"passhash\":\"bb22\",\"is-admin\":false}}";
+
+/* Write a file in place, or by renaming a temporary over it */
+static void write_file(const char* path, const char* text, bool rename_into_place) {
+    char temp[520];
+    snprintf(temp, sizeof(temp), "%s.new", path);
+    const char* target = rename_into_place ? temp : path;
+    FILE* file = fopen(target, "w");
+    CHECK(file != NULL);
+    if (file != NULL) {
+        fputs(text, file);
+        fclose(file);
+    }
+    if (rename_into_place) {
+        CHECK(rename(temp, path) == 0);
+    }
+}
+
+/* Wait until the database has reloaded more than before times */
+static bool wait_reloads(json_db_t* db, int64_t before) {
+    for (int waited = 0; waited < RELOAD_WAIT_MS; waited++) {
+        int64_t reloads = 0;
+        json_db_get_stats(db, NULL, &reloads);
+        if (reloads > before) {
+            return true;
+        }
+        usleep(1000);
+    }
+    return false;
+}
+
+/* Number of reloads so far */
+static int64_t reloads_of(json_db_t* db) {
+    int64_t reloads = 0;
+    json_db_get_stats(db, NULL, &reloads);
+    return reloads;
+}
+
+/* Logins are found with their hash and admin flag */
+static void test_lookup(void) {
+    char dir[] = "/tmp/ll_json_db_XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    char path[512];
+    snprintf(path, sizeof(path), "%s/auth.json", dir);
+    write_file(path, first_users, false);
+
+    json_db_t* db = json_db_create(path);
+    CHECK(db != NULL);
+    UserInfo info;
+    CHECK(json_db_get_user(db, "bob", &info));
+    CHECK(strcmp(info.Login, "bob") == 0 && strcmp(info.Passhash, "bb22") == 0 && !info.IsAdmin);
+    CHECK(json_db_is_admin(db, "admin"));
+    CHECK(!json_db_is_admin(db, "bob"));
+    CHECK(!json_db_get_user(db, "carol", &info));
+    CHECK(!json_db_get_user(db, "bo", &info));
+    CHECK(!json_db_get_user(db, NULL, &info));
+
+    int users = 0;
+    json_db_get_stats(db, &users, NULL);
+    CHECK(users == 2);
+    json_db_free(db);
+    unlink(path);
+    rmdir(dir);
+}
+
+/* A missing file leaves the database empty until it appears */
+static void test_missing_file(void) {
+    char dir[] = "/tmp/ll_json_db_XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    char path[512];
+    snprintf(path, sizeof(path), "%s/auth.json", dir);
+    json_db_t* db = json_db_create(path);
+    CHECK(db != NULL && !json_db_get_user(db, "bob", NULL));
+
+    write_file(path, first_users, true);
+    CHECK(wait_reloads(db, 0));
+    CHECK(json_db_get_user(db, "bob", NULL));
+    json_db_free(db);
+    unlink(path);
+    rmdir(dir);
+}
+
+/* Shared with the reader thread */
+static json_db_t* shared_db;
+static int stop_readers;
+static int torn_reads;
+
+/* Look bob up as fast as possible, the hash must always be one of the two written */
+static void* read_loop(void* arg) {
+    (void)arg;
+    while (!__atomic_load_n(&stop_readers, __ATOMIC_ACQUIRE)) {
+        UserInfo info;
+        if (json_db_get_user(shared_db, "bob", &info) && strcmp(info.Passhash, "bb22") != 0 &&
+            strcmp(info.Passhash, "cc33") != 0) {
+            __atomic_add_fetch(&torn_reads, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return NULL;
+}
+
+/* Edits, in place or by rename, are picked up; broken ones are not */
+static void test_reload(void) {
+    char dir[] = "/tmp/ll_json_db_XXXXXX";
+    CHECK(mkdtemp(dir) != NULL);
+    char path[512];
+    snprintf(path, sizeof(path), "%s/auth.json", dir);
+    write_file(path, first_users, false);
+    shared_db = json_db_create(path);
+    pthread_t reader;
+    pthread_create(&reader, NULL, read_loop, NULL);
+
+    int64_t before = reloads_of(shared_db);
+    write_file(path, "{\"bob\":{\"passhash\":\"cc33\",\"is-admin\":true},\"carol\":{\"passhash\":\"dd44\"}}", true);
+    CHECK(wait_reloads(shared_db, before));
+    UserInfo info;
+    CHECK(json_db_get_user(shared_db, "bob", &info) && strcmp(info.Passhash, "cc33") == 0 && info.IsAdmin);
+    CHECK(json_db_get_user(shared_db, "carol", NULL));
+    CHECK(!json_db_get_user(shared_db, "admin", NULL));
+
+    /* A file that does not parse keeps the users already loaded */
+    before = reloads_of(shared_db);
+    write_file(path, "{\"bob\":{\"passhash\":", false);
+    usleep(200 * 1000);
+    CHECK(reloads_of(shared_db) == before);
+    CHECK(json_db_get_user(shared_db, "carol", NULL));
+
+    write_file(path, first_users, false);
+    CHECK(wait_reloads(shared_db, before));
+    CHECK(json_db_get_user(shared_db, "admin", NULL) && !json_db_get_user(shared_db, "carol", NULL));
+
+    __atomic_store_n(&stop_readers, 1, __ATOMIC_RELEASE);
+    pthread_join(reader, NULL);
+    CHECK(torn_reads == 0);
+    json_db_free(shared_db);
+    unlink(path);
+    rmdir(dir);
+}
+
+int main(void) {
+    RUN(test_lookup);
+    RUN(test_missing_file);
+    RUN(test_reload);
+    return TEST_RESULT();
+}
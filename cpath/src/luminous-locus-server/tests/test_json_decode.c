@@ -0,0 +1,158 @@
+/*
+ * Luminous Locus JSON Decode Test
+ * Schema decoding of message bodies and the auth database map
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../model.h"
+#include "../json_decode.h"
+#include "test.h"
+
+/* Decode a NUL terminated body */
+static enum JsonDecodeResult decode(int kind, const char* body, void* out) {
+    return json_decode_message(kind, body, strlen(body), out);
+}
+
+/* Fields land in their struct members, other keys are skipped */
+static void test_decodes_fields(void) {
+    MessageMouseClick click;
+    const char* body = "{ \"extra\": {\"a\": [1, \"]}\", {\"b\": null}]}, \"obj\": -17,\n"
+                       "  \"action\": \"pull\", \"id\": 3, \"flag\": true }";
+    CHECK(decode(MSGID_MOUSECLICK, body, &click) == JSON_DECODE_OK);
+    CHECK(click.ID == 3 && click.Object == -17);
+    CHECK(strcmp(click.Action, "pull") == 0);
+
+    MessageLogin login;
+    CHECK(decode(MSGID_LOGIN, "{\"login\":\"a\",\"guest\":true,\"protocol\":3,\"game_version\":null}", &login) ==
+          JSON_DECODE_OK);
+    CHECK(strcmp(login.Login, "a") == 0 && login.IsGuest && login.Protocol == 3);
+    CHECK(login.Password[0] == '\0' && login.GameVersion[0] == '\0');
+
+    MessageInput input;
+    CHECK(decode(MSGID_INPUT, "{}", &input) == JSON_DECODE_OK);
+    CHECK(input.ID == 0 && input.Key[0] == '\0');
+
+    /* An empty body stands for {} */
+    CHECK(decode(MSGID_INPUT, " ", &input) == JSON_DECODE_OK);
+}
+
+/* Escapes are unescaped into the field, \u as UTF-8 */
+static void test_unescapes_strings(void) {
+    MessageJustMessage message;
+    const char* body = "{\"text\":\"a\\\"b\\\\c\\/d\\n\\t\\u00e9\\u20ac\\ud83d\\ude00\"}";
+    CHECK(decode(MSGID_JUSTMESSAGE, body, &message) == JSON_DECODE_OK);
+    CHECK(strcmp(message.Text, "a\"b\\c/d\n\t\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80") == 0);
+
+    CHECK(decode(MSGID_JUSTMESSAGE, "{\"text\":\"\\x\"}", &message) == JSON_DECODE_SYNTAX);
+    CHECK(decode(MSGID_JUSTMESSAGE, "{\"text\":\"\\u12\"}", &message) == JSON_DECODE_SYNTAX);
+}
+
+/* Hashes of either signedness wrap to 32 bits */
+static void test_hash_signedness(void) {
+    MessageHash hash;
+    CHECK(decode(MSGID_HASH, "{\"hash\":4294967295,\"tick\":9}", &hash) == JSON_DECODE_OK);
+    CHECK(hash.Hash == -1 && hash.Tick == 9);
+    CHECK(decode(MSGID_HASH, "{\"hash\":-2147483648,\"tick\":1}", &hash) == JSON_DECODE_OK);
+    CHECK(hash.Hash == (int)0x80000000u);
+    CHECK(decode(MSGID_HASH, "{\"hash\":4294967296,\"tick\":1}", &hash) == JSON_DECODE_TYPE);
+}
+
+/* Each way a body can be wrong has its own result */
+static void test_errors(void) {
+    MessageHash hash;
+    MessageInput input;
+    MessageLogin login;
+    CHECK(decode(MSGID_HASH, "{\"hash\":1}", &hash) == JSON_DECODE_MISSING);
+    CHECK(decode(MSGID_INPUT, "{\"id\":\"7\"}", &input) == JSON_DECODE_TYPE);
+    CHECK(decode(MSGID_INPUT, "{\"id\":1.5}", &input) == JSON_DECODE_TYPE);
+    CHECK(decode(MSGID_INPUT, "{\"id\":99999999999}", &input) == JSON_DECODE_TYPE);
+    CHECK(decode(MSGID_LOGIN, "{\"guest\":1}", &login) == JSON_DECODE_TYPE);
+    CHECK(decode(MSGID_INPUT, "{\"id\":1", &input) == JSON_DECODE_SYNTAX);
+    CHECK(decode(MSGID_INPUT, "{\"id\" 1}", &input) == JSON_DECODE_SYNTAX);
+    CHECK(decode(MSGID_INPUT, "[1]", &input) == JSON_DECODE_SYNTAX);
+    CHECK(decode(MSGID_INPUT, " x", &input) == JSON_DECODE_SYNTAX);
+    CHECK(decode(MSGID_EXIT, "{}", &input) == JSON_DECODE_UNKNOWN);
+
+    char body[300];
+    memset(body, 'k', sizeof(body));
+    memcpy(body, "{\"login\":\"", 10);
+    memcpy(body + sizeof(body) - 3, "\"}", 3);
+    CHECK(decode(MSGID_LOGIN, body, &login) == JSON_DECODE_TOO_LONG);
+}
+
+/* Only the given length is read, the body need not be terminated */
+static void test_respects_length(void) {
+    MessageInput input;
+    const char* body = "{\"key\":\"w\"}garbage";
+    CHECK(json_decode_message(MSGID_INPUT, body, 11, &input) == JSON_DECODE_OK);
+    CHECK(strcmp(input.Key, "w") == 0);
+    CHECK(json_decode_message(MSGID_INPUT, body, 10, &input) == JSON_DECODE_SYNTAX);
+}
+
+/* Members of the auth map collected by the visitor */
+typedef struct Users {
+    int Count;
+    char Login[4][64];
+    UserInfo Info[4];
+} Users;
+
+/* Keep one decoded member */
+static void visit_user(void* data, const char* key, size_t key_length, const void* value) {
+    Users* users = (Users*)data;
+    if (users->Count < 4 && key_length < 64) {
+        memcpy(users->Login[users->Count], key, key_length);
+        users->Login[users->Count][key_length] = '\0';
+        memcpy(&users->Info[users->Count], value, sizeof(UserInfo));
+    }
+    users->Count++;
+}
+
+/* An object of objects is decoded one member at a time */
+static void test_decode_map(void) {
+    const char* body = "{\"admin\":{\"passhash\":\"x1\",\"is-admin\":true},\n"
+                       " \"us\\u0065r\":{\"passhash\":\"y2\",\"note\":[1,2]}}";
+    UserInfo value;
+    Users users = {0};
+    CHECK(json_decode_map(json_schema_user_info(), body, strlen(body), &value, visit_user, &users) ==
+          JSON_DECODE_OK);
+    CHECK(users.Count == 2);
+    CHECK(strcmp(users.Login[0], "admin") == 0 && strcmp(users.Info[0].Passhash, "x1") == 0);
+    CHECK(users.Info[0].IsAdmin);
+    CHECK(strcmp(users.Login[1], "user") == 0 && strcmp(users.Info[1].Passhash, "y2") == 0);
+    CHECK(!users.Info[1].IsAdmin);
+
+    memset(&users, 0, sizeof(users));
+    const char* broken = "{\"a\":{\"passhash\":\"1\"},\"b\":{\"is-admin\":true}}";
+    CHECK(json_decode_map(json_schema_user_info(), broken, strlen(broken), &value, visit_user, &users) ==
+          JSON_DECODE_MISSING);
+    CHECK(users.Count == 1);
+
+    memset(&users, 0, sizeof(users));
+    CHECK(json_decode_map(json_schema_user_info(), "{}", 2, &value, visit_user, &users) == JSON_DECODE_OK);
+    CHECK(users.Count == 0);
+}
+
+/* Truncating a non-empty body anywhere is never accepted */
+static void test_every_truncation(void) {
+    const char* body = "{\"id\":12,\"obj\":-3,\"action\":\"a\\u0041\\n\",\"x\":[{\"y\":\"}\"}]}";
+    size_t length = strlen(body);
+    MessageMouseClick click;
+    CHECK(json_decode_message(MSGID_MOUSECLICK, body, length, &click) == JSON_DECODE_OK);
+    CHECK(strcmp(click.Action, "aA\n") == 0);
+    for (size_t cut = 1; cut < length; cut++) {
+        CHECK(json_decode_message(MSGID_MOUSECLICK, body, cut, &click) != JSON_DECODE_OK);
+    }
+}
+
+int main(void) {
+    RUN(test_decodes_fields);
+    RUN(test_unescapes_strings);
+    RUN(test_hash_signedness);
+    RUN(test_errors);
+    RUN(test_respects_length);
+    RUN(test_decode_map);
+    RUN(test_every_truncation);
+    return TEST_RESULT();
+}
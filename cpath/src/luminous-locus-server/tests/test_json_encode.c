@@ -0,0 +1,103 @@
+/*
+ * Luminous Locus JSON Encode Test
+ * Integers, escapes and the fixed-shape server frames
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "../model.h"
+#include "../frame.h"
+#include "../json_encode.h"
+#include "test.h"
+
+/* Check that out holds one frame of kind with the given body */
+static void check_frame(const char* out, size_t size, uint32_t kind, const char* body) {
+    size_t length = strlen(body);
+    char header[FRAME_HEADER_SIZE];
+    frame_write_header(header, kind, (uint32_t)length);
+    CHECK(size == FRAME_HEADER_SIZE + length);
+    CHECK_BYTES(out, header, FRAME_HEADER_SIZE);
+    CHECK(size >= FRAME_HEADER_SIZE && memcmp(out + FRAME_HEADER_SIZE, body, length) == 0);
+}
+
+/* Integers match printf, extremes included */
+static void test_int(void) {
+    int64_t values[] = { 0, 7, -7, 10, 99, 100, -100, 12345, INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN };
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        char out[JSON_ENCODE_INT_MAX];
+        char expected[32];
+        size_t length = json_encode_int(out, values[i]);
+        snprintf(expected, sizeof(expected), "%" PRId64, values[i]);
+        CHECK(length == strlen(expected) && memcmp(out, expected, length) == 0);
+    }
+    for (int i = 0; i < 1000; i++) {
+        int64_t value = (int64_t)test_rand() * 100003 - 1000000000;
+        char out[JSON_ENCODE_INT_MAX];
+        char expected[32];
+        size_t length = json_encode_int(out, value);
+        snprintf(expected, sizeof(expected), "%" PRId64, value);
+        CHECK(length == strlen(expected) && memcmp(out, expected, length) == 0);
+    }
+}
+
+/* Integer frames */
+static void test_int_frames(void) {
+    char out[JSON_ENCODE_INT_FRAME_MAX];
+    check_frame(out, json_encode_new_client(out, sizeof(out), 42), MSGID_NEWCLIENT, "{\"id\":42}");
+    check_frame(out, json_encode_current_connections(out, sizeof(out), 3), MSGID_CURRENTCONNECTIONS,
+                "{\"amount\":3}");
+    check_frame(out, json_encode_request_hash(out, sizeof(out), -9000000000LL), MSGID_REQUESTHASH,
+                "{\"tick\":-9000000000}");
+    CHECK(json_encode_new_client(out, 10, 1) == 0);
+    CHECK(json_encode_new_client(NULL, sizeof(out), 1) == 0);
+}
+
+/* Strings are escaped, and a frame that would not fit is refused */
+static void test_successful_connect(void) {
+    char out[128];
+    check_frame(out, json_encode_successful_connect(out, sizeof(out), 5, "maps/a\"b\\c\n\x01"),
+                MSGID_SUCCESSFULCONNECT, "{\"id\":5,\"map\":\"maps/a\\\"b\\\\c\\n\\u0001\"}");
+    check_frame(out, json_encode_successful_connect(out, sizeof(out), 0, NULL), MSGID_SUCCESSFULCONNECT,
+                "{\"id\":0,\"map\":\"\"}");
+
+    char map[200];
+    memset(map, 'm', sizeof(map) - 1);
+    map[sizeof(map) - 1] = '\0';
+    CHECK(json_encode_successful_connect(out, sizeof(out), 1, map) == 0);
+}
+
+/* Error frames carry text only where the protocol has it */
+static void test_errors(void) {
+    char out[128];
+    check_frame(out, json_encode_error(out, sizeof(out), MSGID_WRONGGAMEVERSION, "v1.2"), MSGID_WRONGGAMEVERSION,
+                "{\"correct_game_version\":\"v1.2\"}");
+    check_frame(out, json_encode_error(out, sizeof(out), MSGID_INTERNALSERVERERROR, "bad\ttab"),
+                MSGID_INTERNALSERVERERROR, "{\"message\":\"bad\\ttab\"}");
+    check_frame(out, json_encode_error(out, sizeof(out), MSGID_TOOSLOW, "ignored"), MSGID_TOOSLOW, "{}");
+    check_frame(out, json_encode_error(out, sizeof(out), MSGID_WRONGAUTH, NULL), MSGID_WRONGAUTH, "{}");
+    CHECK(json_encode_error(out, sizeof(out), MSGID_NEWCLIENT, NULL) == 0);
+    CHECK(json_encode_error(out, FRAME_HEADER_SIZE + 1, MSGID_TOOSLOW, NULL) == 0);
+}
+
+/* Escaped strings stop short of end instead of overrunning it */
+static void test_string(void) {
+    char out[16];
+    char* end = json_encode_string(out, out + sizeof(out), "a\"b");
+    CHECK(end == out + 4 && memcmp(out, "a\\\"b", 4) == 0);
+    CHECK(json_encode_string(out, out + 5, "\x1f") == NULL);
+    CHECK(json_encode_string(out, out + 6, "\x1f") == out + 6 && memcmp(out, "\\u001f", 6) == 0);
+    CHECK(json_encode_string(out, out + 3, "abcd") == NULL);
+    CHECK(json_encode_string(out, out + 3, NULL) == out);
+}
+
+int main(void) {
+    RUN(test_int);
+    RUN(test_int_frames);
+    RUN(test_successful_connect);
+    RUN(test_errors);
+    RUN(test_string);
+    return TEST_RESULT();
+}
@@ -0,0 +1,114 @@
+/*
+ * Luminous Locus Message Pool Test
+ * Reuse of concrete message structs within and across threads
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../model.h"
+#include "../message.h"
+#include "../message_pool.h"
+#include "test.h"
+
+/* Objects passed from the producer to the consumer thread */
+#define HANDED_OVER 1000
+
+/* Pool the cross-thread test runs on, untouched by the other tests */
+#define HANDOFF_POOL 9
+
+/* A put object comes back from the same thread's next get */
+static void test_reuse_same_thread(void) {
+    MessagePoolStats before;
+    MessagePoolStats after;
+    message_pool_get_stats(3, &before);
+    void* first = message_pool_get(3, 48);
+    CHECK(first != NULL);
+    memset(first, 0xab, 48);
+    message_pool_put(3, first);
+    void* second = message_pool_get(3, 48);
+    CHECK(second == first);
+    message_pool_put(3, second);
+    message_pool_get_stats(3, &after);
+    CHECK(after.Hits == before.Hits + 1 && after.Misses == before.Misses + 1);
+}
+
+/* Pools outside the table fall back to malloc and free */
+static void test_out_of_range(void) {
+    void* object = message_pool_get(MESSAGE_POOL_COUNT, 16);
+    CHECK(object != NULL);
+    message_pool_put(MESSAGE_POOL_COUNT, object);
+    object = message_pool_get(-1, 16);
+    CHECK(object != NULL);
+    message_pool_put(-1, object);
+    message_pool_put(0, NULL);
+}
+
+/* Objects handed over */
+static void* objects[HANDED_OVER];
+
+/* Free what the main thread allocated */
+static void* consume(void* arg) {
+    (void)arg;
+    for (int i = 0; i < HANDED_OVER; i++) {
+        message_pool_put(HANDOFF_POOL, objects[i]);
+    }
+    return NULL;
+}
+
+/* Objects freed on another thread reach the allocating thread through the depot */
+static void test_cross_thread(void) {
+    for (int i = 0; i < HANDED_OVER; i++) {
+        objects[i] = message_pool_get(HANDOFF_POOL, 64);
+    }
+    pthread_t consumer;
+    pthread_create(&consumer, NULL, consume, NULL);
+    pthread_join(consumer, NULL);
+
+    MessagePoolStats before;
+    MessagePoolStats after;
+    message_pool_get_stats(HANDOFF_POOL, &before);
+    CHECK(before.Misses >= HANDED_OVER);
+    for (int i = 0; i < HANDED_OVER; i++) {
+        objects[i] = message_pool_get(HANDOFF_POOL, 64);
+    }
+    message_pool_get_stats(HANDOFF_POOL, &after);
+    CHECK(after.Hits - before.Hits > HANDED_OVER / 2);
+    for (int i = 0; i < HANDED_OVER; i++) {
+        message_pool_put(HANDOFF_POOL, objects[i]);
+    }
+
+    /* Summed stats cover every pool, exited threads included */
+    MessagePoolStats total;
+    message_pool_get_stats(-1, &total);
+    CHECK(total.Hits >= after.Hits && total.Misses >= after.Misses);
+}
+
+/* Concrete messages come from their kind's pool and decode into it */
+static void test_concrete_messages(void) {
+    MessageInput* input = (MessageInput*)get_concrete_message(MSGID_INPUT);
+    CHECK(input != NULL);
+    free_concrete_message(input, MSGID_INPUT);
+    CHECK(get_concrete_message(MSGID_INPUT) == input);
+    free_concrete_message(input, MSGID_INPUT);
+
+    const char* body = "{\"hash\":-5,\"tick\":40}";
+    MessageHash* hash = (MessageHash*)message_decode_concrete(MSGID_HASH, body, strlen(body));
+    CHECK(hash != NULL && hash->Hash == -5 && hash->Tick == 40);
+    free_concrete_message(hash, MSGID_HASH);
+    CHECK(message_decode_concrete(MSGID_HASH, "{\"hash\":", 8) == NULL);
+
+    body = "{\"login\":\"alice\",\"password\":\"pw\",\"guest\":false,\"game_version\":\"v\"}";
+    MessageLogin* login = (MessageLogin*)message_decode_concrete(MSGID_LOGIN, body, strlen(body));
+    CHECK(login != NULL && strcmp(login->Login, "alice") == 0 && strcmp(login->Password, "pw") == 0);
+    free_concrete_message(login, MSGID_LOGIN);
+}
+
+int main(void) {
+    RUN(test_reuse_same_thread);
+    RUN(test_out_of_range);
+    RUN(test_cross_thread);
+    RUN(test_concrete_messages);
+    return TEST_RESULT();
+}
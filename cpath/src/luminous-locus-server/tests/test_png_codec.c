@@ -0,0 +1,105 @@
+/*
+ * Luminous Locus PNG Codec Test
+ * Decoding of the color types sheets use, and encode round trips
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../deflate.h"
+#include "../png_codec.h"
+#include "test.h"
+
+/* 3x2 2-bit palette image with tRNS, the second row Sub-filtered */
+static const char palette_png[] =
+    "\x89\x50\x4e\x47\x0d\x0a\x1a\x0a\x00\x00\x00\x0d\x49\x48\x44\x52\x00\x00\x00\x03\x00\x00\x00\x02\x02\x03"
+    "\x00\x00\x00\xe0\x1a\x8e\x89\x00\x00\x00\x0c\x50\x4c\x54\x45\xff\x00\x00\x00\xff\x00\x00\x00\xff\x0a\x14"
+    "\x1e\x22\x88\x29\x04\x00\x00\x00\x04\x74\x52\x4e\x53\xff\xff\x80\x00\xe8\x8d\xcc\xcd\x00\x00\x00\x0c\x49"
+    "\x44\x41\x54\x78\x9c\x63\x90\x60\x7c\x02\x00\x01\x32\x00\xfe\x38\x0f\xbd\xb4\x00\x00\x00\x00\x49\x45\x4e"
+    "\x44\xae\x42\x60\x82";
+
+/* 2x1 16-bit grayscale image, samples 0x1234 and 0xff00 */
+static const char gray16_png[] =
+    "\x89\x50\x4e\x47\x0d\x0a\x1a\x0a\x00\x00\x00\x0d\x49\x48\x44\x52\x00\x00\x00\x02\x00\x00\x00\x01\x10\x00"
+    "\x00\x00\x00\x81\xd9\xfc\x15\x00\x00\x00\x0d\x49\x44\x41\x54\x78\x9c\x63\x10\x32\xf9\xcf\x00\x00\x02\xe7"
+    "\x01\x46\x7f\xfb\x8c\x42\x00\x00\x00\x00\x49\x45\x4e\x44\xae\x42\x60\x82";
+
+/* Palette entries expand to RGBA with their tRNS alpha */
+static void test_palette(void) {
+    static const uint8_t expected[] = {
+        255, 0, 0, 255,   0, 255, 0, 255,   0, 0, 255, 128,
+        10, 20, 30, 0,    0, 0, 255, 128,   0, 255, 0, 255
+    };
+    PngImage image;
+    CHECK(png_decode(palette_png, sizeof(palette_png) - 1, &image));
+    CHECK(image.Width == 3 && image.Height == 2);
+    CHECK_BYTES(image.Pixels, expected, sizeof(expected));
+    png_image_free(&image);
+}
+
+/* 16-bit samples keep their high byte */
+static void test_gray16(void) {
+    static const uint8_t expected[] = { 0x12, 0x12, 0x12, 255, 0xff, 0xff, 0xff, 255 };
+    PngImage image;
+    CHECK(png_decode(gray16_png, sizeof(gray16_png) - 1, &image));
+    CHECK(image.Width == 2 && image.Height == 1);
+    CHECK_BYTES(image.Pixels, expected, sizeof(expected));
+    png_image_free(&image);
+}
+
+/* What is encoded decodes to the same pixels */
+static void test_round_trip(void) {
+    uint32_t width = 37;
+    uint32_t height = 23;
+    uint8_t* pixels = (uint8_t*)malloc(width * height * 4);
+    for (uint32_t i = 0; i < width * height * 4; i++) {
+        pixels[i] = (uint8_t)(i % 4 == 3 ? (i / 4) % 3 * 127 : test_rand());
+    }
+
+    size_t length = 0;
+    char* png = png_encode(pixels, width, height, &length);
+    CHECK(png != NULL && length > 8 && memcmp(png, "\x89PNG\r\n\x1a\n", 8) == 0);
+    PngImage image;
+    CHECK(png_decode(png, length, &image));
+    CHECK(image.Width == width && image.Height == height);
+    CHECK_BYTES(image.Pixels, pixels, width * height * 4);
+    png_image_free(&image);
+    free(png);
+    free(pixels);
+}
+
+/* Damaged or truncated files are refused and leave the image empty */
+static void test_refused(void) {
+    char copy[sizeof(palette_png)];
+    PngImage image;
+    memcpy(copy, palette_png, sizeof(copy));
+    CHECK(!png_decode(copy, 40, &image));
+    CHECK(image.Pixels == NULL && image.Width == 0);
+
+    copy[1] = 'Q';
+    CHECK(!png_decode(copy, sizeof(copy) - 1, &image));
+    copy[1] = palette_png[1];
+
+    /* IHDR CRC */
+    copy[29] ^= 1;
+    CHECK(!png_decode(copy, sizeof(copy) - 1, &image));
+    copy[29] ^= 1;
+
+    /* Interlaced, with a CRC that matches */
+    copy[28] = 1;
+    uint32_t crc = crc32_update(0, copy + 12, 17);
+    for (int i = 0; i < 4; i++) {
+        copy[29 + i] = (char)(crc >> (24 - 8 * i));
+    }
+    CHECK(!png_decode(copy, sizeof(copy) - 1, &image));
+    CHECK(!png_decode(NULL, 0, &image));
+}
+
+int main(void) {
+    RUN(test_palette);
+    RUN(test_gray16);
+    RUN(test_round_trip);
+    RUN(test_refused);
+    return TEST_RESULT();
+}
@@ -0,0 +1,144 @@
+/*
+ * Luminous Locus Ring Buffer Test
+ * Growth, wrap-around and shrinking of the connection input ring
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../ring_buffer.h"
+#include "test.h"
+
+/* Sizes round up to powers of two */
+static void test_init_rounds_sizes(void) {
+    RingBuffer ring;
+    CHECK(ring_buffer_init(&ring, 10, 100));
+    CHECK(ring_buffer_capacity(&ring) == 16);
+    CHECK(ring_buffer_max_capacity(&ring) == 128);
+    CHECK(ring_buffer_used(&ring) == 0);
+    ring_buffer_destroy(&ring);
+
+    CHECK(!ring_buffer_init(&ring, 0, 64));
+}
+
+/* Bytes appended across the end come back in order */
+static void test_wrap_and_peek(void) {
+    RingBuffer ring;
+    ring_buffer_init(&ring, 16, 16);
+    CHECK(ring_buffer_append(&ring, "0123456789", 10));
+    CHECK(ring_buffer_consume(&ring, 8) == 8);
+    CHECK(ring_buffer_append(&ring, "abcdefghij", 10));
+    CHECK(ring_buffer_used(&ring) == 12);
+    CHECK(ring_buffer_capacity(&ring) == 16);
+    CHECK_BYTES(ring_buffer_peek(&ring), "89abcdefghij", 12);
+    ring_buffer_destroy(&ring);
+}
+
+/* Growing keeps the contents, the maximum is a hard limit */
+static void test_grow_to_limit(void) {
+    RingBuffer ring;
+    ring_buffer_init(&ring, 16, 64);
+    char data[64];
+    for (int i = 0; i < 64; i++) {
+        data[i] = (char)i;
+    }
+    CHECK(ring_buffer_append(&ring, data, 40));
+    CHECK(ring_buffer_capacity(&ring) == 64);
+    CHECK(ring_buffer_append(&ring, data + 40, 24));
+    CHECK(!ring_buffer_append(&ring, "x", 1));
+    CHECK(!ring_buffer_grow(&ring));
+    CHECK_BYTES(ring_buffer_peek(&ring), data, 64);
+    ring_buffer_destroy(&ring);
+}
+
+/* Draining a grown ring gives the memory back */
+static void test_shrinks_when_empty(void) {
+    RingBuffer ring;
+    ring_buffer_init(&ring, 16, 1024);
+    char data[300];
+    memset(data, 'q', sizeof(data));
+    ring_buffer_append(&ring, data, sizeof(data));
+    CHECK(ring_buffer_capacity(&ring) == 512);
+    ring_buffer_consume(&ring, 100);
+    CHECK(ring_buffer_capacity(&ring) == 512);
+    ring_buffer_consume(&ring, 200);
+    CHECK(ring_buffer_capacity(&ring) == 16);
+    CHECK(ring_buffer_consume(&ring, 1) == 0);
+    ring_buffer_destroy(&ring);
+}
+
+/* Reads straight into the free region, as recv does */
+static void test_write_space_commit(void) {
+    RingBuffer ring;
+    ring_buffer_init(&ring, 16, 16);
+    ring_buffer_append(&ring, "0123456789ab", 12);
+    ring_buffer_consume(&ring, 10);
+
+    size_t space = 0;
+    char* out = ring_buffer_write_space(&ring, &space);
+    CHECK(space == 4);
+    memcpy(out, "WXYZ", 4);
+    ring_buffer_commit(&ring, 4);
+
+    out = ring_buffer_write_space(&ring, &space);
+    CHECK(space == 10);
+    memcpy(out, "!", 1);
+    ring_buffer_commit(&ring, 1);
+
+    CHECK(ring_buffer_used(&ring) == 7);
+    CHECK_BYTES(ring_buffer_peek(&ring), "abWXYZ!", 7);
+
+    ring_buffer_append(&ring, "123456789", 9);
+    out = ring_buffer_write_space(&ring, &space);
+    CHECK(out == NULL && space == 0);
+    ring_buffer_destroy(&ring);
+}
+
+/* Random appends, consumes and peeks agree with a flat copy */
+static void test_matches_reference(void) {
+    RingBuffer ring;
+    ring_buffer_init(&ring, 16, 256);
+    char model[256];
+    size_t used = 0;
+    unsigned char next = 0;
+
+    for (int step = 0; step < 20000; step++) {
+        unsigned op = test_rand() % 3;
+        if (op == 0) {
+            char data[64];
+            size_t length = test_rand() % sizeof(data);
+            for (size_t i = 0; i < length; i++) {
+                data[i] = (char)next++;
+            }
+            bool fits = used + length <= sizeof(model);
+            CHECK(ring_buffer_append(&ring, data, length) == fits);
+            if (fits) {
+                memcpy(model + used, data, length);
+                used += length;
+            } else {
+                next = (unsigned char)(next - length);
+            }
+        } else if (op == 1 && used > 0) {
+            size_t length = test_rand() % (used + 1);
+            CHECK(ring_buffer_consume(&ring, length) == length);
+            memmove(model, model + length, used - length);
+            used -= length;
+        } else {
+            CHECK(ring_buffer_used(&ring) == used);
+            if (used > 0) {
+                CHECK_BYTES(ring_buffer_peek(&ring), model, used);
+            }
+        }
+    }
+    ring_buffer_destroy(&ring);
+}
+
+int main(void) {
+    RUN(test_init_rounds_sizes);
+    RUN(test_wrap_and_peek);
+    RUN(test_grow_to_limit);
+    RUN(test_shrinks_when_empty);
+    RUN(test_write_space_commit);
+    RUN(test_matches_reference);
+    return TEST_RESULT();
+}
@@ -0,0 +1,80 @@
+/*
+ * Luminous Locus Shared Frame Test
+ * Encoding and reference counting of fan-out frames
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "../frame.h"
+#include "../shared_frame.h"
+#include "test.h"
+
+/* References each thread takes and drops */
+#define REFS_PER_THREAD 100000
+
+/* A created frame is a header followed by the body */
+static void test_create(void) {
+    SharedFrame* frame = shared_frame_create(42, "{}", 2);
+    CHECK(frame != NULL);
+    CHECK(shared_frame_length(frame) == FRAME_HEADER_SIZE + 2);
+    char expected[FRAME_HEADER_SIZE + 2];
+    frame_write_header(expected, 42, 2);
+    memcpy(expected + FRAME_HEADER_SIZE, "{}", 2);
+    CHECK_BYTES(shared_frame_data(frame), expected, sizeof(expected));
+    shared_frame_release(frame);
+
+    SharedFrame* empty = shared_frame_create(7, NULL, 0);
+    CHECK(shared_frame_length(empty) == FRAME_HEADER_SIZE);
+    shared_frame_release(empty);
+}
+
+/* Copies and allocated frames hold exactly the bytes given */
+static void test_copy_and_alloc(void) {
+    SharedFrame* copy = shared_frame_copy("abcdef", 6);
+    CHECK(shared_frame_length(copy) == 6);
+    CHECK_BYTES(shared_frame_data(copy), "abcdef", 6);
+    shared_frame_release(copy);
+
+    SharedFrame* frame = shared_frame_alloc(4);
+    memcpy(shared_frame_mutable_data(frame), "wxyz", 4);
+    CHECK(shared_frame_data(frame) == shared_frame_mutable_data(frame));
+    CHECK_BYTES(shared_frame_data(frame), "wxyz", 4);
+    shared_frame_release(frame);
+
+    CHECK(shared_frame_data(NULL) == NULL && shared_frame_length(NULL) == 0);
+    shared_frame_release(NULL);
+}
+
+/* Take and drop references */
+static void* churn(void* arg) {
+    SharedFrame* frame = (SharedFrame*)arg;
+    for (int i = 0; i < REFS_PER_THREAD; i++) {
+        shared_frame_release(shared_frame_retain(frame));
+    }
+    return NULL;
+}
+
+/* Concurrent retains and releases keep the frame alive for its last holder */
+static void test_threads(void) {
+    SharedFrame* frame = shared_frame_create(1, "body", 4);
+    pthread_t threads[4];
+    for (int i = 0; i < 4; i++) {
+        pthread_create(&threads[i], NULL, churn, frame);
+    }
+    for (int i = 0; i < 4; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    CHECK(shared_frame_retain(frame) == frame);
+    shared_frame_release(frame);
+    CHECK_BYTES(shared_frame_data(frame) + FRAME_HEADER_SIZE, "body", 4);
+    shared_frame_release(frame);
+}
+
+int main(void) {
+    RUN(test_create);
+    RUN(test_copy_and_alloc);
+    RUN(test_threads);
+    return TEST_RESULT();
+}
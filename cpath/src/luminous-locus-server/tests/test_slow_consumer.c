@@ -0,0 +1,126 @@
+/*
+ * Luminous Locus Slow Consumer Test
+ * Thresholds, sampling and eviction of clients that fall behind
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../slow_consumer.h"
+#include "test.h"
+
+/* One millisecond in tracker time */
+#define MS 1000000LL
+
+/* Warn at a quarter and drop at half of the eviction threshold, 0 turns a metric off */
+static void test_scale(void) {
+    SlowThresholds thresholds;
+    slow_thresholds_scale(&thresholds, 100);
+    CHECK(thresholds.Warn == 25 && thresholds.Drop == 50 && thresholds.Evict == 100);
+    slow_thresholds_scale(&thresholds, -5);
+    CHECK(thresholds.Warn == 0 && thresholds.Drop == 0 && thresholds.Evict == 0);
+}
+
+/* The worst metric decides the level */
+static void test_assess(void) {
+    SlowPolicy policy;
+    memset(&policy, 0, sizeof(policy));
+    slow_thresholds_scale(&policy.QueueBytes, 1000);
+    slow_thresholds_scale(&policy.QueueTicks, 40);
+
+    SlowSample sample = { 0, 0, 0, 0 };
+    CHECK(slow_policy_assess(&policy, &sample) == SLOW_OK);
+    sample.QueueBytes = 249;
+    CHECK(slow_policy_assess(&policy, &sample) == SLOW_OK);
+    sample.QueueBytes = 250;
+    CHECK(slow_policy_assess(&policy, &sample) == SLOW_WARN);
+    sample.QueueTicks = 20;
+    CHECK(slow_policy_assess(&policy, &sample) == SLOW_DROP);
+    sample.QueueBytes = 1000;
+    CHECK(slow_policy_assess(&policy, &sample) == SLOW_EVICT);
+
+    /* Metrics without thresholds never escalate */
+    sample.QueueBytes = 0;
+    sample.QueueTicks = 0;
+    sample.HashTicks = 1000000;
+    sample.StallMs = 1000000;
+    CHECK(slow_policy_assess(&policy, &sample) == SLOW_OK);
+    CHECK(slow_policy_assess(NULL, &sample) == SLOW_OK);
+}
+
+/* Queue age and stall time only count while output is waiting */
+static void test_sample_backlog(void) {
+    SlowTracker tracker;
+    SlowSample sample;
+    slow_tracker_init(&tracker, 10, 0);
+    slow_tracker_sample(&tracker, 0, 30, 500 * MS, &sample);
+    CHECK(sample.QueueBytes == 0 && sample.QueueTicks == 0 && sample.StallMs == 0);
+    CHECK(sample.HashTicks == 20);
+
+    slow_tracker_backlog_started(&tracker, 30, 500 * MS);
+    slow_tracker_backlog_started(&tracker, 35, 900 * MS);
+    slow_tracker_sample(&tracker, 4096, 42, 1700 * MS, &sample);
+    CHECK(sample.QueueBytes == 4096 && sample.QueueTicks == 12 && sample.StallMs == 1200);
+
+    /* Progress resets the stall but not the age of the backlog */
+    slow_tracker_progress(&tracker, false, 1600 * MS);
+    slow_tracker_sample(&tracker, 100, 42, 1700 * MS, &sample);
+    CHECK(sample.QueueTicks == 12 && sample.StallMs == 100);
+
+    slow_tracker_progress(&tracker, true, 1700 * MS);
+    slow_tracker_sample(&tracker, 0, 50, 9000 * MS, &sample);
+    CHECK(sample.QueueTicks == 0 && sample.StallMs == 0);
+
+    slow_tracker_hash(&tracker, 48);
+    slow_tracker_sample(&tracker, 0, 50, 9000 * MS, &sample);
+    CHECK(sample.HashTicks == 2);
+}
+
+/* Eviction sets the linger deadline once */
+static void test_evict(void) {
+    SlowPolicy policy;
+    slow_policy_defaults(&policy);
+    policy.EvictLingerMs = 250;
+
+    SlowTracker tracker;
+    slow_tracker_init(&tracker, 0, 0);
+    CHECK(!slow_tracker_evicting(&tracker));
+    slow_tracker_evict(&tracker, &policy, 1000 * MS);
+    CHECK(slow_tracker_evicting(&tracker));
+    CHECK(tracker.EvictDeadline == 1250 * MS);
+    slow_tracker_evict(&tracker, &policy, 5000 * MS);
+    CHECK(tracker.EvictDeadline == 1250 * MS);
+    CHECK(strcmp(slow_level_name(tracker.Level), "evict") == 0);
+}
+
+/* Held back input ages like queued output */
+static void test_paused_input(void) {
+    SlowTracker tracker;
+    SlowSample sample;
+    slow_tracker_init(&tracker, 0, 0);
+    slow_tracker_pause_input(&tracker, 5);
+    slow_tracker_pause_input(&tracker, 9);
+    CHECK(slow_tracker_input_paused(&tracker));
+    slow_tracker_sample(&tracker, 0, 25, 0, &sample);
+    CHECK(sample.QueueTicks == 20);
+
+    /* Whichever waited longer counts */
+    slow_tracker_backlog_started(&tracker, 1, 0);
+    slow_tracker_sample(&tracker, 10, 25, 0, &sample);
+    CHECK(sample.QueueTicks == 24);
+
+    slow_tracker_resume_input(&tracker);
+    slow_tracker_progress(&tracker, true, 0);
+    CHECK(!slow_tracker_input_paused(&tracker));
+    slow_tracker_sample(&tracker, 0, 40, 0, &sample);
+    CHECK(sample.QueueTicks == 0);
+}
+
+int main(void) {
+    RUN(test_scale);
+    RUN(test_assess);
+    RUN(test_sample_backlog);
+    RUN(test_evict);
+    RUN(test_paused_input);
+    return TEST_RESULT();
+}
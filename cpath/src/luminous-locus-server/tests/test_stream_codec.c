@@ -0,0 +1,155 @@
+/*
+ * Luminous Locus Stream Codec Test
+ * Round trips across frames and rejection of corrupt input
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../stream_codec.h"
+#include "test.h"
+
+/* Compress and decompress one frame on a stream pair */
+static bool round_trip(StreamEncoder* encoder, StreamDecoder* decoder, const char* data, size_t length,
+                       size_t* wire) {
+    size_t bound = stream_encode_bound(length);
+    char* packed = (char*)malloc(bound);
+    char* unpacked = (char*)malloc(length + 1);
+    size_t packed_length = stream_encode(encoder, data, length, packed, bound);
+    size_t written = 0;
+    bool ok = (packed_length > 0 || length == 0) &&
+              stream_decode(decoder, packed, packed_length, unpacked, length, &written) &&
+              written == length && memcmp(unpacked, data, length) == 0;
+    if (wire != NULL) {
+        *wire = packed_length;
+    }
+    free(packed);
+    free(unpacked);
+    return ok;
+}
+
+/* Text, runs and nothing at all come back intact */
+static void test_simple_round_trips(void) {
+    StreamEncoder* encoder = stream_encoder_create();
+    StreamDecoder* decoder = stream_decoder_create();
+    const char* text = "{\"id\":1,\"key\":\"w\"}{\"id\":2,\"key\":\"w\"}{\"id\":3,\"key\":\"s\"}";
+    CHECK(round_trip(encoder, decoder, text, strlen(text), NULL));
+    CHECK(round_trip(encoder, decoder, "", 0, NULL));
+    CHECK(round_trip(encoder, decoder, "a", 1, NULL));
+
+    char run[5000];
+    memset(run, 'z', sizeof(run));
+    size_t wire = 0;
+    CHECK(round_trip(encoder, decoder, run, sizeof(run), &wire));
+    CHECK(wire < 100);
+    stream_encoder_free(encoder);
+    stream_decoder_free(decoder);
+}
+
+/* A frame repeating an earlier one costs little */
+static void test_history_across_frames(void) {
+    StreamEncoder* encoder = stream_encoder_create();
+    StreamDecoder* decoder = stream_decoder_create();
+    char frame[2000];
+    for (size_t i = 0; i < sizeof(frame); i++) {
+        frame[i] = (char)test_rand();
+    }
+    size_t first = 0;
+    size_t second = 0;
+    CHECK(round_trip(encoder, decoder, frame, sizeof(frame), &first));
+    CHECK(round_trip(encoder, decoder, frame, sizeof(frame), &second));
+    CHECK(first >= sizeof(frame));
+    CHECK(second < 64);
+    stream_encoder_free(encoder);
+    stream_decoder_free(decoder);
+}
+
+/* Many frames of mixed content run the windows through several slides */
+static void test_long_stream(void) {
+    StreamEncoder* encoder = stream_encoder_create();
+    StreamDecoder* decoder = stream_decoder_create();
+    size_t size = 3 * STREAM_CODEC_WINDOW + 123;
+    char* data = (char*)malloc(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (i / 700) % 3 == 0 ? (char)test_rand() : (char)('a' + i % 17);
+    }
+    CHECK(round_trip(encoder, decoder, data, size, NULL));
+
+    bool ok = true;
+    for (int frame = 0; frame < 400 && ok; frame++) {
+        size_t offset = test_rand() % (size - 4000);
+        size_t length = test_rand() % 4000;
+        ok = round_trip(encoder, decoder, data + offset, length, NULL);
+    }
+    CHECK(ok);
+    free(data);
+    stream_encoder_free(encoder);
+    stream_decoder_free(decoder);
+}
+
+/* Too small a buffer is refused without touching the stream */
+static void test_small_capacity(void) {
+    StreamEncoder* encoder = stream_encoder_create();
+    StreamDecoder* decoder = stream_decoder_create();
+    char out[64];
+    CHECK(stream_encode(encoder, "abcdefgh", 8, out, 4) == 0);
+    CHECK(round_trip(encoder, decoder, "abcdefgh", 8, NULL));
+
+    /* Output larger than the caller allows is corrupt for the caller */
+    char packed[64];
+    size_t packed_length = stream_encode(encoder, "0123456789", 10, packed, sizeof(packed));
+    size_t written = 0;
+    CHECK(!stream_decode(decoder, packed, packed_length, out, 9, &written));
+    stream_encoder_free(encoder);
+    stream_decoder_free(decoder);
+}
+
+/* Hand-made corrupt sequences are rejected */
+static void test_rejects_corrupt(void) {
+    char out[256];
+    size_t written = 0;
+    const struct {
+        const char* Data;
+        size_t Length;
+    } cases[] = {
+        { "\x50" "abc", 4 },              /* five literals promised, three present */
+        { "\xf0", 1 },                    /* literal length continues past the end */
+        { "\x10" "a" "\x02", 3 },         /* match without its distance */
+        { "\x01\x00\x00", 3 },            /* distance zero */
+        { "\x10" "a" "\x01\x02\x00", 5 }, /* reaches before the stream started */
+        { "\x0f\x01\x00\xff\xff", 5 },    /* match length runs off the end */
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        StreamDecoder* decoder = stream_decoder_create();
+        CHECK(!stream_decode(decoder, cases[i].Data, cases[i].Length, out, sizeof(out), &written));
+        stream_decoder_free(decoder);
+    }
+}
+
+/* Random bytes never write past the output */
+static void test_random_input(void) {
+    char input[512];
+    char out[1024];
+    for (int round = 0; round < 2000; round++) {
+        size_t length = test_rand() % sizeof(input);
+        for (size_t i = 0; i < length; i++) {
+            input[i] = (char)test_rand();
+        }
+        StreamDecoder* decoder = stream_decoder_create();
+        size_t written = 0;
+        if (stream_decode(decoder, input, length, out, sizeof(out), &written)) {
+            CHECK(written <= sizeof(out));
+        }
+        stream_decoder_free(decoder);
+    }
+}
+
+int main(void) {
+    RUN(test_simple_round_trips);
+    RUN(test_history_across_frames);
+    RUN(test_long_stream);
+    RUN(test_small_capacity);
+    RUN(test_rejects_corrupt);
+    RUN(test_random_input);
+    return TEST_RESULT();
+}
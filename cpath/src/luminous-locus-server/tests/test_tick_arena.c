@@ -0,0 +1,110 @@
+/*
+ * Luminous Locus Tick Arena Test
+ * Bump allocation, holds and flipping of the per-tick arenas
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../model.h"
+#include "../message.h"
+#include "../tick_arena.h"
+#include "test.h"
+
+/* Allocations are aligned, distinct and counted */
+static void test_alloc(void) {
+    TickArena* arena = tick_arena_create(1024);
+    char* a = (char*)tick_arena_alloc(arena, 3);
+    char* b = (char*)tick_arena_alloc(arena, 20);
+    CHECK(a != NULL && b != NULL && a != b);
+    CHECK((uintptr_t)a % 16 == 0 && (uintptr_t)b % 16 == 0);
+    CHECK(b - a >= 16);
+    CHECK(tick_arena_used(arena) == 16 + 32);
+
+    /* Too large for a chunk, or nothing at all */
+    CHECK(tick_arena_alloc(arena, 1025) == NULL);
+    CHECK(tick_arena_alloc(arena, 0) == NULL);
+
+    tick_arena_reset(arena);
+    CHECK(tick_arena_used(arena) == 0);
+    CHECK(tick_arena_alloc(arena, 3) == a);
+    tick_arena_free(arena);
+}
+
+/* Full chunks chain up to the limit and are kept across resets */
+static void test_chunks(void) {
+    TickArena* arena = tick_arena_create(256);
+    void* first[TICK_ARENA_MAX_CHUNKS];
+    for (int i = 0; i < TICK_ARENA_MAX_CHUNKS; i++) {
+        first[i] = tick_arena_alloc(arena, 256);
+        CHECK(first[i] != NULL);
+    }
+    CHECK(tick_arena_alloc(arena, 16) == NULL);
+
+    tick_arena_reset(arena);
+    for (int i = 0; i < TICK_ARENA_MAX_CHUNKS; i++) {
+        CHECK(tick_arena_alloc(arena, 256) == first[i]);
+    }
+    tick_arena_free(arena);
+}
+
+/* A pair only flips to the other arena once nothing holds it */
+static void test_pair_flip(void) {
+    TickArenaPair* pair = tick_arena_pair_create(1024);
+    TickArena* first = tick_arena_pair_current(pair, 0);
+    CHECK(tick_arena_pair_current(pair, 0) == first);
+    tick_arena_alloc(first, 64);
+    tick_arena_hold(first);
+
+    TickArena* second = tick_arena_pair_current(pair, 1);
+    CHECK(second != first);
+    tick_arena_hold(second);
+    CHECK(!tick_arena_idle(first));
+
+    /* The first arena is still held, so tick 2 keeps filling the second */
+    CHECK(tick_arena_pair_current(pair, 2) == second);
+    tick_arena_release(first);
+    CHECK(tick_arena_idle(first));
+    CHECK(tick_arena_pair_current(pair, 3) == first);
+    CHECK(tick_arena_used(first) == 0);
+    tick_arena_release(second);
+    tick_arena_pair_free(pair);
+}
+
+/* Envelopes in an arena hold it, and a copied out envelope lets it go */
+static void test_envelopes(void) {
+    TickArena* arena = tick_arena_create(1024);
+    Envelope* env = envelope_create_frame_in(arena, MSGID_INPUT, 7, "{\"key\":\"w\"}", 11);
+    CHECK(env != NULL && !tick_arena_idle(arena));
+    CHECK(envelope_get_body_length(env) == 11 && memcmp(envelope_get_body(env), "{\"key\":\"w\"}", 11) == 0);
+
+    MessageInput* input = (MessageInput*)get_concrete_message(MSGID_INPUT);
+    envelope_set_message(env, input);
+    Envelope* held = envelope_copy_out(env);
+    CHECK(held != NULL && tick_arena_idle(arena));
+    CHECK(envelope_get_kind(held) == MSGID_INPUT && envelope_get_from(held) == 7);
+    CHECK(envelope_get_message(held) == input);
+    CHECK(memcmp(envelope_get_body(held), "{\"key\":\"w\"}", 11) == 0);
+
+    /* Heap envelopes are already free of any arena */
+    CHECK(envelope_copy_out(held) == held);
+    envelope_discard(held);
+
+    /* Bodies larger than a chunk go to the heap */
+    char big[2048];
+    memset(big, 'x', sizeof(big));
+    env = envelope_create_frame_in(arena, MSGID_OOCMESSAGE, 1, big, sizeof(big));
+    CHECK(env != NULL && tick_arena_idle(arena) && envelope_copy_out(env) == env);
+    CHECK(envelope_get_body_length(env) == sizeof(big));
+    envelope_free(env);
+    tick_arena_free(arena);
+}
+
+int main(void) {
+    RUN(test_alloc);
+    RUN(test_chunks);
+    RUN(test_pair_flip);
+    RUN(test_envelopes);
+    return TEST_RESULT();
+}
@@ -0,0 +1,181 @@
+/*
+ * Luminous Locus Tick Batch Test
+ * Stamping, ordering and encoding of a tick's relayed inputs
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../model.h"
+#include "../frame.h"
+#include "../compact_codec.h"
+#include "../tick_batch.h"
+#include "test.h"
+
+/* Frames of one finished tick */
+typedef struct Tick {
+    int Count;
+    uint32_t Kind[8];
+    char Body[8][256];
+} Tick;
+
+/* Split a finished tick into its frames, NUL terminating each body */
+static void read_tick(SharedFrame* frame, Tick* tick) {
+    FrameReader reader;
+    FrameView view;
+    size_t length = shared_frame_length(frame);
+    memset(tick, 0, sizeof(Tick));
+    frame_reader_init(&reader, shared_frame_data(frame), length, length);
+    while (frame_reader_next(&reader, &view) == FRAME_OK && tick->Count < 8) {
+        tick->Kind[tick->Count] = view.Kind;
+        memcpy(tick->Body[tick->Count], view.Body, view.Length < 255 ? view.Length : 255);
+        tick->Count++;
+    }
+    shared_frame_release(frame);
+}
+
+/* Add a NUL terminated body */
+static bool add(TickBatch* batch, int from, int kind, const char* body) {
+    return tick_batch_add(batch, from, kind, body, strlen(body));
+}
+
+/* The id goes in front of the closing brace, empty objects get no comma */
+static void test_stamps_sender(void) {
+    TickBatch* batch = tick_batch_create();
+    CHECK(add(batch, 7, MSGID_INPUT, " {\"key\":\"w\"} "));
+    CHECK(add(batch, 9, MSGID_ORDINARY, "{ }"));
+    Tick tick;
+    read_tick(tick_batch_finish(batch, NULL), &tick);
+    CHECK(tick.Count == 3);
+    CHECK(strcmp(tick.Body[0], "{\"key\":\"w\",\"id\":7}") == 0);
+    CHECK(strcmp(tick.Body[1], "{\"id\":9}") == 0);
+    CHECK(tick.Kind[2] == MSGID_NEWTICK && strcmp(tick.Body[2], "{}") == 0);
+    tick_batch_free(batch);
+}
+
+/* An id the client put in the body is replaced, not repeated */
+static void test_replaces_client_id(void) {
+    TickBatch* batch = tick_batch_create();
+    CHECK(add(batch, 4, MSGID_INPUT, "{\"id\":1,\"key\":\"w\"}"));
+    CHECK(add(batch, 5, MSGID_MOUSECLICK, "{\"obj\":2,\"action\":\"use\",\"\\u0069d\":1}"));
+    CHECK(add(batch, 6, MSGID_INPUT, "{\"key\":\"\\\"id\\\"\"}"));
+    CHECK(!add(batch, 8, MSGID_INPUT, "{\"id\":1,\"key\""));
+    CHECK(tick_batch_count(batch) == 3);
+
+    Tick tick;
+    read_tick(tick_batch_finish(batch, NULL), &tick);
+    CHECK(tick.Count == 4);
+    for (int i = 0; i < 3; i++) {
+        const char* first = strstr(tick.Body[i], "\"id\":");
+        CHECK(first != NULL && strstr(first + 1, "\"id\":") == NULL);
+        CHECK(strstr(tick.Body[i], "\\u0069d") == NULL);
+    }
+    CHECK(strstr(tick.Body[0], "\"id\":4") != NULL && strstr(tick.Body[0], "\"key\":\"w\"") != NULL);
+    CHECK(strstr(tick.Body[1], "\"id\":5") != NULL && strstr(tick.Body[1], "\"action\":\"use\"") != NULL);
+    CHECK(strstr(tick.Body[2], "\"id\":6") != NULL);
+    tick_batch_free(batch);
+}
+
+/* Bodies that are not exactly one object are dropped, never relayed unstamped */
+static void test_rejects_bad_bodies(void) {
+    TickBatch* batch = tick_batch_create();
+    CHECK(!tick_batch_add(batch, 1, MSGID_INPUT, "", 0));
+    CHECK(!add(batch, 1, MSGID_INPUT, "   "));
+    CHECK(!add(batch, 1, MSGID_INPUT, "[\"w\"]"));
+    CHECK(!add(batch, 1, MSGID_INPUT, "\"w\""));
+    CHECK(!add(batch, 1, MSGID_INPUT, "{\"key\":\"w\"}x"));
+    CHECK(!add(batch, 1, MSGID_INPUT, "{\"key\":\"w\"}{\"key\":\"s\"}"));
+    CHECK(!add(batch, 1, MSGID_INPUT, "{\"key\":\"w\"} }"));
+    CHECK(add(batch, 1, MSGID_INPUT, "{\"key\":\"w\"}\r\n"));
+    CHECK(tick_batch_count(batch) == 1);
+
+    Tick tick;
+    read_tick(tick_batch_finish(batch, NULL), &tick);
+    CHECK(tick.Count == 2);
+    CHECK(strcmp(tick.Body[0], "{\"key\":\"w\",\"id\":1}") == 0);
+    tick_batch_free(batch);
+}
+
+/* Inputs go out by sender, then by arrival */
+static void test_orders_by_sender(void) {
+    TickBatch* batch = tick_batch_create();
+    add(batch, 3, MSGID_INPUT, "{\"key\":\"a\"}");
+    add(batch, 1, MSGID_INPUT, "{\"key\":\"b\"}");
+    add(batch, 3, MSGID_INPUT, "{\"key\":\"c\"}");
+    add(batch, 2, MSGID_INPUT, "{\"key\":\"d\"}");
+    Tick tick;
+    read_tick(tick_batch_finish(batch, NULL), &tick);
+    CHECK(tick.Count == 5);
+    CHECK(strstr(tick.Body[0], "\"b\"") != NULL && strstr(tick.Body[1], "\"d\"") != NULL);
+    CHECK(strstr(tick.Body[2], "\"a\"") != NULL && strstr(tick.Body[3], "\"c\"") != NULL);
+    CHECK(tick_batch_count(batch) == 0);
+    tick_batch_free(batch);
+}
+
+/* Compact input is relayed as JSON, and in compact form to compact clients */
+static void test_compact_input(void) {
+    TickBatch* batch = tick_batch_create();
+    MessageInput input = { .ID = 99, .Key = "q" };
+    char body[COMPACT_BODY_MAX];
+    size_t length = compact_encode(MSGID_INPUT, &input, body, sizeof(body));
+    CHECK(tick_batch_add(batch, 2, MSGID_INPUT, body, length));
+
+    SharedFrame* compact = NULL;
+    Tick tick;
+    read_tick(tick_batch_finish(batch, &compact), &tick);
+    CHECK(tick.Count == 2);
+    CHECK(strstr(tick.Body[0], "\"id\":2") != NULL && strstr(tick.Body[0], "99") == NULL);
+
+    CHECK(compact != NULL);
+    FrameReader reader;
+    FrameView view;
+    frame_reader_init(&reader, shared_frame_data(compact), shared_frame_length(compact),
+                      shared_frame_length(compact));
+    CHECK(frame_reader_next(&reader, &view) == FRAME_OK && compact_is_body(view.Body, view.Length));
+    MessageInput out;
+    CHECK(compact_decode(MSGID_INPUT, view.Body, view.Length, &out));
+    CHECK(out.ID == 2 && strcmp(out.Key, "q") == 0);
+    shared_frame_release(compact);
+    tick_batch_free(batch);
+}
+
+/* JSON input reaches compact clients in compact form, stamped and in order */
+static void test_json_input_compact(void) {
+    TickBatch* batch = tick_batch_create();
+    CHECK(add(batch, 5, MSGID_INPUT, "{\"key\":\"b\"}"));
+    CHECK(add(batch, 3, MSGID_MOUSECLICK, "{\"obj\":12,\"action\":\"use\"}"));
+    for (int round = 0; round < 2; round++) {
+        SharedFrame* compact = NULL;
+        shared_frame_release(tick_batch_finish(batch, &compact));
+        CHECK(compact != NULL);
+        FrameReader reader;
+        FrameView view;
+        frame_reader_init(&reader, shared_frame_data(compact), shared_frame_length(compact),
+                          shared_frame_length(compact));
+        if (round == 0) {
+            MessageMouseClick click;
+            CHECK(frame_reader_next(&reader, &view) == FRAME_OK && view.Kind == MSGID_MOUSECLICK);
+            CHECK(compact_decode(MSGID_MOUSECLICK, view.Body, view.Length, &click));
+            CHECK(click.ID == 3 && click.Object == 12 && strcmp(click.Action, "use") == 0);
+            MessageInput input;
+            CHECK(frame_reader_next(&reader, &view) == FRAME_OK && view.Kind == MSGID_INPUT);
+            CHECK(compact_decode(MSGID_INPUT, view.Body, view.Length, &input));
+            CHECK(input.ID == 5 && strcmp(input.Key, "b") == 0);
+        }
+        /* Storage is reset with the tick, an empty tick is just NEWTICK */
+        CHECK(frame_reader_next(&reader, &view) == FRAME_OK && view.Kind == MSGID_NEWTICK);
+        CHECK(frame_reader_next(&reader, &view) == FRAME_INCOMPLETE);
+        shared_frame_release(compact);
+    }
+    tick_batch_free(batch);
+}
+
+int main(void) {
+    RUN(test_stamps_sender);
+    RUN(test_replaces_client_id);
+    RUN(test_rejects_bad_bodies);
+    RUN(test_orders_by_sender);
+    RUN(test_compact_input);
+    RUN(test_json_input_compact);
+    return TEST_RESULT();
+}
@@ -0,0 +1,94 @@
+/*
+ * Luminous Locus Tick Clock Test
+ * Deadlines, lateness and skipped ticks of the fixed-rate clock
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include "../tick_clock.h"
+#include "test.h"
+
+/* One millisecond in clock time */
+#define MS 1000000LL
+
+/* Deadlines stay on the grid however late a tick starts */
+static void test_no_drift(void) {
+    TickClock* clock = tick_clock_create(50);
+    CHECK(clock != NULL);
+    CHECK(tick_clock_interval(clock) == 50 * MS);
+    int64_t first = tick_clock_deadline(clock);
+
+    CHECK(!tick_clock_due(clock, first - 1));
+    CHECK(tick_clock_due(clock, first));
+    CHECK(tick_clock_begin(clock, first + 20 * MS) == 1);
+    tick_clock_end(clock, first + 30 * MS);
+    CHECK(tick_clock_deadline(clock) == first + 50 * MS);
+
+    CHECK(tick_clock_begin(clock, first + 50 * MS) == 2);
+    tick_clock_end(clock, first + 55 * MS);
+    CHECK(tick_clock_deadline(clock) == first + 100 * MS);
+
+    TickStats stats;
+    tick_clock_get_stats(clock, &stats);
+    CHECK(stats.Ticks == 2 && stats.Missed == 0);
+    CHECK(stats.LastLateness == 0 && stats.MaxLateness == 20 * MS && stats.TotalLateness == 20 * MS);
+    CHECK(stats.LastDuration == 5 * MS && stats.MaxDuration == 10 * MS && stats.TotalDuration == 15 * MS);
+    tick_clock_free(clock);
+}
+
+/* Falling whole intervals behind skips them instead of bursting */
+static void test_skips_missed(void) {
+    TickClock* clock = tick_clock_create(10);
+    int64_t first = tick_clock_deadline(clock);
+    CHECK(tick_clock_begin(clock, first + 35 * MS) == 1);
+    CHECK(tick_clock_deadline(clock) == first + 40 * MS);
+    CHECK(!tick_clock_due(clock, first + 39 * MS));
+
+    /* Exactly on a later deadline counts that one as missed too */
+    CHECK(tick_clock_begin(clock, first + 60 * MS) == 2);
+    CHECK(tick_clock_deadline(clock) == first + 70 * MS);
+
+    TickStats stats;
+    tick_clock_get_stats(clock, &stats);
+    CHECK(stats.Ticks == 2 && stats.Missed == 5);
+    CHECK(stats.MaxLateness == 35 * MS);
+    tick_clock_free(clock);
+}
+
+/* The timer fd fires on the deadline and drains */
+static void test_timer_fd(void) {
+    TickClock* clock = tick_clock_create(5);
+    int fd = tick_clock_timer_fd(clock);
+    if (fd < 0) {
+        tick_clock_free(clock);
+        return;
+    }
+    CHECK(tick_clock_timer_fd(clock) == fd);
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    CHECK(poll(&pfd, 1, 1000) == 1);
+    CHECK(tick_clock_due(clock, tick_clock_now()));
+    tick_clock_drain_timer(clock);
+    pfd.revents = 0;
+    CHECK(poll(&pfd, 1, 0) == 0);
+    tick_clock_free(clock);
+}
+
+/* Sleeping returns at the deadline, not before */
+static void test_sleep(void) {
+    TickClock* clock = tick_clock_create(5);
+    tick_clock_sleep(clock);
+    CHECK(tick_clock_now() >= tick_clock_deadline(clock));
+    CHECK(tick_clock_create(0) == NULL);
+    tick_clock_free(clock);
+}
+
+int main(void) {
+    RUN(test_no_drift);
+    RUN(test_skips_missed);
+    RUN(test_timer_fd);
+    RUN(test_sleep);
+    return TEST_RESULT();
+}
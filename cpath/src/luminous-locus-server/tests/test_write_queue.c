@@ -0,0 +1,210 @@
+/*
+ * Luminous Locus Write Queue Test
+ * Queueing, partial writes and flushing of connection output
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include "../frame.h"
+#include "../shared_frame.h"
+#include "../write_queue.h"
+#include "test.h"
+
+/* Concatenate what gather describes */
+static size_t gather_all(const WriteQueue* queue, char* out) {
+    struct iovec iov[WRITE_QUEUE_MAX_IOV];
+    int count = write_queue_gather(queue, iov, WRITE_QUEUE_MAX_IOV);
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        memcpy(out + total, iov[i].iov_base, iov[i].iov_len);
+        total += iov[i].iov_len;
+    }
+    return total;
+}
+
+/* Copies, frames and shared frames come out in order */
+static void test_push_and_gather(void) {
+    WriteQueue queue;
+    write_queue_init(&queue, 0);
+    CHECK(write_queue_empty(&queue));
+
+    SharedFrame* frame = shared_frame_copy("shared", 6);
+    CHECK(write_queue_push(&queue, "abc", 3));
+    CHECK(write_queue_push_frame(&queue, 7, "xy", 2));
+    CHECK(write_queue_push_shared(&queue, frame));
+    CHECK(write_queue_push(&queue, "", 0));
+    shared_frame_release(frame);
+
+    char expected[32];
+    memcpy(expected, "abc", 3);
+    frame_write_header(expected + 3, 7, 2);
+    memcpy(expected + 3 + FRAME_HEADER_SIZE, "xy", 2);
+    memcpy(expected + 5 + FRAME_HEADER_SIZE, "shared", 6);
+    size_t length = 11 + FRAME_HEADER_SIZE;
+
+    char out[32];
+    CHECK(write_queue_bytes(&queue) == length);
+    CHECK(gather_all(&queue, out) == length);
+    CHECK_BYTES(out, expected, length);
+    write_queue_destroy(&queue);
+}
+
+/* A partial write resumes mid-chunk */
+static void test_advance_partial(void) {
+    WriteQueue queue;
+    write_queue_init(&queue, 0);
+    write_queue_push(&queue, "hello", 5);
+    write_queue_push(&queue, "world", 5);
+
+    write_queue_advance(&queue, 3);
+    CHECK(write_queue_bytes(&queue) == 7);
+    char out[16];
+    CHECK(gather_all(&queue, out) == 7);
+    CHECK_BYTES(out, "loworld", 7);
+
+    write_queue_advance(&queue, 4);
+    CHECK(gather_all(&queue, out) == 3);
+    CHECK_BYTES(out, "rld", 3);
+
+    write_queue_advance(&queue, 4);
+    CHECK(write_queue_bytes(&queue) == 3);
+    write_queue_advance(&queue, 3);
+    CHECK(write_queue_empty(&queue));
+    CHECK(write_queue_bytes(&queue) == 0);
+    write_queue_destroy(&queue);
+}
+
+/* Pushes past the high-water mark are refused whole */
+static void test_high_water(void) {
+    WriteQueue queue;
+    write_queue_init(&queue, 10);
+    CHECK(write_queue_push(&queue, "0123456", 7));
+    CHECK(!write_queue_push(&queue, "abcd", 4));
+    CHECK(write_queue_push(&queue, "abc", 3));
+    CHECK(!write_queue_push_frame(&queue, 1, NULL, 0));
+    CHECK(write_queue_bytes(&queue) == 10);
+    write_queue_destroy(&queue);
+}
+
+/* Discarding a queue that is not mid-chunk empties it */
+static void test_discard_whole(void) {
+    WriteQueue queue;
+    write_queue_init(&queue, 0);
+    write_queue_push(&queue, "abc", 3);
+    write_queue_push(&queue, "def", 3);
+    write_queue_discard(&queue);
+    CHECK(write_queue_empty(&queue));
+    CHECK(write_queue_bytes(&queue) == 0);
+
+    CHECK(write_queue_push(&queue, "g", 1));
+    char out[8];
+    CHECK(gather_all(&queue, out) == 1 && out[0] == 'g');
+    write_queue_destroy(&queue);
+}
+
+/* A partly written chunk alone in the queue survives a discard */
+static void test_discard_keeps_only_chunk(void) {
+    WriteQueue queue;
+    write_queue_init(&queue, 0);
+    write_queue_push(&queue, "0123456789", 10);
+    write_queue_advance(&queue, 4);
+    write_queue_discard(&queue);
+    CHECK(!write_queue_empty(&queue));
+    CHECK(write_queue_bytes(&queue) == 6);
+
+    char out[32];
+    CHECK(gather_all(&queue, out) == 6);
+    CHECK_BYTES(out, "456789", 6);
+
+    CHECK(write_queue_push(&queue, "TOOSLOW", 7));
+    CHECK(write_queue_bytes(&queue) == 13);
+    CHECK(gather_all(&queue, out) == 13);
+    CHECK_BYTES(out, "456789TOOSLOW", 13);
+
+    write_queue_advance(&queue, 13);
+    CHECK(write_queue_empty(&queue));
+    write_queue_destroy(&queue);
+}
+
+/* Behind a partly written head, every other chunk goes */
+static void test_discard_keeps_partial_head(void) {
+    WriteQueue queue;
+    write_queue_init(&queue, 0);
+    SharedFrame* frame = shared_frame_copy("shared", 6);
+    write_queue_push(&queue, "0123456789", 10);
+    write_queue_push(&queue, "abc", 3);
+    write_queue_push_shared(&queue, frame);
+    write_queue_push(&queue, "def", 3);
+    write_queue_advance(&queue, 7);
+    write_queue_discard(&queue);
+    CHECK(write_queue_bytes(&queue) == 3);
+
+    CHECK(write_queue_push(&queue, "!", 1));
+    char out[32];
+    CHECK(gather_all(&queue, out) == 4);
+    CHECK_BYTES(out, "789!", 4);
+    write_queue_destroy(&queue);
+    shared_frame_release(frame);
+}
+
+/* Flush writes everything a socket takes and reports a full socket */
+static void test_flush_socket(void) {
+    int fds[2];
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+
+    WriteQueue queue;
+    write_queue_init(&queue, 64 * 1024 * 1024);
+    char block[1000];
+    for (int i = 0; i < 20; i++) {
+        memset(block, 'a' + i % 26, sizeof(block));
+        write_queue_push(&queue, block, sizeof(block));
+    }
+
+    size_t written = 0;
+    CHECK(write_queue_flush(&queue, fds[0], &written) == WRITE_QUEUE_DONE);
+    CHECK(written == 20000);
+    CHECK(write_queue_empty(&queue));
+
+    char* in = (char*)malloc(20000);
+    size_t got = 0;
+    while (got < 20000) {
+        ssize_t n = read(fds[1], in + got, 20000 - got);
+        if (n <= 0) {
+            break;
+        }
+        got += (size_t)n;
+    }
+    CHECK(got == 20000);
+    CHECK(in[0] == 'a' && in[999] == 'a' && in[1000] == 'b' && in[19999] == 'a' + 19);
+    free(in);
+
+    /* Nobody reads now, so the socket fills up */
+    for (int i = 0; i < 20000; i++) {
+        write_queue_push(&queue, block, sizeof(block));
+    }
+    CHECK(write_queue_flush(&queue, fds[0], &written) == WRITE_QUEUE_PENDING);
+    CHECK(written > 0 && written < 20000000);
+    CHECK(write_queue_bytes(&queue) == 20000000 - written);
+
+    close(fds[1]);
+    CHECK(write_queue_flush(&queue, fds[0], &written) == WRITE_QUEUE_ERROR);
+    close(fds[0]);
+    write_queue_destroy(&queue);
+}
+
+int main(void) {
+    RUN(test_push_and_gather);
+    RUN(test_advance_partial);
+    RUN(test_high_water);
+    RUN(test_discard_whole);
+    RUN(test_discard_keeps_only_chunk);
+    RUN(test_discard_keeps_partial_head);
+    RUN(test_flush_socket);
+    return TEST_RESULT();
+}
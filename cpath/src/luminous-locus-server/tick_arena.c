@@ -0,0 +1,198 @@
+/*
+ * Luminous Locus Tick Arena Module
+ * Tick-scoped bump allocation for envelopes
+ *
+ * A reactor copies every inbound frame into an envelope that the game
+ * thread frees a moment later. Instead of a malloc/free pair per frame,
+ * envelopes are carved from the reactor's current arena and the arena
+ * is rewound as a whole. Each envelope holds its arena; the reactor
+ * fills one arena during tick N+1 while the game thread finishes with
+ * tick N's, and only rewinds an arena once every hold on it is gone.
+ * A game thread running late therefore delays the flip instead of
+ * racing it. Only the reactor allocates and resets its own arenas.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "tick_arena.h"
+
+/* Allocation alignment, enough for any message struct */
+#define TICK_ARENA_ALIGN 16
+
+typedef struct ArenaChunk {
+    struct ArenaChunk* Next;
+    size_t Size;
+    _Alignas(TICK_ARENA_ALIGN) char Data[];
+} ArenaChunk;
+
+struct TickArena {
+    ArenaChunk* First;
+    ArenaChunk* Current;
+    size_t Offset;        /* next free byte in Current */
+    size_t Used;
+    size_t ChunkSize;
+    int ChunkCount;
+    int Holds;            /* envelopes not yet released, atomic */
+};
+
+struct TickArenaPair {
+    TickArena* Arenas[2];
+    int Active;
+    uint64_t Tick;        /* tick the active arena was taken for */
+};
+
+/* Allocate a chunk */
+static ArenaChunk* arena_chunk_create(size_t size) {
+    ArenaChunk* chunk = (ArenaChunk*)malloc(sizeof(ArenaChunk) + size);
+    if (chunk != NULL) {
+        chunk->Next = NULL;
+        chunk->Size = size;
+    }
+    return chunk;
+}
+
+/* Create arena */
+TickArena* tick_arena_create(size_t chunk_size) {
+    TickArena* arena = (TickArena*)malloc(sizeof(TickArena));
+    if (arena == NULL) {
+        return NULL;
+    }
+    arena->ChunkSize = chunk_size > 0 ? chunk_size : TICK_ARENA_DEFAULT_CHUNK;
+    arena->First = arena_chunk_create(arena->ChunkSize);
+    if (arena->First == NULL) {
+        free(arena);
+        return NULL;
+    }
+    arena->Current = arena->First;
+    arena->Offset = 0;
+    arena->Used = 0;
+    arena->ChunkCount = 1;
+    arena->Holds = 0;
+    return arena;
+}
+
+/* Free arena */
+void tick_arena_free(TickArena* arena) {
+    if (arena != NULL) {
+        ArenaChunk* chunk = arena->First;
+        while (chunk != NULL) {
+            ArenaChunk* next = chunk->Next;
+            free(chunk);
+            chunk = next;
+        }
+        free(arena);
+    }
+}
+
+/* Allocate */
+void* tick_arena_alloc(TickArena* arena, size_t size) {
+    if (arena == NULL || size == 0 || size > arena->ChunkSize) {
+        return NULL;
+    }
+    size = (size + TICK_ARENA_ALIGN - 1) & ~(size_t)(TICK_ARENA_ALIGN - 1);
+
+    if (arena->Offset + size > arena->Current->Size) {
+        /* Move to the next chunk, kept from an earlier tick or fresh */
+        if (arena->Current->Next == NULL) {
+            if (arena->ChunkCount >= TICK_ARENA_MAX_CHUNKS) {
+                return NULL;
+            }
+            arena->Current->Next = arena_chunk_create(arena->ChunkSize);
+            if (arena->Current->Next == NULL) {
+                return NULL;
+            }
+            arena->ChunkCount++;
+        }
+        arena->Current = arena->Current->Next;
+        arena->Offset = 0;
+    }
+
+    void* data = arena->Current->Data + arena->Offset;
+    arena->Offset += size;
+    arena->Used += size;
+    return data;
+}
+
+/* Reset arena */
+void tick_arena_reset(TickArena* arena) {
+    if (arena != NULL) {
+        arena->Current = arena->First;
+        arena->Offset = 0;
+        arena->Used = 0;
+    }
+}
+
+/* Add hold */
+void tick_arena_hold(TickArena* arena) {
+    if (arena != NULL) {
+        __atomic_add_fetch(&arena->Holds, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/* Drop hold */
+void tick_arena_release(TickArena* arena) {
+    if (arena != NULL) {
+        /* Release orders the holder's reads before the owner's reset */
+        __atomic_sub_fetch(&arena->Holds, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* Check for holds */
+bool tick_arena_idle(TickArena* arena) {
+    return arena == NULL || __atomic_load_n(&arena->Holds, __ATOMIC_ACQUIRE) == 0;
+}
+
+/* Get used bytes */
+size_t tick_arena_used(const TickArena* arena) {
+    return arena != NULL ? arena->Used : 0;
+}
+
+/* Create pair */
+TickArenaPair* tick_arena_pair_create(size_t chunk_size) {
+    TickArenaPair* pair = (TickArenaPair*)malloc(sizeof(TickArenaPair));
+    if (pair == NULL) {
+        return NULL;
+    }
+    pair->Arenas[0] = tick_arena_create(chunk_size);
+    pair->Arenas[1] = tick_arena_create(chunk_size);
+    if (pair->Arenas[0] == NULL || pair->Arenas[1] == NULL) {
+        tick_arena_pair_free(pair);
+        return NULL;
+    }
+    pair->Active = 0;
+    pair->Tick = 0;
+    return pair;
+}
+
+/* Free pair */
+void tick_arena_pair_free(TickArenaPair* pair) {
+    if (pair != NULL) {
+        tick_arena_free(pair->Arenas[0]);
+        tick_arena_free(pair->Arenas[1]);
+        free(pair);
+    }
+}
+
+/* Get arena for tick */
+TickArena* tick_arena_pair_current(TickArenaPair* pair, uint64_t tick) {
+    if (pair == NULL) {
+        return NULL;
+    }
+    TickArena* active = pair->Arenas[pair->Active];
+    if (tick == pair->Tick) {
+        return active;
+    }
+
+    TickArena* other = pair->Arenas[pair->Active ^ 1];
+    if (!tick_arena_idle(other)) {
+        /* Game thread still holds the older tick, keep filling this one */
+        return active;
+    }
+    tick_arena_reset(other);
+    pair->Active ^= 1;
+    pair->Tick = tick;
+    return other;
+}
@@ -0,0 +1,57 @@
+/*
+ * Luminous Locus Tick Arena Header
+ */
+
+#ifndef TICK_ARENA_H
+#define TICK_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Default chunk size, several hundred small envelopes */
+#define TICK_ARENA_DEFAULT_CHUNK (64 * 1024)
+
+/* Chunks one arena may hold before allocations fall back to the heap */
+#define TICK_ARENA_MAX_CHUNKS 64
+
+/* Bump allocator for data that lives at most one tick */
+typedef struct TickArena TickArena;
+
+/* Two arenas, one filling while the other drains */
+typedef struct TickArenaPair TickArenaPair;
+
+/* Create arena, 0 selects the default chunk size */
+TickArena* tick_arena_create(size_t chunk_size);
+
+/* Free arena and all of its chunks */
+void tick_arena_free(TickArena* arena);
+
+/* Allocate 16-byte aligned memory, NULL when it does not fit a chunk */
+void* tick_arena_alloc(TickArena* arena, size_t size);
+
+/* Forget every allocation, chunks are kept for reuse */
+void tick_arena_reset(TickArena* arena);
+
+/* Count an allocation another thread will release */
+void tick_arena_hold(TickArena* arena);
+
+/* Drop a hold, callable from any thread */
+void tick_arena_release(TickArena* arena);
+
+/* No holds outstanding, safe to reset */
+bool tick_arena_idle(TickArena* arena);
+
+/* Bytes handed out since the last reset */
+size_t tick_arena_used(const TickArena* arena);
+
+/* Create pair */
+TickArenaPair* tick_arena_pair_create(size_t chunk_size);
+
+/* Free pair */
+void tick_arena_pair_free(TickArenaPair* pair);
+
+/* Arena to allocate in during tick, flips once the other half is idle */
+TickArena* tick_arena_pair_current(TickArenaPair* pair, uint64_t tick);
+
+#endif /* TICK_ARENA_H */
@@ -0,0 +1,304 @@
+/*
+ * Luminous Locus Tick Batch Module
+ * Per-tick input accumulator for lockstep relay
+ *
+ * Every client has to see every input of a tick in the same order.
+ * Inputs are sorted by sender id and then by arrival at that sender,
+ * which does not depend on how reactors interleave their handoffs.
+ * The whole tick then goes out as one buffer of back-to-back frames
+ * ending with NEWTICK, i.e. one write per client per tick.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "model.h"
+#include "frame.h"
+#include "json_encode.h"
+#include "json_decode.h"
+#include "compact_codec.h"
+#include "tick_batch.h"
+
+/* Stamped id suffix: ,"id":-2147483648} */
+#define ID_SUFFIX_MAX 24
+
+/* NEWTICK body */
+#define NEWTICK_BODY "{}"
+#define NEWTICK_BODY_SIZE 2
+
+/* One collected input */
+typedef struct TickInput {
+    int From;
+    int Kind;
+    uint64_t Seq;
+    size_t Offset;   /* stamped body in Bytes */
+    size_t Length;
+    size_t CompactOffset;   /* compact body in Compact */
+    size_t CompactLength;   /* 0 when it has no compact form and goes out as JSON */
+} TickInput;
+
+struct TickBatch {
+    TickInput* Inputs;
+    size_t Count;
+    size_t Capacity;
+    char* Bytes;
+    size_t BytesUsed;
+    size_t BytesCapacity;
+    char* Compact;
+    size_t CompactUsed;
+    size_t CompactCapacity;
+    uint64_t NextSeq;
+};
+
+/* Create batch */
+TickBatch* tick_batch_create(void) {
+    TickBatch* batch = (TickBatch*)malloc(sizeof(TickBatch));
+    if (batch == NULL) {
+        return NULL;
+    }
+    memset(batch, 0, sizeof(TickBatch));
+    return batch;
+}
+
+/* Free batch */
+void tick_batch_free(TickBatch* batch) {
+    if (batch != NULL) {
+        free(batch->Inputs);
+        free(batch->Bytes);
+        free(batch->Compact);
+        free(batch);
+    }
+}
+
+/* Check relayed kinds */
+bool tick_batch_accepts(int kind) {
+    return kind == MSGID_INPUT || kind == MSGID_ORDINARY || kind == MSGID_MOUSECLICK;
+}
+
+/* Make room for length more bytes in a growable buffer */
+static bool reserve_bytes(char** bytes, size_t used, size_t* capacity, size_t length) {
+    if (used + length <= *capacity) {
+        return true;
+    }
+    size_t grown = *capacity > 0 ? *capacity : 4096;
+    while (grown < used + length) {
+        grown *= 2;
+    }
+    char* resized = (char*)realloc(*bytes, grown);
+    if (resized == NULL) {
+        return false;
+    }
+    *bytes = resized;
+    *capacity = grown;
+    return true;
+}
+
+/* Point the struct's id at the sender */
+static void stamp_message(int kind, CompactMessage* message, int from) {
+    switch (kind) {
+        case MSGID_INPUT:
+            message->Input.ID = from;
+            break;
+        case MSGID_ORDINARY:
+            message->Ordinary.ID = from;
+            break;
+        case MSGID_MOUSECLICK:
+            message->MouseClick.ID = from;
+            break;
+        default:
+            break;
+    }
+}
+
+/* JSON whitespace */
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/* No key can spell "id" without the literal or an escape, so the id can be appended as text */
+static bool stamps_as_text(const char* body, size_t length) {
+    return memchr(body, '\\', length) == NULL && memmem(body, length, "\"id\"", 4) == NULL;
+}
+
+/* Copy a single object body, replacing its closing brace with the sender id, 0 for anything else */
+static size_t stamp_body(char* out, int from, const char* body, size_t length) {
+    size_t start = 0;
+    while (start < length && is_space(body[start])) {
+        start++;
+    }
+    size_t end = length;
+    while (end > start && is_space(body[end - 1])) {
+        end--;
+    }
+    if (end - start < 2 || body[start] != '{' || body[end - 1] != '}') {
+        return 0;
+    }
+
+    /* Empty object needs no comma */
+    bool empty = true;
+    for (size_t i = start + 1; i + 1 < end; i++) {
+        if (!is_space(body[i])) {
+            empty = false;
+            break;
+        }
+    }
+
+    size_t prefix = empty ? 1 : end - 1 - start;
+    memcpy(out, body + start, prefix);
+    char* p = out + prefix;
+    if (!empty) {
+        *p++ = ',';
+    }
+    memcpy(p, "\"id\":", 5);
+    p += 5;
+    p += json_encode_int(p, from);
+    *p++ = '}';
+    return (size_t)(p - out);
+}
+
+/* Add input */
+bool tick_batch_add(TickBatch* batch, int from, int kind, const char* body, size_t length) {
+    if (batch == NULL || body == NULL || length == 0) {
+        return false;
+    }
+    if (batch->Count == batch->Capacity) {
+        size_t capacity = batch->Capacity > 0 ? batch->Capacity * 2 : 64;
+        TickInput* inputs = (TickInput*)realloc(batch->Inputs, capacity * sizeof(TickInput));
+        if (inputs == NULL) {
+            return false;
+        }
+        batch->Inputs = inputs;
+        batch->Capacity = capacity;
+    }
+    bool compact = compact_is_body(body, length);
+    bool rebuild = compact || !stamps_as_text(body, length);
+    if (!reserve_bytes(&batch->Bytes, batch->BytesUsed, &batch->BytesCapacity,
+                       rebuild ? COMPACT_JSON_MAX : length + ID_SUFFIX_MAX) ||
+        !reserve_bytes(&batch->Compact, batch->CompactUsed, &batch->CompactCapacity, COMPACT_BODY_MAX)) {
+        return false;
+    }
+
+    /* A body that is not exactly one well formed object would go out unstamped */
+    CompactMessage message;
+    bool decoded = compact ? compact_decode(kind, body, length, &message)
+                           : json_decode_message(kind, body, length, &message) == JSON_DECODE_OK;
+    if (!decoded) {
+        return false;
+    }
+    stamp_message(kind, &message, from);
+
+    /*
+     * Compact input is kept as JSON, the form every client can read. JSON
+     * that may carry an id of its own is rebuilt from its struct too, so
+     * a client cannot relay a second id naming someone else.
+     */
+    char* out = batch->Bytes + batch->BytesUsed;
+    size_t stamped = rebuild ? compact_encode_json(kind, &message, out, COMPACT_JSON_MAX)
+                             : stamp_body(out, from, body, length);
+    if (stamped == 0) {
+        return false;
+    }
+
+    /* Both formats are encoded here, once, while the struct is at hand */
+    TickInput* input = &batch->Inputs[batch->Count++];
+    input->From = from;
+    input->Kind = kind;
+    input->Seq = batch->NextSeq++;
+    input->Offset = batch->BytesUsed;
+    input->Length = stamped;
+    input->CompactOffset = batch->CompactUsed;
+    input->CompactLength = compact_encode(kind, &message, batch->Compact + batch->CompactUsed, COMPACT_BODY_MAX);
+    batch->BytesUsed += stamped;
+    batch->CompactUsed += input->CompactLength;
+    return true;
+}
+
+/* Get count */
+size_t tick_batch_count(TickBatch* batch) {
+    return batch != NULL ? batch->Count : 0;
+}
+
+/* Order by sender, then by arrival */
+static int compare_inputs(const void* a, const void* b) {
+    const TickInput* left = (const TickInput*)a;
+    const TickInput* right = (const TickInput*)b;
+    if (left->From != right->From) {
+        return left->From < right->From ? -1 : 1;
+    }
+    return left->Seq < right->Seq ? -1 : (left->Seq > right->Seq ? 1 : 0);
+}
+
+/* Frame body of an input for compact clients, its JSON when it has no compact form */
+static const char* compact_body(const TickBatch* batch, const TickInput* input, size_t* length) {
+    if (input->CompactLength == 0) {
+        *length = input->Length;
+        return batch->Bytes + input->Offset;
+    }
+    *length = input->CompactLength;
+    return batch->Compact + input->CompactOffset;
+}
+
+/* Gather the compact bodies encoded at add time into one tick */
+static SharedFrame* build_compact(TickBatch* batch) {
+    size_t total = 0;
+    for (size_t i = 0; i < batch->Count; i++) {
+        size_t length;
+        compact_body(batch, &batch->Inputs[i], &length);
+        total += FRAME_HEADER_SIZE + length;
+    }
+
+    char newtick[COMPACT_BODY_MAX];
+    size_t newtick_length = compact_encode(MSGID_NEWTICK, NULL, newtick, sizeof(newtick));
+    SharedFrame* frame = shared_frame_alloc(total + FRAME_HEADER_SIZE + newtick_length);
+    if (frame != NULL) {
+        char* out = shared_frame_mutable_data(frame);
+        for (size_t i = 0; i < batch->Count; i++) {
+            const TickInput* input = &batch->Inputs[i];
+            size_t length;
+            const char* body = compact_body(batch, input, &length);
+            frame_write_header(out, (uint32_t)input->Kind, (uint32_t)length);
+            memcpy(out + FRAME_HEADER_SIZE, body, length);
+            out += FRAME_HEADER_SIZE + length;
+        }
+        frame_write_header(out, MSGID_NEWTICK, (uint32_t)newtick_length);
+        memcpy(out + FRAME_HEADER_SIZE, newtick, newtick_length);
+    }
+    return frame;
+}
+
+/* Finish tick */
+SharedFrame* tick_batch_finish(TickBatch* batch, SharedFrame** compact) {
+    if (batch == NULL) {
+        return NULL;
+    }
+    qsort(batch->Inputs, batch->Count, sizeof(TickInput), compare_inputs);
+    if (compact != NULL) {
+        *compact = build_compact(batch);
+    }
+
+    size_t total = FRAME_HEADER_SIZE + NEWTICK_BODY_SIZE;
+    for (size_t i = 0; i < batch->Count; i++) {
+        total += FRAME_HEADER_SIZE + batch->Inputs[i].Length;
+    }
+
+    SharedFrame* frame = shared_frame_alloc(total);
+    if (frame != NULL) {
+        char* out = shared_frame_mutable_data(frame);
+        for (size_t i = 0; i < batch->Count; i++) {
+            const TickInput* input = &batch->Inputs[i];
+            frame_write_header(out, (uint32_t)input->Kind, (uint32_t)input->Length);
+            memcpy(out + FRAME_HEADER_SIZE, batch->Bytes + input->Offset, input->Length);
+            out += FRAME_HEADER_SIZE + input->Length;
+        }
+        frame_write_header(out, MSGID_NEWTICK, NEWTICK_BODY_SIZE);
+        memcpy(out + FRAME_HEADER_SIZE, NEWTICK_BODY, NEWTICK_BODY_SIZE);
+    }
+
+    batch->Count = 0;
+    batch->BytesUsed = 0;
+    batch->CompactUsed = 0;
+    return frame;
+}
@@ -0,0 +1,43 @@
+/*
+ * Luminous Locus Tick Batch Header
+ */
+
+#ifndef TICK_BATCH_H
+#define TICK_BATCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "shared_frame.h"
+
+/* Inputs collected during one tick */
+typedef struct TickBatch TickBatch;
+
+/* Create batch */
+TickBatch* tick_batch_create(void);
+
+/* Free batch */
+void tick_batch_free(TickBatch* batch);
+
+/* Kinds relayed through the tick batch */
+bool tick_batch_accepts(int kind);
+
+/*
+ * Copy an input in with the sender id stamped into its body, encoded
+ * both as JSON and in compact form. Compact bodies, and JSON that could
+ * already name an id, are stored as JSON rebuilt from their struct.
+ * Empty bodies and bodies that do not decode to one object are refused.
+ */
+bool tick_batch_add(TickBatch* batch, int from, int kind, const char* body, size_t length);
+
+/* Inputs collected so far */
+size_t tick_batch_count(TickBatch* batch);
+
+/*
+ * Encode every input in deterministic order followed by the NEWTICK
+ * frame into one shared buffer, then reset for the next tick. Storage
+ * is kept, so a steady tick only allocates the returned frame. When
+ * compact is not NULL the same tick is also built from the compact bodies.
+ */
+SharedFrame* tick_batch_finish(TickBatch* batch, SharedFrame** compact);
+
+#endif /* TICK_BATCH_H */
@@ -0,0 +1,187 @@
+/*
+ * Luminous Locus Tick Clock Module
+ * Drift-free fixed-rate tick scheduling
+ *
+ * Deadlines are absolute: tick n is due at start + n * interval, no
+ * matter how late tick n - 1 ran, so lateness never accumulates. When the
+ * server falls more than a whole interval behind, the missed deadlines
+ * are skipped rather than replayed in a burst, which keeps the jitter a
+ * client can observe below one interval.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef __linux__
+    #include <sys/timerfd.h>
+#endif
+#include "tick_clock.h"
+
+#define NS_PER_SEC 1000000000LL
+#define NS_PER_MS 1000000LL
+
+struct TickClock {
+    int64_t Interval;
+    int64_t Deadline;       /* absolute deadline of the next tick */
+    int64_t TickStart;
+    uint64_t Tick;
+    int TimerFD;
+    TickStats Stats;
+};
+
+/* Convert nanoseconds to timespec */
+static struct timespec to_timespec(int64_t ns) {
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / NS_PER_SEC);
+    ts.tv_nsec = (long)(ns % NS_PER_SEC);
+    return ts;
+}
+
+/* Get monotonic time */
+int64_t tick_clock_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * NS_PER_SEC + ts.tv_nsec;
+}
+
+/* Create clock */
+TickClock* tick_clock_create(int interval_ms) {
+    if (interval_ms <= 0) {
+        return NULL;
+    }
+    TickClock* clock = (TickClock*)malloc(sizeof(TickClock));
+    if (clock == NULL) {
+        return NULL;
+    }
+    memset(clock, 0, sizeof(TickClock));
+    clock->Interval = (int64_t)interval_ms * NS_PER_MS;
+    clock->Deadline = tick_clock_now() + clock->Interval;
+    clock->TimerFD = -1;
+    return clock;
+}
+
+/* Free clock */
+void tick_clock_free(TickClock* clock) {
+    if (clock != NULL) {
+        if (clock->TimerFD >= 0) {
+            close(clock->TimerFD);
+        }
+        free(clock);
+    }
+}
+
+/* Get interval */
+int64_t tick_clock_interval(TickClock* clock) {
+    return clock != NULL ? clock->Interval : 0;
+}
+
+/* Get next deadline */
+int64_t tick_clock_deadline(TickClock* clock) {
+    return clock != NULL ? clock->Deadline : 0;
+}
+
+/* Get timer fd */
+int tick_clock_timer_fd(TickClock* clock) {
+    if (clock == NULL) {
+        return -1;
+    }
+#ifdef __linux__
+    if (clock->TimerFD < 0) {
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd < 0) {
+            return -1;
+        }
+        /* Absolute first expiry plus a period keeps the kernel on our grid */
+        struct itimerspec spec;
+        spec.it_value = to_timespec(clock->Deadline);
+        spec.it_interval = to_timespec(clock->Interval);
+        if (timerfd_settime(fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+            close(fd);
+            return -1;
+        }
+        clock->TimerFD = fd;
+    }
+#endif
+    return clock->TimerFD;
+}
+
+/* Drain timer fd */
+void tick_clock_drain_timer(TickClock* clock) {
+    if (clock != NULL && clock->TimerFD >= 0) {
+        uint64_t expirations;
+        while (read(clock->TimerFD, &expirations, sizeof(expirations)) > 0) {
+        }
+    }
+}
+
+/* Sleep until the next deadline */
+void tick_clock_sleep(TickClock* clock) {
+    if (clock == NULL) {
+        return;
+    }
+    struct timespec ts = to_timespec(clock->Deadline);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+    }
+}
+
+/* Check if due */
+bool tick_clock_due(TickClock* clock, int64_t now) {
+    return clock != NULL && now >= clock->Deadline;
+}
+
+/* Begin tick */
+uint64_t tick_clock_begin(TickClock* clock, int64_t now) {
+    if (clock == NULL) {
+        return 0;
+    }
+
+    int64_t lateness = now - clock->Deadline;
+    if (lateness < 0) {
+        lateness = 0;
+    }
+    clock->Deadline += clock->Interval;
+
+    /* A whole interval behind: skip to the next deadline still ahead */
+    if (now >= clock->Deadline) {
+        int64_t missed = (now - clock->Deadline) / clock->Interval + 1;
+        clock->Deadline += missed * clock->Interval;
+        clock->Stats.Missed += (uint64_t)missed;
+    }
+
+    clock->Tick++;
+    clock->TickStart = now;
+    clock->Stats.Ticks++;
+    clock->Stats.LastLateness = lateness;
+    clock->Stats.TotalLateness += lateness;
+    if (lateness > clock->Stats.MaxLateness) {
+        clock->Stats.MaxLateness = lateness;
+    }
+    return clock->Tick;
+}
+
+/* End tick */
+void tick_clock_end(TickClock* clock, int64_t now) {
+    if (clock == NULL) {
+        return;
+    }
+    int64_t duration = now - clock->TickStart;
+    clock->Stats.LastDuration = duration;
+    clock->Stats.TotalDuration += duration;
+    if (duration > clock->Stats.MaxDuration) {
+        clock->Stats.MaxDuration = duration;
+    }
+}
+
+/* Get stats */
+void tick_clock_get_stats(TickClock* clock, TickStats* stats) {
+    if (clock != NULL && stats != NULL) {
+        *stats = clock->Stats;
+    }
+}
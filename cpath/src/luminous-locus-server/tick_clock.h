@@ -0,0 +1,60 @@
+/*
+ * Luminous Locus Tick Clock Header
+ */
+
+#ifndef TICK_CLOCK_H
+#define TICK_CLOCK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Fixed-rate tick schedule on CLOCK_MONOTONIC */
+typedef struct TickClock TickClock;
+
+/* Per-clock measurements, all times in nanoseconds */
+typedef struct TickStats {
+    uint64_t Ticks;
+    uint64_t Missed;            /* deadlines skipped after falling a whole interval behind */
+    int64_t LastLateness;       /* tick start minus its deadline */
+    int64_t MaxLateness;
+    int64_t TotalLateness;
+    int64_t LastDuration;       /* tick_clock_begin to tick_clock_end */
+    int64_t MaxDuration;
+    int64_t TotalDuration;
+} TickStats;
+
+/* Create clock, the first deadline is one interval from now */
+TickClock* tick_clock_create(int interval_ms);
+
+/* Free clock, closes its timer fd */
+void tick_clock_free(TickClock* clock);
+
+/* Current CLOCK_MONOTONIC time */
+int64_t tick_clock_now(void);
+
+/* Interval and next deadline */
+int64_t tick_clock_interval(TickClock* clock);
+int64_t tick_clock_deadline(TickClock* clock);
+
+/* Timer fd firing on every deadline for event loop use, -1 when unsupported */
+int tick_clock_timer_fd(TickClock* clock);
+
+/* Clear the timer fd after it became readable */
+void tick_clock_drain_timer(TickClock* clock);
+
+/* Block until the next deadline */
+void tick_clock_sleep(TickClock* clock);
+
+/* Check whether the next deadline has passed */
+bool tick_clock_due(TickClock* clock, int64_t now);
+
+/* Start the due tick, returns its number; lateness is measured against its deadline */
+uint64_t tick_clock_begin(TickClock* clock, int64_t now);
+
+/* Finish the tick started last */
+void tick_clock_end(TickClock* clock, int64_t now);
+
+/* Snapshot of the measurements */
+void tick_clock_get_stats(TickClock* clock, TickStats* stats);
+
+#endif /* TICK_CLOCK_H */
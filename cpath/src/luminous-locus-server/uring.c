@@ -0,0 +1,734 @@
+/*
+ * Luminous Locus io_uring Backend Module
+ * Completion based networking
+ *
+ * Talks to the kernel through the raw io_uring syscalls so the server
+ * does not depend on liburing. Uses multishot accept, multishot recv
+ * into a provided-buffer ring, and gather sends straight from the
+ * connection write queues. Every submission and completion of one loop
+ * iteration goes through a single io_uring_enter. Pausing a connection
+ * cancels its recv, leaving unread data in the socket where TCP pushes
+ * back on the sender. Data that completed before the cancel and that
+ * the owner cannot take yet stays in its provided buffers until the
+ * connection resumes, which then re-arms the recv.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include "uring.h"
+
+#ifdef __linux__
+
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/* Completion tags, stored in the low bits of user_data */
+#define TAG_ACCEPT   1
+#define TAG_RECV     2
+#define TAG_SELFTEST 3
+#define TAG_CANCEL   4
+#define TAG_POLL     5
+#define TAG_SENDMSG  6
+#define TAG_MASK     7
+
+#define URING_BUFFER_GROUP 0
+
+/* Completed buffer the owner could not take yet */
+typedef struct HeldBuffer {
+    unsigned short Bid;
+    unsigned Length;
+} HeldBuffer;
+
+/* Multishot recv of one connection, parked while paused */
+struct UringRecv {
+    int FD;
+    void* Owner;
+    bool Armed;         /* a recv is in the kernel */
+    bool Paused;        /* do not re-arm when it ends */
+    bool Cancelling;    /* cancel submitted, not yet seen to end the recv */
+    bool Delivering;    /* handing held buffers over */
+    HeldBuffer* Held;   /* ring of URING_BUFFER_COUNT, oldest at HeldHead */
+    int HeldHead;
+    int HeldCount;
+};
+
+/* Armed multishot poll */
+typedef struct WatchOp {
+    int FD;
+    void* Owner;
+} WatchOp;
+
+/* In-flight gather send, the caller keeps the buffers alive */
+typedef struct SendMsgOp {
+    void* Owner;
+    struct msghdr Msg;
+    struct iovec Iov[];
+} SendMsgOp;
+
+/* io_uring loop state */
+struct UringLoop {
+    int RingFD;
+    void* Data;
+    UringCallbacks Callbacks;
+
+    /* Submission queue */
+    void* SqRing;
+    size_t SqRingSize;
+    unsigned* SqHead;
+    unsigned* SqTailPtr;
+    unsigned* SqArray;
+    unsigned SqMask;
+    unsigned SqEntries;
+    unsigned SqTail;
+    unsigned SqFlushed;
+    struct io_uring_sqe* Sqes;
+    size_t SqesSize;
+
+    /* Completion queue */
+    void* CqRing;
+    size_t CqRingSize;
+    unsigned* CqHead;
+    unsigned* CqTail;
+    unsigned CqMask;
+    struct io_uring_cqe* Cqes;
+
+    /* Provided buffers */
+    struct io_uring_buf_ring* BufRing;
+    size_t BufRingSize;
+    char* Buffers;
+    unsigned short BufTail;
+
+    /* Startup self test */
+    int SelfTestResult;
+    bool SelfTestMore;
+};
+
+/* Raw syscalls */
+static int sys_setup(unsigned entries, struct io_uring_params* params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_enter(int fd, unsigned submit, unsigned wait, unsigned flags, void* arg, size_t size) {
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait, flags, arg, size);
+}
+
+static int sys_register(int fd, unsigned opcode, void* arg, unsigned count) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, count);
+}
+
+/* Get next free submission entry */
+static struct io_uring_sqe* get_sqe(UringLoop* loop) {
+    unsigned head = __atomic_load_n(loop->SqHead, __ATOMIC_ACQUIRE);
+    if (loop->SqTail - head >= loop->SqEntries) {
+        /* Ring full, push what we have to the kernel first */
+        __atomic_store_n(loop->SqTailPtr, loop->SqTail, __ATOMIC_RELEASE);
+        if (sys_enter(loop->RingFD, loop->SqTail - loop->SqFlushed, 0, 0, NULL, 0) < 0) {
+            return NULL;
+        }
+        loop->SqFlushed = loop->SqTail;
+        head = __atomic_load_n(loop->SqHead, __ATOMIC_ACQUIRE);
+        if (loop->SqTail - head >= loop->SqEntries) {
+            return NULL;
+        }
+    }
+
+    unsigned index = loop->SqTail & loop->SqMask;
+    struct io_uring_sqe* sqe = &loop->Sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    loop->SqArray[index] = index;
+    loop->SqTail++;
+    return sqe;
+}
+
+/* Return a provided buffer to the kernel */
+static void recycle_buffer(UringLoop* loop, unsigned short bid) {
+    struct io_uring_buf* buf = &loop->BufRing->bufs[loop->BufTail & (URING_BUFFER_COUNT - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(loop->Buffers + (size_t)bid * URING_BUFFER_SIZE);
+    buf->len = URING_BUFFER_SIZE;
+    buf->bid = bid;
+    loop->BufTail++;
+    __atomic_store_n(&loop->BufRing->tail, loop->BufTail, __ATOMIC_RELEASE);
+}
+
+/* Queue multishot accept */
+static bool queue_accept(UringLoop* loop, int listen_fd) {
+    struct io_uring_sqe* sqe = get_sqe(loop);
+    if (sqe == NULL) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = ((uint64_t)(unsigned)listen_fd << 3) | TAG_ACCEPT;
+    return true;
+}
+
+/* Queue multishot recv with buffer selection */
+static bool queue_recv(UringLoop* loop, int fd, uint64_t user_data) {
+    struct io_uring_sqe* sqe = get_sqe(loop);
+    if (sqe == NULL) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = user_data;
+    return true;
+}
+
+/* Queue multishot poll for readability */
+static bool queue_poll(UringLoop* loop, WatchOp* op) {
+    struct io_uring_sqe* sqe = get_sqe(loop);
+    if (sqe == NULL) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = op->FD;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = (uint64_t)(uintptr_t)op | TAG_POLL;
+    return true;
+}
+
+/* Queue cancellation of an armed recv */
+static bool queue_cancel(UringLoop* loop, UringRecv* op) {
+    struct io_uring_sqe* sqe = get_sqe(loop);
+    if (sqe == NULL) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = (uint64_t)(uintptr_t)op | TAG_RECV;
+    sqe->user_data = TAG_CANCEL;
+    return true;
+}
+
+/* Stop the recv, data already received still completes */
+static void pause_recv(UringLoop* loop, UringRecv* op) {
+    op->Paused = true;
+    if (op->Armed && !op->Cancelling) {
+        /* Without a free entry the recv keeps running and its data is held */
+        op->Cancelling = queue_cancel(loop, op);
+    }
+}
+
+/* Hand a buffer to the owner, false when it has to wait */
+static bool offer_buffer(UringLoop* loop, UringRecv* op, unsigned short bid, unsigned length) {
+    const char* data = loop->Buffers + (size_t)bid * URING_BUFFER_SIZE;
+    return loop->Callbacks.OnRecv == NULL || loop->Callbacks.OnRecv(loop, op->Owner, data, length);
+}
+
+/* Keep a buffer the owner could not take, false when there is nowhere to keep it */
+static bool hold_buffer(UringRecv* op, unsigned short bid, unsigned length) {
+    if (op->Held == NULL) {
+        op->Held = (HeldBuffer*)malloc(URING_BUFFER_COUNT * sizeof(HeldBuffer));
+        if (op->Held == NULL) {
+            return false;
+        }
+    }
+    /* Never more than the ring has buffers */
+    HeldBuffer* held = &op->Held[(op->HeldHead + op->HeldCount) & (URING_BUFFER_COUNT - 1)];
+    held->Bid = bid;
+    held->Length = length;
+    op->HeldCount++;
+    return true;
+}
+
+/* Give held buffers back to the ring without delivering them */
+static void drop_held(UringLoop* loop, UringRecv* op) {
+    while (op->HeldCount > 0) {
+        recycle_buffer(loop, op->Held[op->HeldHead].Bid);
+        op->HeldHead = (op->HeldHead + 1) & (URING_BUFFER_COUNT - 1);
+        op->HeldCount--;
+    }
+    free(op->Held);
+    op->Held = NULL;
+}
+
+/* Handle recv completion */
+static void complete_recv(UringLoop* loop, struct io_uring_cqe* cqe, UringRecv* op) {
+    bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+
+    if (cqe->flags & IORING_CQE_F_BUFFER) {
+        unsigned short bid = (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+        bool taken = cqe->res <= 0 || (op->HeldCount == 0 && offer_buffer(loop, op, bid, (unsigned)cqe->res));
+        if (taken) {
+            recycle_buffer(loop, bid);
+        } else if (hold_buffer(op, bid, (unsigned)cqe->res)) {
+            /* Later data queues up behind it, in order */
+            pause_recv(loop, op);
+        } else {
+            recycle_buffer(loop, bid);
+            shutdown(op->FD, SHUT_RDWR);
+        }
+    }
+
+    if (more) {
+        return;
+    }
+
+    /* Multishot ended: out of buffers, a full CQ or a cancel for a pause; re-arm unless paused */
+    op->Armed = false;
+    op->Cancelling = false;
+    if (cqe->res > 0 || cqe->res == -ENOBUFS || cqe->res == -ECANCELED) {
+        if (op->Paused || op->HeldCount > 0) {
+            return;
+        }
+        if (queue_recv(loop, op->FD, (uint64_t)(uintptr_t)op | TAG_RECV)) {
+            op->Armed = true;
+            return;
+        }
+    }
+
+    drop_held(loop, op);
+    if (loop->Callbacks.OnClosed != NULL) {
+        loop->Callbacks.OnClosed(loop, op->Owner);
+    }
+    free(op);
+}
+
+/* Dispatch one completion */
+static void dispatch(UringLoop* loop, struct io_uring_cqe* cqe) {
+    uint64_t tag = cqe->user_data & TAG_MASK;
+    uint64_t value = cqe->user_data & ~(uint64_t)TAG_MASK;
+
+    switch (tag) {
+        case TAG_ACCEPT:
+            if (cqe->res >= 0 && loop->Callbacks.OnAccept != NULL) {
+                loop->Callbacks.OnAccept(loop, cqe->res);
+            }
+            if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                queue_accept(loop, (int)(value >> 3));
+            }
+            break;
+        case TAG_RECV:
+            complete_recv(loop, cqe, (UringRecv*)(uintptr_t)value);
+            break;
+        case TAG_POLL: {
+            WatchOp* op = (WatchOp*)(uintptr_t)value;
+            if (cqe->res >= 0 && loop->Callbacks.OnReady != NULL) {
+                loop->Callbacks.OnReady(loop, op->Owner);
+            }
+            if (!(cqe->flags & IORING_CQE_F_MORE) && !queue_poll(loop, op)) {
+                free(op);
+            }
+            break;
+        }
+        case TAG_SENDMSG: {
+            SendMsgOp* op = (SendMsgOp*)(uintptr_t)value;
+            void* owner = op->Owner;
+            free(op);
+            if (loop->Callbacks.OnSent != NULL) {
+                loop->Callbacks.OnSent(loop, owner, cqe->res);
+            }
+            break;
+        }
+        case TAG_SELFTEST:
+            if (cqe->flags & IORING_CQE_F_BUFFER) {
+                recycle_buffer(loop, (unsigned short)(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+            if (loop->SelfTestResult == 0) {
+                loop->SelfTestResult = cqe->res;
+                loop->SelfTestMore = (cqe->flags & IORING_CQE_F_MORE) != 0;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* Reap all available completions */
+static int reap(UringLoop* loop) {
+    unsigned head = *loop->CqHead;
+    unsigned tail = __atomic_load_n(loop->CqTail, __ATOMIC_ACQUIRE);
+    int count = 0;
+
+    while (head != tail) {
+        struct io_uring_cqe cqe = loop->Cqes[head & loop->CqMask];
+        head++;
+        /* Release the slot before the callback, it may queue more work */
+        __atomic_store_n(loop->CqHead, head, __ATOMIC_RELEASE);
+        dispatch(loop, &cqe);
+        count++;
+        if (head == tail) {
+            tail = __atomic_load_n(loop->CqTail, __ATOMIC_ACQUIRE);
+        }
+    }
+    return count;
+}
+
+/* Check that multishot recv with provided buffers actually works */
+static bool self_test(UringLoop* loop) {
+    int pair[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) < 0) {
+        return false;
+    }
+
+    bool ok = queue_recv(loop, pair[0], TAG_SELFTEST) && write(pair[1], "S", 1) == 1 &&
+              uring_loop_run_once(loop, 100) >= 0 && loop->SelfTestResult == 1 && loop->SelfTestMore;
+
+    /* Terminate the multishot recv and drain its final completion */
+    shutdown(pair[0], SHUT_RDWR);
+    for (int i = 0; i < 10 && loop->SelfTestMore; i++) {
+        loop->SelfTestResult = 0;
+        if (uring_loop_run_once(loop, 10) < 0) {
+            break;
+        }
+        if (loop->SelfTestResult <= 0) {
+            loop->SelfTestMore = false;
+        }
+    }
+
+    close(pair[0]);
+    close(pair[1]);
+    return ok;
+}
+
+/* Create new io_uring loop */
+UringLoop* uring_loop_create(unsigned entries, const UringCallbacks* callbacks, void* data) {
+    UringLoop* loop = (UringLoop*)malloc(sizeof(UringLoop));
+    if (loop == NULL) {
+        return NULL;
+    }
+    memset(loop, 0, sizeof(UringLoop));
+    loop->RingFD = -1;
+    loop->Data = data;
+    if (callbacks != NULL) {
+        loop->Callbacks = *callbacks;
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    loop->RingFD = sys_setup(entries > 0 ? entries : URING_DEFAULT_ENTRIES, &params);
+    if (loop->RingFD < 0) {
+        /* ENOSYS on old kernels, EPERM when disabled by sysctl/seccomp */
+        free(loop);
+        return NULL;
+    }
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        uring_loop_free(loop);
+        return NULL;
+    }
+
+    /* Map rings, SQ and CQ share one mapping */
+    loop->SqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    loop->CqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (loop->CqRingSize > loop->SqRingSize) {
+        loop->SqRingSize = loop->CqRingSize;
+    }
+    loop->SqRing = mmap(NULL, loop->SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        loop->RingFD, IORING_OFF_SQ_RING);
+    if (loop->SqRing == MAP_FAILED) {
+        loop->SqRing = NULL;
+        uring_loop_free(loop);
+        return NULL;
+    }
+    loop->CqRing = loop->SqRing;
+
+    loop->SqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    loop->Sqes = (struct io_uring_sqe*)mmap(NULL, loop->SqesSize, PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_POPULATE, loop->RingFD, IORING_OFF_SQES);
+    if (loop->Sqes == MAP_FAILED) {
+        loop->Sqes = NULL;
+        uring_loop_free(loop);
+        return NULL;
+    }
+
+    char* sq = (char*)loop->SqRing;
+    loop->SqHead = (unsigned*)(sq + params.sq_off.head);
+    loop->SqTailPtr = (unsigned*)(sq + params.sq_off.tail);
+    loop->SqArray = (unsigned*)(sq + params.sq_off.array);
+    loop->SqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    loop->SqEntries = params.sq_entries;
+    loop->SqTail = *loop->SqTailPtr;
+    loop->SqFlushed = loop->SqTail;
+
+    char* cq = (char*)loop->CqRing;
+    loop->CqHead = (unsigned*)(cq + params.cq_off.head);
+    loop->CqTail = (unsigned*)(cq + params.cq_off.tail);
+    loop->CqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    loop->Cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+    /* Provided buffer ring, needs 5.19+ */
+    loop->BufRingSize = URING_BUFFER_COUNT * sizeof(struct io_uring_buf);
+    loop->BufRing = (struct io_uring_buf_ring*)mmap(NULL, loop->BufRingSize, PROT_READ | PROT_WRITE,
+                                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    loop->Buffers = (char*)malloc((size_t)URING_BUFFER_COUNT * URING_BUFFER_SIZE);
+    if (loop->BufRing == MAP_FAILED || loop->Buffers == NULL) {
+        if (loop->BufRing == MAP_FAILED) {
+            loop->BufRing = NULL;
+        }
+        uring_loop_free(loop);
+        return NULL;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)loop->BufRing;
+    reg.ring_entries = URING_BUFFER_COUNT;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (sys_register(loop->RingFD, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        uring_loop_free(loop);
+        return NULL;
+    }
+    for (unsigned short bid = 0; bid < URING_BUFFER_COUNT; bid++) {
+        recycle_buffer(loop, bid);
+    }
+
+    /* Multishot recv needs 6.0+, there is no probe bit for it */
+    if (!self_test(loop)) {
+        uring_loop_free(loop);
+        return NULL;
+    }
+
+    return loop;
+}
+
+/* Free io_uring loop */
+void uring_loop_free(UringLoop* loop) {
+    if (loop != NULL) {
+        if (loop->RingFD >= 0) {
+            close(loop->RingFD);
+        }
+        if (loop->Sqes != NULL) {
+            munmap(loop->Sqes, loop->SqesSize);
+        }
+        if (loop->SqRing != NULL) {
+            munmap(loop->SqRing, loop->SqRingSize);
+        }
+        if (loop->BufRing != NULL) {
+            munmap(loop->BufRing, loop->BufRingSize);
+        }
+        free(loop->Buffers);
+        free(loop);
+    }
+}
+
+/* Arm multishot accept */
+bool uring_loop_accept(UringLoop* loop, int listen_fd) {
+    return loop != NULL && listen_fd >= 0 && queue_accept(loop, listen_fd);
+}
+
+/* Arm multishot recv */
+UringRecv* uring_loop_recv(UringLoop* loop, int fd, void* owner) {
+    if (loop == NULL || fd < 0) {
+        return NULL;
+    }
+    UringRecv* op = (UringRecv*)calloc(1, sizeof(UringRecv));
+    if (op == NULL) {
+        return NULL;
+    }
+    op->FD = fd;
+    op->Owner = owner;
+    if (!queue_recv(loop, fd, (uint64_t)(uintptr_t)op | TAG_RECV)) {
+        free(op);
+        return NULL;
+    }
+    op->Armed = true;
+    return op;
+}
+
+/* Cancel the recv, it stays parked until resumed */
+void uring_loop_pause_recv(UringLoop* loop, UringRecv* recv) {
+    if (loop != NULL && recv != NULL && !recv->Paused) {
+        pause_recv(loop, recv);
+    }
+}
+
+/* Deliver held buffers, then re-arm the recv */
+bool uring_loop_resume_recv(UringLoop* loop, UringRecv* recv) {
+    if (loop == NULL || recv == NULL) {
+        return false;
+    }
+    recv->Paused = false;
+    if (recv->Delivering) {
+        /* Resumed from inside OnRecv, the delivery below carries on */
+        return true;
+    }
+
+    recv->Delivering = true;
+    while (recv->HeldCount > 0 && !recv->Paused) {
+        HeldBuffer* held = &recv->Held[recv->HeldHead];
+        if (!offer_buffer(loop, recv, held->Bid, held->Length)) {
+            pause_recv(loop, recv);
+            break;
+        }
+        recycle_buffer(loop, held->Bid);
+        recv->HeldHead = (recv->HeldHead + 1) & (URING_BUFFER_COUNT - 1);
+        recv->HeldCount--;
+    }
+    recv->Delivering = false;
+
+    if (recv->Paused || recv->HeldCount > 0 || recv->Armed) {
+        /* A recv still running or its cancel not yet seen re-arms from its final completion */
+        return true;
+    }
+    if (!queue_recv(loop, recv->FD, (uint64_t)(uintptr_t)recv | TAG_RECV)) {
+        return false;
+    }
+    recv->Armed = true;
+    return true;
+}
+
+/* Watch fd */
+bool uring_loop_watch(UringLoop* loop, int fd, void* owner) {
+    if (loop == NULL || fd < 0) {
+        return false;
+    }
+    WatchOp* op = (WatchOp*)malloc(sizeof(WatchOp));
+    if (op == NULL) {
+        return false;
+    }
+    op->FD = fd;
+    op->Owner = owner;
+    if (!queue_poll(loop, op)) {
+        free(op);
+        return false;
+    }
+    return true;
+}
+
+/* Queue gather send */
+bool uring_loop_sendmsg(UringLoop* loop, int fd, const struct iovec* iov, int count, void* owner) {
+    if (loop == NULL || fd < 0 || count <= 0) {
+        return false;
+    }
+    SendMsgOp* op = (SendMsgOp*)malloc(sizeof(SendMsgOp) + (size_t)count * sizeof(struct iovec));
+    if (op == NULL) {
+        return false;
+    }
+    struct io_uring_sqe* sqe = get_sqe(loop);
+    if (sqe == NULL) {
+        free(op);
+        return false;
+    }
+    op->Owner = owner;
+    memcpy(op->Iov, iov, (size_t)count * sizeof(struct iovec));
+    memset(&op->Msg, 0, sizeof(op->Msg));
+    op->Msg.msg_iov = op->Iov;
+    op->Msg.msg_iovlen = (size_t)count;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)&op->Msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = (uint64_t)(uintptr_t)op | TAG_SENDMSG;
+    return true;
+}
+
+/* Submit, wait and dispatch */
+int uring_loop_run_once(UringLoop* loop, int timeout_ms) {
+    if (loop == NULL) {
+        return -1;
+    }
+
+    __atomic_store_n(loop->SqTailPtr, loop->SqTail, __ATOMIC_RELEASE);
+    unsigned to_submit = loop->SqTail - loop->SqFlushed;
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    arg.sigmask_sz = _NSIG / 8;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+
+    int ret = sys_enter(loop->RingFD, to_submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG,
+                        &arg, sizeof(arg));
+    if (ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY) {
+        return -1;
+    }
+    if (ret > 0) {
+        loop->SqFlushed += (unsigned)ret;
+    }
+
+    return reap(loop);
+}
+
+/* Get loop user data */
+void* uring_loop_get_data(UringLoop* loop) {
+    return loop != NULL ? loop->Data : NULL;
+}
+
+#else /* !__linux__ */
+
+/* io_uring is Linux only, callers fall back to the event loop */
+UringLoop* uring_loop_create(unsigned entries, const UringCallbacks* callbacks, void* data) {
+    (void)entries;
+    (void)callbacks;
+    (void)data;
+    return NULL;
+}
+
+void uring_loop_free(UringLoop* loop) {
+    (void)loop;
+}
+
+bool uring_loop_accept(UringLoop* loop, int listen_fd) {
+    (void)loop;
+    (void)listen_fd;
+    return false;
+}
+
+UringRecv* uring_loop_recv(UringLoop* loop, int fd, void* owner) {
+    (void)loop;
+    (void)fd;
+    (void)owner;
+    return NULL;
+}
+
+void uring_loop_pause_recv(UringLoop* loop, UringRecv* recv) {
+    (void)loop;
+    (void)recv;
+}
+
+bool uring_loop_resume_recv(UringLoop* loop, UringRecv* recv) {
+    (void)loop;
+    (void)recv;
+    return false;
+}
+
+bool uring_loop_watch(UringLoop* loop, int fd, void* owner) {
+    (void)loop;
+    (void)fd;
+    (void)owner;
+    return false;
+}
+
+bool uring_loop_sendmsg(UringLoop* loop, int fd, const struct iovec* iov, int count, void* owner) {
+    (void)loop;
+    (void)fd;
+    (void)iov;
+    (void)count;
+    (void)owner;
+    return false;
+}
+
+int uring_loop_run_once(UringLoop* loop, int timeout_ms) {
+    (void)loop;
+    (void)timeout_ms;
+    return -1;
+}
+
+void* uring_loop_get_data(UringLoop* loop) {
+    (void)loop;
+    return NULL;
+}
+
+#endif /* __linux__ */
@@ -0,0 +1,67 @@
+/*
+ * Luminous Locus io_uring Backend Header
+ */
+
+#ifndef URING_H
+#define URING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+/* Ring sizing */
+#define URING_DEFAULT_ENTRIES 1024
+#define URING_BUFFER_COUNT 1024   /* provided buffers, power of two */
+#define URING_BUFFER_SIZE 4096
+
+/* io_uring loop */
+typedef struct UringLoop UringLoop;
+
+/* Multishot recv of one connection, owned by the loop until OnClosed */
+typedef struct UringRecv UringRecv;
+
+/* Completion callbacks */
+typedef struct UringCallbacks {
+    /* New connection accepted on the listening socket */
+    void (*OnAccept)(UringLoop* loop, int fd);
+    /* Data received for a connection armed with uring_loop_recv, false pauses the recv and holds the data */
+    bool (*OnRecv)(UringLoop* loop, void* owner, const char* data, size_t length);
+    /* Connection hit EOF or an error, no more completions follow for owner */
+    void (*OnClosed)(UringLoop* loop, void* owner);
+    /* fd armed with uring_loop_watch became readable */
+    void (*OnReady)(UringLoop* loop, void* owner);
+    /* Send queued with uring_loop_sendmsg finished, result is bytes written or -errno */
+    void (*OnSent)(UringLoop* loop, void* owner, int result);
+} UringCallbacks;
+
+/* Create loop, returns NULL when the kernel lacks the needed features */
+UringLoop* uring_loop_create(unsigned entries, const UringCallbacks* callbacks, void* data);
+
+/* Free loop */
+void uring_loop_free(UringLoop* loop);
+
+/* Arm multishot accept on a listening socket */
+bool uring_loop_accept(UringLoop* loop, int listen_fd);
+
+/* Arm multishot recv into the provided-buffer ring, NULL on failure */
+UringRecv* uring_loop_recv(UringLoop* loop, int fd, void* owner);
+
+/* Stop receiving until resumed, completions already queued are still delivered */
+void uring_loop_pause_recv(UringLoop* loop, UringRecv* recv);
+
+/* Deliver held data and receive again after a pause, false when the recv cannot be re-armed */
+bool uring_loop_resume_recv(UringLoop* loop, UringRecv* recv);
+
+/* Watch fd for readability (wakeup eventfds and the like) */
+bool uring_loop_watch(UringLoop* loop, int fd, void* owner);
+
+/* Queue one gather send, OnSent reports the bytes written; iov is copied, the data it points at is not */
+bool uring_loop_sendmsg(UringLoop* loop, int fd, const struct iovec* iov, int count, void* owner);
+
+/* Submit queued work, wait for completions and dispatch them */
+int uring_loop_run_once(UringLoop* loop, int timeout_ms);
+
+/* Loop user data */
+void* uring_loop_get_data(UringLoop* loop);
+
+#endif /* URING_H */
@@ -0,0 +1,282 @@
+/*
+ * Luminous Locus Write Queue Module
+ * Per-connection outbound queue flushed with scatter-gather writes
+ *
+ * Senders only append; the owning loop flushes when the socket is
+ * writable. A partial write leaves HeadOffset pointing into the first
+ * chunk, so the next flush resumes exactly where the kernel stopped.
+ * Shared frames are queued by reference through a small per-queue cache
+ * of chunk nodes, so steady fan-out neither allocates nor copies.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include "frame.h"
+#include "shared_frame.h"
+#include "write_queue.h"
+
+#ifndef MSG_NOSIGNAL
+    #define MSG_NOSIGNAL 0
+#endif
+
+/* Reference chunks kept around per queue */
+#define WRITE_QUEUE_MAX_SPARE 16
+
+struct WriteChunk {
+    WriteChunk* Next;
+    const char* Data;
+    size_t Length;
+    SharedFrame* Shared;  /* referenced frame, NULL when Data points at Inline */
+    char Inline[];
+};
+
+/* Append chunk and account for it */
+static void write_queue_link(WriteQueue* queue, WriteChunk* chunk) {
+    chunk->Next = NULL;
+    if (queue->Tail != NULL) {
+        queue->Tail->Next = chunk;
+    } else {
+        queue->Head = chunk;
+    }
+    queue->Tail = chunk;
+    queue->Bytes += chunk->Length;
+}
+
+/* Allocate a chunk owning a copy of length bytes */
+static WriteChunk* write_queue_reserve(WriteQueue* queue, size_t length) {
+    if (queue->Bytes + length > queue->HighWater) {
+        return NULL;
+    }
+    WriteChunk* chunk = (WriteChunk*)malloc(sizeof(WriteChunk) + length);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    chunk->Data = chunk->Inline;
+    chunk->Length = length;
+    chunk->Shared = NULL;
+    write_queue_link(queue, chunk);
+    return chunk;
+}
+
+/* Free head chunk */
+static void write_queue_pop(WriteQueue* queue) {
+    WriteChunk* chunk = queue->Head;
+    queue->Head = chunk->Next;
+    if (queue->Head == NULL) {
+        queue->Tail = NULL;
+    }
+    queue->HeadOffset = 0;
+
+    if (chunk->Shared != NULL) {
+        shared_frame_release(chunk->Shared);
+        if (queue->SpareCount < WRITE_QUEUE_MAX_SPARE) {
+            chunk->Next = queue->Spare;
+            queue->Spare = chunk;
+            queue->SpareCount++;
+            return;
+        }
+    }
+    free(chunk);
+}
+
+/* Init queue */
+void write_queue_init(WriteQueue* queue, size_t high_water) {
+    if (queue != NULL) {
+        queue->Head = NULL;
+        queue->Tail = NULL;
+        queue->HeadOffset = 0;
+        queue->Bytes = 0;
+        queue->HighWater = high_water > 0 ? high_water : WRITE_QUEUE_DEFAULT_HIGH_WATER;
+        queue->Spare = NULL;
+        queue->SpareCount = 0;
+    }
+}
+
+/* Destroy queue */
+void write_queue_destroy(WriteQueue* queue) {
+    if (queue != NULL) {
+        while (queue->Head != NULL) {
+            write_queue_pop(queue);
+        }
+        while (queue->Spare != NULL) {
+            WriteChunk* next = queue->Spare->Next;
+            free(queue->Spare);
+            queue->Spare = next;
+        }
+        queue->SpareCount = 0;
+        queue->Bytes = 0;
+    }
+}
+
+/* Push bytes */
+bool write_queue_push(WriteQueue* queue, const void* data, size_t length) {
+    if (queue == NULL) {
+        return false;
+    }
+    if (length == 0) {
+        return true;
+    }
+    WriteChunk* chunk = write_queue_reserve(queue, length);
+    if (chunk == NULL) {
+        return false;
+    }
+    memcpy(chunk->Inline, data, length);
+    return true;
+}
+
+/* Push frame */
+bool write_queue_push_frame(WriteQueue* queue, uint32_t kind, const void* body, uint32_t length) {
+    if (queue == NULL) {
+        return false;
+    }
+    WriteChunk* chunk = write_queue_reserve(queue, FRAME_HEADER_SIZE + (size_t)length);
+    if (chunk == NULL) {
+        return false;
+    }
+    frame_write_header(chunk->Inline, kind, length);
+    if (length > 0) {
+        memcpy(chunk->Inline + FRAME_HEADER_SIZE, body, length);
+    }
+    return true;
+}
+
+/* Push shared frame */
+bool write_queue_push_shared(WriteQueue* queue, SharedFrame* frame) {
+    if (queue == NULL || frame == NULL) {
+        return false;
+    }
+    size_t length = shared_frame_length(frame);
+    if (queue->Bytes + length > queue->HighWater) {
+        return false;
+    }
+
+    WriteChunk* chunk = queue->Spare;
+    if (chunk != NULL) {
+        queue->Spare = chunk->Next;
+        queue->SpareCount--;
+    } else {
+        chunk = (WriteChunk*)malloc(sizeof(WriteChunk));
+        if (chunk == NULL) {
+            return false;
+        }
+    }
+    chunk->Data = shared_frame_data(frame);
+    chunk->Length = length;
+    chunk->Shared = shared_frame_retain(frame);
+    write_queue_link(queue, chunk);
+    return true;
+}
+
+/* Discard unsent chunks */
+void write_queue_discard(WriteQueue* queue) {
+    if (queue == NULL || queue->Head == NULL) {
+        return;
+    }
+    WriteChunk* keep = NULL;
+    size_t offset = queue->HeadOffset;
+    if (offset > 0) {
+        /* Cutting a frame in half would desync the peer */
+        keep = queue->Head;
+        queue->Head = keep->Next;
+    }
+    while (queue->Head != NULL) {
+        write_queue_pop(queue);
+    }
+    /* Popping stops short of a kept head that was also the tail */
+    queue->Tail = NULL;
+    queue->Bytes = 0;
+    queue->HeadOffset = 0;
+    if (keep != NULL) {
+        write_queue_link(queue, keep);
+        queue->Bytes -= offset;
+        queue->HeadOffset = offset;
+    }
+}
+
+/* Gather iovecs */
+int write_queue_gather(const WriteQueue* queue, struct iovec* iov, int max) {
+    int count = 0;
+    if (queue == NULL) {
+        return 0;
+    }
+    size_t offset = queue->HeadOffset;
+    for (WriteChunk* chunk = queue->Head; chunk != NULL && count < max; chunk = chunk->Next) {
+        iov[count].iov_base = (void*)(chunk->Data + offset);
+        iov[count].iov_len = chunk->Length - offset;
+        offset = 0;
+        count++;
+    }
+    return count;
+}
+
+/* Retire written bytes, remember where a partial chunk stopped */
+void write_queue_advance(WriteQueue* queue, size_t written) {
+    if (queue == NULL || written > queue->Bytes) {
+        return;
+    }
+    queue->Bytes -= written;
+    while (written > 0) {
+        size_t remaining = queue->Head->Length - queue->HeadOffset;
+        if (written < remaining) {
+            queue->HeadOffset += written;
+            break;
+        }
+        written -= remaining;
+        write_queue_pop(queue);
+    }
+}
+
+/* Flush queue */
+enum WriteQueueResult write_queue_flush(WriteQueue* queue, int fd, size_t* written) {
+    size_t total = 0;
+    enum WriteQueueResult result = WRITE_QUEUE_DONE;
+
+    while (queue != NULL && queue->Head != NULL) {
+        struct iovec iov[WRITE_QUEUE_MAX_IOV];
+        int count = write_queue_gather(queue, iov, WRITE_QUEUE_MAX_IOV);
+
+        /* sendmsg is writev that can suppress SIGPIPE */
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)count;
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = (errno == EAGAIN || errno == EWOULDBLOCK) ? WRITE_QUEUE_PENDING : WRITE_QUEUE_ERROR;
+            break;
+        }
+
+        total += (size_t)sent;
+        write_queue_advance(queue, (size_t)sent);
+
+        if (queue->Head != NULL && count < WRITE_QUEUE_MAX_IOV) {
+            /* Short write with the whole queue offered, the socket is full */
+            result = WRITE_QUEUE_PENDING;
+            break;
+        }
+    }
+
+    if (written != NULL) {
+        *written = total;
+    }
+    return result;
+}
+
+/* Get queued bytes */
+size_t write_queue_bytes(const WriteQueue* queue) {
+    return queue != NULL ? queue->Bytes : 0;
+}
+
+/* Check if queue is empty */
+bool write_queue_empty(const WriteQueue* queue) {
+    return queue == NULL || queue->Head == NULL;
+}
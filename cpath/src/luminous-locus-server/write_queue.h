@@ -0,0 +1,70 @@
+/*
+ * Luminous Locus Write Queue Header
+ */
+
+#ifndef WRITE_QUEUE_H
+#define WRITE_QUEUE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/uio.h>
+#include "shared_frame.h"
+
+/* Default cap on queued bytes per connection, fits the largest message */
+#define WRITE_QUEUE_DEFAULT_HIGH_WATER (4 * 1024 * 1024)
+
+/* Chunks handed to one writev call */
+#define WRITE_QUEUE_MAX_IOV 64
+
+/* Flush result */
+enum WriteQueueResult {
+    WRITE_QUEUE_DONE,     /* everything written */
+    WRITE_QUEUE_PENDING,  /* socket full, wait for writability */
+    WRITE_QUEUE_ERROR     /* peer gone or socket error */
+};
+
+/* One queued buffer */
+typedef struct WriteChunk WriteChunk;
+
+/* Pending output of one connection */
+typedef struct WriteQueue {
+    WriteChunk* Head;
+    WriteChunk* Tail;
+    size_t HeadOffset;    /* bytes of Head already written */
+    size_t Bytes;         /* unwritten bytes across all chunks */
+    size_t HighWater;
+    WriteChunk* Spare;    /* recycled reference chunks */
+    int SpareCount;
+} WriteQueue;
+
+/* Init queue, 0 selects the default high-water mark */
+void write_queue_init(WriteQueue* queue, size_t high_water);
+
+/* Drop everything queued */
+void write_queue_destroy(WriteQueue* queue);
+
+/* Copy bytes onto the queue, false when it would pass the high-water mark */
+bool write_queue_push(WriteQueue* queue, const void* data, size_t length);
+
+/* Queue a protocol v2 frame, header and body in one chunk */
+bool write_queue_push_frame(WriteQueue* queue, uint32_t kind, const void* body, uint32_t length);
+
+/* Queue a reference to a shared frame, no copy */
+bool write_queue_push_shared(WriteQueue* queue, SharedFrame* frame);
+
+/* Drop queued chunks, keeps a partially written head so the stream stays framed */
+void write_queue_discard(WriteQueue* queue);
+
+/* Write as much as the non-blocking socket takes */
+enum WriteQueueResult write_queue_flush(WriteQueue* queue, int fd, size_t* written);
+
+/* Describe unwritten data for an external send, then retire what it wrote */
+int write_queue_gather(const WriteQueue* queue, struct iovec* iov, int max);
+void write_queue_advance(WriteQueue* queue, size_t written);
+
+/* Unwritten bytes */
+size_t write_queue_bytes(const WriteQueue* queue);
+bool write_queue_empty(const WriteQueue* queue);
+
+#endif /* WRITE_QUEUE_H */